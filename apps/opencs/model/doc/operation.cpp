@@ -1,15 +1,60 @@
 #include "operation.hpp"
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
 #include <QTimer>
+#include <QThread>
+#include <QRunnable>
+#include <QAtomicInt>
 
 #include "../world/universalid.hpp"
 
 #include "state.hpp"
 #include "stage.hpp"
 
+namespace
+{
+    class ParallelSteps : public QRunnable
+    {
+            CSMDoc::Stage& mStage;
+            int mFirstStep;
+            std::vector<CSMDoc::Messages>& mMessages;
+            std::vector<std::string>& mErrors;
+            QAtomicInt& mNext;
+
+        public:
+
+            ParallelSteps (CSMDoc::Stage& stage, int firstStep,
+                std::vector<CSMDoc::Messages>& messages, std::vector<std::string>& errors,
+                QAtomicInt& next)
+            : mStage (stage), mFirstStep (firstStep), mMessages (messages), mErrors (errors),
+              mNext (next)
+            {}
+
+            virtual void run()
+            {
+                int size = static_cast<int> (mMessages.size());
+
+                for (int i = mNext.fetchAndAddOrdered (1); i<size; i = mNext.fetchAndAddOrdered (1))
+                {
+                    try
+                    {
+                        mStage.perform (mFirstStep + i, mMessages[i]);
+                    }
+                    catch (const std::exception& e)
+                    {
+                        mErrors[i] = e.what();
+
+                        if (mErrors[i].empty())
+                            mErrors[i] = "unknown error";
+                    }
+                }
+            }
+    };
+}
+
 void CSMDoc::Operation::prepareStages()
 {
     mCurrentStage = mStages.begin();
@@ -32,6 +77,8 @@ CSMDoc::Operation::Operation (int type, bool ordered, bool finalAlways)
   mDefaultSeverity (Message::Severity_Error)
 {
     mTimer = new QTimer (this);
+    mThreadPool = new QThreadPool (this);
+    mThreadPool->setMaxThreadCount (1);
 }
 
 CSMDoc::Operation::~Operation()
@@ -65,6 +112,14 @@ void CSMDoc::Operation::setDefaultSeverity (Message::Severity severity)
     mDefaultSeverity = severity;
 }
 
+void CSMDoc::Operation::setThreads (int threads)
+{
+    if (threads<=0)
+        threads = QThread::idealThreadCount();
+
+    mThreadPool->setMaxThreadCount (std::max (threads, 1));
+}
+
 bool CSMDoc::Operation::hasError() const
 {
     return mError;
@@ -106,6 +161,11 @@ void CSMDoc::Operation::executeStage()
             mCurrentStep = 0;
             ++mCurrentStage;
         }
+        else if (mThreadPool->maxThreadCount()>1 && mCurrentStage->first->isParallel())
+        {
+            performParallel (messages);
+            break;
+        }
         else
         {
             try
@@ -132,6 +192,43 @@ void CSMDoc::Operation::executeStage()
         operationDone();
 }
 
+void CSMDoc::Operation::performParallel (Messages& messages)
+{
+    // Process a limited batch per call, so that progress is reported and abort requests are
+    // handled in between.
+    const int stepsPerThread = 16;
+
+    int threads = mThreadPool->maxThreadCount();
+    int size = std::min (threads * stepsPerThread, mCurrentStage->second - mCurrentStep);
+
+    std::vector<Messages> stepMessages (size, Messages (mDefaultSeverity));
+    std::vector<std::string> errors (size);
+    QAtomicInt next (0);
+
+    for (int i=0; i<std::min (threads, size); ++i)
+        mThreadPool->start (new ParallelSteps (*mCurrentStage->first, mCurrentStep, stepMessages,
+            errors, next));
+
+    mThreadPool->waitForDone();
+
+    // merge in step order, so that the result does not depend on scheduling
+    for (int i=0; i<size; ++i)
+    {
+        for (Messages::Iterator iter (stepMessages[i].begin()); iter!=stepMessages[i].end(); ++iter)
+            messages.add (iter->mId, iter->mMessage, iter->mHint, iter->mSeverity);
+
+        ++mCurrentStep;
+        ++mCurrentStepTotal;
+
+        if (!errors[i].empty())
+        {
+            emit reportMessage (Message (CSMWorld::UniversalId(), errors[i], "", Message::Severity_SeriousError), mType);
+            abort();
+            break;
+        }
+    }
+}
+
 void CSMDoc::Operation::operationDone()
 {
     mTimer->stop();
@@ -6,6 +6,7 @@
 
 #include <QObject>
 #include <QTimer>
+#include <QThreadPool>
 #include <QStringList>
 
 #include "messages.hpp"
@@ -34,11 +35,15 @@ namespace CSMDoc
             bool mError;
             bool mConnected;
             QTimer *mTimer;
+            QThreadPool *mThreadPool;
             bool mPrepared;
             Message::Severity mDefaultSeverity;
 
             void prepareStages();
 
+            void performParallel (Messages& messages);
+            ///< Perform a batch of steps of the current stage on the thread pool.
+
         public:
 
             Operation (int type, bool ordered, bool finalAlways = false);
@@ -55,6 +60,12 @@ namespace CSMDoc
             /// \attention Do no call this function while this Operation is running.
             void setDefaultSeverity (Message::Severity severity);
 
+            /// Set the number of threads used for stages that can be performed in parallel
+            /// (0: one per CPU core).
+            ///
+            /// \attention Do no call this function while this Operation is running.
+            void setThreads (int threads);
+
             bool hasError() const;
 
         signals:
@@ -23,6 +23,12 @@ namespace CSMDoc
 
             virtual void perform (int stage, Messages& messages) = 0;
             ///< Messages resulting from this stage will be appended to \a messages.
+
+            virtual bool isParallel() const;
+            ///< Can the steps of this stage be performed concurrently and in any order?
+            ///
+            /// \note A stage returning true must not modify its own state or the document in
+            /// perform(). Messages are still reported in step order. Default: false.
     };
 }
 
@@ -123,6 +123,10 @@ void CSMPrefs::State::declare()
     declareEnum ("double-s", "Shift Double Click", actionRemove).addValues (reportValues);
     declareEnum ("double-c", "Control Double Click", actionEditAndRemove).addValues (reportValues);
     declareEnum ("double-sc", "Shift Control Double Click", actionNone).addValues (reportValues);
+    declareInt ("verifier-threads", "Verifier threads", 0).
+        setTooltip ("Number of threads used by the verifier for checks that can run in "
+        "parallel (0: one per CPU core).").
+        setRange (0, 64);
 
     declareCategory ("Search & Replace");
     declareInt ("char-before", "Characters before search string", 10).
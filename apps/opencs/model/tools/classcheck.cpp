@@ -66,3 +66,8 @@ void CSMTools::ClassCheckStage::perform (int stage, CSMDoc::Messages& messages)
                 ESM::Skill::indexToId (iter->first) + " is listed more than once"));
         }
 }
+
+bool CSMTools::ClassCheckStage::isParallel() const
+{
+    return true;
+}
@@ -131,3 +131,8 @@ void CSMTools::MagicEffectCheckStage::perform(int stage, CSMDoc::Messages &messa
         messages.push_back(std::make_pair(id, "Description is empty"));
     }
 }
+
+bool CSMTools::MagicEffectCheckStage::isParallel() const
+{
+    return true;
+}
@@ -13,7 +13,6 @@ namespace CSMTools
     class RaceCheckStage : public CSMDoc::Stage
     {
             const CSMWorld::IdCollection<ESM::Race>& mRaces;
-            bool mPlayable;
 
             void performPerRecord (int stage, CSMDoc::Messages& messages);
 
@@ -28,6 +27,8 @@ namespace CSMTools
 
             virtual void perform (int stage, CSMDoc::Messages& messages);
             ///< Messages resulting from this tage will be appended to \a messages.
+
+            virtual bool isParallel() const;
     };
 }
 
@@ -15,8 +15,7 @@ CSMTools::ReferenceableCheckStage::ReferenceableCheckStage(
     mRaces(races),
     mClasses(classes),
     mFactions(faction),
-    mScripts(scripts),
-    mPlayerPresent(false)
+    mScripts(scripts)
 {
 }
 
@@ -227,7 +226,6 @@ void CSMTools::ReferenceableCheckStage::perform (int stage, CSMDoc::Messages& me
 
 int CSMTools::ReferenceableCheckStage::setup()
 {
-    mPlayerPresent = false;
     return mReferencables.getSize() + 1;
 }
 
@@ -626,10 +624,6 @@ void CSMTools::ReferenceableCheckStage::npcCheck (
     //Don't know what unknown is for
     int gold(npc.mNpdt.mGold);
 
-    //Detect if player is present
-    if (Misc::StringUtils::ciEqual(npc.mId, "player")) //Happy now, scrawl?
-        mPlayerPresent = true;
-
     if (npc.mNpdtType == ESM::NPC::NPC_WITH_AUTOCALCULATED_STATS) //12 = autocalculated
     {
         if ((npc.mFlags & ESM::NPC::Autocalc) == 0) //0x0010 = autocalculated flag
@@ -860,7 +854,14 @@ void CSMTools::ReferenceableCheckStage::staticCheck (
 
 void CSMTools::ReferenceableCheckStage::finalCheck (CSMDoc::Messages& messages)
 {
-    if (!mPlayerPresent)
+    // Detect if player is present. Looked up here rather than in npcCheck, so that steps do not
+    // depend on each other.
+    CSMWorld::RefIdData::LocalIndex index = mReferencables.searchId ("player");
+
+    bool playerPresent = index.first!=-1 && index.second==CSMWorld::UniversalId::Type_Npc &&
+        !mReferencables.getRecord (index).isDeleted();
+
+    if (!playerPresent)
         messages.push_back (std::make_pair (CSMWorld::UniversalId::Type_Referenceables,
             "There is no player record"));
 }
@@ -998,3 +999,8 @@ template<typename Tool> void CSMTools::ReferenceableCheckStage::scriptCheck (
             messages.push_back (std::make_pair (someID, someTool.mId + " refers to an unknown script \""+someTool.mScript+"\""));
     }
 }
+
+bool CSMTools::ReferenceableCheckStage::isParallel() const
+{
+    return true;
+}
@@ -102,3 +102,8 @@ int CSMTools::ReferenceCheckStage::setup()
 {
     return mReferences.getSize();
 }
+
+bool CSMTools::ReferenceCheckStage::isParallel() const
+{
+    return true;
+}
@@ -42,3 +42,8 @@ void CSMTools::RegionCheckStage::perform (int stage, CSMDoc::Messages& messages)
 
     /// \todo check data members that can't be edited in the table view
 }
+
+bool CSMTools::RegionCheckStage::isParallel() const
+{
+    return true;
+}
@@ -6,6 +6,8 @@
 #include "../doc/operation.hpp"
 #include "../doc/document.hpp"
 
+#include "../prefs/state.hpp"
+
 #include "../world/data.hpp"
 #include "../world/universalid.hpp"
 
@@ -184,7 +186,9 @@ CSMWorld::UniversalId CSMTools::Tools::runVerifier (const CSMWorld::UniversalId&
 
     mActiveReports[CSMDoc::State_Verifying] = reportNumber;
 
-    getVerifier()->start();
+    CSMDoc::OperationHolder *verifier = getVerifier();
+    mVerifierOperation->setThreads (CSMPrefs::get()["Reports"]["verifier-threads"].toInt());
+    verifier->start();
 
     return CSMWorld::UniversalId (CSMWorld::UniversalId::Type_VerificationResults, reportNumber);
 }
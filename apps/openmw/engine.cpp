@@ -1,5 +1,6 @@
 #include "engine.hpp"
 
+#include <algorithm>
 #include <iomanip>
 
 #include <boost/filesystem/fstream.hpp>
@@ -20,11 +21,15 @@
 
 #include <components/resource/resourcesystem.hpp>
 #include <components/resource/scenemanager.hpp>
+#include <components/resource/imagemanager.hpp>
 #include <components/resource/stats.hpp>
 
 #include <components/compiler/extensions0.hpp>
 
 #include <components/sceneutil/workqueue.hpp>
+#include <components/sceneutil/jobsystem.hpp>
+
+#include <components/nifosg/nifloader.hpp>
 
 #include <components/files/configurationmanager.hpp>
 
@@ -69,12 +74,16 @@ void OMW::Engine::executeLocalScripts()
 {
     MWWorld::LocalScripts& localScripts = mEnvironment.getWorld()->getLocalScripts();
 
-    localScripts.startIteration();
+    osg::Vec3f viewPosition = mEnvironment.getWorld()->getPlayerPtr().getRefData().getPosition().asVec3();
+
+    localScripts.startIteration(mEnvironment.getFrameDuration(), viewPosition);
     std::pair<std::string, MWWorld::Ptr> script;
-    while (localScripts.getNext(script))
+    float secondsPassed = 0;
+    while (localScripts.getNext(script, secondsPassed))
     {
         MWScript::InterpreterContext interpreterContext (
             &script.second.getRefData().getLocals(), script.second);
+        interpreterContext.setSecondsPassed(secondsPassed);
         mEnvironment.getScriptManager()->run (script.first, interpreterContext);
     }
 }
@@ -182,8 +191,8 @@ bool OMW::Engine::frame(float frametime)
         {
             mResourceSystem->reportStats(frameNumber, stats);
 
-            stats->setAttribute(frameNumber, "WorkQueue", mWorkQueue->getNumItems());
-            stats->setAttribute(frameNumber, "WorkThread", mWorkQueue->getNumActiveThreads());
+            mWorkQueue->reportStats(frameNumber, stats);
+            mJobSystem->reportStats(frameNumber, stats);
         }
 
     }
@@ -236,7 +245,11 @@ OMW::Engine::~Engine()
     delete mScriptContext;
     mScriptContext = NULL;
 
+    if (mResourceSystem)
+        mResourceSystem->getImageManager()->setWorkQueue(NULL);
     mWorkQueue = NULL;
+    mJobSystem = NULL;
+    NifOsg::Loader::setWorkQueue(NULL);
 
     mResourceSystem.reset();
 
@@ -456,11 +469,31 @@ void OMW::Engine::prepareEngine (Settings::Manager & settings)
         Settings::Manager::getString("texture mipmap", "General"),
         Settings::Manager::getInt("anisotropy", "General")
     );
+    if (Settings::Manager::getBool("model disk cache", "Cells"))
+        mResourceSystem->getSceneManager()->setDiskCachePath((mCfgMgr.getCachePath() / "models").string());
+
+    Resource::ImageManager* imageManager = mResourceSystem->getImageManager();
+    imageManager->setProcessing(Settings::Manager::getBool("texture cpu mipmaps", "General"),
+                                Settings::Manager::getBool("texture compression", "General"));
+    if (Settings::Manager::getBool("texture disk cache", "General"))
+        imageManager->setDiskCachePath((mCfgMgr.getCachePath() / "textures").string());
+    if (Settings::Manager::getBool("texture streaming", "General"))
+        imageManager->setTextureStreaming(std::max(1, Settings::Manager::getInt("texture streaming min size", "General")),
+                                          static_cast<size_t>(std::max(0, Settings::Manager::getInt("texture streaming budget", "General"))) * 1024 * 1024);
 
     int numThreads = Settings::Manager::getInt("preload num threads", "Cells");
     if (numThreads <= 0)
         throw std::runtime_error("Invalid setting: 'preload num threads' must be >0");
-    mWorkQueue = new SceneUtil::WorkQueue(numThreads);
+    int ioThreads = std::max(0, Settings::Manager::getInt("preload io threads", "Cells"));
+    mWorkQueue = new SceneUtil::WorkQueue(numThreads, ioThreads);
+    imageManager->setWorkQueue(mWorkQueue);
+
+    // the main thread takes part in running the jobs of a frame
+    mJobSystem = new SceneUtil::JobSystem(std::max(0, Settings::Manager::getInt("job threads", "General")));
+
+    int modelThreads = Settings::Manager::getInt("model loading threads", "Cells");
+    if (modelThreads > 0)
+        NifOsg::Loader::setWorkQueue(new SceneUtil::WorkQueue(modelThreads));
 
     // Create input and UI first to set up a bootstrapping environment for
     // showing a loading screen and keeping the window responsive while doing so
@@ -524,9 +557,10 @@ void OMW::Engine::prepareEngine (Settings::Manager & settings)
     }
 
     // Create the world
-    mEnvironment.setWorld( new MWWorld::World (mViewer, rootNode, mResourceSystem.get(), mWorkQueue.get(),
+    mEnvironment.setWorld( new MWWorld::World (mViewer, rootNode, mResourceSystem.get(), mWorkQueue.get(), mJobSystem.get(),
         mFileCollections, mContentFiles, mEncoder, mFallbackMap,
-        mActivationDistanceOverride, mCellName, mStartupScript, mResDir.string(), mCfgMgr.getUserDataPath().string()));
+        mActivationDistanceOverride, mCellName, mStartupScript, mResDir.string(), mCfgMgr.getUserDataPath().string(),
+        mCfgMgr.getCachePath().string()));
     mEnvironment.getWorld()->setupPlayer();
     input->setPlayer(&mEnvironment.getWorld()->getPlayer());
 
@@ -545,7 +579,7 @@ void OMW::Engine::prepareEngine (Settings::Manager & settings)
     mScriptContext->setExtensions (&mExtensions);
 
     mEnvironment.setScriptManager (new MWScript::ScriptManager (mEnvironment.getWorld()->getStore(), *mScriptContext, mWarningsMode,
-        mScriptBlacklistUse ? mScriptBlacklist : std::vector<std::string>()));
+        mScriptBlacklistUse ? mScriptBlacklist : std::vector<std::string>(), mCfgMgr.getUserDataPath().string()));
 
     // Create game mechanics system
     MWMechanics::MechanicsManager* mechanics = new MWMechanics::MechanicsManager;
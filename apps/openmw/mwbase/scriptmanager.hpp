@@ -1,6 +1,8 @@
 #ifndef GAME_MWBASE_SCRIPTMANAGER_H
 #define GAME_MWBASE_SCRIPTMANAGER_H
 
+#include <cstddef>
+#include <iosfwd>
 #include <string>
 
 namespace Interpreter
@@ -50,6 +52,21 @@ namespace MWBase
             ///< Return locals for script \a name.
 
             virtual MWScript::GlobalScripts& getGlobalScripts() = 0;
+
+            virtual bool toggleProfiling() = 0;
+            ///< Enable/disable collection of script execution statistics. Enabling discards
+            /// previously collected statistics.
+            /// \return Profiling enabled?
+
+            virtual bool isProfiling() const = 0;
+
+            virtual void reportProfile (std::ostream& stream, std::size_t maxEntries = 0) const = 0;
+            ///< Write collected script execution statistics to \a stream.
+            /// \param maxEntries Limit for the number of scripts and opcodes listed (0: unlimited)
+
+            virtual std::string writeProfile() const = 0;
+            ///< Write collected script execution statistics to a file in the user data directory.
+            /// \return File name
    };
 }
 
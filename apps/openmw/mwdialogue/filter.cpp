@@ -183,23 +183,20 @@ bool MWDialogue::Filter::testFunctionLocal(const MWDialogue::SelectWrapper& sele
     const Compiler::Locals& localDefs =
         MWBase::Environment::get().getScriptManager()->getLocals (scriptName);
 
-    char type = localDefs.getType (name);
+    char type;
+    int index;
 
-    if (type==' ')
+    if (!localDefs.lookup (name, type, index))
         return false; // script does not have a variable of this name.
 
-    int index = localDefs.getIndex (name);
-    if (index < 0)
-        return false; // shouldn't happen, we checked that variable has a type above, so must exist
-
     const MWScript::Locals& locals = mActor.getRefData().getLocals();
     if (locals.isEmpty())
         return select.selectCompare(0);
     switch (type)
     {
-        case 's': return select.selectCompare (static_cast<int> (locals.mShorts[index]));
-        case 'l': return select.selectCompare (locals.mLongs[index]);
-        case 'f': return select.selectCompare (locals.mFloats[index]);
+        case 's': return select.selectCompare (locals.getShort (index));
+        case 'l': return select.selectCompare (locals.getLong (index));
+        case 'f': return select.selectCompare (locals.getFloat (index));
     }
 
     throw std::logic_error ("unknown local variable type in dialogue filter");
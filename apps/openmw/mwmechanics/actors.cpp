@@ -2,6 +2,7 @@
 
 #include <typeinfo>
 #include <iostream>
+#include <cmath>
 
 #include <components/esm/esmreader.hpp>
 #include <components/esm/esmwriter.hpp>
@@ -1320,6 +1321,8 @@ namespace MWMechanics
 
             // Animation/movement update
             CharacterController* playerCharacter = NULL;
+            static const float animationLodDistance = Settings::Manager::getFloat("animation lod distance", "General");
+            static const int animationLodMaxInterval = Settings::Manager::getInt("animation lod max interval", "General");
             for(PtrActorMap::iterator iter(mActors.begin()); iter != mActors.end(); ++iter)
             {
                 const float animationDistance = aiProcessingDistance + 400; // Slightly larger than AI distance so there is time to switch back to the idle animation.
@@ -1339,6 +1342,19 @@ namespace MWMechanics
                 }
                 iter->second->getCharacterController()->setActive(active);
 
+                if (animationLodMaxInterval > 1 && animationLodDistance > 0.f)
+                {
+                    // Update the bones of distant actors less often. Larger actors stay detailed for longer, as they cover more of the screen.
+                    unsigned int interval = 1;
+                    if (!isPlayer)
+                    {
+                        float scale = std::max(iter->first.getCellRef().getScale(), 0.01f);
+                        float distance = std::sqrt(distSqr) / scale;
+                        interval = static_cast<unsigned int>(std::min(1.f + distance / animationLodDistance, static_cast<float>(animationLodMaxInterval)));
+                    }
+                    iter->second->getCharacterController()->setUpdateInterval(interval);
+                }
+
                 if (!inAnimationRange)
                     continue;
 
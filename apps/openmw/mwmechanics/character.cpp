@@ -2395,6 +2395,11 @@ void CharacterController::setActive(int active)
     mAnimation->setActive(active);
 }
 
+void CharacterController::setUpdateInterval(unsigned int interval)
+{
+    mAnimation->setUpdateInterval(interval);
+}
+
 void CharacterController::setHeadTrackTarget(const MWWorld::ConstPtr &target)
 {
     mHeadTrackTarget = target;
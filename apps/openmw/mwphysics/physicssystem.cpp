@@ -1,5 +1,6 @@
 #include "physicssystem.hpp"
 
+#include <functional>
 #include <iostream>
 #include <stdexcept>
 
@@ -24,6 +25,7 @@
 #include <components/esm/loadgmst.hpp>
 #include <components/sceneutil/positionattitudetransform.hpp>
 #include <components/sceneutil/unrefqueue.hpp>
+#include <components/sceneutil/jobsystem.hpp>
 
 #include <components/nifosg/particle.hpp> // FindRecIndexVisitor
 
@@ -61,6 +63,9 @@ namespace MWPhysics
     // Arbitrary number. To prevent infinite loops. They shouldn't happen but it's good to be prepared.
     static const int sMaxIterations = 8;
 
+    // Animated objects to update per job, as updating a single object is too little work to be worth a job of its own.
+    static const unsigned int sAnimatedObjectsPerJob = 4;
+
     static bool isActor(const btCollisionObject *obj)
     {
         assert(obj);
@@ -616,7 +621,10 @@ namespace MWPhysics
             return !mShapeInstance->mAnimatedShapes.empty();
         }
 
-        void animateCollisionShapes(btCollisionWorld* collisionWorld)
+        /// Move the animated parts of the collision shape along with the scene graph.
+        /// @note Only changes the object itself, so different objects may be animated in parallel. The bounding box in the
+        /// collision world is left for the caller to update.
+        void animateCollisionShapes()
         {
             if (mShapeInstance->mAnimatedShapes.empty())
                 return;
@@ -661,8 +669,6 @@ namespace MWPhysics
                 if (!(transform == compound->getChildTransform(shapeIndex)))
                     compound->updateChildTransform(shapeIndex, transform);
             }
-
-            collisionWorld->updateSingleAabb(mCollisionObject.get());
         }
 
     private:
@@ -744,6 +750,11 @@ namespace MWPhysics
         mUnrefQueue = unrefQueue;
     }
 
+    void PhysicsSystem::setJobSystem(SceneUtil::JobSystem *jobSystem)
+    {
+        mJobSystem = jobSystem;
+    }
+
     Resource::BulletShapeManager *PhysicsSystem::getShapeManager()
     {
         return mShapeManager.get();
@@ -1453,8 +1464,21 @@ namespace MWPhysics
 
     void PhysicsSystem::stepSimulation(float dt)
     {
-        for (std::set<Object*>::iterator it = mAnimatedObjects.begin(); it != mAnimatedObjects.end(); ++it)
-            (*it)->animateCollisionShapes(mCollisionWorld);
+        mAnimatingObjects.assign(mAnimatedObjects.begin(), mAnimatedObjects.end());
+
+        std::function<void(unsigned int, unsigned int)> animate = [this] (unsigned int begin, unsigned int end)
+        {
+            for (unsigned int i=begin; i<end; ++i)
+                mAnimatingObjects[i]->animateCollisionShapes();
+        };
+        if (mJobSystem)
+            mJobSystem->parallelFor(mAnimatingObjects.size(), animate, sAnimatedObjectsPerJob);
+        else
+            animate(0, mAnimatingObjects.size());
+
+        // the broadphase is shared by all objects
+        for (std::vector<Object*>::iterator it = mAnimatingObjects.begin(); it != mAnimatingObjects.end(); ++it)
+            mCollisionWorld->updateSingleAabb((*it)->getCollisionObject());
 
 #ifndef BT_NO_PROFILE
         CProfileManager::Reset();
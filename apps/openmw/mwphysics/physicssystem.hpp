@@ -32,6 +32,7 @@ namespace Resource
 namespace SceneUtil
 {
     class UnrefQueue;
+    class JobSystem;
 }
 
 class btCollisionWorld;
@@ -57,6 +58,9 @@ namespace MWPhysics
 
             void setUnrefQueue(SceneUtil::UnrefQueue* unrefQueue);
 
+            /// Set the job system to spread the per-frame work over, if any.
+            void setJobSystem(SceneUtil::JobSystem* jobSystem);
+
             Resource::BulletShapeManager* getShapeManager();
 
             void enableWater(float height);
@@ -175,6 +179,7 @@ namespace MWPhysics
             void updateWater();
 
             osg::ref_ptr<SceneUtil::UnrefQueue> mUnrefQueue;
+            osg::ref_ptr<SceneUtil::JobSystem> mJobSystem;
 
             btBroadphaseInterface* mBroadphase;
             btDefaultCollisionConfiguration* mCollisionConfiguration;
@@ -188,6 +193,7 @@ namespace MWPhysics
             ObjectMap mObjects;
 
             std::set<Object*> mAnimatedObjects; // stores pointers to elements in mObjects
+            std::vector<Object*> mAnimatingObjects; // mAnimatedObjects as a list to split among jobs, kept around to avoid allocations
 
             typedef std::map<MWWorld::ConstPtr, Actor*> ActorMap;
             ActorMap mActors;
@@ -1,6 +1,7 @@
 #include "animation.hpp"
 
 #include <iomanip>
+#include <cmath>
 #include <limits>
 
 #include <osg/TexGen>
@@ -492,6 +493,12 @@ namespace MWRender
             mSkeleton->setActive(static_cast<SceneUtil::Skeleton::ActiveType>(active));
     }
 
+    void Animation::setUpdateInterval(unsigned int interval)
+    {
+        if (mSkeleton)
+            mSkeleton->setUpdateInterval(interval);
+    }
+
     void Animation::updatePtr(const MWWorld::Ptr &ptr)
     {
         mPtr = ptr;
@@ -1634,9 +1641,9 @@ namespace MWRender
 
     float Animation::AnimationTime::getValue(osg::NodeVisitor*)
     {
-        if (mTimePtr)
-            return *mTimePtr;
-        return 0.f;
+        if (!mTimePtr)
+            return 0.f;
+        return *mTimePtr;
     }
 
     float EffectAnimationTime::getValue(osg::NodeVisitor*)
@@ -350,6 +350,10 @@ public:
     /// 0 = Inactive, 1 = Active in place, 2 = Active
     void setActive(int active);
 
+    /// Only update the bones every \a interval frames and interpolate in between, 1 to update every frame.
+    /// @see SceneUtil::Skeleton::setUpdateInterval
+    void setUpdateInterval(unsigned int interval);
+
     osg::Group* getOrCreateObjectRoot();
 
     osg::Group* getObjectRoot();
@@ -0,0 +1,436 @@
+#include "distantobjects.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#include <osg/Stats>
+#include <osg/Transform>
+
+#include <osgUtil/IncrementalCompileOperation>
+
+#include <components/esm/esmreader.hpp>
+#include <components/esm/loadcell.hpp>
+#include <components/esm/loadstat.hpp>
+#include <components/misc/stringops.hpp>
+#include <components/resource/objectcache.hpp>
+#include <components/resource/scenemanager.hpp>
+#include <components/sceneutil/lightmanager.hpp>
+#include <components/sceneutil/staticbatch.hpp>
+#include <components/sceneutil/workqueue.hpp>
+#include <components/vfs/manager.hpp>
+
+#include "../mwbase/environment.hpp"
+#include "../mwbase/world.hpp"
+#include "../mwworld/esmstore.hpp"
+
+#include "vismask.hpp"
+
+namespace
+{
+
+    struct CellObjects
+    {
+        int mX;
+        int mY;
+        osg::ref_ptr<osg::Node> mNode;
+    };
+
+    /// Reads the statics of a chunk's cells from the content files and merges them.
+    class ChunkLoader : public SceneUtil::WorkItem
+    {
+    public:
+        ChunkLoader(Resource::SceneManager* sceneManager, ToUTF8::Utf8Encoder* encoder, float cellWorldSize, float size,
+                    const osg::Vec2f& center, float minRadius)
+            : mSceneManager(sceneManager)
+            , mEncoder(encoder)
+            , mCellWorldSize(cellWorldSize)
+            , mSize(size)
+            , mCenter(center)
+            , mMinRadius(minRadius)
+            , mAborted(0)
+        {
+        }
+
+        virtual void doWork()
+        {
+            const MWWorld::ESMStore& store = MWBase::Environment::get().getWorld()->getStore();
+
+            int minX = static_cast<int>(std::floor(mCenter.x() - mSize/2.f));
+            int minY = static_cast<int>(std::floor(mCenter.y() - mSize/2.f));
+            int numCells = static_cast<int>(mSize);
+
+            for (int x = minX; x < minX + numCells; ++x)
+            {
+                for (int y = minY; y < minY + numCells; ++y)
+                {
+                    if (mAborted)
+                        return;
+
+                    const ESM::Cell* cell = store.get<ESM::Cell>().search(x, y);
+                    if (!cell)
+                        continue;
+
+                    osg::ref_ptr<osg::Node> node = loadCell(*cell, store);
+                    if (!node)
+                        continue;
+
+                    CellObjects objects;
+                    objects.mX = x;
+                    objects.mY = y;
+                    objects.mNode = node;
+                    mCells.push_back(objects);
+                }
+            }
+        }
+
+        virtual void abort()
+        {
+            mAborted = 1;
+        }
+
+        const std::vector<CellObjects>& getCells() const
+        {
+            return mCells;
+        }
+
+    private:
+        /// The world's readers may be in use by the main thread, so open our own.
+        ESM::ESMReader& getReader(int index)
+        {
+            if (index >= static_cast<int>(mReaders.size()))
+                mReaders.resize(index+1);
+
+            ESM::ESMReader& reader = mReaders[index];
+            if (reader.getName().empty())
+            {
+                ESM::ESMReader& source = MWBase::Environment::get().getWorld()->getEsmReader().at(index);
+                reader.setIndex(index);
+                reader.setEncoder(mEncoder);
+                reader.open(source.getName());
+
+                // resolve the parent files like the ESMStore did for the source, so that reference numbers are adjusted the same way
+                const std::vector<ESM::Header::MasterData>& masters = reader.getGameFiles();
+                const std::vector<ESM::Header::MasterData>& sourceMasters = source.getGameFiles();
+                for (unsigned int i=0; i<masters.size() && i<sourceMasters.size(); ++i)
+                    const_cast<ESM::Header::MasterData&>(masters[i]).index = sourceMasters[i].index;
+            }
+            return reader;
+        }
+
+        void readRefs(const ESM::Cell& cell, std::map<ESM::RefNum, ESM::CellRef>& refs)
+        {
+            for (size_t i = 0; i < cell.mContextList.size(); ++i)
+            {
+                try
+                {
+                    ESM::ESMReader& reader = getReader(cell.mContextList[i].index);
+                    cell.restore(reader, i);
+
+                    ESM::CellRef ref;
+                    ref.mRefNum.mContentFile = ESM::RefNum::RefNum_NoContentFile;
+
+                    bool deleted = false;
+                    while (cell.getNextRef(reader, ref, deleted))
+                    {
+                        if (std::find(cell.mMovedRefs.begin(), cell.mMovedRefs.end(), ref.mRefNum) != cell.mMovedRefs.end())
+                            continue;
+
+                        if (deleted)
+                            refs.erase(ref.mRefNum);
+                        else
+                            refs[ref.mRefNum] = ref;
+                    }
+                }
+                catch (std::exception& e)
+                {
+                    std::cerr << "Failed to read distant objects of cell " << cell.getDescription() << ": " << e.what() << std::endl;
+                }
+            }
+
+            for (ESM::CellRefTracker::const_iterator it = cell.mLeasedRefs.begin(); it != cell.mLeasedRefs.end(); ++it)
+            {
+                if (it->second)
+                    refs.erase(it->first.mRefNum);
+                else
+                    refs[it->first.mRefNum] = it->first;
+            }
+        }
+
+        struct StaticRef
+        {
+            std::string mModel;
+            ESM::Position mPos;
+            float mScale;
+        };
+
+        /// Identifies the merged objects of a cell, covering the objects' models and placement and the settings they are merged with.
+        std::string getDiskCacheKey(const ESM::Cell& cell, const std::vector<StaticRef>& statics) const
+        {
+            // increment when the merging changes in a way that affects the result
+            const int version = 2;
+
+            const VFS::Manager* vfs = mSceneManager->getVFS();
+
+            std::ostringstream stream;
+            stream << "distant objects " << version << " " << cell.getGridX() << " " << cell.getGridY() << " "
+                   << mCellWorldSize << " " << mMinRadius;
+            for (std::vector<StaticRef>::const_iterator it = statics.begin(); it != statics.end(); ++it)
+            {
+                const ESM::Position& pos = it->mPos;
+                stream << "\n" << it->mModel << " " << vfs->getStamp(it->mModel) << " " << it->mScale;
+                for (int i=0; i<3; ++i)
+                    stream << " " << pos.pos[i] << " " << pos.rot[i];
+            }
+            return stream.str();
+        }
+
+        /// The light lists are managed at run time, store the merged objects without them.
+        void writeToDiskCache(const std::string& key, const osg::Group& result)
+        {
+            osg::ref_ptr<osg::Group> stored (new osg::Group(result, osg::CopyOp::SHALLOW_COPY));
+            for (unsigned int i=0; i<stored->getNumChildren(); ++i)
+            {
+                osg::ref_ptr<osg::Node> child = static_cast<osg::Node*>(stored->getChild(i)->clone(osg::CopyOp::SHALLOW_COPY));
+                child->setCullCallback(NULL);
+                stored->setChild(i, child);
+            }
+            mSceneManager->writeCachedScene(key, *stored);
+        }
+
+        osg::ref_ptr<osg::Node> readFromDiskCache(const std::string& key)
+        {
+            osg::ref_ptr<osg::Node> node = mSceneManager->readCachedScene(key);
+            osg::Group* result = node ? node->asGroup() : NULL;
+            if (!result)
+                return NULL;
+
+            for (unsigned int i=0; i<result->getNumChildren(); ++i)
+                result->getChild(i)->addCullCallback(new SceneUtil::LightListCallback);
+            return result;
+        }
+
+        osg::ref_ptr<osg::Node> loadCell(const ESM::Cell& cell, const MWWorld::ESMStore& store)
+        {
+            std::map<ESM::RefNum, ESM::CellRef> refs;
+            readRefs(cell, refs);
+
+            std::vector<StaticRef> statics;
+            for (std::map<ESM::RefNum, ESM::CellRef>::iterator it = refs.begin(); it != refs.end(); ++it)
+            {
+                ESM::CellRef& ref = it->second;
+                Misc::StringUtils::lowerCaseInPlace(ref.mRefID);
+
+                const ESM::Static* base = store.get<ESM::Static>().search(ref.mRefID);
+                if (!base || base->mModel.empty())
+                    continue;
+
+                StaticRef object;
+                object.mModel = "meshes\\" + base->mModel;
+                object.mPos = ref.mPos;
+                object.mScale = ref.mScale;
+                statics.push_back(object);
+            }
+
+            if (statics.empty())
+                return NULL;
+
+            std::string diskCacheKey = getDiskCacheKey(cell, statics);
+            osg::ref_ptr<osg::Node> cached = readFromDiskCache(diskCacheKey);
+            if (cached)
+            {
+                if (mSceneManager->getIncrementalCompileOperation())
+                    mSceneManager->getIncrementalCompileOperation()->add(cached);
+                return cached;
+            }
+
+            // nodes hidden by the NIF loader keep only the update visitor's mask
+            const unsigned int cullMask = ~static_cast<unsigned int>(MWRender::Mask_UpdateVisitor);
+            osg::ref_ptr<SceneUtil::StaticBatch> batch (new SceneUtil::StaticBatch(mCellWorldSize, cullMask));
+            // the small parts of large objects are just as hard to see as small objects
+            batch->setMinRadius(mMinRadius);
+
+            for (std::vector<StaticRef>::const_iterator it = statics.begin(); it != statics.end(); ++it)
+            {
+                const StaticRef& ref = *it;
+
+                // the merged objects are stored before the shaders and texture streaming are set up, as these can't be stored
+                osg::ref_ptr<const osg::Node> node = mSceneManager->getUnpreparedTemplate(ref.mModel);
+                if (node->getBound().radius() * ref.mScale < mMinRadius || !SceneUtil::StaticBatch::canBatch(node, cullMask))
+                    continue;
+
+                // same as the rotation set up when the object is inserted into the scene
+                const ESM::Position& pos = ref.mPos;
+                osg::Quat rotation = osg::Quat(pos.rot[2], osg::Vec3f(0,0,-1)) * osg::Quat(pos.rot[1], osg::Vec3f(0,-1,0))
+                        * osg::Quat(pos.rot[0], osg::Vec3f(-1,0,0));
+                osg::Matrixf worldMatrix = osg::Matrixf::scale(osg::Vec3f(ref.mScale, ref.mScale, ref.mScale))
+                        * osg::Matrixf::rotate(rotation) * osg::Matrixf::translate(pos.asVec3());
+
+                // the template is attached below the object's own transform, so its root transform has to be kept
+                if (const osg::Transform* transform = node->asTransform())
+                {
+                    osg::Matrix local;
+                    transform->computeLocalToWorldMatrix(local, NULL);
+                    worldMatrix = osg::Matrixf(local) * worldMatrix;
+                }
+
+                batch->addObject(node, worldMatrix);
+            }
+
+            if (!batch->getNumObjects())
+                return NULL;
+
+            batch->doWork();
+            osg::ref_ptr<osg::Group> result = batch->getResult();
+            if (!result)
+                return NULL;
+
+            writeToDiskCache(diskCacheKey, *result);
+            mSceneManager->prepareScene(*result);
+
+            if (mSceneManager->getIncrementalCompileOperation())
+                mSceneManager->getIncrementalCompileOperation()->add(result);
+            return result;
+        }
+
+        Resource::SceneManager* mSceneManager;
+        ToUTF8::Utf8Encoder* mEncoder;
+        float mCellWorldSize;
+        float mSize;
+        osg::Vec2f mCenter;
+        float mMinRadius;
+
+        std::vector<ESM::ESMReader> mReaders;
+        std::vector<CellObjects> mCells;
+
+        OpenThreads::Atomic mAborted;
+    };
+
+    /// Draws the objects of a chunk once they are loaded, leaving out the cells that are loaded.
+    class DistantObjectsChunk : public osg::Node
+    {
+    public:
+        DistantObjectsChunk(const MWRender::DistantObjects* owner)
+            : mOwner(owner)
+        {
+        }
+
+        ~DistantObjectsChunk()
+        {
+            if (mLoader)
+                mLoader->abort();
+        }
+
+        void setLoader(ChunkLoader* loader)
+        {
+            mLoader = loader;
+            // nothing to cull until loaded
+            setCullingActive(false);
+        }
+
+        void setCells(const std::vector<CellObjects>& cells)
+        {
+            mCells = cells;
+            setCullingActive(true);
+            dirtyBound();
+        }
+
+        virtual osg::BoundingSphere computeBound() const
+        {
+            osg::BoundingSphere bound;
+            for (std::vector<CellObjects>::const_iterator it = mCells.begin(); it != mCells.end(); ++it)
+                bound.expandBy(it->mNode->getBound());
+            return bound;
+        }
+
+        virtual void traverse(osg::NodeVisitor& nv)
+        {
+            if (mLoader && mLoader->isDone())
+            {
+                setCells(mLoader->getCells());
+                mLoader = NULL;
+            }
+
+            for (std::vector<CellObjects>::const_iterator it = mCells.begin(); it != mCells.end(); ++it)
+            {
+                if (!mOwner->isCellActive(it->mX, it->mY))
+                    it->mNode->accept(nv);
+            }
+        }
+
+    private:
+        const MWRender::DistantObjects* mOwner;
+        osg::ref_ptr<ChunkLoader> mLoader;
+        std::vector<CellObjects> mCells;
+    };
+
+}
+
+namespace MWRender
+{
+
+DistantObjects::DistantObjects(Resource::SceneManager* sceneManager, SceneUtil::WorkQueue* workQueue, ToUTF8::Utf8Encoder* encoder,
+                               float cellWorldSize, float minSize)
+    : ResourceManager(NULL)
+    , mSceneManager(sceneManager)
+    , mWorkQueue(workQueue)
+    , mEncoder(encoder)
+    , mCellWorldSize(cellWorldSize)
+    , mMinSize(minSize)
+{
+}
+
+osg::ref_ptr<osg::Node> DistantObjects::getChunk(float size, const osg::Vec2f &center, bool async)
+{
+    // smaller chunks are only used close to the viewer, where the cells are loaded anyway
+    if (size < 1.f)
+        return NULL;
+
+    std::ostringstream stream;
+    stream << size << " " << center.x() << " " << center.y();
+    std::string id = stream.str();
+
+    osg::ref_ptr<osg::Object> obj = mCache->getRefFromObjectCache(id);
+    if (obj)
+        return obj->asNode();
+
+    osg::ref_ptr<DistantObjectsChunk> chunk (new DistantObjectsChunk(this));
+    chunk->setNodeMask(Mask_DistantObjects);
+
+    osg::ref_ptr<ChunkLoader> loader (new ChunkLoader(mSceneManager, mEncoder, mCellWorldSize, size, center, mMinSize * size * mCellWorldSize));
+    if (async && mWorkQueue)
+    {
+        chunk->setLoader(loader);
+        mWorkQueue->addWorkItem(loader);
+    }
+    else
+    {
+        loader->doWork();
+        chunk->setCells(loader->getCells());
+    }
+
+    mCache->addEntryToObjectCache(id, chunk.get());
+    return chunk;
+}
+
+void DistantObjects::setCellActive(int x, int y, bool active)
+{
+    if (active)
+        mActiveCells.insert(std::make_pair(x, y));
+    else
+        mActiveCells.erase(std::make_pair(x, y));
+}
+
+bool DistantObjects::isCellActive(int x, int y) const
+{
+    return mActiveCells.find(std::make_pair(x, y)) != mActiveCells.end();
+}
+
+void DistantObjects::reportStats(unsigned int frameNumber, osg::Stats *stats) const
+{
+    stats->setAttribute(frameNumber, "Distant Objects", mCache->getCacheSize());
+}
+
+}
@@ -0,0 +1,62 @@
+#ifndef OPENMW_MWRENDER_DISTANTOBJECTS_H
+#define OPENMW_MWRENDER_DISTANTOBJECTS_H
+
+#include <set>
+
+#include <components/resource/resourcemanager.hpp>
+#include <components/terrain/quadtreeworld.hpp>
+
+namespace Resource
+{
+    class SceneManager;
+}
+
+namespace SceneUtil
+{
+    class WorkQueue;
+}
+
+namespace ToUTF8
+{
+    class Utf8Encoder;
+}
+
+namespace MWRender
+{
+
+    /// @brief Draws the statics of cells that are not loaded along with the distant terrain.
+    /// @par The objects are read from the content files and merged per cell, on a background thread. The further away a chunk,
+    /// the larger objects and their parts have to be to be included. Cells that are loaded are left out, as their objects are drawn as usual.
+    /// The merged objects are stored in the SceneManager's disk cache, if it is used.
+    /// @note Changes made to objects during the game are not reflected, the objects are shown as they are in the content files.
+    class DistantObjects : public Resource::ResourceManager, public Terrain::QuadTreeWorld::ChunkProvider
+    {
+    public:
+        /// @param encoder Used to read the content files, like the world does.
+        /// @param minSize Minimum radius of an object or a part of it, relative to the size of the chunk, to be drawn.
+        DistantObjects(Resource::SceneManager* sceneManager, SceneUtil::WorkQueue* workQueue, ToUTF8::Utf8Encoder* encoder,
+                       float cellWorldSize, float minSize);
+
+        virtual osg::ref_ptr<osg::Node> getChunk(float size, const osg::Vec2f& center, bool async);
+
+        /// Set if a cell is loaded, so that its distant objects are not drawn.
+        /// @note Not thread safe, call from the thread that does the cull traversal.
+        void setCellActive(int x, int y, bool active);
+
+        bool isCellActive(int x, int y) const;
+
+        virtual void reportStats(unsigned int frameNumber, osg::Stats* stats) const;
+
+    private:
+        Resource::SceneManager* mSceneManager;
+        osg::ref_ptr<SceneUtil::WorkQueue> mWorkQueue;
+        ToUTF8::Utf8Encoder* mEncoder;
+        float mCellWorldSize;
+        float mMinSize;
+
+        std::set<std::pair<int, int> > mActiveCells;
+    };
+
+}
+
+#endif
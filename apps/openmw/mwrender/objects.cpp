@@ -1,12 +1,21 @@
 #include "objects.hpp"
 
 #include <cmath>
+#include <typeinfo>
 
 #include <osg/Group>
 #include <osg/UserDataContainer>
 
+#include <components/sceneutil/occlusionculler.hpp>
 #include <components/sceneutil/positionattitudetransform.hpp>
 #include <components/sceneutil/unrefqueue.hpp>
+#include <components/sceneutil/staticbatch.hpp>
+#include <components/sceneutil/workqueue.hpp>
+
+#include <components/esm/loadstat.hpp>
+
+#include <components/resource/resourcesystem.hpp>
+#include <components/resource/scenemanager.hpp>
 
 #include "../mwworld/ptr.hpp"
 #include "../mwworld/class.hpp"
@@ -17,6 +26,12 @@
 #include "vismask.hpp"
 
 
+namespace
+{
+    /// Meshes with more triangles than this are too costly to draw into the occlusion buffer every frame.
+    const unsigned int sMaxOccluderTriangles = 4096;
+}
+
 namespace MWRender
 {
 
@@ -24,11 +39,28 @@ Objects::Objects(Resource::ResourceSystem* resourceSystem, osg::ref_ptr<osg::Gro
     : mRootNode(rootNode)
     , mResourceSystem(resourceSystem)
     , mUnrefQueue(unrefQueue)
+    , mStaticBatchCellSize(0.f)
+    , mStaticBatchMinInstances(0)
+    , mOccluderMinSize(0.f)
 {
 }
 
 Objects::~Objects()
 {
+    for (StaticBatchMap::iterator iter = mStaticBatches.begin(); iter != mStaticBatches.end(); ++iter)
+    {
+        if (iter->second.mPending)
+            iter->second.mPending->abort();
+    }
+    mStaticBatches.clear();
+
+    if (mOcclusionCuller)
+    {
+        for (std::map<const osg::Node*, osg::ref_ptr<SceneUtil::Occluder> >::iterator iter = mOccluders.begin(); iter != mOccluders.end(); ++iter)
+            mOcclusionCuller->removeOccluder(iter->second);
+    }
+    mOccluders.clear();
+
     mObjects.clear();
 
     for (CellMap::iterator iter = mCellSceneNodes.begin(); iter != mCellSceneNodes.end(); ++iter)
@@ -44,12 +76,7 @@ void Objects::insertBegin(const MWWorld::Ptr& ptr)
 
     CellMap::iterator found = mCellSceneNodes.find(ptr.getCell());
     if (found == mCellSceneNodes.end())
-    {
-        cellnode = new osg::Group;
-        cellnode->setName("Cell Root");
-        mRootNode->addChild(cellnode);
-        mCellSceneNodes[ptr.getCell()] = cellnode;
-    }
+        cellnode = createCellNode(ptr.getCell());
     else
         cellnode = found->second;
 
@@ -70,6 +97,17 @@ void Objects::insertBegin(const MWWorld::Ptr& ptr)
     ptr.getRefData().setBaseNode(insert);
 }
 
+osg::Group* Objects::createCellNode(const MWWorld::CellStore* store)
+{
+    osg::ref_ptr<osg::Group> cellnode = new osg::Group;
+    cellnode->setName("Cell Root");
+    if (mOcclusionCuller)
+        cellnode->addCullCallback(new SceneUtil::OcclusionCullCallback(mOcclusionCuller));
+    mRootNode->addChild(cellnode);
+    mCellSceneNodes[store] = cellnode;
+    return cellnode;
+}
+
 void Objects::insertModel(const MWWorld::Ptr &ptr, const std::string &mesh, bool animated, bool allowLight)
 {
     insertBegin(ptr);
@@ -77,6 +115,19 @@ void Objects::insertModel(const MWWorld::Ptr &ptr, const std::string &mesh, bool
     osg::ref_ptr<ObjectAnimation> anim (new ObjectAnimation(ptr, mesh, mResourceSystem, animated, allowLight));
 
     mObjects.insert(std::make_pair(ptr, anim));
+
+    if (mStaticBatchWorkQueue && !animated && ptr.getTypeName() == typeid(ESM::Static).name())
+    {
+        StaticBatchCell& cell = mStaticBatches[ptr.getCell()];
+        if (!cell.mExcluded.count(ptr.getBase()))
+        {
+            cell.mCandidates[ptr.getBase()] = ptr;
+            cell.mDirty = true;
+        }
+    }
+
+    if (mOcclusionCuller && !animated && ptr.getTypeName() == typeid(ESM::Static).name())
+        addOccluder(ptr, mesh);
 }
 
 void Objects::insertCreature(const MWWorld::Ptr &ptr, const std::string &mesh, bool weaponsShields)
@@ -115,6 +166,10 @@ bool Objects::removeObject (const MWWorld::Ptr& ptr)
     if(!ptr.getRefData().getBaseNode())
         return true;
 
+    objectChanged(ptr);
+    removeStaticBatchCandidate(ptr);
+    removeOccluder(ptr);
+
     PtrAnimationMap::iterator iter = mObjects.find(ptr);
     if(iter != mObjects.end())
     {
@@ -146,6 +201,8 @@ void Objects::removeCell(const MWWorld::CellStore* store)
         MWWorld::Ptr ptr = iter->second->getPtr();
         if(ptr.getCell() == store)
         {
+            removeOccluder(ptr);
+
             if (mUnrefQueue.get())
                 mUnrefQueue->push(iter->second);
 
@@ -162,6 +219,14 @@ void Objects::removeCell(const MWWorld::CellStore* store)
             ++iter;
     }
 
+    StaticBatchMap::iterator batch = mStaticBatches.find(store);
+    if (batch != mStaticBatches.end())
+    {
+        if (batch->second.mPending)
+            batch->second.mPending->abort();
+        mStaticBatches.erase(batch);
+    }
+
     CellMap::iterator cell = mCellSceneNodes.find(store);
     if(cell != mCellSceneNodes.end())
     {
@@ -178,13 +243,14 @@ void Objects::updatePtr(const MWWorld::Ptr &old, const MWWorld::Ptr &cur)
     if (!objectNode)
         return;
 
+    objectChanged(old);
+    removeStaticBatchCandidate(old);
+
     MWWorld::CellStore *newCell = cur.getCell();
 
     osg::Group* cellnode;
     if(mCellSceneNodes.find(newCell) == mCellSceneNodes.end()) {
-        cellnode = new osg::Group;
-        mRootNode->addChild(cellnode);
-        mCellSceneNodes[newCell] = cellnode;
+        cellnode = createCellNode(newCell);
     } else {
         cellnode = mCellSceneNodes[newCell];
     }
@@ -229,4 +295,197 @@ const Animation* Objects::getAnimation(const MWWorld::ConstPtr &ptr) const
     return NULL;
 }
 
+void Objects::enableStaticBatching(SceneUtil::WorkQueue* workQueue, float cellSize, unsigned int minInstances)
+{
+    mStaticBatchWorkQueue = workQueue;
+    mStaticBatchCellSize = cellSize;
+    mStaticBatchMinInstances = minInstances;
+}
+
+void Objects::enableOcclusionCulling(SceneUtil::OcclusionCuller* culler, float minSize)
+{
+    mOcclusionCuller = culler;
+    mOccluderMinSize = minSize;
+}
+
+void Objects::addOccluder(const MWWorld::Ptr& ptr, const std::string& model)
+{
+    osg::Node* node = ptr.getRefData().getBaseNode();
+    if (!node || node->getBound().radius() < mOccluderMinSize)
+        return;
+
+    osg::ref_ptr<SceneUtil::OccluderMesh> mesh;
+    std::map<std::string, osg::ref_ptr<SceneUtil::OccluderMesh> >::const_iterator found = mOccluderMeshes.find(model);
+    if (found != mOccluderMeshes.end())
+        mesh = found->second;
+    else
+    {
+        // nodes hidden by the NIF loader keep only the update visitor's mask
+        mesh = SceneUtil::createOccluderMesh(*node, ~static_cast<unsigned int>(Mask_UpdateVisitor), sMaxOccluderTriangles);
+        mOccluderMeshes[model] = mesh;
+    }
+    if (!mesh)
+        return;
+
+    osg::ref_ptr<SceneUtil::Occluder> occluder = new SceneUtil::Occluder(mesh, node->asTransform());
+    mOcclusionCuller->addOccluder(occluder);
+    mOccluders[node] = occluder;
+}
+
+void Objects::removeOccluder(const MWWorld::Ptr& ptr)
+{
+    std::map<const osg::Node*, osg::ref_ptr<SceneUtil::Occluder> >::iterator found = mOccluders.find(ptr.getRefData().getBaseNode());
+    if (found == mOccluders.end())
+        return;
+
+    mOcclusionCuller->removeOccluder(found->second);
+    mOccluders.erase(found);
+}
+
+void Objects::updateStaticBatches()
+{
+    for (StaticBatchMap::iterator iter = mStaticBatches.begin(); iter != mStaticBatches.end(); ++iter)
+    {
+        StaticBatchCell& cell = iter->second;
+        if (cell.mPending && cell.mPending->isDone())
+            applyStaticBatch(iter->first, cell);
+
+        if (cell.mDirty && !cell.mPending)
+            startStaticBatch(cell);
+    }
+}
+
+namespace
+{
+    bool containsObject(const std::vector<MWWorld::Ptr>& objects, const MWWorld::Ptr& ptr)
+    {
+        for (std::vector<MWWorld::Ptr>::const_iterator it = objects.begin(); it != objects.end(); ++it)
+        {
+            if (it->getBase() == ptr.getBase())
+                return true;
+        }
+        return false;
+    }
+}
+
+void Objects::objectChanged(const MWWorld::Ptr& ptr)
+{
+    if (ptr.getTypeName() != typeid(ESM::Static).name())
+        return;
+
+    StaticBatchMap::iterator found = mStaticBatches.find(ptr.getCell());
+    if (found == mStaticBatches.end())
+        return;
+    StaticBatchCell& cell = found->second;
+
+    // The batches are built from the transforms at the time they are started, so only objects that are already part of
+    // a batch need to be taken out. This ignores the transforms set while inserting the object.
+    if (!containsObject(cell.mBatched, ptr) && !containsObject(cell.mPendingObjects, ptr))
+        return;
+
+    // an object that is changed once is likely to be changed again, so don't bother batching it anymore
+    cell.mCandidates.erase(ptr.getBase());
+    cell.mExcluded.insert(ptr.getBase());
+
+    if (cell.mPending)
+    {
+        cell.mPending->abort();
+        cell.mPending = NULL;
+        cell.mPendingObjects.clear();
+    }
+
+    clearStaticBatch(cell);
+    cell.mDirty = true;
+}
+
+void Objects::removeStaticBatchCandidate(const MWWorld::Ptr& ptr)
+{
+    StaticBatchMap::iterator found = mStaticBatches.find(ptr.getCell());
+    if (found != mStaticBatches.end() && found->second.mCandidates.erase(ptr.getBase()))
+        found->second.mDirty = true;
+}
+
+void Objects::startStaticBatch(StaticBatchCell& cell)
+{
+    cell.mDirty = false;
+
+    // nodes hidden by the NIF loader keep only the update visitor's mask
+    const unsigned int cullMask = ~static_cast<unsigned int>(Mask_UpdateVisitor);
+    osg::ref_ptr<SceneUtil::StaticBatch> batch (new SceneUtil::StaticBatch(mStaticBatchCellSize, cullMask));
+    batch->setMinInstances(mStaticBatchMinInstances);
+    batch->setShaderManager(&mResourceSystem->getSceneManager()->getShaderManager());
+    std::vector<MWWorld::Ptr> objects;
+    for (std::map<const MWWorld::LiveCellRefBase*, MWWorld::Ptr>::const_iterator it = cell.mCandidates.begin(); it != cell.mCandidates.end(); ++it)
+    {
+        osg::Node* node = it->second.getRefData().getBaseNode();
+        if (!node || !SceneUtil::StaticBatch::canBatch(node, cullMask))
+            continue;
+
+        // hidden objects are already batched, others must be visible with the default mask to be restored correctly
+        if (node->getNodeMask() != ~0u && node->getNodeMask() != Mask_Batched)
+            continue;
+
+        // make sure bounds are computed on this thread, the work item only reads them
+        node->getBound();
+
+        osg::Matrix worldMatrix;
+        node->asTransform()->computeLocalToWorldMatrix(worldMatrix, NULL);
+        batch->addObject(node, worldMatrix);
+        objects.push_back(it->second);
+    }
+
+    // not worth it
+    if (objects.size() < 2)
+    {
+        clearStaticBatch(cell);
+        return;
+    }
+
+    cell.mPending = batch;
+    cell.mPendingObjects.swap(objects);
+    mStaticBatchWorkQueue->addWorkItem(batch);
+}
+
+void Objects::applyStaticBatch(const MWWorld::CellStore* store, StaticBatchCell& cell)
+{
+    osg::ref_ptr<osg::Group> result = cell.mPending->getResult();
+    cell.mPending = NULL;
+
+    std::vector<MWWorld::Ptr> objects;
+    objects.swap(cell.mPendingObjects);
+
+    CellMap::iterator cellNode = mCellSceneNodes.find(store);
+    if (!result || cellNode == mCellSceneNodes.end())
+        return;
+
+    clearStaticBatch(cell);
+
+    result->setNodeMask(Mask_StaticBatch);
+    cellNode->second->addChild(result);
+    cell.mBatchNode = result;
+
+    for (std::vector<MWWorld::Ptr>::const_iterator it = objects.begin(); it != objects.end(); ++it)
+        it->getRefData().getBaseNode()->setNodeMask(Mask_Batched);
+    cell.mBatched.swap(objects);
+}
+
+void Objects::clearStaticBatch(StaticBatchCell& cell)
+{
+    for (std::vector<MWWorld::Ptr>::const_iterator it = cell.mBatched.begin(); it != cell.mBatched.end(); ++it)
+    {
+        if (osg::Node* node = it->getRefData().getBaseNode())
+            node->setNodeMask(~0u);
+    }
+    cell.mBatched.clear();
+
+    if (cell.mBatchNode)
+    {
+        if (cell.mBatchNode->getNumParents())
+            cell.mBatchNode->getParent(0)->removeChild(cell.mBatchNode);
+        if (mUnrefQueue.get())
+            mUnrefQueue->push(cell.mBatchNode);
+        cell.mBatchNode = NULL;
+    }
+}
+
 }
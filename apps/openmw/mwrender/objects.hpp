@@ -3,7 +3,9 @@
 
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
+#include <vector>
 
 #include <osg/ref_ptr>
 #include <osg/Object>
@@ -28,6 +30,11 @@ namespace MWWorld
 namespace SceneUtil
 {
     class UnrefQueue;
+    class WorkQueue;
+    class StaticBatch;
+    class OcclusionCuller;
+    class Occluder;
+    class OccluderMesh;
 }
 
 namespace MWRender{
@@ -69,8 +76,53 @@ class Objects{
 
     osg::ref_ptr<SceneUtil::UnrefQueue> mUnrefQueue;
 
+    /// Statics of a cell that are drawn as merged geometry instead of through their own nodes.
+    struct StaticBatchCell
+    {
+        StaticBatchCell() : mDirty(false) {}
+
+        /// Statics that may be batched. Objects are dropped from this when they are moved or removed.
+        std::map<const MWWorld::LiveCellRefBase*, MWWorld::Ptr> mCandidates;
+        std::set<const MWWorld::LiveCellRefBase*> mExcluded;
+
+        /// The objects hidden in favour of mBatchNode.
+        std::vector<MWWorld::Ptr> mBatched;
+        osg::ref_ptr<osg::Group> mBatchNode;
+
+        /// Batch being built in the background, and the objects it contains.
+        osg::ref_ptr<SceneUtil::StaticBatch> mPending;
+        std::vector<MWWorld::Ptr> mPendingObjects;
+
+        /// The candidates changed since the batch was started.
+        bool mDirty;
+    };
+    typedef std::map<const MWWorld::CellStore*, StaticBatchCell> StaticBatchMap;
+    StaticBatchMap mStaticBatches;
+
+    osg::ref_ptr<SceneUtil::WorkQueue> mStaticBatchWorkQueue;
+    float mStaticBatchCellSize;
+    unsigned int mStaticBatchMinInstances;
+
+    osg::ref_ptr<SceneUtil::OcclusionCuller> mOcclusionCuller;
+    float mOccluderMinSize;
+    /// Occluder meshes by model name, NULL for models that can not be used as occluders.
+    std::map<std::string, osg::ref_ptr<SceneUtil::OccluderMesh> > mOccluderMeshes;
+    std::map<const osg::Node*, osg::ref_ptr<SceneUtil::Occluder> > mOccluders;
+
     void insertBegin(const MWWorld::Ptr& ptr);
 
+    osg::Group* createCellNode(const MWWorld::CellStore* store);
+
+    void addOccluder(const MWWorld::Ptr& ptr, const std::string& model);
+    void removeOccluder(const MWWorld::Ptr& ptr);
+
+    void startStaticBatch(StaticBatchCell& cell);
+    void applyStaticBatch(const MWWorld::CellStore* store, StaticBatchCell& cell);
+    /// Show the original nodes of a batch again and remove the batch.
+    void clearStaticBatch(StaticBatchCell& cell);
+    /// Stop considering \a ptr for the batch of its cell, as it is leaving the cell.
+    void removeStaticBatchCandidate(const MWWorld::Ptr& ptr);
+
 public:
     Objects(Resource::ResourceSystem* resourceSystem, osg::ref_ptr<osg::Group> rootNode, SceneUtil::UnrefQueue* unrefQueue);
     ~Objects();
@@ -79,6 +131,22 @@ public:
     /// @param allowLight If false, no lights will be created, and particles systems will be removed.
     void insertModel(const MWWorld::Ptr& ptr, const std::string &model, bool animated=false, bool allowLight=true);
 
+    /// Merge the statics of each cell in the background, to be drawn with fewer nodes and draw calls.
+    /// @param cellSize Objects within the same square of this size share a batch and its light list.
+    void enableStaticBatching(SceneUtil::WorkQueue* workQueue, float cellSize, unsigned int minInstances);
+
+    /// Hide objects behind large statics, which are added to \a culler as occluders.
+    /// @param minSize Minimum radius of a static to be used as an occluder.
+    void enableOcclusionCulling(SceneUtil::OcclusionCuller* culler, float minSize);
+
+    /// Apply finished batches and start new ones for cells whose statics changed. Call once per frame.
+    void updateStaticBatches();
+
+    /// Notify that \a ptr is about to be moved, rotated, scaled or removed. If it is part of the static batch of its cell,
+    /// it is excluded from static batching from now on. Changes made before that, e.g. while inserting the object,
+    /// are simply picked up by the next batch.
+    void objectChanged(const MWWorld::Ptr& ptr);
+
     void insertNPC(const MWWorld::Ptr& ptr);
     void insertCreature (const MWWorld::Ptr& ptr, const std::string& model, bool weaponsShields);
 
@@ -22,6 +22,7 @@
 #include <components/resource/imagemanager.hpp>
 #include <components/resource/scenemanager.hpp>
 #include <components/resource/keyframemanager.hpp>
+#include <components/resource/texturestreamer.hpp>
 
 #include <components/settings/settings.hpp>
 
@@ -32,11 +33,15 @@
 #include <components/sceneutil/workqueue.hpp>
 #include <components/sceneutil/unrefqueue.hpp>
 #include <components/sceneutil/writescene.hpp>
+#include <components/sceneutil/riggeometry.hpp>
+#include <components/sceneutil/morphgeometry.hpp>
+#include <components/sceneutil/occlusionculler.hpp>
 
 #include <components/terrain/terraingrid.hpp>
 #include <components/terrain/quadtreeworld.hpp>
 
 #include <components/esm/loadcell.hpp>
+#include <components/esm/loadland.hpp>
 #include <components/fallback/fallback.hpp>
 
 #include "../mwworld/cellstore.hpp"
@@ -49,6 +54,7 @@
 #include "camera.hpp"
 #include "water.hpp"
 #include "terrainstorage.hpp"
+#include "distantobjects.hpp"
 #include "util.hpp"
 
 namespace
@@ -59,6 +65,42 @@ namespace
     float DLUnderwaterFogEnd;
     float DLInteriorFogStart;
     float DLInteriorFogEnd;
+
+    /// Create a coarse mesh of a cell's terrain for occlusion culling. Each vertex takes the lowest height of the area
+    /// around it, so that the mesh is never above the actual terrain and can not hide anything visible.
+    osg::ref_ptr<SceneUtil::OccluderMesh> createTerrainOccluder(const ESM::Land::LandData& data, const osg::Vec2f& origin, float cellSize)
+    {
+        const int step = 8;
+        const int numVerts = (ESM::Land::LAND_SIZE - 1) / step + 1;
+        const float vertexSpacing = cellSize / (numVerts - 1);
+
+        osg::ref_ptr<SceneUtil::OccluderMesh> mesh = new SceneUtil::OccluderMesh;
+        for (int y=0; y<numVerts; ++y)
+        {
+            for (int x=0; x<numVerts; ++x)
+            {
+                float height = std::numeric_limits<float>::max();
+                for (int sy = std::max(0, (y-1)*step); sy <= std::min(ESM::Land::LAND_SIZE-1, (y+1)*step); ++sy)
+                    for (int sx = std::max(0, (x-1)*step); sx <= std::min(ESM::Land::LAND_SIZE-1, (x+1)*step); ++sx)
+                        height = std::min(height, data.mHeights[sy * ESM::Land::LAND_SIZE + sx]);
+
+                mesh->mVertices.push_back(osg::Vec3f(origin.x() + x * vertexSpacing, origin.y() + y * vertexSpacing, height));
+            }
+        }
+
+        for (int y=0; y<numVerts-1; ++y)
+        {
+            for (int x=0; x<numVerts-1; ++x)
+            {
+                unsigned int v = y * numVerts + x;
+                unsigned int indices[6] = { v, v+1, v+numVerts+1, v, v+numVerts+1, v+numVerts };
+                mesh->mIndices.insert(mesh->mIndices.end(), indices, indices+6);
+            }
+        }
+
+        mesh->computeBound();
+        return mesh;
+    }
 }
 
 namespace MWRender
@@ -177,7 +219,7 @@ namespace MWRender
     };
 
     RenderingManager::RenderingManager(osgViewer::Viewer* viewer, osg::ref_ptr<osg::Group> rootNode, Resource::ResourceSystem* resourceSystem, SceneUtil::WorkQueue* workQueue,
-                                       const Fallback::Map* fallback, const std::string& resourcePath)
+                                       ToUTF8::Utf8Encoder* encoder, const Fallback::Map* fallback, const std::string& resourcePath, const std::string& cachePath)
         : mViewer(viewer)
         , mRootNode(rootNode)
         , mResourceSystem(resourceSystem)
@@ -217,6 +259,29 @@ namespace MWRender
         mPathgrid.reset(new Pathgrid(mRootNode));
 
         mObjects.reset(new Objects(mResourceSystem, sceneRoot, mUnrefQueue.get()));
+        if (Settings::Manager::getBool("static batching", "Cells"))
+            mObjects->enableStaticBatching(mWorkQueue.get(), Settings::Manager::getFloat("static batching cell size", "Cells"),
+                                           std::max(0, Settings::Manager::getInt("static instancing min count", "Cells")));
+
+        if (Settings::Manager::getBool("occlusion culling", "Camera"))
+        {
+            mOcclusionCuller = new SceneUtil::OcclusionCuller(256, 128);
+            mOcclusionCuller->setCamera(mViewer->getCamera());
+            mOcclusionCuller->setMaxOccluders(std::max(0, Settings::Manager::getInt("occlusion culling max occluders", "Camera")));
+            mObjects->enableOcclusionCulling(mOcclusionCuller, Settings::Manager::getFloat("occlusion culling occluder min size", "Camera"));
+        }
+
+        int animationThreads = Settings::Manager::getInt("animation threads", "General");
+        if (animationThreads > 0)
+        {
+            mAnimationWorkQueue = new SceneUtil::WorkQueue(animationThreads);
+            SceneUtil::RigGeometry::setWorkQueue(mAnimationWorkQueue);
+            SceneUtil::MorphGeometry::setWorkQueue(mAnimationWorkQueue);
+        }
+
+        // Poses are shared only when they are exactly the same, e.g. distant actors sampled at the same animation time.
+        if (Settings::Manager::getBool("skinning cache", "General"))
+            SceneUtil::RigGeometry::setSkinningCache(new SceneUtil::SkinningCache(0.f));
 
         if (getenv("OPENMW_DONT_PRECOMPILE") == NULL)
         {
@@ -244,11 +309,25 @@ namespace MWRender
                                              Settings::Manager::getBool("auto use terrain specular maps", "Shaders"));
 
         if (mDistantTerrain)
-            mTerrain.reset(new Terrain::QuadTreeWorld(sceneRoot, mRootNode, mResourceSystem, mTerrainStorage, Mask_Terrain, Mask_PreCompile));
+        {
+            Terrain::QuadTreeWorld* quadTreeWorld = new Terrain::QuadTreeWorld(sceneRoot, mRootNode, mResourceSystem, mTerrainStorage, Mask_Terrain, Mask_PreCompile);
+            mTerrain.reset(quadTreeWorld);
+            quadTreeWorld->setWorkQueue(mWorkQueue.get());
+
+            if (Settings::Manager::getBool("distant objects", "Terrain"))
+            {
+                mDistantObjects.reset(new DistantObjects(mResourceSystem->getSceneManager(), mWorkQueue.get(), encoder, mTerrainStorage->getCellWorldSize(),
+                                                         Settings::Manager::getFloat("distant objects min size", "Terrain")));
+                mResourceSystem->addResourceManager(mDistantObjects.get());
+                quadTreeWorld->addChunkProvider(mDistantObjects.get());
+            }
+        }
         else
             mTerrain.reset(new Terrain::TerrainGrid(sceneRoot, mRootNode, mResourceSystem, mTerrainStorage, Mask_Terrain, Mask_PreCompile));
         mTerrain->setDefaultViewer(mViewer->getCamera());
         mTerrain->setTargetFrameRate(Settings::Manager::getFloat("target framerate", "Cells"));
+        if (Settings::Manager::getBool("composite map disk cache", "Terrain"))
+            mTerrain->setDiskCachePath(cachePath + "/terrain", mWorkQueue.get());
 
         mCamera.reset(new Camera(mViewer->getCamera()));
 
@@ -302,7 +381,7 @@ namespace MWRender
         mViewer->getCamera()->setComputeNearFarMode(osg::Camera::DO_NOT_COMPUTE_NEAR_FAR);
         mViewer->getCamera()->setCullingMode(cullingMode);
 
-        mViewer->getCamera()->setCullMask(~(Mask_UpdateVisitor|Mask_SimpleWater));
+        mViewer->getCamera()->setCullMask(~(Mask_UpdateVisitor|Mask_SimpleWater|Mask_Batched));
 
         mNearClip = Settings::Manager::getFloat("near clip", "Camera");
         mViewDistance = Settings::Manager::getFloat("viewing distance", "Camera");
@@ -322,6 +401,14 @@ namespace MWRender
     {
         // let background loading thread finish before we delete anything else
         mWorkQueue = NULL;
+
+        SceneUtil::RigGeometry::setWorkQueue(NULL);
+        SceneUtil::RigGeometry::setSkinningCache(NULL);
+        SceneUtil::MorphGeometry::setWorkQueue(NULL);
+        mAnimationWorkQueue = NULL;
+
+        if (mDistantObjects)
+            mResourceSystem->removeResourceManager(mDistantObjects.get());
     }
 
     MWRender::Objects& RenderingManager::getObjects()
@@ -445,7 +532,14 @@ namespace MWRender
         mWater->changeCell(store);
 
         if (store->getCell()->isExterior())
+        {
             mTerrain->loadCell(store->getCell()->getGridX(), store->getCell()->getGridY());
+            if (mDistantObjects)
+                mDistantObjects->setCellActive(store->getCell()->getGridX(), store->getCell()->getGridY(), true);
+
+            if (mOcclusionCuller)
+                addTerrainOccluder(store->getCell()->getGridX(), store->getCell()->getGridY());
+        }
     }
     void RenderingManager::removeCell(const MWWorld::CellStore *store)
     {
@@ -453,11 +547,36 @@ namespace MWRender
         mObjects->removeCell(store);
 
         if (store->getCell()->isExterior())
+        {
             mTerrain->unloadCell(store->getCell()->getGridX(), store->getCell()->getGridY());
+            if (mDistantObjects)
+                mDistantObjects->setCellActive(store->getCell()->getGridX(), store->getCell()->getGridY(), false);
+
+            std::map<std::pair<int, int>, osg::ref_ptr<SceneUtil::Occluder> >::iterator found
+                    = mTerrainOccluders.find(std::make_pair(store->getCell()->getGridX(), store->getCell()->getGridY()));
+            if (found != mTerrainOccluders.end())
+            {
+                mOcclusionCuller->removeOccluder(found->second);
+                mTerrainOccluders.erase(found);
+            }
+        }
 
         mWater->removeCell(store);
     }
 
+    void RenderingManager::addTerrainOccluder(int cellX, int cellY)
+    {
+        osg::ref_ptr<const ESMTerrain::LandObject> land = mTerrainStorage->getLand(cellX, cellY);
+        const ESM::Land::LandData* data = land ? land->getData(ESM::Land::DATA_VHGT) : NULL;
+        if (!data)
+            return;
+
+        const float cellSize = mTerrainStorage->getCellWorldSize();
+        osg::ref_ptr<SceneUtil::Occluder> occluder = new SceneUtil::Occluder(createTerrainOccluder(*data, osg::Vec2f(cellX, cellY) * cellSize, cellSize), NULL);
+        mOcclusionCuller->addOccluder(occluder);
+        mTerrainOccluders[std::make_pair(cellX, cellY)] = occluder;
+    }
+
     void RenderingManager::enableTerrain(bool enable)
     {
         mTerrain->enable(enable);
@@ -552,6 +671,11 @@ namespace MWRender
 
         mUnrefQueue->flush(mWorkQueue.get());
 
+        mObjects->updateStaticBatches();
+
+        if (Resource::TextureStreamer* textureStreamer = mResourceSystem->getImageManager()->getTextureStreamer())
+            textureStreamer->update(mViewer->getFrameStamp()->getFrameNumber());
+
         if (!paused)
         {
             mEffectManager->update(dt);
@@ -598,6 +722,8 @@ namespace MWRender
 
     void RenderingManager::rotateObject(const MWWorld::Ptr &ptr, const osg::Quat& rot)
     {
+        mObjects->objectChanged(ptr);
+
         if(ptr == mCamera->getTrackingPtr() &&
            !mCamera->isVanityOrPreviewModeEnabled())
         {
@@ -609,11 +735,13 @@ namespace MWRender
 
     void RenderingManager::moveObject(const MWWorld::Ptr &ptr, const osg::Vec3f &pos)
     {
+        mObjects->objectChanged(ptr);
         ptr.getRefData().getBaseNode()->setPosition(pos);
     }
 
     void RenderingManager::scaleObject(const MWWorld::Ptr &ptr, const osg::Vec3f &scale)
     {
+        mObjects->objectChanged(ptr);
         ptr.getRefData().getBaseNode()->setScale(scale);
 
         if (ptr == mCamera->getTrackingPtr()) // update height of camera
@@ -796,7 +924,7 @@ namespace MWRender
         mIntersectionVisitor->setIntersector(intersector);
 
         int mask = ~0;
-        mask &= ~(Mask_RenderToTexture|Mask_Sky|Mask_Debug|Mask_Effect|Mask_Water|Mask_SimpleWater);
+        mask &= ~(Mask_RenderToTexture|Mask_Sky|Mask_Debug|Mask_Effect|Mask_Water|Mask_SimpleWater|Mask_StaticBatch|Mask_DistantObjects);
         if (ignorePlayer)
             mask &= ~(Mask_Player);
         if (ignoreActors)
@@ -48,10 +48,17 @@ namespace Fallback
     class Map;
 }
 
+namespace ToUTF8
+{
+    class Utf8Encoder;
+}
+
 namespace SceneUtil
 {
     class WorkQueue;
     class UnrefQueue;
+    class OcclusionCuller;
+    class Occluder;
 }
 
 namespace MWRender
@@ -67,12 +74,13 @@ namespace MWRender
     class Water;
     class TerrainStorage;
     class LandManager;
+    class DistantObjects;
 
     class RenderingManager : public MWRender::RenderingInterface
     {
     public:
         RenderingManager(osgViewer::Viewer* viewer, osg::ref_ptr<osg::Group> rootNode, Resource::ResourceSystem* resourceSystem, SceneUtil::WorkQueue* workQueue,
-                         const Fallback::Map* fallback, const std::string& resourcePath);
+                         ToUTF8::Utf8Encoder* encoder, const Fallback::Map* fallback, const std::string& resourcePath, const std::string& cachePath);
         ~RenderingManager();
 
         MWRender::Objects& getObjects();
@@ -213,6 +221,8 @@ namespace MWRender
 
         void reportStats() const;
 
+        void addTerrainOccluder(int cellX, int cellY);
+
         osg::ref_ptr<osgUtil::IntersectionVisitor> getIntersectionVisitor(osgUtil::Intersector* intersector, bool ignorePlayer, bool ignoreActors);
 
         osg::ref_ptr<osgUtil::IntersectionVisitor> mIntersectionVisitor;
@@ -223,6 +233,7 @@ namespace MWRender
         Resource::ResourceSystem* mResourceSystem;
 
         osg::ref_ptr<SceneUtil::WorkQueue> mWorkQueue;
+        osg::ref_ptr<SceneUtil::WorkQueue> mAnimationWorkQueue;
         osg::ref_ptr<SceneUtil::UnrefQueue> mUnrefQueue;
 
         osg::ref_ptr<osg::Light> mSunLight;
@@ -231,7 +242,10 @@ namespace MWRender
         std::unique_ptr<Objects> mObjects;
         std::unique_ptr<Water> mWater;
         std::unique_ptr<Terrain::World> mTerrain;
+        std::unique_ptr<DistantObjects> mDistantObjects;
         TerrainStorage* mTerrainStorage;
+        osg::ref_ptr<SceneUtil::OcclusionCuller> mOcclusionCuller;
+        std::map<std::pair<int, int>, osg::ref_ptr<SceneUtil::Occluder> > mTerrainOccluders;
         std::unique_ptr<SkyManager> mSky;
         std::unique_ptr<EffectManager> mEffectManager;
         osg::ref_ptr<NpcAnimation> mPlayerAnimation;
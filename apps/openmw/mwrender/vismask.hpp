@@ -51,7 +51,13 @@ namespace MWRender
         Mask_PreCompile = (1<<16),
 
         // Set on a camera's cull mask to enable the LightManager
-        Mask_Lighting = (1<<17)
+        Mask_Lighting = (1<<17),
+
+        // child of Scene
+        Mask_StaticBatch = (1<<18), // merged geometry of static objects, not used for intersection tests
+        Mask_Batched = (1<<19), // set on objects drawn by a static batch instead, still used for intersection tests
+
+        Mask_DistantObjects = (1<<20) // statics of cells that are not loaded, drawn with the distant terrain
     };
 
 }
@@ -138,7 +138,7 @@ namespace MWScript
 
     InterpreterContext::InterpreterContext (
         MWScript::Locals *locals, const MWWorld::Ptr& reference, const std::string& targetId)
-    : mLocals (locals), mReference (reference), mTargetId (targetId)
+    : mLocals (locals), mReference (reference), mTargetId (targetId), mSecondsPassed (-1)
     {
         // If we run on a reference (local script, dialogue script or console with object
         // selected), store the ID of that reference store it so it can be inherited by
@@ -152,7 +152,7 @@ namespace MWScript
         if (!mLocals)
             throw std::runtime_error ("local variables not available in this context");
 
-        return mLocals->mShorts.at (index);
+        return mLocals->getShort (index);
     }
 
     int InterpreterContext::getLocalLong (int index) const
@@ -160,7 +160,7 @@ namespace MWScript
         if (!mLocals)
             throw std::runtime_error ("local variables not available in this context");
 
-        return mLocals->mLongs.at (index);
+        return mLocals->getLong (index);
     }
 
     float InterpreterContext::getLocalFloat (int index) const
@@ -168,7 +168,7 @@ namespace MWScript
         if (!mLocals)
             throw std::runtime_error ("local variables not available in this context");
 
-        return mLocals->mFloats.at (index);
+        return mLocals->getFloat (index);
     }
 
     void InterpreterContext::setLocalShort (int index, int value)
@@ -176,7 +176,7 @@ namespace MWScript
         if (!mLocals)
             throw std::runtime_error ("local variables not available in this context");
 
-        mLocals->mShorts.at (index) = value;
+        mLocals->setShort (index, value);
     }
 
     void InterpreterContext::setLocalLong (int index, int value)
@@ -184,7 +184,7 @@ namespace MWScript
         if (!mLocals)
             throw std::runtime_error ("local variables not available in this context");
 
-        mLocals->mLongs.at (index) = value;
+        mLocals->setLong (index, value);
     }
 
     void InterpreterContext::setLocalFloat (int index, float value)
@@ -192,7 +192,7 @@ namespace MWScript
         if (!mLocals)
             throw std::runtime_error ("local variables not available in this context");
 
-        mLocals->mFloats.at (index) = value;
+        mLocals->setFloat (index, value);
     }
 
     void InterpreterContext::messageBox (const std::string& message,
@@ -486,8 +486,16 @@ namespace MWScript
         }
     }
 
+    void InterpreterContext::setSecondsPassed (float duration)
+    {
+        mSecondsPassed = duration;
+    }
+
     float InterpreterContext::getSecondsPassed() const
     {
+        if (mSecondsPassed>=0)
+            return mSecondsPassed;
+
         return MWBase::Environment::get().getFrameDuration();
     }
 
@@ -516,7 +524,7 @@ namespace MWScript
 
         const Locals& locals = getMemberLocals (scriptId, global);
 
-        return locals.mShorts[findLocalVariableIndex (scriptId, name, 's')];
+        return locals.getShort (findLocalVariableIndex (scriptId, name, 's'));
     }
 
     int InterpreterContext::getMemberLong (const std::string& id, const std::string& name,
@@ -526,7 +534,7 @@ namespace MWScript
 
         const Locals& locals = getMemberLocals (scriptId, global);
 
-        return locals.mLongs[findLocalVariableIndex (scriptId, name, 'l')];
+        return locals.getLong (findLocalVariableIndex (scriptId, name, 'l'));
     }
 
     float InterpreterContext::getMemberFloat (const std::string& id, const std::string& name,
@@ -536,7 +544,7 @@ namespace MWScript
 
         const Locals& locals = getMemberLocals (scriptId, global);
 
-        return locals.mFloats[findLocalVariableIndex (scriptId, name, 'f')];
+        return locals.getFloat (findLocalVariableIndex (scriptId, name, 'f'));
     }
 
     void InterpreterContext::setMemberShort (const std::string& id, const std::string& name,
@@ -546,7 +554,7 @@ namespace MWScript
 
         Locals& locals = getMemberLocals (scriptId, global);
 
-        locals.mShorts[findLocalVariableIndex (scriptId, name, 's')] = value;
+        locals.setShort (findLocalVariableIndex (scriptId, name, 's'), value);
     }
 
     void InterpreterContext::setMemberLong (const std::string& id, const std::string& name, int value, bool global)
@@ -555,7 +563,7 @@ namespace MWScript
 
         Locals& locals = getMemberLocals (scriptId, global);
 
-        locals.mLongs[findLocalVariableIndex (scriptId, name, 'l')] = value;
+        locals.setLong (findLocalVariableIndex (scriptId, name, 'l'), value);
     }
 
     void InterpreterContext::setMemberFloat (const std::string& id, const std::string& name, float value, bool global)
@@ -564,7 +572,7 @@ namespace MWScript
 
         Locals& locals = getMemberLocals (scriptId, global);
 
-        locals.mFloats[findLocalVariableIndex (scriptId, name, 'f')] = value;
+        locals.setFloat (findLocalVariableIndex (scriptId, name, 'f'), value);
     }
 
     MWWorld::Ptr InterpreterContext::getReference(bool required)
@@ -27,6 +27,8 @@ namespace MWScript
 
             std::string mTargetId;
 
+            float mSecondsPassed;
+
             /// If \a id is empty, a reference the script is run from is returned or in case
             /// of a non-local script the reference derived from the target ID.
             MWWorld::Ptr getReferenceImp (const std::string& id = "", bool activeOnly = false,
@@ -53,6 +55,9 @@ namespace MWScript
                 const std::string& targetId = "");
             ///< The ownership of \a locals is not transferred. 0-pointer allowed.
 
+            void setSecondsPassed (float duration);
+            ///< Override the value reported by GetSecondsPassed (by default the frame duration)
+
             virtual int getLocalShort (int index) const;
 
             virtual int getLocalLong (int index) const;
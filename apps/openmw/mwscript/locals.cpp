@@ -14,6 +14,7 @@
 #include "../mwworld/esmstore.hpp"
 
 #include <iostream>
+#include <stdexcept>
 
 namespace MWScript
 {
@@ -28,7 +29,7 @@ namespace MWScript
         }
     }
 
-    Locals::Locals() : mInitialised (false) {}
+    Locals::Locals() : mInitialised (false), mNumShorts (0), mNumLongs (0), mNumFloats (0) {}
 
     bool Locals::configure (const ESM::Script& script)
     {
@@ -38,12 +39,18 @@ namespace MWScript
         const Compiler::Locals& locals =
             MWBase::Environment::get().getScriptManager()->getLocals (script.mId);
 
-        mShorts.clear();
-        mShorts.resize (locals.get ('s').size(), 0);
-        mLongs.clear();
-        mLongs.resize (locals.get ('l').size(), 0);
-        mFloats.clear();
-        mFloats.resize (locals.get ('f').size(), 0);
+        mNumShorts = static_cast<int> (locals.get ('s').size());
+        mNumLongs = static_cast<int> (locals.get ('l').size());
+        mNumFloats = static_cast<int> (locals.get ('f').size());
+
+        Interpreter::Data zero;
+        zero.mInteger = 0;
+
+        mData.assign (mNumShorts+mNumLongs, zero);
+
+        zero.mFloat = 0;
+
+        mData.resize (mNumShorts+mNumLongs+mNumFloats, zero);
 
         mInitialised = true;
         return true;
@@ -51,7 +58,43 @@ namespace MWScript
 
     bool Locals::isEmpty() const
     {
-        return (mShorts.empty() && mLongs.empty() && mFloats.empty());
+        return mData.empty();
+    }
+
+    int Locals::getInt (char type, int index) const
+    {
+        switch (type)
+        {
+            case 's': return getShort (index);
+            case 'l': return getLong (index);
+            case 'f': return static_cast<int> (getFloat (index));
+        }
+
+        throw std::logic_error ("unknown local variable type");
+    }
+
+    float Locals::getFloat (char type, int index) const
+    {
+        switch (type)
+        {
+            case 's': return static_cast<float> (getShort (index));
+            case 'l': return static_cast<float> (getLong (index));
+            case 'f': return getFloat (index);
+        }
+
+        throw std::logic_error ("unknown local variable type");
+    }
+
+    void Locals::setInt (char type, int index, int value)
+    {
+        switch (type)
+        {
+            case 's': setShort (index, value); return;
+            case 'l': setLong (index, value); return;
+            case 'f': setFloat (index, static_cast<float> (value)); return;
+        }
+
+        throw std::logic_error ("unknown local variable type");
     }
 
     bool Locals::hasVar(const std::string &script, const std::string &var)
@@ -62,8 +105,9 @@ namespace MWScript
 
             const Compiler::Locals& locals =
                 MWBase::Environment::get().getScriptManager()->getLocals(script);
-            int index = locals.getIndex(var);
-            return (index != -1);
+            char type;
+            int index;
+            return locals.lookup (var, type, index);
         }
         catch (const Compiler::SourceException&)
         {
@@ -76,24 +120,10 @@ namespace MWScript
         ensure (script);
 
         const Compiler::Locals& locals = MWBase::Environment::get().getScriptManager()->getLocals(script);
-        int index = locals.getIndex(var);
-        char type = locals.getType(var);
-        if(index != -1)
-        {
-            switch(type)
-            {
-                case 's':
-                    return mShorts.at (index);
-
-                case 'l':
-                    return mLongs.at (index);
-
-                case 'f':
-                    return static_cast<int>(mFloats.at(index));
-                default:
-                    return 0;
-            }
-        }
+        char type;
+        int index;
+        if (locals.lookup (var, type, index))
+            return getInt (type, index);
         return 0;
     }
 
@@ -102,24 +132,10 @@ namespace MWScript
         ensure (script);
 
         const Compiler::Locals& locals = MWBase::Environment::get().getScriptManager()->getLocals(script);
-        int index = locals.getIndex(var);
-        char type = locals.getType(var);
-        if(index != -1)
-        {
-            switch(type)
-            {
-                case 's':
-                    return mShorts.at (index);
-
-                case 'l':
-                    return mLongs.at (index);
-
-                case 'f':
-                    return mFloats.at(index);
-                default:
-                    return 0;
-            }
-        }
+        char type;
+        int index;
+        if (locals.lookup (var, type, index))
+            return getFloat (type, index);
         return 0;
     }
 
@@ -128,21 +144,11 @@ namespace MWScript
         ensure (script);
 
         const Compiler::Locals& locals = MWBase::Environment::get().getScriptManager()->getLocals(script);
-        int index = locals.getIndex(var);
-        char type = locals.getType(var);
-        if(index != -1)
+        char type;
+        int index;
+        if (locals.lookup (var, type, index))
         {
-            switch(type)
-            {
-                case 's':
-                    mShorts.at (index) = val; break;
-
-                case 'l':
-                    mLongs.at (index) = val; break;
-
-                case 'f':
-                    mFloats.at(index) = static_cast<float>(val); break;
-            }
+            setInt (type, index, val);
             return true;
         }
         return false;
@@ -177,9 +183,9 @@ namespace MWScript
 
                     switch (i)
                     {
-                        case 0: value.setType (ESM::VT_Int); value.setInteger (mShorts.at (i2)); break;
-                        case 1: value.setType (ESM::VT_Int); value.setInteger (mLongs.at (i2)); break;
-                        case 2: value.setType (ESM::VT_Float); value.setFloat (mFloats.at (i2)); break;
+                        case 0: value.setType (ESM::VT_Int); value.setInteger (getShort (i2)); break;
+                        case 1: value.setType (ESM::VT_Int); value.setInteger (getLong (i2)); break;
+                        case 2: value.setType (ESM::VT_Float); value.setFloat (getFloat (i2)); break;
                     }
 
                     locals.mVariables.push_back (std::make_pair (names[i2], value));
@@ -221,32 +227,33 @@ namespace MWScript
                     try
                     {
                         if (index >= numshorts+numlongs)
-                            mFloats.at(index - (numshorts+numlongs)) = iter->second.getFloat();
+                            setFloat (index - (numshorts+numlongs), iter->second.getFloat());
                         else if (index >= numshorts)
-                            mLongs.at(index - numshorts) = iter->second.getInteger();
+                            setLong (index - numshorts, iter->second.getInteger());
                         else
-                            mShorts.at(index) = iter->second.getInteger();
+                            setShort (index, iter->second.getInteger());
                     }
                     catch (std::exception& e)
                     {
                         std::cerr << "Failed to read local variable state for script '"
                                   << script << "' (legacy format): " << e.what()
-                                  << "\nNum shorts: " << numshorts << " / " << mShorts.size()
-                                  << " Num longs: " << numlongs << " / " << mLongs.size() << std::endl;
+                                  << "\nNum shorts: " << numshorts << " / " << mNumShorts
+                                  << " Num longs: " << numlongs << " / " << mNumLongs << std::endl;
                     }
                 }
                 else
                 {
-                    char type =  declarations.getType (iter->first);
-                    int index2 = declarations.getIndex (iter->first);
+                    char type = ' ';
+                    int index2 = -1;
+                    declarations.lookup (iter->first, type, index2);
 
                     try
                     {
                         switch (type)
                         {
-                            case 's': mShorts.at (index2) = iter->second.getInteger(); break;
-                            case 'l': mLongs.at (index2) = iter->second.getInteger(); break;
-                            case 'f': mFloats.at (index2) = iter->second.getFloat(); break;
+                            case 's': setShort (index2, iter->second.getInteger()); break;
+                            case 'l': setLong (index2, iter->second.getInteger()); break;
+                            case 'f': setFloat (index2, iter->second.getFloat()); break;
 
                             // silently ignore locals that don't exist anymore
                         }
@@ -2,6 +2,7 @@
 #define GAME_SCRIPT_LOCALS_H
 
 #include <vector>
+#include <string>
 
 #include <components/interpreter/types.hpp>
 
@@ -16,16 +17,53 @@ namespace MWScript
     class Locals
     {
             bool mInitialised;
+            std::vector<Interpreter::Data> mData; ///< shorts, then longs, then floats
+            int mNumShorts;
+            int mNumLongs;
+            int mNumFloats;
 
             void ensure (const std::string& scriptName);
 
+            const Interpreter::Data& get (int offset, int size, int index) const;
+
+            Interpreter::Data& get (int offset, int size, int index);
+
         public:
-            std::vector<Interpreter::Type_Short> mShorts;
-            std::vector<Interpreter::Type_Integer> mLongs;
-            std::vector<Interpreter::Type_Float> mFloats;
 
             Locals();
 
+            int getShortCount() const { return mNumShorts; }
+
+            int getLongCount() const { return mNumLongs; }
+
+            int getFloatCount() const { return mNumFloats; }
+
+            /// \note All accessors throw std::out_of_range, if \a index is not valid.
+
+            int getShort (int index) const { return get (0, mNumShorts, index).mInteger; }
+
+            int getLong (int index) const { return get (mNumShorts, mNumLongs, index).mInteger; }
+
+            float getFloat (int index) const
+            { return get (mNumShorts+mNumLongs, mNumFloats, index).mFloat; }
+
+            void setShort (int index, int value)
+            { get (0, mNumShorts, index).mInteger = static_cast<Interpreter::Type_Short> (value); }
+
+            void setLong (int index, int value) { get (mNumShorts, mNumLongs, index).mInteger = value; }
+
+            void setFloat (int index, float value)
+            { get (mNumShorts+mNumLongs, mNumFloats, index).mFloat = value; }
+
+            /// Get a variable of type \a type ('s', 'l' or 'f') converted to int.
+            int getInt (char type, int index) const;
+
+            /// Get a variable of type \a type ('s', 'l' or 'f') converted to float.
+            float getFloat (char type, int index) const;
+
+            /// Set a variable of type \a type ('s', 'l' or 'f') from an int.
+            void setInt (char type, int index, int value);
+
             /// Are there any locals?
             ///
             /// \note Will return false, if locals have not been configured yet.
@@ -65,6 +103,22 @@ namespace MWScript
             /// \note Locals will be automatically configured first, if necessary
             void read (const ESM::Locals& locals, const std::string& script);
     };
+
+    inline const Interpreter::Data& Locals::get (int offset, int size, int index) const
+    {
+        if (index<0 || index>=size)
+            throw std::out_of_range ("local variable index out of range");
+
+        return mData[offset+index];
+    }
+
+    inline Interpreter::Data& Locals::get (int offset, int size, int index)
+    {
+        if (index<0 || index>=size)
+            throw std::out_of_range ("local variable index out of range");
+
+        return mData[offset+index];
+    }
 }
 
 #endif
@@ -1,6 +1,7 @@
 #include "miscextensions.hpp"
 
 #include <cstdlib>
+#include <sstream>
 
 #include <components/compiler/extensions.hpp>
 #include <components/compiler/opcodes.hpp>
@@ -937,23 +938,23 @@ namespace MWScript
                     const std::vector<std::string> *names = &complocals.get('s');
                     for(size_t i = 0;i < names->size();++i)
                     {
-                        if(i >= locals.mShorts.size())
+                        if(i >= static_cast<size_t> (locals.getShortCount()))
                             break;
-                        str<<std::endl<< "  "<<(*names)[i]<<" = "<<locals.mShorts[i]<<" (short)";
+                        str<<std::endl<< "  "<<(*names)[i]<<" = "<<locals.getShort (i)<<" (short)";
                     }
                     names = &complocals.get('l');
                     for(size_t i = 0;i < names->size();++i)
                     {
-                        if(i >= locals.mLongs.size())
+                        if(i >= static_cast<size_t> (locals.getLongCount()))
                             break;
-                        str<<std::endl<< "  "<<(*names)[i]<<" = "<<locals.mLongs[i]<<" (long)";
+                        str<<std::endl<< "  "<<(*names)[i]<<" = "<<locals.getLong (i)<<" (long)";
                     }
                     names = &complocals.get('f');
                     for(size_t i = 0;i < names->size();++i)
                     {
-                        if(i >= locals.mFloats.size())
+                        if(i >= static_cast<size_t> (locals.getFloatCount()))
                             break;
-                        str<<std::endl<< "  "<<(*names)[i]<<" = "<<locals.mFloats[i]<<" (float)";
+                        str<<std::endl<< "  "<<(*names)[i]<<" = "<<locals.getFloat (i)<<" (float)";
                     }
                 }
 
@@ -1023,6 +1024,46 @@ namespace MWScript
             }
         };
 
+        class OpToggleScriptProfiling : public Interpreter::Opcode0
+        {
+        public:
+            virtual void execute (Interpreter::Runtime& runtime)
+            {
+                bool enabled = MWBase::Environment::get().getScriptManager()->toggleProfiling();
+
+                runtime.getContext().report(enabled ? "Script Profiling -> On" : "Script Profiling -> Off");
+            }
+        };
+
+        class OpReportScriptProfile : public Interpreter::Opcode0
+        {
+        public:
+            virtual void execute (Interpreter::Runtime& runtime)
+            {
+                MWBase::ScriptManager* scriptManager = MWBase::Environment::get().getScriptManager();
+
+                if (!scriptManager->isProfiling())
+                {
+                    runtime.getContext().report("Script profiling is disabled. Enable it with 'ToggleScriptProfiling' first.");
+                    return;
+                }
+
+                std::ostringstream summary;
+                scriptManager->reportProfile(summary, 10);
+                runtime.getContext().report(summary.str());
+
+                try
+                {
+                    const std::string& filename = scriptManager->writeProfile();
+                    runtime.getContext().report("Wrote '" + filename + "'");
+                }
+                catch (const std::exception& e)
+                {
+                    runtime.getContext().report(std::string("Failed to write script profile: ") + e.what());
+                }
+            }
+        };
+
         class OpToggleGodMode : public Interpreter::Opcode0
         {
             public:
@@ -1364,6 +1405,8 @@ namespace MWScript
             interpreter.installSegment5 (Compiler::Misc::opcodeShowExplicit, new OpShow<ExplicitRef>);
             interpreter.installSegment5 (Compiler::Misc::opcodeToggleGodMode, new OpToggleGodMode);
             interpreter.installSegment5 (Compiler::Misc::opcodeToggleScripts, new OpToggleScripts);
+            interpreter.installSegment5 (Compiler::Misc::opcodeToggleScriptProfiling, new OpToggleScriptProfiling);
+            interpreter.installSegment5 (Compiler::Misc::opcodeReportScriptProfile, new OpReportScriptProfile);
             interpreter.installSegment5 (Compiler::Misc::opcodeDisableLevitation, new OpEnableLevitation<false>);
             interpreter.installSegment5 (Compiler::Misc::opcodeEnableLevitation, new OpEnableLevitation<true>);
             interpreter.installSegment5 (Compiler::Misc::opcodeCast, new OpCast<ImplicitRef>);
@@ -5,6 +5,7 @@
 #include <sstream>
 #include <exception>
 #include <algorithm>
+#include <fstream>
 
 #include <components/esm/loadscpt.hpp>
 
@@ -23,10 +24,11 @@ namespace MWScript
 {
     ScriptManager::ScriptManager (const MWWorld::ESMStore& store,
         Compiler::Context& compilerContext, int warningsMode,
-        const std::vector<std::string>& scriptBlacklist)
+        const std::vector<std::string>& scriptBlacklist, const std::string& userDataPath)
     : mErrorHandler (std::cerr), mStore (store),
       mCompilerContext (compilerContext), mParser (mErrorHandler, mCompilerContext),
-      mOpcodesInstalled (false), mGlobalScripts (store)
+      mOpcodesInstalled (false), mGlobalScripts (store), mProfiling (false),
+      mUserDataPath (userDataPath)
     {
         mErrorHandler.setWarningsMode (warningsMode);
 
@@ -117,7 +119,7 @@ namespace MWScript
                     mOpcodesInstalled = true;
                 }
 
-                mInterpreter.run (&iter->second.first[0], iter->second.first.size(), interpreterContext);
+                mInterpreter.run (&iter->second.first[0], iter->second.first.size(), interpreterContext, name);
             }
             catch (const std::exception& e)
             {
@@ -191,4 +193,40 @@ namespace MWScript
     {
         return mGlobalScripts;
     }
+
+    bool ScriptManager::toggleProfiling()
+    {
+        mProfiling = !mProfiling;
+
+        if (mProfiling)
+            mProfiler.clear();
+
+        mInterpreter.setProfiler (mProfiling ? &mProfiler : 0);
+
+        return mProfiling;
+    }
+
+    bool ScriptManager::isProfiling() const
+    {
+        return mProfiling;
+    }
+
+    void ScriptManager::reportProfile (std::ostream& stream, std::size_t maxEntries) const
+    {
+        mProfiler.report (stream, maxEntries);
+    }
+
+    std::string ScriptManager::writeProfile() const
+    {
+        std::string file = mUserDataPath + "/scriptprofile.txt";
+
+        std::ofstream stream (file.c_str());
+
+        if (!stream.is_open())
+            throw std::runtime_error ("failed to open " + file);
+
+        mProfiler.report (stream);
+
+        return file;
+    }
 }
@@ -8,6 +8,7 @@
 #include <components/compiler/fileparser.hpp>
 
 #include <components/interpreter/interpreter.hpp>
+#include <components/interpreter/profiler.hpp>
 #include <components/interpreter/types.hpp>
 
 #include "../mwbase/scriptmanager.hpp"
@@ -48,12 +49,15 @@ namespace MWScript
             GlobalScripts mGlobalScripts;
             std::map<std::string, Compiler::Locals> mOtherLocals;
             std::vector<std::string> mScriptBlacklist;
+            Interpreter::Profiler mProfiler;
+            bool mProfiling;
+            std::string mUserDataPath;
 
         public:
 
             ScriptManager (const MWWorld::ESMStore& store,
                 Compiler::Context& compilerContext, int warningsMode,
-                const std::vector<std::string>& scriptBlacklist);
+                const std::vector<std::string>& scriptBlacklist, const std::string& userDataPath);
 
             virtual void run (const std::string& name, Interpreter::Context& interpreterContext);
             ///< Run the script with the given name (compile first, if not compiled yet)
@@ -70,6 +74,21 @@ namespace MWScript
             ///< Return locals for script \a name.
 
             virtual GlobalScripts& getGlobalScripts();
+
+            virtual bool toggleProfiling();
+            ///< Enable/disable collection of script execution statistics. Enabling discards
+            /// previously collected statistics.
+            /// \return Profiling enabled?
+
+            virtual bool isProfiling() const;
+
+            virtual void reportProfile (std::ostream& stream, std::size_t maxEntries = 0) const;
+            ///< Write collected script execution statistics to \a stream.
+            /// \param maxEntries Limit for the number of scripts and opcodes listed (0: unlimited)
+
+            virtual std::string writeProfile() const;
+            ///< Write collected script execution statistics to a file in the user data directory.
+            /// \return File name
     };
 }
 
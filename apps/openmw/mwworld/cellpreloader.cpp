@@ -188,6 +188,15 @@ namespace MWWorld
         Resource::ResourceSystem* mResourceSystem;
     };
 
+    const double CellPreloader::sStaleDelay = 1.0;
+
+    /// Cancel \a item if it was not started yet, otherwise ask it to finish early.
+    static void cancelWorkItem(SceneUtil::WorkQueue* workQueue, SceneUtil::WorkItem* item)
+    {
+        if (!workQueue || !workQueue->cancel(item))
+            item->abort();
+    }
+
     CellPreloader::CellPreloader(Resource::ResourceSystem* resourceSystem, Resource::BulletShapeManager* bulletShapeManager, Terrain::World* terrain, MWRender::LandManager* landManager)
         : mResourceSystem(resourceSystem)
         , mBulletShapeManager(bulletShapeManager)
@@ -217,7 +226,7 @@ namespace MWWorld
         }
 
         for (PreloadMap::iterator it = mPreloadCells.begin(); it != mPreloadCells.end();++it)
-            it->second.mWorkItem->abort();
+            cancelWorkItem(mWorkQueue.get(), it->second.mWorkItem);
 
         for (PreloadMap::iterator it = mPreloadCells.begin(); it != mPreloadCells.end();++it)
             it->second.mWorkItem->waitTillDone();
@@ -225,7 +234,7 @@ namespace MWWorld
         mPreloadCells.clear();
     }
 
-    void CellPreloader::preload(CellStore *cell, double timestamp)
+    void CellPreloader::preload(CellStore *cell, double timestamp, bool urgent)
     {
         if (!mWorkQueue)
         {
@@ -243,6 +252,8 @@ namespace MWWorld
         {
             // already preloaded, nothing to do other than updating the timestamp
             found->second.mTimeStamp = timestamp;
+            if (urgent && !found->second.mWorkItem->isDone())
+                mWorkQueue->setPriority(found->second.mWorkItem, Priority_Urgent, true);
             return;
         }
 
@@ -263,7 +274,7 @@ namespace MWWorld
 
             if (oldestTimestamp + threshold < timestamp)
             {
-                oldestCell->second.mWorkItem->abort();
+                cancelWorkItem(mWorkQueue.get(), oldestCell->second.mWorkItem);
                 mPreloadCells.erase(oldestCell);
             }
             else
@@ -271,7 +282,8 @@ namespace MWWorld
         }
 
         osg::ref_ptr<PreloadItem> item (new PreloadItem(cell, mResourceSystem->getSceneManager(), mBulletShapeManager, mResourceSystem->getKeyframeManager(), mTerrain, mLandManager, mPreloadInstances));
-        mWorkQueue->addWorkItem(item);
+        item->setPriority(urgent ? Priority_Urgent : Priority_Normal);
+        mWorkQueue->addWorkItem(item, urgent);
 
         mPreloadCells[cell] = PreloadEntry(timestamp, item);
     }
@@ -284,7 +296,7 @@ namespace MWWorld
             // do the deletion in the background thread
             if (found->second.mWorkItem)
             {
-                found->second.mWorkItem->abort();
+                cancelWorkItem(mWorkQueue.get(), found->second.mWorkItem);
                 mUnrefQueue->push(mPreloadCells[cell].mWorkItem);
             }
 
@@ -298,7 +310,7 @@ namespace MWWorld
         {
             if (it->second.mWorkItem)
             {
-                it->second.mWorkItem->abort();
+                cancelWorkItem(mWorkQueue.get(), it->second.mWorkItem);
                 mUnrefQueue->push(it->second.mWorkItem);
             }
 
@@ -314,11 +326,19 @@ namespace MWWorld
             {
                 if (it->second.mWorkItem)
                 {
-                    it->second.mWorkItem->abort();
+                    cancelWorkItem(mWorkQueue.get(), it->second.mWorkItem);
                     mUnrefQueue->push(it->second.mWorkItem);
                 }
                 mPreloadCells.erase(it++);
             }
+            // drop the preloads that were requested for a cell the player has since moved away from, but not started yet,
+            // so that they don't hold up the work that is still needed
+            else if (it->second.mWorkItem && it->second.mTimeStamp < timestamp - sStaleDelay
+                     && mWorkQueue && mWorkQueue->cancel(it->second.mWorkItem))
+            {
+                mUnrefQueue->push(it->second.mWorkItem);
+                mPreloadCells.erase(it++);
+            }
             else
                 ++it;
         }
@@ -39,8 +39,9 @@ namespace MWWorld
         ~CellPreloader();
 
         /// Ask a background thread to preload rendering meshes and collision shapes for objects in this cell.
+        /// @param urgent Preload the cell ahead of other work, including cells that were requested earlier but not started yet.
         /// @note The cell itself must be in State_Loaded or State_Preloaded.
-        void preload(MWWorld::CellStore* cell, double timestamp);
+        void preload(MWWorld::CellStore* cell, double timestamp, bool urgent=false);
 
         void notifyLoaded(MWWorld::CellStore* cell);
 
@@ -70,6 +71,16 @@ namespace MWWorld
         void setTerrainPreloadPositions(const std::vector<osg::Vec3f>& positions);
 
     private:
+        /// Priorities of the preload items in the work queue.
+        enum Priority
+        {
+            Priority_Normal = 0,
+            Priority_Urgent = 1
+        };
+
+        /// How long a preload can wait in the work queue without being requested again before it is cancelled, in seconds.
+        static const double sStaleDelay;
+
         Resource::ResourceSystem* mResourceSystem;
         Resource::BulletShapeManager* mBulletShapeManager;
         Terrain::World* mTerrain;
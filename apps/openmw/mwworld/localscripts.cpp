@@ -1,7 +1,10 @@
 #include "localscripts.hpp"
 
+#include <algorithm>
 #include <iostream>
 
+#include <components/settings/settings.hpp>
+
 #include "esmstore.hpp"
 #include "cellstore.hpp"
 
@@ -61,22 +64,73 @@ namespace
 
 }
 
-MWWorld::LocalScripts::LocalScripts (const MWWorld::ESMStore& store) : mStore (store)
+MWWorld::LocalScripts::LocalScripts (const MWWorld::ESMStore& store)
+: mIter (0), mStore (store), mFrameDuration (0), mTimeStamp (0), mFrame (0), mIterationStart (0)
+{
+    float updateDistance = Settings::Manager::getFloat ("local script update distance", "Game");
+    mUpdateDistance2 = updateDistance>0 ? updateDistance*updateDistance : 0;
+    mDistantInterval = std::max (0.f, Settings::Manager::getFloat ("distant local script interval", "Game"));
+    mTimeBudget = std::max (0.f, Settings::Manager::getFloat ("local script time budget", "Game")) / 1000.0;
+}
+
+bool MWWorld::LocalScripts::isDistant (const Ptr& ptr) const
+{
+    if (mUpdateDistance2<=0)
+        return false;
+
+    // The position of items in containers is meaningless.
+    if (!ptr.isInCell())
+        return false;
+
+    return (ptr.getRefData().getPosition().asVec3() - mViewPosition).length2() > mUpdateDistance2;
+}
+
+void MWWorld::LocalScripts::erase (std::size_t index)
 {
-    mIter = mScripts.end();
+    mScripts.erase (mScripts.begin()+index);
+
+    if (index<mIter)
+        --mIter;
 }
 
-void MWWorld::LocalScripts::startIteration()
+void MWWorld::LocalScripts::startIteration (float duration, const osg::Vec3f& viewPosition)
 {
-    mIter = mScripts.begin();
+    mIter = 0;
+    mViewPosition = viewPosition;
+    mFrameDuration = duration;
+    mTimeStamp += duration;
+    ++mFrame;
+    mIterationStart = osg::Timer::instance()->tick();
 }
 
-bool MWWorld::LocalScripts::getNext(std::pair<std::string, Ptr>& script)
+bool MWWorld::LocalScripts::getNext (std::pair<std::string, Ptr>& script, float& secondsPassed)
 {
-    while (mIter!=mScripts.end())
+    while (mIter<mScripts.size())
     {
-        std::list<std::pair<std::string, Ptr> >::iterator iter = mIter++;
-        script = *iter;
+        Entry& entry = mScripts[mIter++];
+
+        if (entry.mLastRun>=0 && isDistant (entry.mPtr))
+        {
+            if (mTimeStamp-entry.mLastRun < mDistantInterval)
+                continue;
+
+            // Scripts skipped due to the budget stay due and get their turn in the next frame,
+            // since the scripts that did run are not due again until the interval has passed.
+            if (mTimeBudget>0 &&
+                osg::Timer::instance()->delta_s (mIterationStart, osg::Timer::instance()->tick())>mTimeBudget)
+                continue;
+        }
+
+        if (entry.mLastRun<0 || entry.mLastFrame+1==mFrame)
+            secondsPassed = mFrameDuration;
+        else
+            secondsPassed = static_cast<float> (mTimeStamp-entry.mLastRun);
+
+        entry.mLastRun = mTimeStamp;
+        entry.mLastFrame = mFrame;
+
+        script.first = entry.mScript;
+        script.second = entry.mPtr;
         return true;
     }
     return false;
@@ -90,15 +144,15 @@ void MWWorld::LocalScripts::add (const std::string& scriptName, const Ptr& ptr)
         {
             ptr.getRefData().setLocals (*script);
 
-            for (std::list<std::pair<std::string, Ptr> >::iterator iter = mScripts.begin(); iter!=mScripts.end(); ++iter)
-                if (iter->second==ptr)
+            for (std::vector<Entry>::const_iterator iter = mScripts.begin(); iter!=mScripts.end(); ++iter)
+                if (iter->mPtr==ptr)
                 {
                     std::cerr << "Error: tried to add local script twice for " << ptr.getCellRef().getRefId() << std::endl;
                     remove(ptr);
                     break;
                 }
 
-            mScripts.push_back (std::make_pair (scriptName, ptr));
+            mScripts.push_back (Entry (scriptName, ptr));
         }
         catch (const std::exception& exception)
         {
@@ -127,50 +181,50 @@ void MWWorld::LocalScripts::addCell (CellStore *cell)
 void MWWorld::LocalScripts::clear()
 {
     mScripts.clear();
+    mIter = 0;
 }
 
 void MWWorld::LocalScripts::clearCell (CellStore *cell)
 {
-    std::list<std::pair<std::string, Ptr> >::iterator iter = mScripts.begin();
+    std::size_t target = 0;
+    std::size_t iter = mIter;
 
-    while (iter!=mScripts.end())
+    for (std::size_t i=0; i<mScripts.size(); ++i)
     {
-        if (iter->second.mCell==cell)
+        if (mScripts[i].mPtr.mCell==cell)
         {
-            if (iter==mIter)
-               ++mIter;
-
-            mScripts.erase (iter++);
+            if (i<mIter)
+                --iter;
         }
         else
-            ++iter;
+        {
+            if (target!=i)
+                mScripts[target] = mScripts[i];
+
+            ++target;
+        }
     }
+
+    mScripts.resize (target, Entry ("", Ptr()));
+    mIter = iter;
 }
 
 void MWWorld::LocalScripts::remove (RefData *ref)
 {
-    for (std::list<std::pair<std::string, Ptr> >::iterator iter = mScripts.begin();
-        iter!=mScripts.end(); ++iter)
-        if (&(iter->second.getRefData()) == ref)
+    for (std::size_t i=0; i<mScripts.size(); ++i)
+        if (&(mScripts[i].mPtr.getRefData()) == ref)
         {
-            if (iter==mIter)
-                ++mIter;
-
-            mScripts.erase (iter);
+            erase (i);
             break;
         }
 }
 
 void MWWorld::LocalScripts::remove (const Ptr& ptr)
 {
-    for (std::list<std::pair<std::string, Ptr> >::iterator iter = mScripts.begin();
-        iter!=mScripts.end(); ++iter)
-        if (iter->second==ptr)
+    for (std::size_t i=0; i<mScripts.size(); ++i)
+        if (mScripts[i].mPtr==ptr)
         {
-            if (iter==mIter)
-                ++mIter;
-
-            mScripts.erase (iter);
+            erase (i);
             break;
         }
 }
@@ -1,8 +1,11 @@
 #ifndef GAME_MWWORLD_LOCALSCRIPTS_H
 #define GAME_MWWORLD_LOCALSCRIPTS_H
 
-#include <list>
 #include <string>
+#include <vector>
+
+#include <osg/Timer>
+#include <osg/Vec3f>
 
 #include "ptr.hpp"
 
@@ -13,21 +16,53 @@ namespace MWWorld
     class RefData;
 
     /// \brief List of active local scripts
+    ///
+    /// Scripts of references further away from the viewer than the configured update distance
+    /// are only run every few frames and only as long as the per-frame time budget allows. The
+    /// time elapsed since the last run is reported back to the caller, so GetSecondsPassed stays
+    /// meaningful for these scripts.
     class LocalScripts
     {
-            std::list<std::pair<std::string, Ptr> > mScripts;
-            std::list<std::pair<std::string, Ptr> >::iterator mIter;
+            struct Entry
+            {
+                std::string mScript;
+                Ptr mPtr;
+                double mLastRun; ///< time stamp of the last run (negative: never run)
+                unsigned int mLastFrame;
+
+                Entry (const std::string& script, const Ptr& ptr)
+                : mScript (script), mPtr (ptr), mLastRun (-1), mLastFrame (0) {}
+            };
+
+            std::vector<Entry> mScripts;
+            std::size_t mIter;
             const MWWorld::ESMStore& mStore;
 
+            float mUpdateDistance2;
+            float mDistantInterval;
+            double mTimeBudget;
+
+            osg::Vec3f mViewPosition;
+            float mFrameDuration;
+            double mTimeStamp;
+            unsigned int mFrame;
+            osg::Timer_t mIterationStart;
+
+            bool isDistant (const Ptr& ptr) const;
+
+            void erase (std::size_t index);
+
         public:
 
             LocalScripts (const MWWorld::ESMStore& store);
 
-            void startIteration();
-            ///< Set the iterator to the begin of the script list.
+            void startIteration (float duration, const osg::Vec3f& viewPosition);
+            ///< Set the iterator to the begin of the script list and start a new frame.
+            /// \param duration Time passed since the last iteration
 
-            bool getNext(std::pair<std::string, Ptr>& script);
-            ///< Get next local script
+            bool getNext (std::pair<std::string, Ptr>& script, float& secondsPassed);
+            ///< Get next local script that is due to run in this frame
+            /// @param secondsPassed Time passed since the script was last run
             /// @return Did we get a script?
 
             void add (const std::string& scriptName, const Ptr& ptr);
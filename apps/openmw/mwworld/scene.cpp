@@ -474,6 +474,7 @@ namespace MWWorld
         MWBase::Environment::get().getWorld()->adjustSky();
 
         mLastPlayerPos = pos.asVec3();
+        mPlayerVelocity = osg::Vec3f();
     }
 
     Scene::Scene (MWRender::RenderingManager& rendering, MWPhysics::PhysicsSystem *physics)
@@ -700,13 +701,21 @@ namespace MWWorld
         const MWWorld::ConstPtr player = MWBase::Environment::get().getWorld()->getPlayerPtr();
         osg::Vec3f playerPos = player.getRefData().getPosition().asVec3();
         osg::Vec3f moved = playerPos - mLastPlayerPos;
-        osg::Vec3f predictedPos = playerPos + moved / dt * mPredictionTime;
+        mLastPlayerPos = playerPos;
+
+        // Average the velocity over the last few updates, so that a short stop or sidestep doesn't throw off the prediction.
+        // Moving more than a cell per update means a teleport, which says nothing about where the player is heading.
+        const float velocitySmoothing = 0.3f;
+        if (moved.length2() > 8192*8192)
+            mPlayerVelocity = osg::Vec3f();
+        else
+            mPlayerVelocity = mPlayerVelocity * (1.f - velocitySmoothing) + moved * (velocitySmoothing / dt);
+
+        osg::Vec3f predictedPos = playerPos + mPlayerVelocity * mPredictionTime;
 
         if (mCurrentCell->isExterior())
             exteriorPositions.push_back(predictedPos);
 
-        mLastPlayerPos = playerPos;
-
         if (mPreloadEnabled)
         {
             if (mPreloadDoors)
@@ -774,34 +783,52 @@ namespace MWWorld
 
         int halfGridSizePlusOne = mHalfGridSize + 1;
 
+        // Check the path to the predicted position every half cell, so that no cells are skipped when moving fast.
+        // When moving fast, the path may also lead past the cells next to the grid.
+        osg::Vec2f path (predictedPos.x() - playerPos.x(), predictedPos.y() - playerPos.y());
+        int numSteps = static_cast<int>(std::ceil(path.length() / 4096.f));
+        int range = halfGridSizePlusOne + std::min(static_cast<int>(std::ceil(path.length() / 8192.f)), 3);
 
         int cellX,cellY;
         getGridCenter(cellX,cellY);
 
-        float centerX, centerY;
-        MWBase::Environment::get().getWorld()->indexToPosition(cellX, cellY, centerX, centerY, true);
+        float loadDist = 8192/2 + 8192 - mCellLoadingThreshold + mPreloadDistance;
 
-        for (int dx = -halfGridSizePlusOne; dx <= halfGridSizePlusOne; ++dx)
+        // <step at which the cell comes within the loading distance, distance>, cell
+        typedef std::pair<std::pair<int, float>, std::pair<int, int> > Candidate;
+        std::vector<Candidate> candidates;
+
+        for (int dx = -range; dx <= range; ++dx)
         {
-            for (int dy = -halfGridSizePlusOne; dy <= halfGridSizePlusOne; ++dy)
+            for (int dy = -range; dy <= range; ++dy)
             {
-                if (dy != halfGridSizePlusOne && dy != -halfGridSizePlusOne && dx != halfGridSizePlusOne && dx != -halfGridSizePlusOne)
+                if (std::abs(dx) <= mHalfGridSize && std::abs(dy) <= mHalfGridSize)
                     continue; // only care about the outer (not yet loaded) part of the grid
 
                 float thisCellCenterX, thisCellCenterY;
                 MWBase::Environment::get().getWorld()->indexToPosition(cellX+dx, cellY+dy, thisCellCenterX, thisCellCenterY, true);
 
-                float dist = std::max(std::abs(thisCellCenterX - playerPos.x()), std::abs(thisCellCenterY - playerPos.y()));
-                dist = std::min(dist,std::max(std::abs(thisCellCenterX - predictedPos.x()), std::abs(thisCellCenterY - predictedPos.y())));
-                float loadDist = 8192/2 + 8192 - mCellLoadingThreshold + mPreloadDistance;
-
-                if (dist < loadDist)
-                    preloadCell(MWBase::Environment::get().getWorld()->getExterior(cellX+dx, cellY+dy));
+                for (int step = 0; step <= numSteps; ++step)
+                {
+                    osg::Vec2f pos = osg::Vec2f(playerPos.x(), playerPos.y()) + path * (numSteps ? step / float(numSteps) : 0.f);
+                    float dist = std::max(std::abs(thisCellCenterX - pos.x()), std::abs(thisCellCenterY - pos.y()));
+                    if (dist < loadDist)
+                    {
+                        candidates.push_back(std::make_pair(std::make_pair(step, dist), std::make_pair(cellX+dx, cellY+dy)));
+                        break;
+                    }
+                }
             }
         }
+
+        // The cells that are needed soonest are preloaded first, ahead of door and travel destinations.
+        // Urgent requests go to the front of the queue, so they are made starting with the cell needed last.
+        std::sort(candidates.begin(), candidates.end());
+        for (std::vector<Candidate>::reverse_iterator it = candidates.rbegin(); it != candidates.rend(); ++it)
+            preloadCell(MWBase::Environment::get().getWorld()->getExterior(it->second.first, it->second.second), false, true);
     }
 
-    void Scene::preloadCell(CellStore *cell, bool preloadSurrounding)
+    void Scene::preloadCell(CellStore *cell, bool preloadSurrounding, bool urgent)
     {
         if (preloadSurrounding && cell->isExterior())
         {
@@ -812,14 +839,14 @@ namespace MWWorld
             {
                 for (int dy = -mHalfGridSize; dy <= mHalfGridSize; ++dy)
                 {
-                    mPreloader->preload(MWBase::Environment::get().getWorld()->getExterior(x+dx, y+dy), mRendering.getReferenceTime());
+                    mPreloader->preload(MWBase::Environment::get().getWorld()->getExterior(x+dx, y+dy), mRendering.getReferenceTime(), urgent);
                     if (++numpreloaded >= mPreloader->getMaxCacheSize())
                         break;
                 }
             }
         }
         else
-            mPreloader->preload(cell, mRendering.getReferenceTime());
+            mPreloader->preload(cell, mRendering.getReferenceTime(), urgent);
     }
 
     void Scene::preloadTerrain(const osg::Vec3f &pos)
@@ -70,6 +70,8 @@ namespace MWWorld
             float mPredictionTime;
 
             osg::Vec3f mLastPlayerPos;
+            /// Averaged over the last few preloading updates.
+            osg::Vec3f mPlayerVelocity;
 
             void insertCell (CellStore &cell, bool rescale, Loading::Listener* loadingListener);
 
@@ -89,7 +91,7 @@ namespace MWWorld
 
             ~Scene();
 
-            void preloadCell(MWWorld::CellStore* cell, bool preloadSurrounding=false);
+            void preloadCell(MWWorld::CellStore* cell, bool preloadSurrounding=false, bool urgent=false);
             void preloadTerrain(const osg::Vec3f& pos);
 
             void unloadCell (CellStoreCollection::iterator iter);
@@ -35,6 +35,7 @@ namespace Resource
 namespace SceneUtil
 {
     class WorkQueue;
+    class JobSystem;
 }
 
 namespace ESM
@@ -182,11 +183,11 @@ namespace MWWorld
             World (
                 osgViewer::Viewer* viewer,
                 osg::ref_ptr<osg::Group> rootNode,
-                Resource::ResourceSystem* resourceSystem, SceneUtil::WorkQueue* workQueue,
+                Resource::ResourceSystem* resourceSystem, SceneUtil::WorkQueue* workQueue, SceneUtil::JobSystem* jobSystem,
                 const Files::Collections& fileCollections,
                 const std::vector<std::string>& contentFiles,
                 ToUTF8::Utf8Encoder* encoder, const std::map<std::string,std::string>& fallbackMap,
-                int activationDistanceOverride, const std::string& startCell, const std::string& startupScript, const std::string& resourcePath, const std::string& userDataPath);
+                int activationDistanceOverride, const std::string& startCell, const std::string& startupScript, const std::string& resourcePath, const std::string& userDataPath, const std::string& cachePath);
 
             virtual ~World();
 
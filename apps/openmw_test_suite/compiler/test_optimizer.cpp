@@ -0,0 +1,446 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+#include "components/compiler/context.hpp"
+#include "components/compiler/extensions.hpp"
+#include "components/compiler/extensions0.hpp"
+#include "components/compiler/fileparser.hpp"
+#include "components/compiler/locals.hpp"
+#include "components/compiler/scanner.hpp"
+#include "components/compiler/streamerrorhandler.hpp"
+#include "components/interpreter/context.hpp"
+#include "components/interpreter/installopcodes.hpp"
+#include "components/interpreter/interpreter.hpp"
+
+namespace
+{
+    class TestCompilerContext : public Compiler::Context
+    {
+        public:
+
+            virtual bool canDeclareLocals() const { return true; }
+            virtual char getGlobalType (const std::string& name) const { return ' '; }
+            virtual std::pair<char, bool> getMemberType (const std::string& name, const std::string& id) const { return std::make_pair (' ', false); }
+            virtual bool isId (const std::string& name) const { return false; }
+            virtual bool isJournalId (const std::string& name) const { return false; }
+    };
+
+    /// Only provides local variables, the scripts under test do not use anything else.
+    class TestInterpreterContext : public Interpreter::Context
+    {
+        public:
+
+            std::vector<int> mShorts;
+            std::vector<int> mLongs;
+            std::vector<float> mFloats;
+
+            virtual int getLocalShort (int index) const { return mShorts.at (index); }
+            virtual int getLocalLong (int index) const { return mLongs.at (index); }
+            virtual float getLocalFloat (int index) const { return mFloats.at (index); }
+            virtual void setLocalShort (int index, int value) { mShorts.at (index) = static_cast<short> (value); }
+            virtual void setLocalLong (int index, int value) { mLongs.at (index) = value; }
+            virtual void setLocalFloat (int index, float value) { mFloats.at (index) = value; }
+
+            virtual void messageBox (const std::string& message, const std::vector<std::string>& buttons) { unsupported(); }
+            virtual void report (const std::string& message) { unsupported(); }
+            virtual bool menuMode() { return false; }
+            virtual int getGlobalShort (const std::string& name) const { return unsupported(); }
+            virtual int getGlobalLong (const std::string& name) const { return unsupported(); }
+            virtual float getGlobalFloat (const std::string& name) const { return unsupported(); }
+            virtual void setGlobalShort (const std::string& name, int value) { unsupported(); }
+            virtual void setGlobalLong (const std::string& name, int value) { unsupported(); }
+            virtual void setGlobalFloat (const std::string& name, float value) { unsupported(); }
+            virtual std::vector<std::string> getGlobals() const { unsupported(); return std::vector<std::string>(); }
+            virtual char getGlobalType (const std::string& name) const { return unsupported(); }
+            virtual std::string getActionBinding (const std::string& action) const { return unsupportedString(); }
+            virtual std::string getNPCName() const { return unsupportedString(); }
+            virtual std::string getNPCRace() const { return unsupportedString(); }
+            virtual std::string getNPCClass() const { return unsupportedString(); }
+            virtual std::string getNPCFaction() const { return unsupportedString(); }
+            virtual std::string getNPCRank() const { return unsupportedString(); }
+            virtual std::string getPCName() const { return unsupportedString(); }
+            virtual std::string getPCRace() const { return unsupportedString(); }
+            virtual std::string getPCClass() const { return unsupportedString(); }
+            virtual std::string getPCRank() const { return unsupportedString(); }
+            virtual std::string getPCNextRank() const { return unsupportedString(); }
+            virtual int getPCBounty() const { return unsupported(); }
+            virtual std::string getCurrentCellName() const { return unsupportedString(); }
+            virtual bool isScriptRunning (const std::string& name) const { return unsupported(); }
+            virtual void startScript (const std::string& name, const std::string& targetId) { unsupported(); }
+            virtual void stopScript (const std::string& name) { unsupported(); }
+            virtual float getDistance (const std::string& name, const std::string& id) const { return unsupported(); }
+            virtual float getSecondsPassed() const { return 0.5f; }
+            virtual bool isDisabled (const std::string& id) const { return unsupported(); }
+            virtual void enable (const std::string& id) { unsupported(); }
+            virtual void disable (const std::string& id) { unsupported(); }
+            virtual int getMemberShort (const std::string& id, const std::string& name, bool global) const { return unsupported(); }
+            virtual int getMemberLong (const std::string& id, const std::string& name, bool global) const { return unsupported(); }
+            virtual float getMemberFloat (const std::string& id, const std::string& name, bool global) const { return unsupported(); }
+            virtual void setMemberShort (const std::string& id, const std::string& name, int value, bool global) { unsupported(); }
+            virtual void setMemberLong (const std::string& id, const std::string& name, int value, bool global) { unsupported(); }
+            virtual void setMemberFloat (const std::string& id, const std::string& name, float value, bool global) { unsupported(); }
+            virtual std::string getTargetId() const { return unsupportedString(); }
+
+        private:
+
+            int unsupported() const
+            {
+                throw std::runtime_error ("unsupported by the test context");
+            }
+
+            std::string unsupportedString() const
+            {
+                unsupported();
+                return std::string();
+            }
+    };
+
+    struct ScriptResult
+    {
+        std::vector<int> mShorts;
+        std::vector<int> mLongs;
+        std::vector<float> mFloats;
+        std::string mError;
+        Interpreter::Type_Code mCodeSize;
+    };
+
+    /// Generates random scripts of nested conditions, loops and returns on literals and locals.
+    class ScriptGenerator
+    {
+        public:
+
+            ScriptGenerator (unsigned int seed) : mState (seed), mNumCounters (0) {}
+
+            std::string generate()
+            {
+                std::vector<std::string> body;
+                block (3, "", body);
+
+                std::ostringstream script;
+                script << "begin test\nshort sa\nshort sb\nlong la\nlong lb\nfloat fa\nfloat fb\n";
+                for (int i=0; i<mNumCounters; ++i)
+                    script << "long g" << i << "\n";
+                for (std::vector<std::string>::const_iterator it = body.begin(); it != body.end(); ++it)
+                    script << *it << "\n";
+                script << "end\n";
+                return script.str();
+            }
+
+        private:
+
+            unsigned int random (unsigned int range)
+            {
+                mState = mState * 1103515245u + 12345u;
+                return (mState >> 16) % range;
+            }
+
+            std::string literal()
+            {
+                static const char* values[] = { "0", "1", "2", "3", "-1", "5", "100", "16777215", "16777216", "2147483647",
+                    "-2147483647", "0.5", "1.5", "0.0", "-2.25", "3.0", "100000000.0", "0.001",
+                    "sa", "sb", "la", "lb", "fa", "fb" };
+                return values[random (sizeof (values) / sizeof (values[0]))];
+            }
+
+            std::string expression (int depth)
+            {
+                if (depth<=0 || random (10)<3)
+                    return literal();
+
+                switch (random (7))
+                {
+                    case 0: return "-( " + expression (depth-1) + " )";
+                    case 1: return "( " + expression (depth-1) + " )";
+                }
+
+                static const char* operators[] = { "+", "-", "*", "/" };
+                return expression (depth-1) + " " + operators[random (4)] + " " + expression (depth-1);
+            }
+
+            std::string condition (int depth)
+            {
+                static const char* operators[] = { "==", "!=", "<", "<=", ">", ">=" };
+                return "( " + expression (depth) + " " + operators[random (6)] + " " + expression (depth) + " )";
+            }
+
+            void block (int depth, const std::string& indent, std::vector<std::string>& lines)
+            {
+                static const char* locals[] = { "sa", "sb", "la", "lb", "fa", "fb" };
+
+                for (unsigned int count = random (4) + 1; count>0; --count)
+                {
+                    unsigned int kind = depth>0 ? random (10) : 0;
+                    if (kind<5)
+                        lines.push_back (indent + "set " + locals[random (6)] + " to " + expression (3));
+                    else if (kind<7)
+                    {
+                        lines.push_back (indent + "if " + condition (2));
+                        block (depth-1, indent + "  ", lines);
+                        for (unsigned int i = random (3); i>0; --i)
+                        {
+                            lines.push_back (indent + "elseif " + condition (2));
+                            block (depth-1, indent + "  ", lines);
+                        }
+                        if (random (2))
+                        {
+                            lines.push_back (indent + "else");
+                            block (depth-1, indent + "  ", lines);
+                        }
+                        lines.push_back (indent + "endif");
+                    }
+                    else if (kind<9)
+                    {
+                        std::ostringstream counter;
+                        counter << "g" << mNumCounters++;
+                        std::ostringstream limit;
+                        limit << random (6);
+                        lines.push_back (indent + "set " + counter.str() + " to 0");
+                        lines.push_back (indent + "while ( " + counter.str() + " < " + limit.str() + " )");
+                        lines.push_back (indent + "  set " + counter.str() + " to " + counter.str() + " + 1");
+                        block (depth-1, indent + "  ", lines);
+                        lines.push_back (indent + "endwhile");
+                    }
+                    else
+                    {
+                        lines.push_back (indent + "if " + condition (1));
+                        lines.push_back (indent + "  return");
+                        lines.push_back (indent + "endif");
+                    }
+                }
+            }
+
+            unsigned int mState;
+            int mNumCounters;
+    };
+
+    bool sameFloat (float a, float b)
+    {
+        return a==b || (std::isnan (a) && std::isnan (b));
+    }
+}
+
+struct OptimizerTest : public ::testing::Test
+{
+    protected:
+
+        Compiler::Extensions mExtensions;
+        TestCompilerContext mCompilerContext;
+        Interpreter::Interpreter mInterpreter;
+
+        virtual void SetUp()
+        {
+            Compiler::registerExtensions (mExtensions);
+            mCompilerContext.setExtensions (&mExtensions);
+            Interpreter::installOpcodes (mInterpreter);
+        }
+
+        /// Compile \a script, then run it \a runs times.
+        /// \return false if the script does not compile.
+        bool run (const std::string& script, bool optimize, ScriptResult& result, int runs = 3)
+        {
+            std::istringstream input (script);
+            std::ostringstream errors;
+            Compiler::StreamErrorHandler errorHandler (errors);
+            Compiler::FileParser parser (errorHandler, mCompilerContext);
+            Compiler::Scanner scanner (errorHandler, input, &mExtensions);
+
+            try
+            {
+                scanner.scan (parser);
+            }
+            catch (const std::exception&)
+            {
+                return false;
+            }
+            if (!errorHandler.isGood())
+                return false;
+
+            std::vector<Interpreter::Type_Code> code;
+            parser.getCode (code, optimize);
+            result.mCodeSize = code[0];
+
+            TestInterpreterContext context;
+            context.mShorts.assign (parser.getLocals().get ('s').size(), 0);
+            context.mLongs.assign (parser.getLocals().get ('l').size(), 0);
+            context.mFloats.assign (parser.getLocals().get ('f').size(), 0);
+
+            try
+            {
+                for (int i=0; i<runs; ++i)
+                    mInterpreter.run (&code[0], code.size(), context);
+            }
+            catch (const std::exception& e)
+            {
+                result.mError = e.what();
+            }
+
+            result.mShorts = context.mShorts;
+            result.mLongs = context.mLongs;
+            result.mFloats = context.mFloats;
+            return true;
+        }
+
+        /// Check that \a script has the same effect with and without the optimizer.
+        /// \return The result of the optimized script.
+        ScriptResult expectSameResult (const std::string& script)
+        {
+            ScriptResult plain;
+            ScriptResult optimized;
+            bool compiled = run (script, false, plain);
+            EXPECT_EQ (compiled, run (script, true, optimized)) << script;
+            if (!compiled)
+                return optimized;
+
+            EXPECT_EQ (plain.mError, optimized.mError) << script;
+            EXPECT_EQ (plain.mShorts, optimized.mShorts) << script;
+            EXPECT_EQ (plain.mLongs, optimized.mLongs) << script;
+            EXPECT_EQ (plain.mFloats.size(), optimized.mFloats.size()) << script;
+            for (std::size_t i=0; i<plain.mFloats.size() && i<optimized.mFloats.size(); ++i)
+                EXPECT_PRED2 (sameFloat, plain.mFloats[i], optimized.mFloats[i]) << script;
+            EXPECT_LE (optimized.mCodeSize, plain.mCodeSize) << script;
+            return optimized;
+        }
+};
+
+TEST_F (OptimizerTest, constant_expressions_are_folded)
+{
+    const std::string script =
+        "begin test\n"
+        "short a\n"
+        "long b\n"
+        "float c\n"
+        "set a to 2 + 3 * 4\n"
+        "set b to 100000 * 3 - 7\n"
+        "set c to 1.5 / 2 + 3\n"
+        "end\n";
+
+    ScriptResult plain;
+    ASSERT_TRUE (run (script, false, plain));
+    ScriptResult result = expectSameResult (script);
+    EXPECT_LT (result.mCodeSize, plain.mCodeSize);
+    EXPECT_EQ (14, result.mShorts[0]);
+    EXPECT_EQ (299993, result.mLongs[0]);
+    EXPECT_FLOAT_EQ (3.75f, result.mFloats[0]);
+}
+
+TEST_F (OptimizerTest, constant_and_variable_branches)
+{
+    ScriptResult result = expectSameResult (
+        "begin test\n"
+        "short a\n"
+        "short b\n"
+        "if ( 1 )\n"
+        "  set a to a + 1\n"
+        "else\n"
+        "  set a to 100\n"
+        "endif\n"
+        "if ( 0 )\n"
+        "  set b to 5\n"
+        "elseif ( a > 2 )\n"
+        "  set b to b + 10\n"
+        "else\n"
+        "  set b to b - 1\n"
+        "endif\n"
+        "end\n");
+
+    EXPECT_EQ (3, result.mShorts[0]);
+    EXPECT_EQ (8, result.mShorts[1]);
+}
+
+TEST_F (OptimizerTest, jumps_across_rewritten_loops)
+{
+    ScriptResult result = expectSameResult (
+        "begin test\n"
+        "long i\n"
+        "long j\n"
+        "long sum\n"
+        "float f\n"
+        "set sum to 0\n"
+        "set i to 0\n"
+        "while ( i < 10 )\n"
+        "  set i to i + 1\n"
+        "  set j to 0\n"
+        "  while ( j < i )\n"
+        "    set j to j + 1\n"
+        "    if ( j == 3 )\n"
+        "      set sum to sum + 100\n"
+        "    elseif ( 1 == 1 )\n"
+        "      set sum to sum + 2 * 3\n"
+        "    endif\n"
+        "  endwhile\n"
+        "  set f to f + 0.5 * i\n"
+        "endwhile\n"
+        "end\n");
+
+    EXPECT_EQ (10, result.mLongs[0]);
+    EXPECT_EQ (1082, result.mLongs[2]);
+    EXPECT_FLOAT_EQ (82.5f, result.mFloats[0]);
+}
+
+TEST_F (OptimizerTest, early_return)
+{
+    ScriptResult result = expectSameResult (
+        "begin test\n"
+        "short count\n"
+        "short after\n"
+        "set count to count + 1\n"
+        "if ( count >= 2 )\n"
+        "  return\n"
+        "endif\n"
+        "set after to after + 1\n"
+        "end\n");
+
+    EXPECT_EQ (3, result.mShorts[0]);
+    EXPECT_EQ (1, result.mShorts[1]);
+}
+
+TEST_F (OptimizerTest, literal_table_changes)
+{
+    ScriptResult result = expectSameResult (
+        "begin test\n"
+        "short s\n"
+        "long l1\n"
+        "long l2\n"
+        "long l3\n"
+        "float f1\n"
+        "float f2\n"
+        "set l1 to 16777215 + 16777216\n"
+        "set l2 to 2147483647\n"
+        "set l3 to -2147483647 - 1\n"
+        "set f1 to 100000000.0 * 3.0\n"
+        "set f2 to 0.001 + 16777216\n"
+        "set s to 7 * -1\n"
+        "set l1 to l1 + 16777216\n"
+        "end\n");
+
+    EXPECT_EQ (-7, result.mShorts[0]);
+    EXPECT_EQ (16777215 + 16777216 * 2, result.mLongs[0]);
+    EXPECT_EQ (2147483647, result.mLongs[1]);
+    EXPECT_EQ (-2147483647 - 1, result.mLongs[2]);
+    EXPECT_FLOAT_EQ (300000000.f, result.mFloats[0]);
+}
+
+TEST_F (OptimizerTest, runtime_errors_are_kept)
+{
+    ScriptResult result = expectSameResult (
+        "begin test\n"
+        "short a\n"
+        "short b\n"
+        "set a to 1\n"
+        "set a to 5 / 0\n"
+        "set b to 1\n"
+        "end\n");
+
+    EXPECT_EQ ("division by zero", result.mError);
+    EXPECT_EQ (1, result.mShorts[0]);
+    EXPECT_EQ (0, result.mShorts[1]);
+}
+
+TEST_F (OptimizerTest, random_scripts)
+{
+    for (unsigned int seed=0; seed<300; ++seed)
+        expectSameResult (ScriptGenerator (seed).generate());
+}
@@ -0,0 +1,271 @@
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+#include <OpenThreads/Atomic>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+
+#include "components/sceneutil/jobsystem.hpp"
+
+namespace
+{
+    /// Counts how often each element of a parallel loop is visited.
+    class VisitCounter
+    {
+        public:
+
+            VisitCounter (unsigned int count) : mCounts (count, 0) {}
+
+            void visit (unsigned int begin, unsigned int end)
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock (mMutex);
+                for (unsigned int i=begin; i<end; ++i)
+                    ++mCounts.at (i);
+            }
+
+            bool allVisitedOnce() const
+            {
+                for (unsigned int i=0; i<mCounts.size(); ++i)
+                    if (mCounts[i] != 1)
+                        return false;
+                return true;
+            }
+
+        private:
+
+            std::vector<int> mCounts;
+            OpenThreads::Mutex mMutex;
+    };
+
+    class CountJob : public SceneUtil::Job
+    {
+        public:
+
+            CountJob (OpenThreads::Atomic& counter) : mCounter (counter) {}
+
+            virtual void run() { ++mCounter; }
+
+        private:
+
+            OpenThreads::Atomic& mCounter;
+    };
+
+    /// Submits more jobs to its own group from within a job.
+    class NestingJob : public SceneUtil::Job
+    {
+        public:
+
+            NestingJob (SceneUtil::JobSystem& jobSystem, SceneUtil::JobGroup& group, OpenThreads::Atomic& counter, int depth)
+                : mJobSystem (jobSystem), mGroup (group), mCounter (counter), mDepth (depth) {}
+
+            virtual void run()
+            {
+                ++mCounter;
+                if (mDepth > 0)
+                    for (int i=0; i<2; ++i)
+                        mJobSystem.submit (new NestingJob (mJobSystem, mGroup, mCounter, mDepth-1), mGroup);
+            }
+
+        private:
+
+            SceneUtil::JobSystem& mJobSystem;
+            SceneUtil::JobGroup& mGroup;
+            OpenThreads::Atomic& mCounter;
+            int mDepth;
+    };
+
+    struct JobSystemTest : public ::testing::TestWithParam<unsigned int>
+    {
+        SceneUtil::JobSystem mJobSystem;
+
+        JobSystemTest() : mJobSystem (GetParam()) {}
+    };
+
+    /// Records the order tasks finish in.
+    class TaskLog
+    {
+        public:
+
+            void add (unsigned int task)
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock (mMutex);
+                mOrder.push_back (task);
+            }
+
+            /// @return The position of \a task in the order, or -1 if it did not run.
+            int find (unsigned int task) const
+            {
+                for (unsigned int i=0; i<mOrder.size(); ++i)
+                    if (mOrder[i] == task)
+                        return i;
+                return -1;
+            }
+
+            std::size_t size() const { return mOrder.size(); }
+
+        private:
+
+            std::vector<unsigned int> mOrder;
+            OpenThreads::Mutex mMutex;
+    };
+
+    void logTask (TaskLog* log, unsigned int task)
+    {
+        log->add (task);
+    }
+
+    void throwError()
+    {
+        throw std::runtime_error ("job failed");
+    }
+}
+
+TEST_P (JobSystemTest, parallel_for_visits_every_index_once)
+{
+    const unsigned int counts[] = { 0, 1, 2, 7, 64, 1000 };
+    const unsigned int grainSizes[] = { 0, 1, 3, 16, 2000 };
+
+    for (unsigned int c=0; c<sizeof (counts)/sizeof (counts[0]); ++c)
+        for (unsigned int g=0; g<sizeof (grainSizes)/sizeof (grainSizes[0]); ++g)
+        {
+            VisitCounter counter (counts[c]);
+            mJobSystem.parallelFor (counts[c], std::bind (&VisitCounter::visit, &counter, std::placeholders::_1, std::placeholders::_2),
+                grainSizes[g]);
+            EXPECT_TRUE (counter.allVisitedOnce()) << "count " << counts[c] << " grain size " << grainSizes[g];
+        }
+}
+
+TEST_P (JobSystemTest, wait_runs_all_jobs_of_the_group)
+{
+    OpenThreads::Atomic counter;
+    SceneUtil::JobGroup group;
+    for (int i=0; i<100; ++i)
+        mJobSystem.submit (new CountJob (counter), group);
+    mJobSystem.wait (group);
+
+    EXPECT_TRUE (group.isDone());
+    EXPECT_EQ (100u, static_cast<unsigned int> (counter));
+}
+
+TEST_P (JobSystemTest, wait_includes_nested_submits)
+{
+    OpenThreads::Atomic counter;
+    SceneUtil::JobGroup group;
+    mJobSystem.submit (new NestingJob (mJobSystem, group, counter, 6), group);
+    mJobSystem.wait (group);
+
+    // a binary tree of depth 6
+    EXPECT_EQ (127u, static_cast<unsigned int> (counter));
+}
+
+TEST_P (JobSystemTest, nested_parallel_for)
+{
+    VisitCounter counter (32*32);
+    mJobSystem.parallelFor (32, [&] (unsigned int begin, unsigned int end)
+    {
+        for (unsigned int i=begin; i<end; ++i)
+            mJobSystem.parallelFor (32, [&] (unsigned int innerBegin, unsigned int innerEnd)
+            {
+                counter.visit (i*32 + innerBegin, i*32 + innerEnd);
+            });
+    });
+
+    EXPECT_TRUE (counter.allVisitedOnce());
+}
+
+TEST_P (JobSystemTest, graph_runs_dependencies_first)
+{
+    // a diamond: 0 before 1 and 2, both before 3
+    TaskLog* log = NULL;
+    SceneUtil::JobGraph graph;
+    for (unsigned int i=0; i<4; ++i)
+        graph.addTask ([&log, i] () { log->add (i); });
+    graph.addDependency (1, 0);
+    graph.addDependency (2, 0);
+    graph.addDependency (3, 1);
+    graph.addDependency (3, 2);
+
+    // the graph can be run again
+    for (int run=0; run<2; ++run)
+    {
+        TaskLog runLog;
+        log = &runLog;
+        graph.run (mJobSystem);
+
+        ASSERT_EQ (4u, runLog.size());
+        EXPECT_EQ (0, runLog.find (0));
+        EXPECT_LT (runLog.find (1), runLog.find (3));
+        EXPECT_LT (runLog.find (2), runLog.find (3));
+        EXPECT_EQ (3, runLog.find (3));
+    }
+}
+
+TEST_P (JobSystemTest, graph_with_cycle_throws)
+{
+    TaskLog log;
+    SceneUtil::JobGraph graph;
+    for (unsigned int i=0; i<3; ++i)
+        graph.addTask (std::bind (&logTask, &log, i));
+    graph.addDependency (1, 0);
+    graph.addDependency (2, 1);
+    graph.addDependency (1, 2);
+
+    EXPECT_THROW (graph.run (mJobSystem), std::runtime_error);
+    EXPECT_EQ (0u, log.size());
+}
+
+TEST_P (JobSystemTest, job_exception_is_rethrown_by_wait)
+{
+    struct ThrowingJob : public SceneUtil::Job
+    {
+        virtual void run() { throwError(); }
+    };
+
+    OpenThreads::Atomic counter;
+    SceneUtil::JobGroup group;
+    mJobSystem.submit (new ThrowingJob, group);
+    for (int i=0; i<10; ++i)
+        mJobSystem.submit (new CountJob (counter), group);
+    mJobSystem.submit (new ThrowingJob, group);
+
+    EXPECT_THROW (mJobSystem.wait (group), std::runtime_error);
+    // the other jobs still ran
+    EXPECT_TRUE (group.isDone());
+    EXPECT_EQ (10u, static_cast<unsigned int> (counter));
+
+    // the error is only reported once
+    mJobSystem.submit (new CountJob (counter), group);
+    EXPECT_NO_THROW (mJobSystem.wait (group));
+}
+
+TEST_P (JobSystemTest, parallel_for_rethrows)
+{
+    VisitCounter counter (100);
+    EXPECT_THROW (mJobSystem.parallelFor (100, [&] (unsigned int begin, unsigned int end)
+    {
+        counter.visit (begin, end);
+        if (begin <= 50 && 50 < end)
+            throwError();
+    }), std::runtime_error);
+
+    EXPECT_TRUE (counter.allVisitedOnce());
+}
+
+TEST_P (JobSystemTest, graph_rethrows_and_skips_dependents)
+{
+    TaskLog log;
+    SceneUtil::JobGraph graph;
+    unsigned int failing = graph.addTask (&throwError);
+    unsigned int dependent = graph.addTask (std::bind (&logTask, &log, 1));
+    graph.addTask (std::bind (&logTask, &log, 2));
+    graph.addDependency (dependent, failing);
+
+    EXPECT_THROW (graph.run (mJobSystem), std::runtime_error);
+    EXPECT_EQ (-1, log.find (1));
+    EXPECT_NE (-1, log.find (2));
+}
+
+INSTANTIATE_TEST_CASE_P (ThreadCounts, JobSystemTest, ::testing::Values (0u, 1u, 3u));
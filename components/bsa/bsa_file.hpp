@@ -130,6 +130,10 @@ public:
     /// @note Thread safe.
     const FileList &getList() const
     { return files; }
+
+    /// Get the path of the archive
+    const std::string &getFilename() const
+    { return filename; }
 };
 
 }
@@ -305,6 +305,9 @@ namespace Compiler
             extensions.registerInstruction("tgm", "", opcodeToggleGodMode);
             extensions.registerInstruction("togglegodmode", "", opcodeToggleGodMode);
             extensions.registerInstruction("togglescripts", "", opcodeToggleScripts);
+            extensions.registerInstruction("togglescriptprofiling", "", opcodeToggleScriptProfiling);
+            extensions.registerInstruction("tsp", "", opcodeToggleScriptProfiling);
+            extensions.registerInstruction("reportscriptprofile", "", opcodeReportScriptProfile);
             extensions.registerInstruction ("disablelevitation", "", opcodeDisableLevitation);
             extensions.registerInstruction ("enablelevitation", "", opcodeEnableLevitation);
             extensions.registerFunction ("getpcinjail", 'l', "", opcodeGetPcInJail);
@@ -16,9 +16,9 @@ namespace Compiler
         return mName;
     }
 
-    void FileParser::getCode (std::vector<Interpreter::Type_Code>& code) const
+    void FileParser::getCode (std::vector<Interpreter::Type_Code>& code, bool optimize) const
     {
-        mScriptParser.getCode (code);
+        mScriptParser.getCode (code, optimize);
     }
 
     const Locals& FileParser::getLocals() const
@@ -30,8 +30,9 @@ namespace Compiler
             std::string getName() const;
             ///< Return script name.
 
-            void getCode (std::vector<Interpreter::Type_Code>& code) const;
+            void getCode (std::vector<Interpreter::Type_Code>& code, bool optimize = true) const;
             ///< store generated code in \a code.
+            /// \param optimize Run the code through Optimizer::optimize.
             
             const Locals& getLocals() const;
             ///< get local variable declarations.
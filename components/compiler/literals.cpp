@@ -83,6 +83,16 @@ namespace Compiler
         return index;
     }
 
+    Interpreter::Type_Integer Literals::getInteger (int index) const
+    {
+        return mIntegers.at (index);
+    }
+
+    Interpreter::Type_Float Literals::getFloat (int index) const
+    {
+        return mFloats.at (index);
+    }
+
     void Literals::clear()
     {
         mIntegers.clear();
@@ -39,6 +39,12 @@ namespace Compiler
             
             int addString (const std::string& value);
             ///< add string literal and return value.
+
+            Interpreter::Type_Integer getInteger (int index) const;
+            ///< return integer literal at \a index.
+
+            Interpreter::Type_Float getFloat (int index) const;
+            ///< return float literal at \a index.
         
             void clear();
             ///< remove all literals.
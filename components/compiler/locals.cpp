@@ -24,15 +24,24 @@ namespace Compiler
 
     int Locals::searchIndex (char type, const std::string& name) const
     {
-        const std::vector<std::string>& collection = get (type);
+        std::map<std::string, std::pair<char, int> >::const_iterator iter = mIndex.find (name);
 
-        std::vector<std::string>::const_iterator iter =
-            std::find (collection.begin(), collection.end(), name);
-
-        if (iter==collection.end())
+        if (iter==mIndex.end() || iter->second.first!=type)
             return -1;
 
-        return iter-collection.begin();
+        return iter->second.second;
+    }
+
+    bool Locals::lookup (const std::string& name, char& type, int& index) const
+    {
+        std::map<std::string, std::pair<char, int> >::const_iterator iter = mIndex.find (name);
+
+        if (iter==mIndex.end())
+            return false;
+
+        type = iter->second.first;
+        index = iter->second.second;
+        return true;
     }
 
     bool Locals::search (char type, const std::string& name) const
@@ -54,31 +63,18 @@ namespace Compiler
 
     char Locals::getType (const std::string& name) const
     {
-        if (search ('s', name))
-            return 's';
-
-        if (search ('l', name))
-            return 'l';
-
-        if (search ('f', name))
-            return 'f';
-
-        return ' ';
+        char type = ' ';
+        int index;
+        lookup (name, type, index);
+        return type;
     }
 
     int Locals::getIndex (const std::string& name) const
     {
-        int index = searchIndex ('s', name);
-
-        if (index!=-1)
-            return index;
-
-        index = searchIndex ('l', name);
-
-        if (index!=-1)
-            return index;
-
-        return searchIndex ('f', name);
+        char type;
+        int index = -1;
+        lookup (name, type, index);
+        return index;
     }
 
     void Locals::write (std::ostream& localFile) const
@@ -98,7 +94,11 @@ namespace Compiler
 
     void Locals::declare (char type, const std::string& name)
     {
-        get (type).push_back (Misc::StringUtils::lowerCase (name));
+        std::vector<std::string>& collection = get (type);
+        std::string name2 = Misc::StringUtils::lowerCase (name);
+
+        mIndex.insert (std::make_pair (name2, std::make_pair (type, static_cast<int> (collection.size()))));
+        collection.push_back (name2);
     }
 
     void Locals::clear()
@@ -106,6 +106,7 @@ namespace Compiler
         get ('s').clear();
         get ('l').clear();
         get ('f').clear();
+        mIndex.clear();
     }
 }
 
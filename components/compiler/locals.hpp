@@ -1,6 +1,7 @@
 #ifndef COMPILER_LOCALS_H_INCLUDED
 #define COMPILER_LOCALS_H_INCLUDED
 
+#include <map>
 #include <vector>
 #include <string>
 #include <iosfwd>
@@ -14,6 +15,7 @@ namespace Compiler
             std::vector<std::string> mShorts;
             std::vector<std::string> mLongs;
             std::vector<std::string> mFloats;
+            std::map<std::string, std::pair<char, int> > mIndex; ///< name -> (type, index)
 
             std::vector<std::string>& get (char type);
 
@@ -31,6 +33,11 @@ namespace Compiler
             /// exit).
             int searchIndex (char type, const std::string& name) const;
 
+            /// Look up type and index of local variable \a name with a single search.
+            ///
+            /// \return Does the variable exist?
+            bool lookup (const std::string& name, char& type, int& index) const;
+
             const std::vector<std::string>& get (char type) const;
 
             void write (std::ostream& localFile) const;
@@ -0,0 +1,736 @@
+#include "optimizer.hpp"
+
+#include <cstdlib>
+#include <limits>
+
+#include "generator.hpp"
+#include "literals.hpp"
+
+namespace
+{
+    typedef Interpreter::Type_Code Code;
+
+    // segment 0 opcodes
+    const unsigned int op0Push = 0;
+    const unsigned int op0JumpForward = 1;
+    const unsigned int op0JumpBackward = 2;
+    const unsigned int op0PushLocalShort = 3;
+    const unsigned int op0PushLocalLong = 4;
+    const unsigned int op0PushLocalFloat = 5;
+    const unsigned int op0PushIntLiteral = 6;
+    const unsigned int op0PushFloatLiteral = 7;
+    const unsigned int op0JumpForwardZero = 8;
+    const unsigned int op0JumpBackwardZero = 9;
+
+    // segment 5 opcodes
+    const unsigned int op5IntToFloat = 3;
+    const unsigned int op5FetchIntLiteral = 4;
+    const unsigned int op5FetchFloatLiteral = 5;
+    const unsigned int op5FloatToInt = 6;
+    const unsigned int op5NegateInt = 7;
+    const unsigned int op5NegateFloat = 8;
+    const unsigned int op5AddInt = 9;
+    const unsigned int op5AddFloat = 10;
+    const unsigned int op5SubInt = 11;
+    const unsigned int op5SubFloat = 12;
+    const unsigned int op5MulInt = 13;
+    const unsigned int op5MulFloat = 14;
+    const unsigned int op5DivInt = 15;
+    const unsigned int op5DivFloat = 16;
+    const unsigned int op5IntToFloat1 = 17;
+    const unsigned int op5FloatToInt1 = 18;
+    const unsigned int op5Return = 20;
+    const unsigned int op5FetchLocalShort = 21;
+    const unsigned int op5FetchLocalLong = 22;
+    const unsigned int op5FetchLocalFloat = 23;
+    const unsigned int op5SkipZero = 24;
+    const unsigned int op5SkipNonZero = 25;
+    const unsigned int op5EqualInt = 26;
+    const unsigned int op5GreaterOrEqualFloat = 37;
+
+    const unsigned int maxArg0 = 0xffffff;
+
+    enum JumpType
+    {
+        Jump_None,
+        Jump_Always,
+        Jump_Zero ///< pop; jump if the popped value is 0
+    };
+
+    struct Instruction
+    {
+        Code mCode; ///< ignored for jumps
+        JumpType mJump;
+        int mTarget; ///< absolute index of the jump target
+        bool mRemoved;
+
+        Instruction (Code code) : mCode (code), mJump (Jump_None), mTarget (-1), mRemoved (false) {}
+    };
+
+    struct Constant
+    {
+        bool mIsFloat;
+        Interpreter::Type_Integer mInteger;
+        Interpreter::Type_Float mFloat;
+
+        Constant() : mIsFloat (false), mInteger (0), mFloat (0) {}
+    };
+
+    bool isSegment0 (Code code, unsigned int opcode)
+    {
+        return (code>>24)==opcode;
+    }
+
+    unsigned int getArg0 (Code code)
+    {
+        return code & maxArg0;
+    }
+
+    bool isSegment5 (Code code, unsigned int opcode)
+    {
+        return code==Compiler::Generator::segment5 (opcode);
+    }
+
+    bool isBetween (Code code, unsigned int first, unsigned int last)
+    {
+        return code>=Compiler::Generator::segment5 (first) &&
+            code<=Compiler::Generator::segment5 (last);
+    }
+
+    bool fitsInteger (long long value)
+    {
+        return value>=std::numeric_limits<Interpreter::Type_Integer>::min() &&
+            value<=std::numeric_limits<Interpreter::Type_Integer>::max();
+    }
+
+    bool foldUnary (Code code, const Constant& value, Constant& result)
+    {
+        if (isSegment5 (code, op5IntToFloat) && !value.mIsFloat)
+        {
+            result.mIsFloat = true;
+            result.mFloat = static_cast<Interpreter::Type_Float> (value.mInteger);
+            return true;
+        }
+
+        if (isSegment5 (code, op5FloatToInt) && value.mIsFloat)
+        {
+            // out of range conversions are left to the interpreter
+            if (!(value.mFloat>=-2147483648.f && value.mFloat<2147483648.f))
+                return false;
+
+            result.mIsFloat = false;
+            result.mInteger = static_cast<Interpreter::Type_Integer> (value.mFloat);
+            return true;
+        }
+
+        if (isSegment5 (code, op5NegateInt) && !value.mIsFloat)
+        {
+            if (!fitsInteger (-static_cast<long long> (value.mInteger)))
+                return false;
+
+            result.mIsFloat = false;
+            result.mInteger = -value.mInteger;
+            return true;
+        }
+
+        if (isSegment5 (code, op5NegateFloat) && value.mIsFloat)
+        {
+            result.mIsFloat = true;
+            result.mFloat = -value.mFloat;
+            return true;
+        }
+
+        return false;
+    }
+
+    template<typename T>
+    bool compare (unsigned int opcode, T left, T right)
+    {
+        switch (opcode % 6)
+        {
+            case 2: return left==right;
+            case 3: return left!=right;
+            case 4: return left<right;
+            case 5: return left<=right;
+            case 0: return left>right;
+            default: return left>=right;
+        }
+    }
+
+    /// \param left stack[1]
+    /// \param right stack[0]
+    bool foldBinary (Code code, const Constant& left, const Constant& right, Constant& result)
+    {
+        unsigned int opcode = code & 0x3ffffff;
+
+        if (isBetween (code, op5AddInt, op5DivFloat))
+        {
+            bool isFloat = (opcode-op5AddInt)%2==1;
+
+            if (left.mIsFloat!=isFloat || right.mIsFloat!=isFloat)
+                return false;
+
+            result.mIsFloat = isFloat;
+
+            if (isFloat)
+            {
+                switch (opcode)
+                {
+                    case op5AddFloat: result.mFloat = left.mFloat + right.mFloat; return true;
+                    case op5SubFloat: result.mFloat = left.mFloat - right.mFloat; return true;
+                    case op5MulFloat: result.mFloat = left.mFloat * right.mFloat; return true;
+                }
+
+                // division by zero has to be reported at runtime
+                if (right.mFloat==0)
+                    return false;
+
+                result.mFloat = left.mFloat / right.mFloat;
+                return true;
+            }
+
+            long long value;
+
+            switch (opcode)
+            {
+                case op5AddInt: value = static_cast<long long> (left.mInteger) + right.mInteger; break;
+                case op5SubInt: value = static_cast<long long> (left.mInteger) - right.mInteger; break;
+                case op5MulInt: value = static_cast<long long> (left.mInteger) * right.mInteger; break;
+
+                default:
+
+                    if (right.mInteger==0)
+                        return false;
+
+                    value = static_cast<long long> (left.mInteger) / right.mInteger;
+            }
+
+            if (!fitsInteger (value))
+                return false;
+
+            result.mInteger = static_cast<Interpreter::Type_Integer> (value);
+            return true;
+        }
+
+        if (isBetween (code, op5EqualInt, op5GreaterOrEqualFloat))
+        {
+            bool isFloat = opcode>=op5EqualInt+6;
+
+            if (left.mIsFloat!=isFloat || right.mIsFloat!=isFloat)
+                return false;
+
+            result.mIsFloat = false;
+            result.mInteger = isFloat ? compare (opcode, left.mFloat, right.mFloat) :
+                compare (opcode, left.mInteger, right.mInteger);
+            return true;
+        }
+
+        return false;
+    }
+
+    class Program
+    {
+            std::vector<Instruction> mInstructions;
+            std::vector<bool> mLeaders; ///< target of a jump or a skip
+            std::vector<bool> mProtected; ///< directly follows a skip and must stay a single instruction
+            Compiler::Literals& mLiterals;
+
+            void analyse();
+
+            void compact();
+
+            bool isUsable (int index) const;
+
+            bool isSpan (int first, int last) const;
+            ///< Can instructions [first, last] be replaced as a whole?
+
+            bool getConstant (int index, Constant& constant) const;
+
+            Code pushInteger (Interpreter::Type_Integer value, int literal = -1);
+
+            Code push (const Constant& constant);
+
+        public:
+
+            Program (Compiler::Literals& literals);
+
+            bool decode (const std::vector<Code>& code);
+
+            bool encode (std::vector<Code>& code) const;
+
+            bool fuse();
+            ///< Replace instruction pairs with superinstructions.
+
+            bool fold();
+            ///< Evaluate operations on constants and branches on constant conditions.
+
+            bool simplifyJumps();
+            ///< Shorten jump chains and remove jumps to the next instruction.
+
+            bool removeUnreachable();
+    };
+
+    Program::Program (Compiler::Literals& literals) : mLiterals (literals) {}
+
+    void Program::analyse()
+    {
+        int size = static_cast<int> (mInstructions.size());
+
+        mLeaders.assign (size+2, false);
+        mProtected.assign (size+2, false);
+
+        for (int i=0; i<size; ++i)
+        {
+            const Instruction& instruction = mInstructions[i];
+
+            if (instruction.mJump!=Jump_None)
+                mLeaders[instruction.mTarget] = true;
+            else if (isSegment5 (instruction.mCode, op5SkipZero) ||
+                isSegment5 (instruction.mCode, op5SkipNonZero))
+            {
+                mProtected[i+1] = true;
+                mLeaders[i+2] = true;
+            }
+        }
+    }
+
+    void Program::compact()
+    {
+        int size = static_cast<int> (mInstructions.size());
+
+        std::vector<int> newIndex (size+1);
+
+        int count = 0;
+
+        for (int i=0; i<size; ++i)
+        {
+            newIndex[i] = count;
+
+            if (!mInstructions[i].mRemoved)
+                ++count;
+        }
+
+        newIndex[size] = count;
+
+        std::vector<Instruction> instructions;
+        instructions.reserve (count);
+
+        for (int i=0; i<size; ++i)
+            if (!mInstructions[i].mRemoved)
+            {
+                instructions.push_back (mInstructions[i]);
+
+                if (instructions.back().mJump!=Jump_None)
+                    instructions.back().mTarget = newIndex[instructions.back().mTarget];
+            }
+
+        mInstructions.swap (instructions);
+    }
+
+    bool Program::isUsable (int index) const
+    {
+        return index>=0 && index<static_cast<int> (mInstructions.size()) &&
+            !mInstructions[index].mRemoved && !mProtected[index];
+    }
+
+    bool Program::isSpan (int first, int last) const
+    {
+        for (int i=first; i<=last; ++i)
+            if (!isUsable (i) || (i>first && mLeaders[i]))
+                return false;
+
+        return true;
+    }
+
+    bool Program::getConstant (int index, Constant& constant) const
+    {
+        const Instruction& instruction = mInstructions[index];
+
+        if (instruction.mJump!=Jump_None)
+            return false;
+
+        Code code = instruction.mCode;
+
+        if (isSegment0 (code, op0Push))
+        {
+            constant.mIsFloat = false;
+            constant.mInteger = static_cast<Interpreter::Type_Integer> (getArg0 (code));
+            return true;
+        }
+
+        if (isSegment0 (code, op0PushIntLiteral))
+        {
+            int literal = static_cast<int> (getArg0 (code));
+
+            if (literal>=mLiterals.getIntegerSize()/4)
+                return false;
+
+            constant.mIsFloat = false;
+            constant.mInteger = mLiterals.getInteger (literal);
+            return true;
+        }
+
+        if (isSegment0 (code, op0PushFloatLiteral))
+        {
+            int literal = static_cast<int> (getArg0 (code));
+
+            if (literal>=mLiterals.getFloatSize()/4)
+                return false;
+
+            constant.mIsFloat = true;
+            constant.mFloat = mLiterals.getFloat (literal);
+            return true;
+        }
+
+        return false;
+    }
+
+    Code Program::pushInteger (Interpreter::Type_Integer value, int literal)
+    {
+        if (value>=0 && static_cast<unsigned int> (value)<=maxArg0)
+            return Compiler::Generator::segment0 (op0Push, value);
+
+        if (literal==-1)
+            literal = mLiterals.addInteger (value);
+
+        return Compiler::Generator::segment0 (op0PushIntLiteral, literal);
+    }
+
+    Code Program::push (const Constant& constant)
+    {
+        if (constant.mIsFloat)
+            return Compiler::Generator::segment0 (op0PushFloatLiteral, mLiterals.addFloat (constant.mFloat));
+
+        return pushInteger (constant.mInteger);
+    }
+
+    bool Program::decode (const std::vector<Code>& code)
+    {
+        int size = static_cast<int> (code.size());
+
+        mInstructions.clear();
+        mInstructions.reserve (size);
+
+        for (int i=0; i<size; ++i)
+        {
+            Instruction instruction (code[i]);
+
+            int offset = static_cast<int> (getArg0 (code[i]));
+
+            if (isSegment0 (code[i], op0JumpForward) || isSegment0 (code[i], op0JumpBackward))
+                instruction.mJump = Jump_Always;
+            else if (isSegment0 (code[i], op0JumpForwardZero) || isSegment0 (code[i], op0JumpBackwardZero))
+                instruction.mJump = Jump_Zero;
+
+            if (instruction.mJump!=Jump_None)
+            {
+                if (isSegment0 (code[i], op0JumpBackward) || isSegment0 (code[i], op0JumpBackwardZero))
+                    offset = -offset;
+
+                instruction.mTarget = i + offset;
+
+                if (offset==0 || instruction.mTarget<0 || instruction.mTarget>size)
+                    return false;
+            }
+
+            mInstructions.push_back (instruction);
+        }
+
+        return true;
+    }
+
+    bool Program::encode (std::vector<Code>& code) const
+    {
+        code.clear();
+        code.reserve (mInstructions.size());
+
+        for (int i=0; i<static_cast<int> (mInstructions.size()); ++i)
+        {
+            const Instruction& instruction = mInstructions[i];
+
+            if (instruction.mJump==Jump_None)
+            {
+                code.push_back (instruction.mCode);
+                continue;
+            }
+
+            int offset = instruction.mTarget - i;
+
+            if (offset==0 || static_cast<unsigned int> (std::abs (offset))>maxArg0)
+                return false;
+
+            unsigned int opcode;
+
+            if (instruction.mJump==Jump_Always)
+                opcode = offset>0 ? op0JumpForward : op0JumpBackward;
+            else
+                opcode = offset>0 ? op0JumpForwardZero : op0JumpBackwardZero;
+
+            code.push_back (Compiler::Generator::segment0 (opcode, std::abs (offset)));
+        }
+
+        return true;
+    }
+
+    bool Program::fuse()
+    {
+        analyse();
+
+        bool changed = false;
+
+        for (int i=0; i+1<static_cast<int> (mInstructions.size()); ++i)
+        {
+            Instruction& first = mInstructions[i];
+            Instruction& second = mInstructions[i+1];
+
+            if (!isUsable (i) || mLeaders[i+1] || first.mJump!=Jump_None)
+                continue;
+
+            if (isSegment5 (first.mCode, op5SkipNonZero) && second.mJump==Jump_Always)
+            {
+                first.mJump = Jump_Zero;
+                first.mTarget = second.mTarget;
+            }
+            else if (isSegment0 (first.mCode, op0Push) && isUsable (i+1) && second.mJump==Jump_None)
+            {
+                unsigned int arg = getArg0 (first.mCode);
+
+                if (isSegment5 (second.mCode, op5FetchIntLiteral))
+                {
+                    if (static_cast<int> (arg)>=mLiterals.getIntegerSize()/4)
+                        continue;
+
+                    first.mCode = pushInteger (mLiterals.getInteger (arg), arg);
+                }
+                else if (isSegment5 (second.mCode, op5FetchFloatLiteral))
+                    first.mCode = Compiler::Generator::segment0 (op0PushFloatLiteral, arg);
+                else if (isSegment5 (second.mCode, op5FetchLocalShort))
+                    first.mCode = Compiler::Generator::segment0 (op0PushLocalShort, arg);
+                else if (isSegment5 (second.mCode, op5FetchLocalLong))
+                    first.mCode = Compiler::Generator::segment0 (op0PushLocalLong, arg);
+                else if (isSegment5 (second.mCode, op5FetchLocalFloat))
+                    first.mCode = Compiler::Generator::segment0 (op0PushLocalFloat, arg);
+                else
+                    continue;
+            }
+            else
+                continue;
+
+            second.mRemoved = true;
+            changed = true;
+            ++i;
+        }
+
+        if (changed)
+            compact();
+
+        return changed;
+    }
+
+    bool Program::fold()
+    {
+        analyse();
+
+        bool changed = false;
+
+        for (int i=1; i<static_cast<int> (mInstructions.size()); ++i)
+        {
+            Instruction& instruction = mInstructions[i];
+
+            if (!isUsable (i))
+                continue;
+
+            Constant right;
+
+            if (!isSpan (i-1, i) || !getConstant (i-1, right))
+                continue;
+
+            if (instruction.mJump==Jump_Zero)
+            {
+                if (right.mIsFloat)
+                    continue;
+
+                mInstructions[i-1].mRemoved = true;
+
+                if (right.mInteger==0)
+                    instruction.mJump = Jump_Always;
+                else
+                    instruction.mRemoved = true;
+
+                changed = true;
+                continue;
+            }
+
+            if (instruction.mJump!=Jump_None)
+                continue;
+
+            Constant result;
+
+            if (foldUnary (instruction.mCode, right, result))
+            {
+                mInstructions[i-1].mCode = push (result);
+                instruction.mRemoved = true;
+                changed = true;
+                continue;
+            }
+
+            Constant left;
+
+            if (i<2 || !isSpan (i-2, i) || !getConstant (i-2, left))
+                continue;
+
+            if (isSegment5 (instruction.mCode, op5IntToFloat1) ||
+                isSegment5 (instruction.mCode, op5FloatToInt1))
+            {
+                Code convert = Compiler::Generator::segment5 (
+                    isSegment5 (instruction.mCode, op5IntToFloat1) ? op5IntToFloat : op5FloatToInt);
+
+                if (!foldUnary (convert, left, result))
+                    continue;
+
+                mInstructions[i-2].mCode = push (result);
+                instruction.mRemoved = true;
+                changed = true;
+            }
+            else if (foldBinary (instruction.mCode, left, right, result))
+            {
+                mInstructions[i-2].mCode = push (result);
+                mInstructions[i-1].mRemoved = true;
+                instruction.mRemoved = true;
+                changed = true;
+            }
+        }
+
+        if (changed)
+            compact();
+
+        return changed;
+    }
+
+    bool Program::simplifyJumps()
+    {
+        analyse();
+
+        bool changed = false;
+
+        int size = static_cast<int> (mInstructions.size());
+
+        for (int i=0; i<size; ++i)
+        {
+            Instruction& instruction = mInstructions[i];
+
+            if (instruction.mJump==Jump_None)
+                continue;
+
+            int target = instruction.mTarget;
+            int steps = 0;
+
+            while (target<size && mInstructions[target].mJump==Jump_Always && steps<=size)
+            {
+                target = mInstructions[target].mTarget;
+                ++steps;
+            }
+
+            // a cycle of unconditional jumps is left for the interpreter to run into
+            if (steps>size)
+                continue;
+
+            if (target!=instruction.mTarget)
+            {
+                instruction.mTarget = target;
+                changed = true;
+            }
+
+            if (instruction.mJump==Jump_Always && !mProtected[i])
+            {
+                if (target==i+1)
+                {
+                    instruction.mRemoved = true;
+                    changed = true;
+                }
+                else if (target<size && mInstructions[target].mJump==Jump_None &&
+                    isSegment5 (mInstructions[target].mCode, op5Return))
+                {
+                    instruction.mJump = Jump_None;
+                    instruction.mCode = mInstructions[target].mCode;
+                    changed = true;
+                }
+            }
+        }
+
+        if (changed)
+            compact();
+
+        return changed;
+    }
+
+    bool Program::removeUnreachable()
+    {
+        analyse();
+
+        bool changed = false;
+        bool reachable = true;
+
+        for (int i=0; i<static_cast<int> (mInstructions.size()); ++i)
+        {
+            Instruction& instruction = mInstructions[i];
+
+            if (mLeaders[i] || mProtected[i])
+                reachable = true;
+
+            if (!reachable)
+            {
+                instruction.mRemoved = true;
+                changed = true;
+                continue;
+            }
+
+            if (instruction.mJump==Jump_Always ||
+                (instruction.mJump==Jump_None && isSegment5 (instruction.mCode, op5Return)))
+                reachable = false;
+        }
+
+        if (changed)
+            compact();
+
+        return changed;
+    }
+}
+
+namespace Compiler
+{
+    namespace Optimizer
+    {
+        void optimize (std::vector<Interpreter::Type_Code>& code, Literals& literals)
+        {
+            Program program (literals);
+
+            if (!program.decode (code))
+                return;
+
+            bool changed = true;
+
+            while (changed)
+            {
+                changed = false;
+
+                if (program.fuse())
+                    changed = true;
+
+                if (program.fold())
+                    changed = true;
+
+                if (program.simplifyJumps())
+                    changed = true;
+
+                if (program.removeUnreachable())
+                    changed = true;
+            }
+
+            std::vector<Interpreter::Type_Code> optimized;
+
+            if (program.encode (optimized))
+                code.swap (optimized);
+        }
+    }
+}
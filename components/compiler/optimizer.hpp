@@ -0,0 +1,23 @@
+#ifndef COMPILER_OPTIMIZER_H_INCLUDED
+#define COMPILER_OPTIMIZER_H_INCLUDED
+
+#include <vector>
+
+#include <components/interpreter/types.hpp>
+
+namespace Compiler
+{
+    class Literals;
+
+    namespace Optimizer
+    {
+        void optimize (std::vector<Interpreter::Type_Code>& code, Literals& literals);
+        ///< Fold constant expressions, replace common instruction sequences with
+        /// superinstructions, shorten jump chains and remove unreachable code.
+        ///
+        /// \note New literals may be added to \a literals. \a code is left untouched, if it
+        /// contains a jump the optimizer can not resolve.
+    }
+}
+
+#endif
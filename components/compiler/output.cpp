@@ -5,32 +5,38 @@
 #include <iterator>
 
 #include "locals.hpp"
+#include "optimizer.hpp"
 
 namespace Compiler
 {
     Output::Output (Locals& locals) : mLocals (locals) {}
 
-    void Output::getCode (std::vector<Interpreter::Type_Code>& code) const
+    void Output::getCode (std::vector<Interpreter::Type_Code>& code, bool optimize) const
     {
         code.clear();
-        
+
+        std::vector<Interpreter::Type_Code> optimized (mCode);
+        Literals literals (mLiterals);
+        if (optimize)
+            Optimizer::optimize (optimized, literals);
+
         // header
-        code.push_back (static_cast<Interpreter::Type_Code> (mCode.size()));
+        code.push_back (static_cast<Interpreter::Type_Code> (optimized.size()));
         
-        assert (mLiterals.getIntegerSize()%4==0);
-        code.push_back (static_cast<Interpreter::Type_Code> (mLiterals.getIntegerSize()/4));
+        assert (literals.getIntegerSize()%4==0);
+        code.push_back (static_cast<Interpreter::Type_Code> (literals.getIntegerSize()/4));
         
-        assert (mLiterals.getFloatSize()%4==0);
-        code.push_back (static_cast<Interpreter::Type_Code> (mLiterals.getFloatSize()/4));
+        assert (literals.getFloatSize()%4==0);
+        code.push_back (static_cast<Interpreter::Type_Code> (literals.getFloatSize()/4));
         
-        assert (mLiterals.getStringSize()%4==0);
-        code.push_back (static_cast<Interpreter::Type_Code> (mLiterals.getStringSize()/4));
+        assert (literals.getStringSize()%4==0);
+        code.push_back (static_cast<Interpreter::Type_Code> (literals.getStringSize()/4));
         
         // code
-        std::copy (mCode.begin(), mCode.end(), std::back_inserter (code));
+        std::copy (optimized.begin(), optimized.end(), std::back_inserter (code));
         
         // literals
-        mLiterals.append (code);
+        literals.append (code);
     }
 
     const Literals& Output::getLiterals() const
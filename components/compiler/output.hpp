@@ -21,8 +21,9 @@ namespace Compiler
         
             Output (Locals& locals);
     
-            void getCode (std::vector<Interpreter::Type_Code>& code) const;
+            void getCode (std::vector<Interpreter::Type_Code>& code, bool optimize = true) const;
             ///< store generated code in \a code.
+            /// \param optimize Run the code through Optimizer::optimize.
 
             const Literals& getLiterals() const;
 
@@ -14,9 +14,9 @@ namespace Compiler
       mEnd (end)
     {}
 
-    void ScriptParser::getCode (std::vector<Interpreter::Type_Code>& code) const
+    void ScriptParser::getCode (std::vector<Interpreter::Type_Code>& code, bool optimize) const
     {
-        mOutput.getCode (code);
+        mOutput.getCode (code, optimize);
     }
 
     bool ScriptParser::parseName (const std::string& name, const TokenLoc& loc,
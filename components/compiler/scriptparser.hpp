@@ -26,8 +26,9 @@ namespace Compiler
             ScriptParser (ErrorHandler& errorHandler, const Context& context, Locals& locals,
                 bool end = false);
 
-            void getCode (std::vector<Interpreter::Type_Code>& code) const;
+            void getCode (std::vector<Interpreter::Type_Code>& code, bool optimize = true) const;
             ///< store generated code in \a code.
+            /// \param optimize Run the code through Optimizer::optimize.
 
             virtual bool parseName (const std::string& name, const TokenLoc& loc,
                 Scanner& scanner);
@@ -2,6 +2,14 @@
 
 #include <set>
 #include <iostream>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define ESMTERRAIN_SSE
+#endif
 
 #include <OpenThreads/ScopedLock>
 
@@ -9,10 +17,24 @@
 #include <osg/Plane>
 
 #include <boost/algorithm/string.hpp>
+#include <boost/crc.hpp>
 
 #include <components/misc/resourcehelpers.hpp>
 #include <components/vfs/manager.hpp>
 
+namespace
+{
+
+    /// Add a layer texture to a checksum, by its name and where its contents come from, so that replaced files are noticed.
+    void processLayerTexture(boost::crc_32_type& crc, const std::string& texture, const VFS::Manager* vfs)
+    {
+        crc.process_bytes(texture.data(), texture.size()+1);
+        std::string stamp = vfs->getStamp(texture);
+        crc.process_bytes(stamp.data(), stamp.size()+1);
+    }
+
+}
+
 namespace ESMTerrain
 {
 
@@ -107,80 +129,125 @@ namespace ESMTerrain
         return false;
     }
 
-    void Storage::fixNormal (osg::Vec3f& normal, int cellX, int cellY, int col, int row, LandCache& cache)
+    namespace
     {
-        while (col >= ESM::Land::LAND_SIZE-1)
-        {
-            ++cellY;
-            col -= ESM::Land::LAND_SIZE-1;
-        }
-        while (row >= ESM::Land::LAND_SIZE-1)
-        {
-            ++cellX;
-            row -= ESM::Land::LAND_SIZE-1;
-        }
-        while (col < 0)
-        {
-            --cellY;
-            col += ESM::Land::LAND_SIZE-1;
-        }
-        while (row < 0)
-        {
-            --cellX;
-            row += ESM::Land::LAND_SIZE-1;
-        }
 
-        const LandObject* land = getLand(cellX, cellY, cache);
-        const ESM::Land::LandData* data = land ? land->getData(ESM::Land::DATA_VNML) : 0;
-        if (data)
+        /// Number of vertices a cell adds to a row of terrain, not counting the one it shares with the previous cell.
+        const int cellVerts = ESM::Land::LAND_SIZE - 1;
+
+        /// @brief The land of the cells spanned by a terrain chunk and of the cells around them, each fetched on first use.
+        class ChunkLand
         {
-            normal.x() = data->mNormals[col*ESM::Land::LAND_SIZE*3+row*3];
-            normal.y() = data->mNormals[col*ESM::Land::LAND_SIZE*3+row*3+1];
-            normal.z() = data->mNormals[col*ESM::Land::LAND_SIZE*3+row*3+2];
-            normal.normalize();
-        }
-        else
-            normal = osg::Vec3f(0,0,1);
-    }
+        public:
+            ChunkLand(Storage* storage, int startCellX, int startCellY, int numCells)
+                : mStorage(storage)
+                , mStartCellX(startCellX)
+                , mStartCellY(startCellY)
+                , mSize(numCells+2)
+                , mLand(mSize*mSize)
+                , mFetched(mSize*mSize, false)
+            {
+            }
 
-    void Storage::averageNormal(osg::Vec3f &normal, int cellX, int cellY, int col, int row, LandCache& cache)
-    {
-        osg::Vec3f n1,n2,n3,n4;
-        fixNormal(n1, cellX, cellY, col+1, row, cache);
-        fixNormal(n2, cellX, cellY, col-1, row, cache);
-        fixNormal(n3, cellX, cellY, col, row+1, cache);
-        fixNormal(n4, cellX, cellY, col, row-1, cache);
-        normal = (n1+n2+n3+n4);
-        normal.normalize();
-    }
+            /// @param x, y Cell relative to the first cell of the chunk, from -1 to numCells.
+            const ESM::Land::LandData* getData(int x, int y, int flags)
+            {
+                assert(x >= -1 && x < mSize-1 && y >= -1 && y < mSize-1);
 
-    void Storage::fixColour (osg::Vec4f& color, int cellX, int cellY, int col, int row, LandCache& cache)
-    {
-        if (col == ESM::Land::LAND_SIZE-1)
+                int index = (y+1)*mSize + x+1;
+                if (!mFetched[index])
+                {
+                    mLand[index] = mStorage->getLand(mStartCellX + x, mStartCellY + y);
+                    mFetched[index] = true;
+                }
+                return mLand[index] ? mLand[index]->getData(flags) : NULL;
+            }
+
+        private:
+            Storage* mStorage;
+            int mStartCellX;
+            int mStartCellY;
+            int mSize;
+            std::vector<osg::ref_ptr<const LandObject> > mLand;
+            std::vector<bool> mFetched;
+        };
+
+        /// @brief Where a vertex of a chunk is sampled from, along one axis.
+        /// @par A vertex on a cell border is contained in both cells. Its height is taken from the cell before the border,
+        /// unless the chunk starts there. Its normal and colour are taken from the cell after the border, since they
+        /// don't always connect seamlessly between cells.
+        struct AxisSample
         {
-            ++cellY;
-            col = 0;
-        }
-        if (row == ESM::Land::LAND_SIZE-1)
+            /// Vertex relative to the first vertex of the chunk's first cell.
+            int mVert;
+
+            int mCell;
+            int mIndex;
+
+            int mSeamCell;
+            int mSeamIndex;
+        };
+
+        void getAxisSamples(int startVert, int increment, std::vector<AxisSample>& samples)
         {
-            ++cellX;
-            row = 0;
+            for (size_t i=0; i<samples.size(); ++i)
+            {
+                AxisSample& sample = samples[i];
+                sample.mVert = startVert + static_cast<int>(i)*increment;
+                sample.mCell = sample.mVert > 0 ? (sample.mVert-1) / cellVerts : 0;
+                sample.mIndex = sample.mVert - sample.mCell*cellVerts;
+                sample.mSeamCell = sample.mVert / cellVerts;
+                sample.mSeamIndex = sample.mVert - sample.mSeamCell*cellVerts;
+            }
         }
 
-        const LandObject* land = getLand(cellX, cellY, cache);
-        const ESM::Land::LandData* data = land ? land->getData(ESM::Land::DATA_VCLR) : 0;
-        if (data)
+        /// Normalize \a count vectors, given as separate arrays of their x, y and z components. Zero vectors are left alone.
+        void normalizeVectors(float* x, float* y, float* z, size_t count)
         {
-            color.r() = data->mColours[col*ESM::Land::LAND_SIZE*3+row*3] / 255.f;
-            color.g() = data->mColours[col*ESM::Land::LAND_SIZE*3+row*3+1] / 255.f;
-            color.b() = data->mColours[col*ESM::Land::LAND_SIZE*3+row*3+2] / 255.f;
+            size_t i = 0;
+#ifdef ESMTERRAIN_SSE
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 one = _mm_set1_ps(1.f);
+            for (; i+4 <= count; i += 4)
+            {
+                __m128 vx = _mm_loadu_ps(x+i);
+                __m128 vy = _mm_loadu_ps(y+i);
+                __m128 vz = _mm_loadu_ps(z+i);
+                __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz)));
+                __m128 inv = _mm_and_ps(_mm_div_ps(one, length), _mm_cmpgt_ps(length, zero));
+                _mm_storeu_ps(x+i, _mm_mul_ps(vx, inv));
+                _mm_storeu_ps(y+i, _mm_mul_ps(vy, inv));
+                _mm_storeu_ps(z+i, _mm_mul_ps(vz, inv));
+            }
+#endif
+            for (; i<count; ++i)
+            {
+                float length = std::sqrt(x[i]*x[i] + y[i]*y[i] + z[i]*z[i]);
+                if (length > 0.f)
+                {
+                    float inv = 1.f / length;
+                    x[i] *= inv;
+                    y[i] *= inv;
+                    z[i] *= inv;
+                }
+            }
         }
-        else
+
+        /// Get the normal of a vertex relative to the first vertex of the chunk, from the cell after any cell border it is on.
+        osg::Vec3f getSeamNormal(ChunkLand& land, int vertX, int vertY)
         {
-            color.r() = 1;
-            color.g() = 1;
-            color.b() = 1;
+            int cellX = vertX >= 0 ? vertX / cellVerts : -1;
+            int cellY = vertY >= 0 ? vertY / cellVerts : -1;
+            const ESM::Land::LandData* data = land.getData(cellX, cellY, ESM::Land::DATA_VNML);
+            if (!data)
+                return osg::Vec3f(0,0,1);
+
+            const ESM::Land::VNML* normal = &data->mNormals[((vertY - cellY*cellVerts)*ESM::Land::LAND_SIZE + vertX - cellX*cellVerts)*3];
+            osg::Vec3f result (normal[0], normal[1], normal[2]);
+            result.normalize();
+            return result;
         }
+
     }
 
     void Storage::fillVertexBuffers (int lodLevel, float size, const osg::Vec2f& center,
@@ -189,12 +256,13 @@ namespace ESMTerrain
                                             osg::ref_ptr<osg::Vec4Array> colours)
     {
         // LOD level n means every 2^n-th vertex is kept
-        size_t increment = static_cast<size_t>(1) << lodLevel;
+        int increment = 1 << lodLevel;
 
         osg::Vec2f origin = center - osg::Vec2f(size/2.f, size/2.f);
 
         int startCellX = static_cast<int>(std::floor(origin.x()));
         int startCellY = static_cast<int>(std::floor(origin.y()));
+        int numCells = static_cast<int>(std::ceil(size));
 
         size_t numVerts = static_cast<size_t>(size*(ESM::Land::LAND_SIZE - 1) / increment + 1);
 
@@ -202,123 +270,103 @@ namespace ESMTerrain
         normals->resize(numVerts*numVerts);
         colours->resize(numVerts*numVerts);
 
-        osg::Vec3f normal;
-        osg::Vec4f color;
+        // Only chunks smaller than (contained in) one cell start inside of it
+        std::vector<AxisSample> samplesX(numVerts);
+        std::vector<AxisSample> samplesY(numVerts);
+        getAxisSamples(static_cast<int>((origin.x() - startCellX) * cellVerts), increment, samplesX);
+        getAxisSamples(static_cast<int>((origin.y() - startCellY) * cellVerts), increment, samplesY);
 
-        float vertY = 0;
-        float vertX = 0;
+        assert(samplesX.back().mVert <= numCells*cellVerts && samplesY.back().mVert <= numCells*cellVerts);
 
-        LandCache cache;
+        std::vector<float> coords(numVerts);
+        for (size_t i=0; i<numVerts; ++i)
+            coords[i] = (i / float(numVerts - 1) - 0.5f) * size * 8192;
+
+        ChunkLand land(this, startCellX, startCellY, numCells);
 
-        float vertY_ = 0; // of current cell corner
-        for (int cellY = startCellY; cellY < startCellY + std::ceil(size); ++cellY)
+        // The current row of each cell, NULL where the cell has no such data
+        std::vector<const float*> heightRows(numCells+1);
+        std::vector<const ESM::Land::VNML*> normalRows(numCells+1);
+        std::vector<const unsigned char*> colourRows(numCells+1);
+
+        std::vector<float> heights(numVerts);
+        std::vector<float> normalX(numVerts);
+        std::vector<float> normalY(numVerts);
+        std::vector<float> normalZ(numVerts);
+
+        for (size_t j=0; j<numVerts; ++j)
         {
-            float vertX_ = 0; // of current cell corner
-            for (int cellX = startCellX; cellX < startCellX + std::ceil(size); ++cellX)
+            const AxisSample& sampleY = samplesY[j];
+
+            for (int cellX = samplesX.front().mCell; cellX <= samplesX.back().mCell; ++cellX)
             {
-                const LandObject* land = getLand(cellX, cellY, cache);
-                const ESM::Land::LandData *heightData = 0;
-                const ESM::Land::LandData *normalData = 0;
-                const ESM::Land::LandData *colourData = 0;
-                if (land)
+                const ESM::Land::LandData* data = land.getData(cellX, sampleY.mCell, ESM::Land::DATA_VHGT);
+                heightRows[cellX] = data ? &data->mHeights[sampleY.mIndex*ESM::Land::LAND_SIZE] : NULL;
+            }
+            for (int cellX = samplesX.front().mSeamCell; cellX <= samplesX.back().mSeamCell; ++cellX)
+            {
+                const ESM::Land::LandData* data = land.getData(cellX, sampleY.mSeamCell, ESM::Land::DATA_VNML);
+                normalRows[cellX] = data ? &data->mNormals[sampleY.mSeamIndex*ESM::Land::LAND_SIZE*3] : NULL;
+                data = land.getData(cellX, sampleY.mSeamCell, ESM::Land::DATA_VCLR);
+                colourRows[cellX] = data ? &data->mColours[sampleY.mSeamIndex*ESM::Land::LAND_SIZE*3] : NULL;
+            }
+
+            for (size_t i=0; i<numVerts; ++i)
+            {
+                const AxisSample& sampleX = samplesX[i];
+
+                const float* heightRow = heightRows[sampleX.mCell];
+                heights[i] = heightRow ? heightRow[sampleX.mIndex] : defaultHeight;
+
+                const ESM::Land::VNML* normalRow = normalRows[sampleX.mSeamCell];
+                if (normalRow)
                 {
-                    heightData = land->getData(ESM::Land::DATA_VHGT);
-                    normalData = land->getData(ESM::Land::DATA_VNML);
-                    colourData = land->getData(ESM::Land::DATA_VCLR);
+                    const ESM::Land::VNML* normal = normalRow + sampleX.mSeamIndex*3;
+                    normalX[i] = normal[0];
+                    normalY[i] = normal[1];
+                    normalZ[i] = normal[2];
                 }
-
-                int rowStart = 0;
-                int colStart = 0;
-                // Skip the first row / column unless we're at a chunk edge,
-                // since this row / column is already contained in a previous cell
-                // This is only relevant if we're creating a chunk spanning multiple cells
-                if (vertY_ != 0)
-                    colStart += increment;
-                if (vertX_ != 0)
-                    rowStart += increment;
-
-                // Only relevant for chunks smaller than (contained in) one cell
-                rowStart += (origin.x() - startCellX) * ESM::Land::LAND_SIZE;
-                colStart += (origin.y() - startCellY) * ESM::Land::LAND_SIZE;
-                int rowEnd = std::min(static_cast<int>(rowStart + std::min(1.f, size) * (ESM::Land::LAND_SIZE-1) + 1), static_cast<int>(ESM::Land::LAND_SIZE));
-                int colEnd = std::min(static_cast<int>(colStart + std::min(1.f, size) * (ESM::Land::LAND_SIZE-1) + 1), static_cast<int>(ESM::Land::LAND_SIZE));
-
-                vertY = vertY_;
-                for (int col=colStart; col<colEnd; col += increment)
+                else
                 {
-                    vertX = vertX_;
-                    for (int row=rowStart; row<rowEnd; row += increment)
-                    {
-                        int srcArrayIndex = col*ESM::Land::LAND_SIZE*3+row*3;
-
-                        assert(row >= 0 && row < ESM::Land::LAND_SIZE);
-                        assert(col >= 0 && col < ESM::Land::LAND_SIZE);
-
-                        assert (vertX < numVerts);
-                        assert (vertY < numVerts);
-
-                        float height = defaultHeight;
-                        if (heightData)
-                            height = heightData->mHeights[col*ESM::Land::LAND_SIZE + row];
-
-                        (*positions)[static_cast<unsigned int>(vertX*numVerts + vertY)]
-                            = osg::Vec3f((vertX / float(numVerts - 1) - 0.5f) * size * 8192,
-                                         (vertY / float(numVerts - 1) - 0.5f) * size * 8192,
-                                         height);
-
-                        if (normalData)
-                        {
-                            for (int i=0; i<3; ++i)
-                                normal[i] = normalData->mNormals[srcArrayIndex+i];
-
-                            normal.normalize();
-                        }
-                        else
-                            normal = osg::Vec3f(0,0,1);
-
-                        // Normals apparently don't connect seamlessly between cells
-                        if (col == ESM::Land::LAND_SIZE-1 || row == ESM::Land::LAND_SIZE-1)
-                            fixNormal(normal, cellX, cellY, col, row, cache);
-
-                        // some corner normals appear to be complete garbage (z < 0)
-                        if ((row == 0 || row == ESM::Land::LAND_SIZE-1) && (col == 0 || col == ESM::Land::LAND_SIZE-1))
-                            averageNormal(normal, cellX, cellY, col, row, cache);
-
-                        assert(normal.z() > 0);
-
-                        (*normals)[static_cast<unsigned int>(vertX*numVerts + vertY)] = normal;
-
-                        if (colourData)
-                        {
-                            for (int i=0; i<3; ++i)
-                                color[i] = colourData->mColours[srcArrayIndex+i] / 255.f;
-                        }
-                        else
-                        {
-                            color.r() = 1;
-                            color.g() = 1;
-                            color.b() = 1;
-                        }
-
-                        // Unlike normals, colors mostly connect seamlessly between cells, but not always...
-                        if (col == ESM::Land::LAND_SIZE-1 || row == ESM::Land::LAND_SIZE-1)
-                            fixColour(color, cellX, cellY, col, row, cache);
-
-                        color.a() = 1;
-
-                        (*colours)[static_cast<unsigned int>(vertX*numVerts + vertY)] = color;
-
-                        ++vertX;
-                    }
-                    ++vertY;
+                    normalX[i] = 0;
+                    normalY[i] = 0;
+                    normalZ[i] = 1;
                 }
-                vertX_ = vertX;
             }
-            vertY_ = vertY;
 
-            assert(vertX_ == numVerts); // Ensure we covered whole area
+            normalizeVectors(&normalX[0], &normalY[0], &normalZ[0], numVerts);
+
+            for (size_t i=0; i<numVerts; ++i)
+            {
+                const AxisSample& sampleX = samplesX[i];
+                size_t index = i*numVerts + j;
+
+                (*positions)[index] = osg::Vec3f(coords[i], coords[j], heights[i]);
+
+                osg::Vec3f normal (normalX[i], normalY[i], normalZ[i]);
+
+                // some corner normals appear to be complete garbage (z < 0)
+                if (sampleX.mSeamIndex == 0 && sampleY.mSeamIndex == 0)
+                {
+                    normal = getSeamNormal(land, sampleX.mVert+1, sampleY.mVert)
+                           + getSeamNormal(land, sampleX.mVert-1, sampleY.mVert)
+                           + getSeamNormal(land, sampleX.mVert, sampleY.mVert+1)
+                           + getSeamNormal(land, sampleX.mVert, sampleY.mVert-1);
+                    normal.normalize();
+                }
+
+                (*normals)[index] = normal;
+
+                const unsigned char* colourRow = colourRows[sampleX.mSeamCell];
+                if (colourRow)
+                {
+                    const unsigned char* colour = colourRow + sampleX.mSeamIndex*3;
+                    (*colours)[index] = osg::Vec4f(colour[0] / 255.f, colour[1] / 255.f, colour[2] / 255.f, 1.f);
+                }
+                else
+                    (*colours)[index] = osg::Vec4f(1.f, 1.f, 1.f, 1.f);
+            }
         }
-        assert(vertY_ == numVerts);  // Ensure we covered whole area
     }
 
     Storage::UniqueTextureId Storage::getVtexIndexAt(int cellX, int cellY,
@@ -460,6 +508,51 @@ namespace ESMTerrain
         }
     }
 
+    bool Storage::getBlendmapChecksum(float chunkSize, const osg::Vec2f &chunkCenter, unsigned int &checksum)
+    {
+        osg::Vec2f origin = chunkCenter - osg::Vec2f(chunkSize/2.f, chunkSize/2.f);
+        int startCellX = static_cast<int>(std::floor(origin.x()));
+        int startCellY = static_cast<int>(std::floor(origin.y()));
+        int endCellX = static_cast<int>(std::ceil(origin.x() + chunkSize));
+        int endCellY = static_cast<int>(std::ceil(origin.y() + chunkSize));
+
+        boost::crc_32_type crc;
+        crc.process_bytes(&chunkSize, sizeof(chunkSize));
+
+        // the base layer is always used
+        processLayerTexture(crc, getLayerInfo(getTextureName(std::make_pair(0,0))).mDiffuseMap, mVFS);
+
+        // getVtexIndexAt() reaches into the neighbouring cells
+        for (int cellY = startCellY-1; cellY <= endCellY; ++cellY)
+        {
+            for (int cellX = startCellX-1; cellX <= endCellX; ++cellX)
+            {
+                osg::ref_ptr<const LandObject> land = getLand(cellX, cellY);
+                const ESM::Land::LandData* data = land ? land->getData(ESM::Land::DATA_VTEX) : 0;
+
+                int header[4] = { cellX, cellY, data != 0, data ? land->getPlugin() : 0 };
+                crc.process_bytes(header, sizeof(header));
+                if (!data)
+                    continue;
+
+                crc.process_bytes(data->mTextures, sizeof(data->mTextures));
+
+                // the land texture records and the files they refer to may have changed as well
+                std::set<UniqueTextureId> textureIndices;
+                for (int i=0; i<ESM::Land::LAND_NUM_TEXTURES; ++i)
+                {
+                    if (data->mTextures[i] != 0)
+                        textureIndices.insert(std::make_pair(data->mTextures[i], land->getPlugin()));
+                }
+                for (std::set<UniqueTextureId>::const_iterator it = textureIndices.begin(); it != textureIndices.end(); ++it)
+                    processLayerTexture(crc, getLayerInfo(getTextureName(*it)).mDiffuseMap, mVFS);
+            }
+        }
+
+        checksum = crc.checksum();
+        return true;
+    }
+
     float Storage::getHeightAt(const osg::Vec3f &worldPos)
     {
         int cellX = static_cast<int>(std::floor(worldPos.x() / 8192.f));
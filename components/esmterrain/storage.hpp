@@ -63,7 +63,8 @@ namespace ESMTerrain
         virtual bool getMinMaxHeights (float size, const osg::Vec2f& center, float& min, float& max);
 
         /// Fill vertex buffers for a terrain chunk.
-        /// @note May be called from background threads. Make sure to only call thread-safe functions from here!
+        /// @note May be called from background threads, also for several chunks at once. Make sure to only call thread-safe functions from here!
+        /// @note The land of each cell involved is fetched once, and the vertices are sampled a row at a time from its arrays.
         /// @note Vertices should be written in row-major order (a row is defined as parallel to the x-axis).
         ///       The specified positions should be in local space, i.e. relative to the center of the terrain chunk.
         /// @param lodLevel LOD level, 0 = most detailed
@@ -92,6 +93,8 @@ namespace ESMTerrain
                            ImageVector& blendmaps,
                            std::vector<Terrain::LayerInfo>& layerList);
 
+        virtual bool getBlendmapChecksum (float chunkSize, const osg::Vec2f& chunkCenter, unsigned int& checksum);
+
         virtual float getHeightAt (const osg::Vec3f& worldPos);
 
         virtual Terrain::LayerInfo getDefaultLayer();
@@ -107,10 +110,6 @@ namespace ESMTerrain
     private:
         const VFS::Manager* mVFS;
 
-        void fixNormal (osg::Vec3f& normal, int cellX, int cellY, int col, int row, LandCache& cache);
-        void fixColour (osg::Vec4f& colour, int cellX, int cellY, int col, int row, LandCache& cache);
-        void averageNormal (osg::Vec3f& normal, int cellX, int cellY, int col, int row, LandCache& cache);
-
         float getVertexHeight (const ESM::Land::LandData* data, int x, int y);
 
         const LandObject* getLand(int cellX, int cellY, LandCache& cache);
@@ -71,6 +71,40 @@ namespace Interpreter
                 runtime.setPC (runtime.getPC()-arg0-1);
             }
     };
+
+    class OpJumpForwardZero : public Opcode1
+    {
+        public:
+
+            virtual void execute (Runtime& runtime, unsigned int arg0)
+            {
+                if (arg0==0)
+                    throw std::logic_error ("infinite loop");
+
+                Type_Integer data = runtime[0].mInteger;
+                runtime.pop();
+
+                if (data==0)
+                    runtime.setPC (runtime.getPC()+arg0-1);
+            }
+    };
+
+    class OpJumpBackwardZero : public Opcode1
+    {
+        public:
+
+            virtual void execute (Runtime& runtime, unsigned int arg0)
+            {
+                if (arg0==0)
+                    throw std::logic_error ("infinite loop");
+
+                Type_Integer data = runtime[0].mInteger;
+                runtime.pop();
+
+                if (data==0)
+                    runtime.setPC (runtime.getPC()-arg0-1);
+            }
+    };
 }
 
 #endif
@@ -51,6 +51,11 @@ namespace Interpreter
         interpreter.installSegment5 (68, new OpFetchMemberShort (true));
         interpreter.installSegment5 (69, new OpFetchMemberLong (true));
         interpreter.installSegment5 (70, new OpFetchMemberFloat (true));
+        interpreter.installSegment0 (3, new OpPushLocalShort);
+        interpreter.installSegment0 (4, new OpPushLocalLong);
+        interpreter.installSegment0 (5, new OpPushLocalFloat);
+        interpreter.installSegment0 (6, new OpPushIntLiteral);
+        interpreter.installSegment0 (7, new OpPushFloatLiteral);
 
         // math
         interpreter.installSegment5 (9, new OpAddInt<Type_Integer>);
@@ -94,6 +99,8 @@ namespace Interpreter
         interpreter.installSegment5 (25, new OpSkipNonZero);
         interpreter.installSegment0 (1, new OpJumpForward);
         interpreter.installSegment0 (2, new OpJumpBackward);
+        interpreter.installSegment0 (8, new OpJumpForwardZero);
+        interpreter.installSegment0 (9, new OpJumpBackwardZero);
 
         // misc
         interpreter.installSegment3 (0, new OpMessageBox);
@@ -5,6 +5,7 @@
 #include <stdexcept>
 
 #include "opcodes.hpp"
+#include "profiler.hpp"
 
 namespace Interpreter
 {
@@ -159,7 +160,7 @@ namespace Interpreter
         }
     }
 
-    Interpreter::Interpreter() : mRunning (false)
+    Interpreter::Interpreter() : mRunning (false), mProfiler (0)
     {}
 
     Interpreter::~Interpreter()
@@ -225,7 +226,13 @@ namespace Interpreter
         mSegment5.insert (std::make_pair (code, opcode));
     }
 
-    void Interpreter::run (const Type_Code *code, int codeSize, Context& context)
+    void Interpreter::setProfiler (Profiler *profiler)
+    {
+        mProfiler = profiler;
+    }
+
+    void Interpreter::run (const Type_Code *code, int codeSize, Context& context,
+        const std::string& name)
     {
         assert (codeSize>=4);
 
@@ -239,11 +246,34 @@ namespace Interpreter
 
             const Type_Code *codeBlock = code + 4;
 
-            while (mRuntime.getPC()>=0 && mRuntime.getPC()<opcodes)
+            if (mProfiler)
+            {
+                // keep a local copy, profiling might get toggled while the script is running
+                Profiler *profiler = mProfiler;
+                Profiler::Clock::time_point start = Profiler::Clock::now();
+                unsigned int instructions = 0;
+
+                while (mRuntime.getPC()>=0 && mRuntime.getPC()<opcodes)
+                {
+                    Type_Code runCode = codeBlock[mRuntime.getPC()];
+                    mRuntime.setPC (mRuntime.getPC()+1);
+
+                    Profiler::Clock::time_point instructionStart = Profiler::Clock::now();
+                    execute (runCode);
+                    profiler->addInstruction (runCode, Profiler::Clock::now()-instructionStart);
+                    ++instructions;
+                }
+
+                profiler->addScript (name, instructions, Profiler::Clock::now()-start);
+            }
+            else
             {
-                Type_Code runCode = codeBlock[mRuntime.getPC()];
-                mRuntime.setPC (mRuntime.getPC()+1);
-                execute (runCode);
+                while (mRuntime.getPC()>=0 && mRuntime.getPC()<opcodes)
+                {
+                    Type_Code runCode = codeBlock[mRuntime.getPC()];
+                    mRuntime.setPC (mRuntime.getPC()+1);
+                    execute (runCode);
+                }
             }
         }
         catch (...)
@@ -3,6 +3,7 @@
 
 #include <map>
 #include <stack>
+#include <string>
 
 #include "runtime.hpp"
 #include "types.hpp"
@@ -12,6 +13,7 @@ namespace Interpreter
     class Opcode0;
     class Opcode1;
     class Opcode2;
+    class Profiler;
 
     class Interpreter
     {
@@ -24,6 +26,7 @@ namespace Interpreter
             std::map<int, Opcode1 *> mSegment3;
             std::map<int, Opcode2 *> mSegment4;
             std::map<int, Opcode0 *> mSegment5;
+            Profiler *mProfiler;
 
             // not implemented
             Interpreter (const Interpreter&);
@@ -63,7 +66,13 @@ namespace Interpreter
             void installSegment5 (int code, Opcode0 *opcode);
             ///< ownership of \a opcode is transferred to *this.
 
-            void run (const Type_Code *code, int codeSize, Context& context);
+            void setProfiler (Profiler *profiler);
+            ///< Collect execution statistics into \a profiler (0: disable profiling).
+            /// Ownership of \a profiler is not transferred.
+
+            void run (const Type_Code *code, int codeSize, Context& context,
+                const std::string& name = "");
+            ///< \param name Script ID used for profiling
     };
 }
 
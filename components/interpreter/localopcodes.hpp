@@ -113,6 +113,59 @@ namespace Interpreter
             }
     };
 
+    class OpPushIntLiteral : public Opcode1
+    {
+        public:
+
+            virtual void execute (Runtime& runtime, unsigned int arg0)
+            {
+                runtime.push (runtime.getIntegerLiteral (arg0));
+            }
+    };
+
+    class OpPushFloatLiteral : public Opcode1
+    {
+        public:
+
+            virtual void execute (Runtime& runtime, unsigned int arg0)
+            {
+                runtime.push (runtime.getFloatLiteral (arg0));
+            }
+    };
+
+    class OpPushLocalShort : public Opcode1
+    {
+        public:
+
+            virtual void execute (Runtime& runtime, unsigned int arg0)
+            {
+                Type_Integer value = runtime.getContext().getLocalShort (arg0);
+                runtime.push (value);
+            }
+    };
+
+    class OpPushLocalLong : public Opcode1
+    {
+        public:
+
+            virtual void execute (Runtime& runtime, unsigned int arg0)
+            {
+                Type_Integer value = runtime.getContext().getLocalLong (arg0);
+                runtime.push (value);
+            }
+    };
+
+    class OpPushLocalFloat : public Opcode1
+    {
+        public:
+
+            virtual void execute (Runtime& runtime, unsigned int arg0)
+            {
+                Type_Float value = runtime.getContext().getLocalFloat (arg0);
+                runtime.push (value);
+            }
+    };
+
     class OpStoreGlobalShort : public Opcode0
     {
         public:
@@ -0,0 +1,127 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <vector>
+
+namespace
+{
+    template<typename Key>
+    bool compareTime (const std::pair<Key, Interpreter::Profiler::Entry>& left,
+        const std::pair<Key, Interpreter::Profiler::Entry>& right)
+    {
+        return left.second.mTime > right.second.mTime;
+    }
+
+    template<typename Key>
+    std::vector<std::pair<Key, Interpreter::Profiler::Entry> > sortByTime (
+        const std::map<Key, Interpreter::Profiler::Entry>& entries, std::size_t maxEntries)
+    {
+        std::vector<std::pair<Key, Interpreter::Profiler::Entry> > sorted (entries.begin(), entries.end());
+        std::stable_sort (sorted.begin(), sorted.end(), compareTime<Key>);
+
+        if (maxEntries && sorted.size()>maxEntries)
+            sorted.resize (maxEntries);
+
+        return sorted;
+    }
+}
+
+namespace Interpreter
+{
+    Profiler::Profiler() : mStart (Clock::now()) {}
+
+    void Profiler::addScript (const std::string& name, unsigned int instructions, Clock::duration time)
+    {
+        Entry& entry = mScripts[name];
+        ++entry.mInvocations;
+        entry.mInstructions += instructions;
+        entry.mTime += std::chrono::duration<double> (time).count();
+    }
+
+    void Profiler::addInstruction (Type_Code code, Clock::duration time)
+    {
+        Entry& entry = mOpcodes[decode (code)];
+        ++entry.mInvocations;
+        ++entry.mInstructions;
+        entry.mTime += std::chrono::duration<double> (time).count();
+    }
+
+    void Profiler::clear()
+    {
+        mScripts.clear();
+        mOpcodes.clear();
+        mStart = Clock::now();
+    }
+
+    const std::map<std::string, Profiler::Entry>& Profiler::getScripts() const
+    {
+        return mScripts;
+    }
+
+    const std::map<Profiler::OpcodeKey, Profiler::Entry>& Profiler::getOpcodes() const
+    {
+        return mOpcodes;
+    }
+
+    void Profiler::report (std::ostream& stream, std::size_t maxEntries) const
+    {
+        double period = std::chrono::duration<double> (Clock::now()-mStart).count();
+
+        stream << "Script profile over " << std::fixed << std::setprecision (3) << period << " s" << std::endl;
+
+        stream << std::endl << "Scripts (time ms, invocations, instructions, us per invocation):" << std::endl;
+
+        std::vector<std::pair<std::string, Entry> > scripts = sortByTime (mScripts, maxEntries);
+
+        for (std::vector<std::pair<std::string, Entry> >::const_iterator iter (scripts.begin());
+            iter!=scripts.end(); ++iter)
+        {
+            const Entry& entry = iter->second;
+
+            stream
+                << "  " << std::left << std::setw (32) << iter->first << std::right
+                << std::setw (12) << std::setprecision (3) << entry.mTime * 1000
+                << std::setw (10) << entry.mInvocations
+                << std::setw (14) << entry.mInstructions
+                << std::setw (12) << std::setprecision (2) << entry.mTime * 1000000 / entry.mInvocations
+                << std::endl;
+        }
+
+        stream << std::endl << "Opcodes (segment, opcode, time ms, executions, ns per execution):" << std::endl;
+
+        std::vector<std::pair<OpcodeKey, Entry> > opcodes = sortByTime (mOpcodes, maxEntries);
+
+        for (std::vector<std::pair<OpcodeKey, Entry> >::const_iterator iter (opcodes.begin());
+            iter!=opcodes.end(); ++iter)
+        {
+            const Entry& entry = iter->second;
+
+            stream
+                << "  " << iter->first.first << "  0x" << std::hex << iter->first.second << std::dec
+                << std::setw (12) << std::setprecision (3) << entry.mTime * 1000
+                << std::setw (14) << entry.mInvocations
+                << std::setw (12) << std::setprecision (1) << entry.mTime * 1000000000 / entry.mInvocations
+                << std::endl;
+        }
+    }
+
+    Profiler::OpcodeKey Profiler::decode (Type_Code code)
+    {
+        switch (code>>30)
+        {
+            case 0: return OpcodeKey (0, code>>24);
+            case 1: return OpcodeKey (1, (code>>24) & 0x3f);
+            case 2: return OpcodeKey (2, (code>>20) & 0x3ff);
+        }
+
+        switch (code>>26)
+        {
+            case 0x30: return OpcodeKey (3, (code>>8) & 0x3ffff);
+            case 0x31: return OpcodeKey (4, (code>>16) & 0x3ff);
+            case 0x32: return OpcodeKey (5, code & 0x3ffffff);
+        }
+
+        return OpcodeKey (-1, code);
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef INTERPRETER_PROFILER_H_INCLUDED
+#define INTERPRETER_PROFILER_H_INCLUDED
+
+#include <chrono>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+
+#include "types.hpp"
+
+namespace Interpreter
+{
+    /// \brief Accumulates execution statistics per script and per opcode
+    ///
+    /// Times are inclusive: a script that triggers the execution of another script on the same
+    /// interpreter is charged for the nested script too.
+    class Profiler
+    {
+        public:
+
+            typedef std::chrono::steady_clock Clock;
+
+            struct Entry
+            {
+                unsigned int mInvocations;
+                unsigned long long mInstructions;
+                double mTime; ///< in seconds
+
+                Entry() : mInvocations (0), mInstructions (0), mTime (0) {}
+            };
+
+            /// (segment, opcode)
+            typedef std::pair<int, int> OpcodeKey;
+
+        private:
+
+            std::map<std::string, Entry> mScripts;
+            std::map<OpcodeKey, Entry> mOpcodes;
+            Clock::time_point mStart;
+
+        public:
+
+            Profiler();
+
+            void addScript (const std::string& name, unsigned int instructions, Clock::duration time);
+
+            void addInstruction (Type_Code code, Clock::duration time);
+
+            void clear();
+            ///< Discard all statistics and restart the measurement period.
+
+            const std::map<std::string, Entry>& getScripts() const;
+
+            const std::map<OpcodeKey, Entry>& getOpcodes() const;
+
+            void report (std::ostream& stream, std::size_t maxEntries = 0) const;
+            ///< Write statistics sorted by accumulated time.
+            /// \param maxEntries Limit for each of the two tables (0: unlimited)
+
+            static OpcodeKey decode (Type_Code code);
+            ///< Return segment and opcode of \a code (arguments are stripped).
+    };
+}
+
+#endif
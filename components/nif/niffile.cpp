@@ -1,34 +1,94 @@
 #include "niffile.hpp"
 #include "effect.hpp"
 
-#include <map>
+#include <cstddef>
+#include <new>
 #include <sstream>
+#include <unordered_map>
 
 namespace Nif
 {
 
+namespace
+{
+    /// Size of the blocks records are allocated from. Most files fit in one or two.
+    const size_t sArenaBlockSize = 16384;
+
+    const size_t sArenaAlignment = alignof(std::max_align_t);
+}
+
+RecordArena::RecordArena()
+    : mUsed(sArenaBlockSize)
+{
+}
+
+RecordArena::~RecordArena()
+{
+    for (std::vector<char*>::iterator it = mBlocks.begin(); it != mBlocks.end(); ++it)
+        delete[] *it;
+}
+
+void* RecordArena::allocate(size_t size)
+{
+    size = (size + sArenaAlignment - 1) / sArenaAlignment * sArenaAlignment;
+
+    // records too large to share a block get one of their own
+    if (size > sArenaBlockSize / 4)
+    {
+        mBlocks.insert(mBlocks.begin(), new char[size]);
+        return mBlocks.front();
+    }
+
+    if (mUsed + size > sArenaBlockSize)
+    {
+        mBlocks.push_back(new char[sArenaBlockSize]);
+        mUsed = 0;
+    }
+
+    void* result = mBlocks.back() + mUsed;
+    mUsed += size;
+    return result;
+}
+
 /// Open a NIF stream. The name is used for error messages.
 NIFFile::NIFFile(Files::IStreamPtr stream, const std::string &name)
     : ver(0)
     , filename(name)
     , mUseSkinning(false)
 {
-    parse(stream);
+    try
+    {
+        parse(stream);
+    }
+    catch (...)
+    {
+        destroyRecords();
+        throw;
+    }
 }
 
 NIFFile::~NIFFile()
 {
+    destroyRecords();
+}
+
+void NIFFile::destroyRecords()
+{
+    // the memory itself is freed along with the arena
     for (std::vector<Record*>::iterator it = records.begin() ; it != records.end(); ++it)
     {
-        delete *it;
+        if (*it)
+            (*it)->~Record();
     }
+    records.clear();
+    roots.clear();
 }
 
-template <typename NodeType> static Record* construct() { return new NodeType; }
+template <typename NodeType> static Record* construct(RecordArena& arena) { return new (arena.allocate(sizeof(NodeType))) NodeType; }
 
 struct RecordFactoryEntry {
 
-    typedef Record* (*create_t) ();
+    typedef Record* (*create_t) (RecordArena&);
 
     create_t        mCreate;
     RecordType      mType;
@@ -36,16 +96,18 @@ struct RecordFactoryEntry {
 };
 
 ///Helper function for adding records to the factory map
-static std::pair<std::string,RecordFactoryEntry> makeEntry(std::string recName, Record* (*create_t) (), RecordType type)
+static std::pair<std::string,RecordFactoryEntry> makeEntry(std::string recName, Record* (*create_t) (RecordArena&), RecordType type)
 {
     RecordFactoryEntry anEntry = {create_t,type};
     return std::make_pair(recName, anEntry);
 }
 
+typedef std::unordered_map<std::string,RecordFactoryEntry> RecordFactory;
+
 ///These are all the record types we know how to read.
-static std::map<std::string,RecordFactoryEntry> makeFactory()
+static RecordFactory makeFactory()
 {
-    std::map<std::string,RecordFactoryEntry> newFactory;
+    RecordFactory newFactory;
     newFactory.insert(makeEntry("NiNode",                     &construct <NiNode>                      , RC_NiNode                        ));
     newFactory.insert(makeEntry("NiSwitchNode",               &construct <NiSwitchNode>                , RC_NiSwitchNode                  ));
     newFactory.insert(makeEntry("NiLODNode",                  &construct <NiLODNode>                   , RC_NiLODNode                     ));
@@ -114,7 +176,7 @@ static std::map<std::string,RecordFactoryEntry> makeFactory()
 
 
 ///Make the factory map used for parsing the file
-static const std::map<std::string,RecordFactoryEntry> factories = makeFactory();
+static const RecordFactory factories = makeFactory();
 
 std::string NIFFile::printVersion(unsigned int version)
 {
@@ -149,7 +211,7 @@ void NIFFile::parse(Files::IStreamPtr stream)
         fail("Unsupported NIF version: " + printVersion(ver));
     // Number of records
     size_t recNum = nif.getInt();
-    records.resize(recNum);
+    records.resize(recNum, NULL);
 
     /* The format for 10.0.1.0 seems to be a bit different. After the
      header, it contains the number of records, r (int), just like
@@ -172,11 +234,11 @@ void NIFFile::parse(Files::IStreamPtr stream)
             fail(error.str());
         }
 
-        std::map<std::string,RecordFactoryEntry>::const_iterator entry = factories.find(rec);
+        RecordFactory::const_iterator entry = factories.find(rec);
 
         if (entry != factories.end())
         {
-            r = entry->second.mCreate ();
+            r = entry->second.mCreate (mArena);
             r->recType = entry->second.mType;
         }
         else
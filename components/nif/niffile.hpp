@@ -14,6 +14,25 @@
 namespace Nif
 {
 
+/// @brief Memory that records are constructed in, so that they don't need a heap allocation each.
+/// @note Does not call destructors, the memory is simply freed all at once when the arena is destroyed.
+class RecordArena
+{
+public:
+    RecordArena();
+    ~RecordArena();
+
+    /// Get \a size bytes of memory, aligned for any type.
+    void* allocate(size_t size);
+
+private:
+    RecordArena(const RecordArena&);
+    void operator = (const RecordArena&);
+
+    std::vector<char*> mBlocks;
+    size_t mUsed;
+};
+
 class NIFFile
 {
     enum NIFVersion {
@@ -34,9 +53,15 @@ class NIFFile
 
     bool mUseSkinning;
 
+    /// The records are constructed in here
+    RecordArena mArena;
+
     /// Parse the file
     void parse(Files::IStreamPtr stream);
 
+    /// Destroy the records constructed so far
+    void destroyRecords();
+
     /// Get the file's version in a human readable form
     ///\returns A string containing a human readable NIF version number
     std::string printVersion(unsigned int version);
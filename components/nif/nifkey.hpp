@@ -5,8 +5,9 @@
 
 #include "nifstream.hpp"
 
+#include <algorithm>
 #include <sstream>
-#include <map>
+#include <vector>
 
 #include "niffile.hpp"
 
@@ -33,8 +34,6 @@ typedef KeyT<osg::Quat> QuaternionKey;
 
 template<typename T, T (NIFStream::*getValue)()>
 struct KeyMapT {
-    typedef std::map< float, KeyT<T> > MapType;
-
     typedef T ValueType;
     typedef KeyT<T> KeyType;
 
@@ -44,10 +43,20 @@ struct KeyMapT {
     static const unsigned int sXYZInterpolation = 4;
 
     unsigned int mInterpolationType;
-    MapType mKeys;
+
+    /// Times of the keys in ascending order, each time appearing only once. The values at these times are in mValues.
+    /// @note Kept in separate arrays rather than a map, so that looking up a time only touches the times and the two
+    /// values that are interpolated.
+    std::vector<float> mTimes;
+    std::vector<T> mValues;
 
     KeyMapT() : mInterpolationType(sLinearInterpolation) {}
 
+    bool empty() const
+    {
+        return mTimes.empty();
+    }
+
     //Read in a KeyGroup (see http://niftools.sourceforge.net/doc/nif/NiKeyframeData.html)
     void read(NIFStream *nif, bool force=false)
     {
@@ -59,7 +68,8 @@ struct KeyMapT {
         if(count == 0 && !force)
             return;
 
-        mKeys.clear();
+        mTimes.clear();
+        mValues.clear();
 
         mInterpolationType = nif->getUInt();
 
@@ -68,29 +78,32 @@ struct KeyMapT {
 
         if(mInterpolationType == sLinearInterpolation)
         {
+            reserve(count);
             for(size_t i = 0;i < count;i++)
             {
                 float time = nif->getFloat();
                 readValue(nifReference, key);
-                mKeys[time] = key;
+                addKey(time, key);
             }
         }
         else if(mInterpolationType == sQuadraticInterpolation)
         {
+            reserve(count);
             for(size_t i = 0;i < count;i++)
             {
                 float time = nif->getFloat();
                 readQuadratic(nifReference, key);
-                mKeys[time] = key;
+                addKey(time, key);
             }
         }
         else if(mInterpolationType == sTBCInterpolation)
         {
+            reserve(count);
             for(size_t i = 0;i < count;i++)
             {
                 float time = nif->getFloat();
                 readTBC(nifReference, key);
-                mKeys[time] = key;
+                addKey(time, key);
             }
         }
         //XYZ keys aren't actually read here.
@@ -123,6 +136,34 @@ struct KeyMapT {
     }
 
 private:
+    void reserve(size_t count)
+    {
+        mTimes.reserve(count);
+        mValues.reserve(count);
+    }
+
+    /// Keys are almost always stored in order, otherwise insert the key where it belongs. A later key replaces an earlier
+    /// one with the same time.
+    void addKey(float time, const KeyT<T>& key)
+    {
+        if (mTimes.empty() || time > mTimes.back())
+        {
+            mTimes.push_back(time);
+            mValues.push_back(key.mValue);
+            return;
+        }
+
+        std::vector<float>::iterator found = std::lower_bound(mTimes.begin(), mTimes.end(), time);
+        size_t index = found - mTimes.begin();
+        if (*found == time)
+            mValues[index] = key.mValue;
+        else
+        {
+            mTimes.insert(found, time);
+            mValues.insert(mValues.begin() + index, key.mValue);
+        }
+    }
+
     static void readValue(NIFStream &nif, KeyT<T> &key)
     {
         key.mValue = (nif.*getValue)();
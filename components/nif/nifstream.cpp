@@ -7,7 +7,25 @@ namespace Nif
 
 //Private functions
 
+void NIFStream::failEndOfFile()
+{
+    file->fail("Unexpected end of file");
+}
 
 //Public functions
 
+NIFStream::NIFStream(NIFFile *file, Files::IStreamPtr inp)
+    : mPos(0)
+    , file(file)
+{
+    const size_t chunkSize = 65536;
+    while (inp->good())
+    {
+        size_t offset = mBuffer.size();
+        mBuffer.resize(offset + chunkSize);
+        inp->read(mBuffer.data() + offset, chunkSize);
+        mBuffer.resize(offset + static_cast<size_t>(inp->gcount()));
+    }
+}
+
 }
@@ -3,7 +3,9 @@
 #ifndef OPENMW_COMPONENTS_NIF_NIFSTREAM_HPP
 #define OPENMW_COMPONENTS_NIF_NIFSTREAM_HPP
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <stdint.h>
 #include <stdexcept>
 #include <vector>
@@ -21,126 +23,115 @@ namespace Nif
 
 class NIFFile;
 
-/* 
-    readLittleEndianBufferOfType: This template should only be used with non POD data types
-*/
-template <uint32_t numInstances, typename T, typename IntegerT> inline void readLittleEndianBufferOfType(Files::IStreamPtr &pIStream, T* dest)
+/// Copy \a numInstances values of type T, stored as little endian in \a source, to \a dest.
+/// @note This template should only be used with POD data types.
+template <typename T, typename IntegerT> inline void copyLittleEndianBufferOfType(const char* source, T* dest, size_t numInstances)
 {
 #if defined(__x86_64__) || defined(_M_X64) || defined(__i386) || defined(_M_IX86)
-    pIStream->read((char*)dest, numInstances * sizeof(T));
+    std::memcpy(dest, source, numInstances * sizeof(T));
 #else
-    uint8_t* destByteBuffer = (uint8_t*)dest;
-    pIStream->read((char*)dest, numInstances * sizeof(T));
-    /*
-        Due to the loop iterations being known at compile time,
-        this nested loop will most likely be unrolled
-        For example, for 2 instances of a 4 byte data type, you should get the below result
-    */
+    const uint8_t* sourceByteBuffer = (const uint8_t*)source;
     union {
         IntegerT i;
         T t;
     } u;
-    for (uint32_t i = 0; i < numInstances; i++)
+    for (size_t i = 0; i < numInstances; i++)
     {
-        u = { 0 };
+        u.i = 0;
         for (uint32_t byte = 0; byte < sizeof(T); byte++)
-            u.i |= (((IntegerT)destByteBuffer[i * sizeof(T) + byte]) << (byte * 8));
+            u.i |= ((IntegerT)sourceByteBuffer[i * sizeof(T) + byte]) << (byte * 8);
         dest[i] = u.t;
     }
 #endif
 }
 
-/*
-    readLittleEndianDynamicBufferOfType: This template should only be used with non POD data types
-*/
-template <typename T, typename IntegerT> inline void readLittleEndianDynamicBufferOfType(Files::IStreamPtr &pIStream, T* dest, uint32_t numInstances)
-{
-#if defined(__x86_64__) || defined(_M_X64) || defined(__i386) || defined(_M_IX86)
-    pIStream->read((char*)dest, numInstances * sizeof(T));
-#else
-    uint8_t* destByteBuffer = (uint8_t*)dest;
-    pIStream->read((char*)dest, numInstances * sizeof(T));
-    union {
-        IntegerT i;
-        T t;
-    } u;
-    for (uint32_t i = 0; i < numInstances; i++)
+class NIFStream {
+
+    /// The contents of the file. It is read all at once, so that values can be copied straight out of memory
+    /// rather than being read from the stream one by one.
+    std::vector<char> mBuffer;
+    size_t mPos;
+
+    /// Get the next \a size bytes and move past them.
+    const char* read(size_t size)
     {
-        u.i = 0;
-        for (uint32_t byte = 0; byte < sizeof(T); byte++)
-            u.i |= ((IntegerT)destByteBuffer[i * sizeof(T) + byte]) << (byte * 8);
-        dest[i] = u.t;
+        if (size > mBuffer.size() - mPos)
+            failEndOfFile();
+        const char* data = mBuffer.data() + mPos;
+        mPos += size;
+        return data;
     }
-#endif
-}
-template<typename type, typename IntegerT> type inline readLittleEndianType(Files::IStreamPtr &pIStream)
-{
-    type val;
-    readLittleEndianBufferOfType<1,type,IntegerT>(pIStream, (type*)&val);
-    return val;
-}
 
-class NIFStream {
+    template<typename T, typename IntegerT> T readType()
+    {
+        T val;
+        copyLittleEndianBufferOfType<T,IntegerT>(read(sizeof(T)), &val, 1);
+        return val;
+    }
+
+    template<typename T, typename IntegerT> void readTypes(T* dest, size_t numInstances)
+    {
+        copyLittleEndianBufferOfType<T,IntegerT>(read(numInstances * sizeof(T)), dest, numInstances);
+    }
 
-    /// Input stream
-    Files::IStreamPtr inp;
+    void failEndOfFile();
 
 public:
 
     NIFFile * const file;
 
-    NIFStream (NIFFile * file, Files::IStreamPtr inp): inp (inp), file (file) {}
+    NIFStream (NIFFile * file, Files::IStreamPtr inp);
 
-    void skip(size_t size) { inp->ignore(size); }
+    void skip(size_t size) { read(size); }
 
     char getChar() 
     {
-        return readLittleEndianType<char,char>(inp); 
+        return readType<char,char>();
     }
     short getShort() 
     { 
-        return readLittleEndianType<short,short>(inp);
+        return readType<short,short>();
     }
     unsigned short getUShort() 
     { 
-        return readLittleEndianType<unsigned short,unsigned short>(inp);
+        return readType<unsigned short,unsigned short>();
     }
     int getInt() 
     {
-        return readLittleEndianType<int,int>(inp);
+        return readType<int,int>();
     }
     unsigned int getUInt() 
     { 
-        return readLittleEndianType<unsigned int,unsigned int>(inp);
+        return readType<unsigned int,unsigned int>();
     }
     float getFloat() 
     { 
-        return readLittleEndianType<float,uint32_t>(inp);
+        return readType<float,uint32_t>();
     }
 
     osg::Vec2f getVector2() {
         osg::Vec2f vec;
-        readLittleEndianBufferOfType<2,float,uint32_t>(inp, (float*)&vec._v[0]);
+        readTypes<float,uint32_t>(vec._v, 2);
         return vec;
     }
     osg::Vec3f getVector3() {
         osg::Vec3f vec;
-        readLittleEndianBufferOfType<3, float,uint32_t>(inp, (float*)&vec._v[0]);
+        readTypes<float,uint32_t>(vec._v, 3);
         return vec;
     }
     osg::Vec4f getVector4() {
         osg::Vec4f vec;
-        readLittleEndianBufferOfType<4, float,uint32_t>(inp, (float*)&vec._v[0]);
+        readTypes<float,uint32_t>(vec._v, 4);
         return vec;
     }
     Matrix3 getMatrix3() {
         Matrix3 mat;
-        readLittleEndianBufferOfType<9, float,uint32_t>(inp, (float*)&mat.mValues);
+        readTypes<float,uint32_t>((float*)&mat.mValues, 9);
         return mat;
     }
     osg::Quat getQuaternion() {
         float f[4];
-        readLittleEndianBufferOfType<4, float,uint32_t>(inp, (float*)&f);
+        readTypes<float,uint32_t>(f, 4);
         osg::Quat quat;
         quat.w() = f[0];
         quat.x() = f[1];
@@ -158,46 +149,46 @@ public:
 
     ///Read in a string of the given length
     std::string getString(size_t length) {
-        std::vector<char> str(length + 1, 0);
-
-        inp->read(&str[0], length);
-
-        return &str[0];
+        const char* str = read(length);
+        // the string ends at the first null character, if any
+        return std::string(str, std::find(str, str + length, '\0'));
     }
     ///Read in a string of the length specified in the file
     std::string getString() {
-        size_t size = readLittleEndianType<uint32_t,uint32_t>(inp);
+        size_t size = readType<uint32_t,uint32_t>();
         return getString(size);
     }
     ///This is special since the version string doesn't start with a number, and ends with "\n"
     std::string getVersionString() {
-        std::string result;
-        std::getline(*inp, result);
+        std::vector<char>::const_iterator begin = mBuffer.begin() + mPos;
+        std::vector<char>::const_iterator end = std::find(begin, mBuffer.end(), '\n');
+        std::string result (begin, end);
+        mPos = std::min(mBuffer.size(), mPos + result.size() + 1);
         return result;
     }
 
     void getUShorts(std::vector<unsigned short> &vec, size_t size) {
         vec.resize(size);
-        readLittleEndianDynamicBufferOfType<unsigned short,unsigned short>(inp, &vec.front(), size);
+        readTypes<unsigned short,unsigned short>(vec.data(), size);
     }
     void getFloats(std::vector<float> &vec, size_t size) {
         vec.resize(size);
-        readLittleEndianDynamicBufferOfType<float,uint32_t>(inp, &vec.front(), size);
+        readTypes<float,uint32_t>(vec.data(), size);
     }
     void getVector2s(std::vector<osg::Vec2f> &vec, size_t size) {
         vec.resize(size);
         /* The packed storage of each Vec2f is 2 floats exactly */
-        readLittleEndianDynamicBufferOfType<float,uint32_t>(inp,(float*) &vec.front(), size*2);
+        readTypes<float,uint32_t>((float*)vec.data(), size*2);
     }
     void getVector3s(std::vector<osg::Vec3f> &vec, size_t size) {
         vec.resize(size);
         /* The packed storage of each Vec3f is 3 floats exactly */
-        readLittleEndianDynamicBufferOfType<float,uint32_t>(inp, (float*) &vec.front(), size*3);
+        readTypes<float,uint32_t>((float*)vec.data(), size*3);
     }
     void getVector4s(std::vector<osg::Vec4f> &vec, size_t size) {
         vec.resize(size);
         /* The packed storage of each Vec4f is 4 floats exactly */
-        readLittleEndianDynamicBufferOfType<float,uint32_t>(inp, (float*) &vec.front(), size*4);
+        readTypes<float,uint32_t>((float*)vec.data(), size*4);
     }
     void getQuaternions(std::vector<osg::Quat> &quat, size_t size) {
         quat.resize(size);
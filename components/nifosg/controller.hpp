@@ -43,18 +43,15 @@ namespace NifOsg
 
         ValueInterpolator()
             : mDefaultVal(ValueT())
+            , mLastIndex(0)
         {
         }
 
         ValueInterpolator(std::shared_ptr<const MapT> keys, ValueT defaultVal = ValueT())
             : mKeys(keys)
             , mDefaultVal(defaultVal)
+            , mLastIndex(0)
         {
-            if (keys)
-            {
-                mLastLowKey = mKeys->mKeys.end();
-                mLastHighKey = mKeys->mKeys.end();
-            }
         }
 
         ValueT interpKey(float time) const
@@ -62,63 +59,45 @@ namespace NifOsg
             if (empty())
                 return mDefaultVal;
 
-            const typename MapT::MapType & keys = mKeys->mKeys;
+            const std::vector<float>& times = mKeys->mTimes;
+            const std::vector<ValueT>& values = mKeys->mValues;
 
-            if(time <= keys.begin()->first)
-                return keys.begin()->second.mValue;
+            if(time <= times.front())
+                return values.front();
+            if(time >= times.back())
+                return values.back();
 
-            // retrieve the current position in the map, optimized for the most common case
-            // where time moves linearly along the keyframe track
-            typename MapT::MapType::const_iterator it = mLastHighKey;
-            if (mLastHighKey != keys.end())
+            // find the first key at or after the time, starting from the keys used last time, optimized for the most
+            // common case where time moves linearly along the keyframe track
+            size_t index = mLastIndex;
+            if (index == 0 || index >= times.size() || time <= times[index-1] || time > times[index])
             {
-                if (time > mLastHighKey->first)
-                {
-                    // try if we're there by incrementing one
-                    ++mLastLowKey;
-                    ++mLastHighKey;
-                    it = mLastHighKey;
-                }
-                if (mLastHighKey == keys.end() || (time < mLastLowKey->first || time > mLastHighKey->first))
-                    it = keys.lower_bound(time); // still not there, reorient by performing lower_bound check on the whole map
+                if (index != 0 && index+1 < times.size() && time > times[index] && time <= times[index+1])
+                    ++index; // we're there by incrementing one
+                else
+                    index = std::lower_bound(times.begin(), times.end(), time) - times.begin(); // reorient by searching the whole track
             }
-            else
-                it = keys.lower_bound(time);
-
-            // now do the actual interpolation
-            if (it != keys.end())
-            {
-                float aTime = it->first;
-                const typename MapT::KeyType* aKey = &it->second;
-
-                // cache for next time
-                mLastHighKey = it;
 
-                typename MapT::MapType::const_iterator last = --it;
-                mLastLowKey = last;
-                float aLastTime = last->first;
-                const typename MapT::KeyType* aLastKey = &last->second;
+            // cache for next time
+            mLastIndex = index;
 
-                float a = (time - aLastTime) / (aTime - aLastTime);
-
-                return InterpolationFunc()(aLastKey->mValue, aKey->mValue, a);
-            }
-            else
-                return keys.rbegin()->second.mValue;
+            // now do the actual interpolation
+            float a = (time - times[index-1]) / (times[index] - times[index-1]);
+            return InterpolationFunc()(values[index-1], values[index], a);
         }
 
         bool empty() const
         {
-            return !mKeys || mKeys->mKeys.empty();
+            return !mKeys || mKeys->empty();
         }
 
     private:
-        mutable typename MapT::MapType::const_iterator mLastLowKey;
-        mutable typename MapT::MapType::const_iterator mLastHighKey;
-
         std::shared_ptr<const MapT> mKeys;
 
         ValueT mDefaultVal;
+
+        /// Index of the later of the two keys interpolated last time.
+        mutable size_t mLastIndex;
     };
 
     struct LerpFunc
@@ -1,5 +1,7 @@
 #include "nifloader.hpp"
 
+#include <algorithm>
+
 #include <osg/Matrixf>
 #include <osg/MatrixTransform>
 #include <osg/Geometry>
@@ -37,6 +39,7 @@
 #include <components/sceneutil/skeleton.hpp>
 #include <components/sceneutil/riggeometry.hpp>
 #include <components/sceneutil/morphgeometry.hpp>
+#include <components/sceneutil/workqueue.hpp>
 
 #include "particle.hpp"
 #include "userdata.hpp"
@@ -44,6 +47,159 @@
 namespace
 {
 
+    /// Minimum number of deferred jobs in a file for them to be spread over the work queue.
+    const unsigned int sMinParallelJobs = 4;
+
+    /// Work that only depends on a TriShape's own data, deferred so that it can run in parallel with other such work.
+    struct GeometryJob
+    {
+        const Nif::NiTriShape* mTriShape;
+
+        /// Geometry to receive the TriShape's arrays, or NULL.
+        osg::ref_ptr<osg::Geometry> mGeometry;
+        std::vector<int> mBoundTextures;
+
+        /// Influence map to receive the TriShape's bone weights, or NULL.
+        osg::ref_ptr<SceneUtil::RigGeometry::InfluenceMap> mInfluenceMap;
+    };
+
+    void fillGeometryArrays(const Nif::NiTriShape *triShape, osg::Geometry *geometry, const std::vector<int>& boundTextures, const std::string& filename)
+    {
+        const Nif::NiTriShapeData* data = triShape->data.getPtr();
+
+        {
+            geometry->setVertexArray(new osg::Vec3Array(data->vertices.size(), &data->vertices[0]));
+            if (!data->normals.empty())
+                geometry->setNormalArray(new osg::Vec3Array(data->normals.size(), &data->normals[0]), osg::Array::BIND_PER_VERTEX);
+        }
+
+        int textureStage = 0;
+        for (std::vector<int>::const_iterator it = boundTextures.begin(); it != boundTextures.end(); ++it,++textureStage)
+        {
+            int uvSet = *it;
+            if (uvSet >= (int)data->uvlist.size())
+            {
+                std::cerr << "Warning: out of bounds UV set " << uvSet << " on TriShape \"" << triShape->name << "\" in " << filename << std::endl;
+                if (!data->uvlist.empty())
+                    geometry->setTexCoordArray(textureStage, new osg::Vec2Array(data->uvlist[0].size(), &data->uvlist[0][0]), osg::Array::BIND_PER_VERTEX);
+                continue;
+            }
+
+            geometry->setTexCoordArray(textureStage, new osg::Vec2Array(data->uvlist[uvSet].size(), &data->uvlist[uvSet][0]), osg::Array::BIND_PER_VERTEX);
+        }
+
+        if (!data->colors.empty())
+            geometry->setColorArray(new osg::Vec4Array(data->colors.size(), &data->colors[0]), osg::Array::BIND_PER_VERTEX);
+
+        geometry->addPrimitiveSet(new osg::DrawElementsUShort(osg::PrimitiveSet::TRIANGLES,
+                                                              data->triangles.size(),
+                                                              (unsigned short*)&data->triangles[0]));
+    }
+
+    void fillInfluenceMap(const Nif::NiSkinInstance* skin, SceneUtil::RigGeometry::InfluenceMap& map)
+    {
+        const Nif::NiSkinData *data = skin->data.getPtr();
+        const Nif::NodeList &bones = skin->bones;
+        for(size_t i = 0;i < bones.length();i++)
+        {
+            std::string boneName = bones[i].getPtr()->name;
+
+            SceneUtil::RigGeometry::BoneInfluence influence;
+            const std::vector<Nif::NiSkinData::VertWeight> &weights = data->bones[i].weights;
+            for(size_t j = 0;j < weights.size();j++)
+            {
+                std::pair<unsigned short, float> indexWeight = std::make_pair(weights[j].vertex, weights[j].weight);
+                influence.mWeights.insert(indexWeight);
+            }
+            influence.mInvBindMatrix = data->bones[i].trafo.toMatrix();
+            influence.mBoundSphere = osg::BoundingSpheref(data->bones[i].boundSphereCenter, data->bones[i].boundSphereRadius);
+
+            map.mMap.insert(std::make_pair(boneName, influence));
+        }
+    }
+
+    /// @brief Runs the jobs deferred while loading a file, on the loading thread and on any work queue threads that join in.
+    /// @par Jobs are claimed one at a time, so the loading thread only ever waits for jobs that are already running. Work items
+    /// that start late simply find nothing left to do, which avoids a deadlock when the file is loaded on the work queue itself.
+    class GeometryJobRunner : public osg::Referenced
+    {
+    public:
+        GeometryJobRunner(std::vector<GeometryJob>& jobs, const std::string& filename)
+            : mFilename(filename)
+            , mNext(0)
+            , mFinished(0)
+        {
+            mJobs.swap(jobs);
+        }
+
+        unsigned int getNumJobs() const
+        {
+            return mJobs.size();
+        }
+
+        void run()
+        {
+            while (true)
+            {
+                unsigned int index = (++mNext) - 1;
+                if (index >= mJobs.size())
+                    return;
+
+                const GeometryJob& job = mJobs[index];
+                try
+                {
+                    if (job.mGeometry)
+                        fillGeometryArrays(job.mTriShape, job.mGeometry, job.mBoundTextures, mFilename);
+                    if (job.mInfluenceMap)
+                        fillInfluenceMap(job.mTriShape->skin.getPtr(), *job.mInfluenceMap);
+                }
+                catch (std::exception& e)
+                {
+                    std::cerr << "Error building TriShape \"" << job.mTriShape->name << "\" in " << mFilename << ": " << e.what() << std::endl;
+                }
+
+                if ((++mFinished) == mJobs.size())
+                {
+                    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+                    mCondition.broadcast();
+                }
+            }
+        }
+
+        void waitTillDone()
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+            while (mFinished < mJobs.size())
+                mCondition.wait(&mMutex);
+        }
+
+    private:
+        std::vector<GeometryJob> mJobs;
+        std::string mFilename;
+
+        OpenThreads::Atomic mNext;
+        OpenThreads::Atomic mFinished;
+        OpenThreads::Mutex mMutex;
+        OpenThreads::Condition mCondition;
+    };
+
+    class GeometryJobWorkItem : public SceneUtil::WorkItem
+    {
+    public:
+        GeometryJobWorkItem(GeometryJobRunner* runner)
+            : mRunner(runner)
+        {
+        }
+
+        virtual void doWork()
+        {
+            mRunner->run();
+        }
+
+    private:
+        osg::ref_ptr<GeometryJobRunner> mRunner;
+    };
+
     void getAllNiNodes(const Nif::Node* node, std::vector<int>& outIndices)
     {
         const Nif::NiNode* ninode = dynamic_cast<const Nif::NiNode*>(node);
@@ -166,6 +322,7 @@ namespace NifOsg
 {
 
     bool Loader::sShowMarkers = false;
+    osg::ref_ptr<SceneUtil::WorkQueue> Loader::sWorkQueue;
 
     void Loader::setShowMarkers(bool show)
     {
@@ -177,6 +334,16 @@ namespace NifOsg
         return sShowMarkers;
     }
 
+    void Loader::setWorkQueue(SceneUtil::WorkQueue* workQueue)
+    {
+        sWorkQueue = workQueue;
+    }
+
+    SceneUtil::WorkQueue* Loader::getWorkQueue()
+    {
+        return sWorkQueue;
+    }
+
     class LoaderImpl
     {
     public:
@@ -190,6 +357,28 @@ namespace NifOsg
         size_t mFirstRootTextureIndex;
         bool mFoundFirstRootTexturingProperty;
 
+        /// Building geometry arrays and bone influences of TriShapes, deferred until the node hierarchy is created.
+        std::vector<GeometryJob> mGeometryJobs;
+
+        void runGeometryJobs()
+        {
+            if (mGeometryJobs.empty())
+                return;
+
+            osg::ref_ptr<GeometryJobRunner> runner (new GeometryJobRunner(mGeometryJobs, mFilename));
+
+            SceneUtil::WorkQueue* workQueue = Loader::getWorkQueue();
+            if (workQueue && runner->getNumJobs() >= sMinParallelJobs)
+            {
+                unsigned int numHelpers = std::min(runner->getNumJobs() / sMinParallelJobs, workQueue->getNumThreads());
+                for (unsigned int i=0; i<numHelpers; ++i)
+                    workQueue->addWorkItem(new GeometryJobWorkItem(runner), true);
+            }
+
+            runner->run();
+            runner->waitTillDone();
+        }
+
         static void loadKf(Nif::NIFFilePtr nif, KeyframeHolder& target)
         {
             if(nif->numRoots() < 1)
@@ -248,6 +437,23 @@ namespace NifOsg
             }
         }
 
+        /// Have the external textures of the file decoded in the background while the scene graph is built.
+        void preloadTextures(Nif::NIFFilePtr nif, Resource::ImageManager* imageManager)
+        {
+            for (size_t i=0; i<nif->numRecords(); ++i)
+            {
+                const Nif::Record* record = nif->getRecord(i);
+                if (!record || record->recType != Nif::RC_NiSourceTexture)
+                    continue;
+
+                // same as in handleSourceTexture
+                const Nif::NiSourceTexture* st = static_cast<const Nif::NiSourceTexture*>(record);
+                if (!st->external && !st->data.empty())
+                    continue;
+                imageManager->preloadImage(Misc::ResourceHelpers::correctTexturePath(st->filename, imageManager->getVFS()));
+            }
+        }
+
         osg::ref_ptr<osg::Node> load(Nif::NIFFilePtr nif, Resource::ImageManager* imageManager)
         {
             if (nif->numRoots() < 1)
@@ -261,8 +467,12 @@ namespace NifOsg
 
             osg::ref_ptr<TextKeyMapHolder> textkeys (new TextKeyMapHolder);
 
+            preloadTextures(nif, imageManager);
+
             osg::ref_ptr<osg::Node> created = handleNode(nifNode, NULL, imageManager, std::vector<int>(), 0, false, false, &textkeys->mTextKeys);
 
+            runGeometryJobs();
+
             if (nif->getUseSkinning())
             {
                 osg::ref_ptr<SceneUtil::Skeleton> skel = new SceneUtil::Skeleton;
@@ -334,7 +544,8 @@ namespace NifOsg
             return lod;
         }
 
-        osg::ref_ptr<osg::Image> handleSourceTexture(const Nif::NiSourceTexture* st, Resource::ImageManager* imageManager)
+        osg::ref_ptr<osg::Image> handleSourceTexture(const Nif::NiSourceTexture* st, Resource::ImageManager* imageManager,
+                                                     Resource::ImageUsage usage = Resource::Usage_Color)
         {
             if (!st)
                 return NULL;
@@ -347,7 +558,7 @@ namespace NifOsg
             else
             {
                 std::string filename = Misc::ResourceHelpers::correctTexturePath(st->filename, imageManager->getVFS());
-                image = imageManager->getImage(filename);
+                image = imageManager->getImage(filename, usage);
             }
             return image;
         }
@@ -968,37 +1179,21 @@ namespace NifOsg
             }
         }
 
-        void triShapeToGeometry(const Nif::NiTriShape *triShape, osg::Geometry *geometry, osg::Node* parentNode, SceneUtil::CompositeStateSetUpdater* composite, const std::vector<int>& boundTextures, int animflags)
+        /// @param deferArrays Leave filling the geometry's arrays to runGeometryJobs(). Only for geometry that is not used before then.
+        void triShapeToGeometry(const Nif::NiTriShape *triShape, osg::Geometry *geometry, osg::Node* parentNode, SceneUtil::CompositeStateSetUpdater* composite, const std::vector<int>& boundTextures, int animflags, bool deferArrays=false)
         {
             const Nif::NiTriShapeData* data = triShape->data.getPtr();
 
+            if (deferArrays)
             {
-                geometry->setVertexArray(new osg::Vec3Array(data->vertices.size(), &data->vertices[0]));
-                if (!data->normals.empty())
-                    geometry->setNormalArray(new osg::Vec3Array(data->normals.size(), &data->normals[0]), osg::Array::BIND_PER_VERTEX);
-            }
-
-            int textureStage = 0;
-            for (std::vector<int>::const_iterator it = boundTextures.begin(); it != boundTextures.end(); ++it,++textureStage)
-            {
-                int uvSet = *it;
-                if (uvSet >= (int)data->uvlist.size())
-                {
-                    std::cerr << "Warning: out of bounds UV set " << uvSet << " on TriShape \"" << triShape->name << "\" in " << mFilename << std::endl;
-                    if (!data->uvlist.empty())
-                        geometry->setTexCoordArray(textureStage, new osg::Vec2Array(data->uvlist[0].size(), &data->uvlist[0][0]), osg::Array::BIND_PER_VERTEX);
-                    continue;
-                }
-
-                geometry->setTexCoordArray(textureStage, new osg::Vec2Array(data->uvlist[uvSet].size(), &data->uvlist[uvSet][0]), osg::Array::BIND_PER_VERTEX);
+                GeometryJob job;
+                job.mTriShape = triShape;
+                job.mGeometry = geometry;
+                job.mBoundTextures = boundTextures;
+                mGeometryJobs.push_back(job);
             }
-
-            if (!data->colors.empty())
-                geometry->setColorArray(new osg::Vec4Array(data->colors.size(), &data->colors[0]), osg::Array::BIND_PER_VERTEX);
-
-            geometry->addPrimitiveSet(new osg::DrawElementsUShort(osg::PrimitiveSet::TRIANGLES,
-                                                                  data->triangles.size(),
-                                                                  (unsigned short*)&data->triangles[0]));
+            else
+                fillGeometryArrays(triShape, geometry, boundTextures, mFilename);
 
             // osg::Material properties are handled here for two reasons:
             // - if there are no vertex colors, we need to disable colorMode.
@@ -1032,7 +1227,7 @@ namespace NifOsg
             {
                 osg::ref_ptr<osg::Geometry> geom (new osg::Geometry);
                 drawable = geom;
-                triShapeToGeometry(triShape, geom, parentNode, composite, boundTextures, animflags);
+                triShapeToGeometry(triShape, geom, parentNode, composite, boundTextures, animflags, true);
             }
 
             drawable->setName(triShape->name);
@@ -1068,29 +1263,12 @@ namespace NifOsg
             rig->setSourceGeometry(geometry);
             rig->setName(triShape->name);
 
-            const Nif::NiSkinInstance *skin = triShape->skin.getPtr();
-
-            // Assign bone weights
+            // Assign bone weights, the map is only read once the scene graph is in use
             osg::ref_ptr<SceneUtil::RigGeometry::InfluenceMap> map (new SceneUtil::RigGeometry::InfluenceMap);
-
-            const Nif::NiSkinData *data = skin->data.getPtr();
-            const Nif::NodeList &bones = skin->bones;
-            for(size_t i = 0;i < bones.length();i++)
-            {
-                std::string boneName = bones[i].getPtr()->name;
-
-                SceneUtil::RigGeometry::BoneInfluence influence;
-                const std::vector<Nif::NiSkinData::VertWeight> &weights = data->bones[i].weights;
-                for(size_t j = 0;j < weights.size();j++)
-                {
-                    std::pair<unsigned short, float> indexWeight = std::make_pair(weights[j].vertex, weights[j].weight);
-                    influence.mWeights.insert(indexWeight);
-                }
-                influence.mInvBindMatrix = data->bones[i].trafo.toMatrix();
-                influence.mBoundSphere = osg::BoundingSpheref(data->bones[i].boundSphereCenter, data->bones[i].boundSphereRadius);
-
-                map->mMap.insert(std::make_pair(boneName, influence));
-            }
+            GeometryJob job;
+            job.mTriShape = triShape;
+            job.mInfluenceMap = map;
+            mGeometryJobs.push_back(job);
             rig->setInfluenceMap(map);
 
             parentNode->addChild(rig);
@@ -1280,7 +1458,9 @@ namespace NifOsg
                     if (!tex.texture.empty())
                     {
                         const Nif::NiSourceTexture *st = tex.texture.getPtr();
-                        osg::ref_ptr<osg::Image> image = handleSourceTexture(st, imageManager);
+                        // bump maps hold offsets rather than colours
+                        Resource::ImageUsage usage = (i == Nif::NiTexturingProperty::BumpTexture) ? Resource::Usage_Data : Resource::Usage_Color;
+                        osg::ref_ptr<osg::Image> image = handleSourceTexture(st, imageManager, usage);
                         texture2d = new osg::Texture2D(image);
                     }
                     else
@@ -18,6 +18,11 @@ namespace Resource
     class ImageManager;
 }
 
+namespace SceneUtil
+{
+    class WorkQueue;
+}
+
 namespace NifOsg
 {
     typedef std::multimap<float,std::string> TextKeyMap;
@@ -74,9 +79,17 @@ namespace NifOsg
 
         static bool getShowMarkers();
 
+        /// Set a work queue to build the geometry of files with many shapes on, in parallel with the loading thread.
+        /// The loading thread still does its share of the work, so it is fine to load files on the same work queue.
+        /// Default: NULL, build everything on the loading thread.
+        static void setWorkQueue(SceneUtil::WorkQueue* workQueue);
+
+        static SceneUtil::WorkQueue* getWorkQueue();
+
     private:
 
         static bool sShowMarkers;
+        static osg::ref_ptr<SceneUtil::WorkQueue> sWorkQueue;
     };
 
 }
@@ -1,11 +1,19 @@
 #include "imagemanager.hpp"
 
 #include <cassert>
+#include <sstream>
+
+#include <boost/crc.hpp>
+
 #include <osgDB/Registry>
 
 #include <components/vfs/manager.hpp>
+#include <components/sceneutil/workqueue.hpp>
 
 #include "objectcache.hpp"
+#include "imageprocessing.hpp"
+#include "scenediskcache.hpp"
+#include "texturestreamer.hpp"
 
 #ifdef OSG_LIBRARY_STATIC
 // This list of plugins should match with the list in the top-level CMakelists.txt.
@@ -38,15 +46,107 @@ namespace
         return warningImage;
     }
 
+    /// Identifies the processed image of a file, covering the file's contents and the processing applied.
+    /// @note Reads the whole file, and rewinds it afterwards.
+    std::string getDiskCacheKey(const std::string& normalizedFilename, std::istream& file, bool cpuMipmaps, bool compress, Resource::ImageUsage usage)
+    {
+        boost::crc_32_type crc;
+        char buffer[4096];
+        while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0)
+            crc.process_bytes(buffer, file.gcount());
+        file.clear();
+        file.seekg(0);
+
+        // increment when the processing changes in a way that affects the result
+        const int version = 2;
+
+        std::ostringstream stream;
+        stream << version << " " << normalizedFilename << " " << crc.checksum() << " " << cpuMipmaps << " " << compress << " " << usage;
+        return stream.str();
+    }
+
+    /// The same file is cached separately for every usage, as it is processed differently.
+    std::string getCacheKey(const std::string& normalizedFilename, Resource::ImageUsage usage)
+    {
+        if (usage == Resource::Usage_Color)
+            return normalizedFilename;
+        std::ostringstream stream;
+        stream << normalizedFilename << " " << usage;
+        return stream.str();
+    }
+
 }
 
 namespace Resource
 {
 
+    /// @brief Loads an image once, on whichever thread gets to it first: a thread of the work queue or one asking for the image.
+    class ImageLoader : public SceneUtil::WorkItem
+    {
+    public:
+        ImageLoader(ImageManager* manager, const std::string& normalized, ImageUsage usage)
+            : mManager(manager)
+            , mNormalized(normalized)
+            , mUsage(usage)
+            , mClaimed(0)
+            , mLoaded(false)
+        {
+            setPool(SceneUtil::WorkQueue::Pool_IO);
+        }
+
+        virtual void doWork()
+        {
+            if (claim())
+                load();
+        }
+
+        /// Load the image, or wait for the thread already loading it.
+        osg::ref_ptr<osg::Image> getImage()
+        {
+            if (claim())
+                return load();
+
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mLoadMutex);
+            while (!mLoaded)
+                mLoadCondition.wait(&mLoadMutex);
+            return mImage;
+        }
+
+    private:
+        bool claim()
+        {
+            return mClaimed.exchange(1) == 0;
+        }
+
+        osg::ref_ptr<osg::Image> load()
+        {
+            osg::ref_ptr<osg::Image> image = mManager->loadImage(mNormalized, mUsage);
+            mManager->finishLoading(getCacheKey(mNormalized, mUsage), image);
+
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mLoadMutex);
+            mImage = image;
+            mLoaded = true;
+            mLoadCondition.broadcast();
+            return image;
+        }
+
+        ImageManager* mManager;
+        std::string mNormalized;
+        ImageUsage mUsage;
+
+        OpenThreads::Atomic mClaimed;
+        osg::ref_ptr<osg::Image> mImage;
+        bool mLoaded;
+        OpenThreads::Mutex mLoadMutex;
+        OpenThreads::Condition mLoadCondition;
+    };
+
     ImageManager::ImageManager(const VFS::Manager *vfs)
         : ResourceManager(vfs)
         , mWarningImage(createWarningImage())
         , mOptions(new osgDB::Options("dds_flip dds_dxt1_detect_rgba"))
+        , mCpuMipmaps(false)
+        , mCompress(false)
     {
     }
 
@@ -55,6 +155,14 @@ namespace Resource
 
     }
 
+    bool isS3TCSupported()
+    {
+        osg::GLExtensions* exts = osg::GLExtensions::Get(0, false);
+        return !exts || exts->isTextureCompressionS3TCSupported
+                // This one works too. Should it be included in isTextureCompressionS3TCSupported()? Submitted as a patch to OSG.
+                || osg::isGLExtensionSupported(0, "GL_S3_s3tc");
+    }
+
     bool checkSupported(osg::Image* image, const std::string& filename)
     {
         switch(image->getPixelFormat())
@@ -64,13 +172,8 @@ namespace Resource
             case(GL_COMPRESSED_RGBA_S3TC_DXT3_EXT):
             case(GL_COMPRESSED_RGBA_S3TC_DXT5_EXT):
             {
-                osg::GLExtensions* exts = osg::GLExtensions::Get(0, false);
-                if (exts && !exts->isTextureCompressionS3TCSupported
-                        // This one works too. Should it be included in isTextureCompressionS3TCSupported()? Submitted as a patch to OSG.
-                        && !osg::isGLExtensionSupported(0, "GL_S3_s3tc"))
-                {
+                if (!isS3TCSupported())
                     return false;
-                }
                 break;
             }
             // not bothering with checks for other compression formats right now, we are unlikely to ever use those anyway
@@ -80,78 +183,163 @@ namespace Resource
         return true;
     }
 
-    osg::ref_ptr<osg::Image> ImageManager::getImage(const std::string &filename)
+    osg::ref_ptr<osg::Image> ImageManager::getImage(const std::string &filename, ImageUsage usage)
     {
         std::string normalized = filename;
         mVFS->normalizeFilename(normalized);
+        const std::string cacheKey = getCacheKey(normalized, usage);
 
-        osg::ref_ptr<osg::Object> obj = mCache->getRefFromObjectCache(normalized);
+        osg::ref_ptr<osg::Object> obj = mCache->getRefFromObjectCache(cacheKey);
         if (obj)
             return osg::ref_ptr<osg::Image>(static_cast<osg::Image*>(obj.get()));
-        else
+
+        osg::ref_ptr<ImageLoader> loader;
         {
-            Files::IStreamPtr stream;
-            try
-            {
-                stream = mVFS->get(normalized.c_str());
-            }
-            catch (std::exception& e)
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mLoadingMutex);
+            // the image may have been loaded since we last checked
+            obj = mCache->getRefFromObjectCache(cacheKey);
+            if (obj)
+                return osg::ref_ptr<osg::Image>(static_cast<osg::Image*>(obj.get()));
+
+            osg::ref_ptr<ImageLoader>& found = mLoading[cacheKey];
+            if (!found)
+                found = new ImageLoader(this, normalized, usage);
+            loader = found;
+        }
+        return loader->getImage();
+    }
+
+    osg::ref_ptr<osg::Image> ImageManager::readImage(const std::string &filename, ImageUsage usage)
+    {
+        std::string normalized = filename;
+        mVFS->normalizeFilename(normalized);
+
+        osg::ref_ptr<osg::Object> obj = mCache->getRefFromObjectCache(getCacheKey(normalized, usage));
+        if (obj)
+            return osg::ref_ptr<osg::Image>(static_cast<osg::Image*>(obj.get()));
+        return loadImage(normalized, usage);
+    }
+
+    void ImageManager::preloadImage(const std::string &filename)
+    {
+        if (!mWorkQueue)
+            return;
+
+        std::string normalized = filename;
+        mVFS->normalizeFilename(normalized);
+
+        osg::ref_ptr<ImageLoader> loader;
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mLoadingMutex);
+            if (mLoading.find(normalized) != mLoading.end() || mCache->getRefFromObjectCache(normalized))
+                return;
+
+            loader = new ImageLoader(this, normalized, Usage_Color);
+            mLoading[normalized] = loader;
+        }
+        // whoever preloads an image is going to need it soon
+        mWorkQueue->addWorkItem(loader, true);
+    }
+
+    void ImageManager::finishLoading(const std::string &cacheKey, osg::Image *image)
+    {
+        mCache->addEntryToObjectCache(cacheKey, image);
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mLoadingMutex);
+        mLoading.erase(cacheKey);
+    }
+
+    osg::ref_ptr<osg::Image> ImageManager::loadImage(const std::string &normalized, ImageUsage usage)
+    {
+        Files::IStreamPtr stream;
+        try
+        {
+            stream = mVFS->get(normalized.c_str());
+        }
+        catch (std::exception& e)
+        {
+            std::cerr << "Failed to open image: " << e.what() << std::endl;
+            return mWarningImage;
+        }
+
+        size_t extPos = normalized.find_last_of('.');
+        std::string ext;
+        if (extPos != std::string::npos && extPos+1 < normalized.size())
+            ext = normalized.substr(extPos+1);
+        osgDB::ReaderWriter* reader = osgDB::Registry::instance()->getReaderWriterForExtension(ext);
+        if (!reader)
+        {
+            std::cerr << "Error loading " << normalized << ": no readerwriter for '" << ext << "' found" << std::endl;
+            return mWarningImage;
+        }
+
+        // compression is lossy in ways that only suit colours
+        const bool compress = mCompress && usage == Usage_Color && isS3TCSupported();
+        std::string diskCacheKey;
+        if (mDiskCache && (mCpuMipmaps || compress))
+        {
+            diskCacheKey = getDiskCacheKey(normalized, *stream, mCpuMipmaps, compress, usage);
+            osg::ref_ptr<osg::Image> cached = mDiskCache->readImage(diskCacheKey);
+            if (cached)
             {
-                std::cerr << "Failed to open image: " << e.what() << std::endl;
-                mCache->addEntryToObjectCache(normalized, mWarningImage);
-                return mWarningImage;
+                cached->setFileName(normalized);
+                if (usage != Usage_Color)
+                    setImageUsage(*cached, usage);
+                return cached;
             }
+        }
 
-            size_t extPos = normalized.find_last_of('.');
-            std::string ext;
-            if (extPos != std::string::npos && extPos+1 < normalized.size())
-                ext = normalized.substr(extPos+1);
-            osgDB::ReaderWriter* reader = osgDB::Registry::instance()->getReaderWriterForExtension(ext);
-            if (!reader)
+        osgDB::ReaderWriter::ReadResult result = reader->readImage(*stream, mOptions);
+        if (!result.success())
+        {
+            std::cerr << "Error loading " << normalized << ": " << result.message() << " code " << result.status() << std::endl;
+            return mWarningImage;
+        }
+
+        osg::ref_ptr<osg::Image> image = result.getImage();
+
+        image->setFileName(normalized);
+        if (!checkSupported(image, normalized))
+        {
+            static bool uncompress = (getenv("OPENMW_DECOMPRESS_TEXTURES") != 0);
+            if (!uncompress)
             {
-                std::cerr << "Error loading " << filename << ": no readerwriter for '" << ext << "' found" << std::endl;
-                mCache->addEntryToObjectCache(normalized, mWarningImage);
+                std::cerr << "Error loading " << normalized << ": no S3TC texture compression support installed" << std::endl;
                 return mWarningImage;
             }
-
-            osgDB::ReaderWriter::ReadResult result = reader->readImage(*stream, mOptions);
-            if (!result.success())
+            else
             {
-                std::cerr << "Error loading " << filename << ": " << result.message() << " code " << result.status() << std::endl;
-                mCache->addEntryToObjectCache(normalized, mWarningImage);
-                return mWarningImage;
+                // decompress texture in software if not supported by GPU
+                // requires update to getColor() to be released with OSG 3.6
+                osg::ref_ptr<osg::Image> newImage = new osg::Image;
+                newImage->setFileName(image->getFileName());
+                newImage->allocateImage(image->s(), image->t(), image->r(), image->isImageTranslucent() ? GL_RGBA : GL_RGB, GL_UNSIGNED_BYTE);
+                for (int s=0; s<image->s(); ++s)
+                    for (int t=0; t<image->t(); ++t)
+                        for (int r=0; r<image->r(); ++r)
+                            newImage->setColor(image->getColor(s,t,r), s,t,r);
+                image = newImage;
             }
+        }
 
-            osg::ref_ptr<osg::Image> image = result.getImage();
+        osg::ref_ptr<osg::Image> processed = processImage(image, compress, usage);
+        if (processed != image && !diskCacheKey.empty())
+            mDiskCache->writeImage(diskCacheKey, *processed);
+        if (usage != Usage_Color)
+            setImageUsage(*processed, usage);
+        return processed;
+    }
 
-            image->setFileName(normalized);
-            if (!checkSupported(image, filename))
-            {
-                static bool uncompress = (getenv("OPENMW_DECOMPRESS_TEXTURES") != 0);
-                if (!uncompress)
-                {
-                    std::cerr << "Error loading " << filename << ": no S3TC texture compression support installed" << std::endl;
-                    mCache->addEntryToObjectCache(normalized, mWarningImage);
-                    return mWarningImage;
-                }
-                else
-                {
-                    // decompress texture in software if not supported by GPU
-                    // requires update to getColor() to be released with OSG 3.6
-                    osg::ref_ptr<osg::Image> newImage = new osg::Image;
-                    newImage->setFileName(image->getFileName());
-                    newImage->allocateImage(image->s(), image->t(), image->r(), image->isImageTranslucent() ? GL_RGBA : GL_RGB, GL_UNSIGNED_BYTE);
-                    for (int s=0; s<image->s(); ++s)
-                        for (int t=0; t<image->t(); ++t)
-                            for (int r=0; r<image->r(); ++r)
-                                newImage->setColor(image->getColor(s,t,r), s,t,r);
-                    image = newImage;
-                }
-            }
+    osg::ref_ptr<osg::Image> ImageManager::processImage(osg::ref_ptr<osg::Image> image, bool compress, ImageUsage usage) const
+    {
+        // compressed images need their mipmaps up front
+        if ((mCpuMipmaps || (compress && canCompress(*image))) && canGenerateMipmaps(*image))
+            image = generateMipmaps(*image, usage);
 
-            mCache->addEntryToObjectCache(normalized, image);
-            return image;
-        }
+        if (compress && canCompress(*image))
+            image = compressImage(*image);
+
+        return image;
     }
 
     osg::Image *ImageManager::getWarningImage()
@@ -159,9 +347,44 @@ namespace Resource
         return mWarningImage;
     }
 
+    void ImageManager::setWorkQueue(SceneUtil::WorkQueue *workQueue)
+    {
+        mWorkQueue = workQueue;
+    }
+
+    SceneUtil::WorkQueue* ImageManager::getWorkQueue()
+    {
+        return mWorkQueue;
+    }
+
+    void ImageManager::setProcessing(bool cpuMipmaps, bool compress)
+    {
+        mCpuMipmaps = cpuMipmaps;
+        mCompress = compress;
+    }
+
+    void ImageManager::setDiskCachePath(const std::string &path)
+    {
+        mDiskCache.reset(new SceneDiskCache(path));
+        if (!mDiskCache->isValid())
+            mDiskCache.reset();
+    }
+
+    void ImageManager::setTextureStreaming(unsigned int minSize, size_t budget)
+    {
+        mTextureStreamer.reset(new TextureStreamer(this, minSize, budget));
+    }
+
+    TextureStreamer* ImageManager::getTextureStreamer()
+    {
+        return mTextureStreamer.get();
+    }
+
     void ImageManager::reportStats(unsigned int frameNumber, osg::Stats *stats) const
     {
         stats->setAttribute(frameNumber, "Image", mCache->getCacheSize());
+        if (mTextureStreamer)
+            mTextureStreamer->reportStats(frameNumber, stats);
     }
 
 }
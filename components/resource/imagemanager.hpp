@@ -3,21 +3,37 @@
 
 #include <string>
 #include <map>
+#include <memory>
+
+#include <OpenThreads/Mutex>
 
 #include <osg/ref_ptr>
 #include <osg/Image>
 #include <osg/Texture2D>
 
 #include "resourcemanager.hpp"
+#include "imageprocessing.hpp"
 
 namespace osgDB
 {
     class Options;
 }
 
+namespace SceneUtil
+{
+    class WorkQueue;
+}
+
 namespace Resource
 {
 
+    class SceneDiskCache;
+    class ImageLoader;
+    class TextureStreamer;
+
+    /// Check if S3TC (DXT) compressed textures are supported, which is assumed as long as no graphics context was created.
+    bool isS3TCSupported();
+
     /// @brief Handles loading/caching of Images.
     /// @note May be used from any thread.
     class ImageManager : public ResourceManager
@@ -28,16 +44,69 @@ namespace Resource
 
         /// Create or retrieve an Image
         /// Returns the dummy image if the given image is not found.
-        osg::ref_ptr<osg::Image> getImage(const std::string& filename);
+        /// @param usage Decides the processing, images of a different usage are loaded and cached separately.
+        osg::ref_ptr<osg::Image> getImage(const std::string& filename, ImageUsage usage = Usage_Color);
+
+        /// Like getImage(), but an image that is not cached yet is not added to the cache, for users only keeping part of it.
+        osg::ref_ptr<osg::Image> readImage(const std::string& filename, ImageUsage usage = Usage_Color);
+
+        /// Start loading an image in the background, so that it is ready, or at least on its way, when getImage() is called.
+        /// @note Does nothing if no work queue is set.
+        void preloadImage(const std::string& filename);
 
         osg::Image* getWarningImage();
 
+        /// Set the work queue that preloadImage() and the TextureStreamer use.
+        void setWorkQueue(SceneUtil::WorkQueue* workQueue);
+
+        SceneUtil::WorkQueue* getWorkQueue();
+
+        /// Set the processing applied to images after decoding them. Must be called before any images are loaded.
+        /// @param cpuMipmaps Generate the mipmaps of uncompressed images on the CPU, rather than leave it to the driver.
+        /// @param compress Compress uncompressed RGB(A) colour images to DXT1/DXT5, if the graphics card supports it.
+        /// Generates their mipmaps on the CPU as well, since they can not be generated by the driver afterwards.
+        void setProcessing(bool cpuMipmaps, bool compress);
+
+        /// Store processed images in the given directory, so that they do not need to be processed again.
+        /// Must be called before any images are loaded.
+        void setDiskCachePath(const std::string& path);
+
+        /// Stream the mipmaps of textures set up by the SceneManager, see TextureStreamer.
+        /// @param minSize Size of the mipmaps that are always resident.
+        /// @param budget Memory in bytes the resident mipmaps should stay within.
+        void setTextureStreaming(unsigned int minSize, size_t budget);
+
+        /// @return NULL if texture streaming is not enabled.
+        TextureStreamer* getTextureStreamer();
+
         void reportStats(unsigned int frameNumber, osg::Stats* stats) const;
 
     private:
+        friend class ImageLoader;
+
+        /// Decode and process an image, without looking at or adding to the cache.
+        /// @return The warning image if the image could not be loaded.
+        osg::ref_ptr<osg::Image> loadImage(const std::string& normalized, ImageUsage usage);
+
+        /// Apply the processing set with setProcessing().
+        osg::ref_ptr<osg::Image> processImage(osg::ref_ptr<osg::Image> image, bool compress, ImageUsage usage) const;
+
+        /// Called by an ImageLoader once its image is loaded.
+        void finishLoading(const std::string& cacheKey, osg::Image* image);
+
         osg::ref_ptr<osg::Image> mWarningImage;
         osg::ref_ptr<osgDB::Options> mOptions;
 
+        osg::ref_ptr<SceneUtil::WorkQueue> mWorkQueue;
+        std::unique_ptr<SceneDiskCache> mDiskCache;
+        std::unique_ptr<TextureStreamer> mTextureStreamer;
+        bool mCpuMipmaps;
+        bool mCompress;
+
+        /// Images being loaded by their cache key, so that threads asking for the same image don't load it twice.
+        std::map<std::string, osg::ref_ptr<ImageLoader> > mLoading;
+        OpenThreads::Mutex mLoadingMutex;
+
         ImageManager(const ImageManager&);
         void operator = (const ImageManager&);
     };
@@ -0,0 +1,503 @@
+#include "imageprocessing.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include <osg/Texture>
+#include <osg/ValueObject>
+
+namespace
+{
+
+    /// Get the layout of an image made of 8 bit channels.
+    /// @param alphaChannel Set to the index of the alpha channel, -1 if there is none.
+    bool getChannels(const osg::Image& image, int& numChannels, int& alphaChannel)
+    {
+        if (image.getDataType() != GL_UNSIGNED_BYTE || image.r() != 1 || image.s() < 1 || image.t() < 1)
+            return false;
+
+        switch (image.getPixelFormat())
+        {
+        case GL_LUMINANCE:
+            numChannels = 1;
+            alphaChannel = -1;
+            return true;
+        case GL_ALPHA:
+            numChannels = 1;
+            alphaChannel = 0;
+            return true;
+        case GL_LUMINANCE_ALPHA:
+            numChannels = 2;
+            alphaChannel = 1;
+            return true;
+        case GL_RGB:
+        case GL_BGR:
+            numChannels = 3;
+            alphaChannel = -1;
+            return true;
+        case GL_RGBA:
+        case GL_BGRA:
+            numChannels = 4;
+            alphaChannel = 3;
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    /// Conversion of colours between sRGB, which the textures are authored in, and linear space.
+    class ColorSpaceTables
+    {
+    public:
+        ColorSpaceTables()
+        {
+            for (int i=0; i<256; ++i)
+            {
+                float c = i / 255.f;
+                mToLinear[i] = (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+            for (int i=0; i<sLinearSteps; ++i)
+            {
+                float c = i / static_cast<float>(sLinearSteps-1);
+                float srgb = (c <= 0.0031308f) ? c * 12.92f : 1.055f * std::pow(c, 1.f/2.4f) - 0.055f;
+                mToSrgb[i] = static_cast<unsigned char>(std::min(255.f, srgb * 255.f + 0.5f));
+            }
+        }
+
+        float toLinear(unsigned char c) const
+        {
+            return mToLinear[c];
+        }
+
+        unsigned char toSrgb(float c) const
+        {
+            c = std::max(0.f, std::min(1.f, c));
+            return mToSrgb[static_cast<int>(c * (sLinearSteps-1) + 0.5f)];
+        }
+
+    private:
+        // dark colours need a fine resolution in linear space
+        static const int sLinearSteps = 1<<14;
+
+        float mToLinear[256];
+        unsigned char mToSrgb[sLinearSteps];
+    };
+
+    const ColorSpaceTables& getColorSpaceTables()
+    {
+        static const ColorSpaceTables tables;
+        return tables;
+    }
+
+    unsigned short toRgb565(const unsigned char* color)
+    {
+        return static_cast<unsigned short>(((color[0] * 31 + 127) / 255) << 11 | ((color[1] * 63 + 127) / 255) << 5 | ((color[2] * 31 + 127) / 255));
+    }
+
+    void fromRgb565(unsigned short packed, int* color)
+    {
+        int r = (packed >> 11) & 31;
+        int g = (packed >> 5) & 63;
+        int b = packed & 31;
+        color[0] = (r << 3) | (r >> 2);
+        color[1] = (g << 2) | (g >> 4);
+        color[2] = (b << 3) | (b >> 2);
+    }
+
+    /// Encode the colours of a 4x4 block of RGBA pixels, as used by DXT1 and DXT5.
+    /// @par The end points are the two pixels furthest apart along the main axis of the colours.
+    void encodeColorBlock(const unsigned char (&pixels)[16][4], unsigned char* out)
+    {
+        float mean[3] = { 0.f, 0.f, 0.f };
+        for (int i=0; i<16; ++i)
+            for (int c=0; c<3; ++c)
+                mean[c] += pixels[i][c] / 16.f;
+
+        // covariance matrix, xx xy xz yy yz zz
+        float covariance[6] = { 0.f, 0.f, 0.f, 0.f, 0.f, 0.f };
+        for (int i=0; i<16; ++i)
+        {
+            float dx = pixels[i][0] - mean[0];
+            float dy = pixels[i][1] - mean[1];
+            float dz = pixels[i][2] - mean[2];
+            covariance[0] += dx*dx;
+            covariance[1] += dx*dy;
+            covariance[2] += dx*dz;
+            covariance[3] += dy*dy;
+            covariance[4] += dy*dz;
+            covariance[5] += dz*dz;
+        }
+
+        // power iteration for the main axis
+        float axis[3] = { 1.f, 1.f, 1.f };
+        for (int iteration=0; iteration<8; ++iteration)
+        {
+            float x = covariance[0]*axis[0] + covariance[1]*axis[1] + covariance[2]*axis[2];
+            float y = covariance[1]*axis[0] + covariance[3]*axis[1] + covariance[4]*axis[2];
+            float z = covariance[2]*axis[0] + covariance[4]*axis[1] + covariance[5]*axis[2];
+            float length = std::max(std::abs(x), std::max(std::abs(y), std::abs(z)));
+            if (length < 1e-6f)
+                break;
+            axis[0] = x / length;
+            axis[1] = y / length;
+            axis[2] = z / length;
+        }
+
+        int minIndex = 0, maxIndex = 0;
+        float minDot = FLT_MAX, maxDot = -FLT_MAX;
+        for (int i=0; i<16; ++i)
+        {
+            float dot = pixels[i][0]*axis[0] + pixels[i][1]*axis[1] + pixels[i][2]*axis[2];
+            if (dot < minDot)
+            {
+                minDot = dot;
+                minIndex = i;
+            }
+            if (dot > maxDot)
+            {
+                maxDot = dot;
+                maxIndex = i;
+            }
+        }
+
+        unsigned short color0 = toRgb565(pixels[maxIndex]);
+        unsigned short color1 = toRgb565(pixels[minIndex]);
+        // color0 > color1 selects the four colour mode of DXT1
+        if (color0 < color1)
+            std::swap(color0, color1);
+
+        unsigned int indices = 0;
+        if (color0 != color1)
+        {
+            int palette[4][3];
+            fromRgb565(color0, palette[0]);
+            fromRgb565(color1, palette[1]);
+            for (int c=0; c<3; ++c)
+            {
+                palette[2][c] = (2*palette[0][c] + palette[1][c] + 1) / 3;
+                palette[3][c] = (palette[0][c] + 2*palette[1][c] + 1) / 3;
+            }
+
+            for (int i=0; i<16; ++i)
+            {
+                int best = 0;
+                int bestDistance = INT_MAX;
+                for (int j=0; j<4; ++j)
+                {
+                    int distance = 0;
+                    for (int c=0; c<3; ++c)
+                        distance += (pixels[i][c] - palette[j][c]) * (pixels[i][c] - palette[j][c]);
+                    if (distance < bestDistance)
+                    {
+                        bestDistance = distance;
+                        best = j;
+                    }
+                }
+                indices |= static_cast<unsigned int>(best) << (2*i);
+            }
+        }
+
+        out[0] = color0 & 0xff;
+        out[1] = color0 >> 8;
+        out[2] = color1 & 0xff;
+        out[3] = color1 >> 8;
+        for (int i=0; i<4; ++i)
+            out[4+i] = (indices >> (8*i)) & 0xff;
+    }
+
+    /// Encode the alpha of a 4x4 block of RGBA pixels, as used by DXT5.
+    void encodeAlphaBlock(const unsigned char (&pixels)[16][4], unsigned char* out)
+    {
+        int alpha0 = 0, alpha1 = 255;
+        for (int i=0; i<16; ++i)
+        {
+            alpha0 = std::max(alpha0, static_cast<int>(pixels[i][3]));
+            alpha1 = std::min(alpha1, static_cast<int>(pixels[i][3]));
+        }
+
+        unsigned long long indices = 0;
+        if (alpha0 != alpha1)
+        {
+            // alpha0 > alpha1 selects the eight value mode
+            int palette[8];
+            palette[0] = alpha0;
+            palette[1] = alpha1;
+            for (int j=2; j<8; ++j)
+                palette[j] = ((8-j)*alpha0 + (j-1)*alpha1 + 3) / 7;
+
+            for (int i=0; i<16; ++i)
+            {
+                int best = 0;
+                int bestDistance = INT_MAX;
+                for (int j=0; j<8; ++j)
+                {
+                    int distance = std::abs(pixels[i][3] - palette[j]);
+                    if (distance < bestDistance)
+                    {
+                        bestDistance = distance;
+                        best = j;
+                    }
+                }
+                indices |= static_cast<unsigned long long>(best) << (3*i);
+            }
+        }
+
+        out[0] = static_cast<unsigned char>(alpha0);
+        out[1] = static_cast<unsigned char>(alpha1);
+        for (int i=0; i<6; ++i)
+            out[2+i] = (indices >> (8*i)) & 0xff;
+    }
+
+}
+
+namespace Resource
+{
+
+    void setImageUsage(osg::Image& image, ImageUsage usage)
+    {
+        image.setUserValue("usage", static_cast<int>(usage));
+    }
+
+    ImageUsage getImageUsage(const osg::Image& image)
+    {
+        int usage = Usage_Color;
+        image.getUserValue("usage", usage);
+        return static_cast<ImageUsage>(usage);
+    }
+
+    bool canGenerateMipmaps(const osg::Image& image)
+    {
+        int numChannels, alphaChannel;
+        return !image.isMipmap() && getChannels(image, numChannels, alphaChannel);
+    }
+
+    osg::ref_ptr<osg::Image> generateMipmaps(const osg::Image& image, ImageUsage usage)
+    {
+        int numChannels, alphaChannel;
+        if (!getChannels(image, numChannels, alphaChannel))
+            return NULL;
+
+        const ColorSpaceTables& tables = getColorSpaceTables();
+
+        int width = image.s();
+        int height = image.t();
+
+        osg::Image::MipmapDataType offsets;
+        size_t totalSize = static_cast<size_t>(width) * height * numChannels;
+        for (int w = width, h = height; w > 1 || h > 1; )
+        {
+            w = std::max(1, w/2);
+            h = std::max(1, h/2);
+            offsets.push_back(static_cast<unsigned int>(totalSize));
+            totalSize += static_cast<size_t>(w) * h * numChannels;
+        }
+
+        unsigned char* data = new unsigned char[totalSize];
+        for (int y=0; y<height; ++y)
+            std::memcpy(data + static_cast<size_t>(y) * width * numChannels, image.data(0, y), width * numChannels);
+
+        // colour channels are converted to linear space, the alpha and data are used as they are
+        const bool isColor = (usage == Usage_Color);
+        std::vector<bool> isSrgb (numChannels);
+        for (int c=0; c<numChannels; ++c)
+            isSrgb[c] = isColor && c != alphaChannel;
+
+        std::vector<float> current (static_cast<size_t>(width) * height * numChannels);
+        for (size_t i=0; i<current.size(); ++i)
+            current[i] = isSrgb[i % numChannels] ? tables.toLinear(data[i]) : data[i] / 255.f;
+
+        std::vector<float> next;
+        for (size_t level=0; level<offsets.size(); ++level)
+        {
+            int nextWidth = std::max(1, width/2);
+            int nextHeight = std::max(1, height/2);
+            next.resize(static_cast<size_t>(nextWidth) * nextHeight * numChannels);
+            unsigned char* out = data + offsets[level];
+
+            for (int y=0; y<nextHeight; ++y)
+            {
+                int y0 = std::min(2*y, height-1);
+                int y1 = std::min(2*y+1, height-1);
+                for (int x=0; x<nextWidth; ++x)
+                {
+                    int x0 = std::min(2*x, width-1);
+                    int x1 = std::min(2*x+1, width-1);
+                    const float* samples[4] = {
+                        &current[(static_cast<size_t>(y0) * width + x0) * numChannels],
+                        &current[(static_cast<size_t>(y0) * width + x1) * numChannels],
+                        &current[(static_cast<size_t>(y1) * width + x0) * numChannels],
+                        &current[(static_cast<size_t>(y1) * width + x1) * numChannels]
+                    };
+
+                    // weigh colours by their alpha, unless all samples are fully transparent
+                    float weights[4] = { 1.f, 1.f, 1.f, 1.f };
+                    float totalWeight = 4.f;
+                    if (isColor && alphaChannel >= 0)
+                    {
+                        float alphaSum = 0.f;
+                        for (int i=0; i<4; ++i)
+                            alphaSum += samples[i][alphaChannel];
+                        if (alphaSum > 0.f)
+                        {
+                            for (int i=0; i<4; ++i)
+                                weights[i] = samples[i][alphaChannel];
+                            totalWeight = alphaSum;
+                        }
+                    }
+
+                    size_t index = (static_cast<size_t>(y) * nextWidth + x) * numChannels;
+                    for (int c=0; c<numChannels; ++c)
+                    {
+                        if (!isSrgb[c])
+                        {
+                            float value = (samples[0][c] + samples[1][c] + samples[2][c] + samples[3][c]) / 4.f;
+                            next[index + c] = value;
+                            out[index + c] = static_cast<unsigned char>(std::min(255.f, value * 255.f + 0.5f));
+                        }
+                        else
+                        {
+                            float color = (samples[0][c]*weights[0] + samples[1][c]*weights[1]
+                                    + samples[2][c]*weights[2] + samples[3][c]*weights[3]) / totalWeight;
+                            next[index + c] = color;
+                            out[index + c] = tables.toSrgb(color);
+                        }
+                    }
+                }
+            }
+
+            current.swap(next);
+            width = nextWidth;
+            height = nextHeight;
+        }
+
+        osg::ref_ptr<osg::Image> result (new osg::Image);
+        result->setFileName(image.getFileName());
+        result->setImage(image.s(), image.t(), 1, image.getInternalTextureFormat(), image.getPixelFormat(), GL_UNSIGNED_BYTE,
+                         data, osg::Image::USE_NEW_DELETE, 1);
+        result->setMipmapLevels(offsets);
+        result->setOrigin(image.getOrigin());
+        return result;
+    }
+
+    bool canCompress(const osg::Image& image)
+    {
+        int numChannels, alphaChannel;
+        return getChannels(image, numChannels, alphaChannel) && numChannels >= 3 && image.s() % 4 == 0 && image.t() % 4 == 0;
+    }
+
+    osg::ref_ptr<osg::Image> compressImage(const osg::Image& image)
+    {
+        int numChannels, alphaChannel;
+        if (!getChannels(image, numChannels, alphaChannel) || numChannels < 3)
+            return NULL;
+
+        const GLenum pixelFormat = image.getPixelFormat();
+        const bool bgr = (pixelFormat == GL_BGR || pixelFormat == GL_BGRA);
+
+        bool opaque = true;
+        if (alphaChannel >= 0)
+        {
+            for (int y=0; y<image.t() && opaque; ++y)
+            {
+                const unsigned char* row = image.data(0, y);
+                for (int x=0; x<image.s(); ++x)
+                {
+                    if (row[x * numChannels + alphaChannel] != 255)
+                    {
+                        opaque = false;
+                        break;
+                    }
+                }
+            }
+        }
+
+        const GLenum format = opaque ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        const size_t blockSize = opaque ? 8 : 16;
+
+        const unsigned int numLevels = image.getNumMipmapLevels();
+        osg::Image::MipmapDataType offsets;
+        size_t totalSize = 0;
+        for (unsigned int level=0; level<numLevels; ++level)
+        {
+            if (level > 0)
+                offsets.push_back(static_cast<unsigned int>(totalSize));
+            size_t width = std::max(1, image.s() >> level);
+            size_t height = std::max(1, image.t() >> level);
+            totalSize += ((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+        }
+
+        unsigned char* data = new unsigned char[totalSize];
+        unsigned char* out = data;
+        for (unsigned int level=0; level<numLevels; ++level)
+        {
+            int width = std::max(1, image.s() >> level);
+            int height = std::max(1, image.t() >> level);
+            const unsigned char* levelData = image.getMipmapData(level);
+            const unsigned int rowStep = osg::Image::computeRowWidthInBytes(width, pixelFormat, GL_UNSIGNED_BYTE, image.getPacking());
+
+            for (int blockY=0; blockY<height; blockY+=4)
+            {
+                for (int blockX=0; blockX<width; blockX+=4)
+                {
+                    // blocks reaching past the edge of small mipmaps repeat the last pixels
+                    unsigned char pixels[16][4];
+                    for (int i=0; i<16; ++i)
+                    {
+                        int x = std::min(blockX + i%4, width-1);
+                        int y = std::min(blockY + i/4, height-1);
+                        const unsigned char* pixel = levelData + y * rowStep + x * numChannels;
+                        pixels[i][0] = pixel[bgr ? 2 : 0];
+                        pixels[i][1] = pixel[1];
+                        pixels[i][2] = pixel[bgr ? 0 : 2];
+                        pixels[i][3] = (alphaChannel >= 0) ? pixel[alphaChannel] : 255;
+                    }
+
+                    if (!opaque)
+                    {
+                        encodeAlphaBlock(pixels, out);
+                        out += 8;
+                    }
+                    encodeColorBlock(pixels, out);
+                    out += 8;
+                }
+            }
+        }
+
+        osg::ref_ptr<osg::Image> result (new osg::Image);
+        result->setFileName(image.getFileName());
+        result->setImage(image.s(), image.t(), 1, format, format, GL_UNSIGNED_BYTE, data, osg::Image::USE_NEW_DELETE, 1);
+        result->setMipmapLevels(offsets);
+        result->setOrigin(image.getOrigin());
+        return result;
+    }
+
+    osg::ref_ptr<osg::Image> getMipmapLevels(const osg::Image& image, unsigned int firstLevel)
+    {
+        const unsigned int numLevels = image.getNumMipmapLevels();
+        if (firstLevel >= numLevels || !image.data())
+            return NULL;
+
+        const unsigned int firstOffset = image.getMipmapOffset(firstLevel);
+        const size_t size = image.getTotalSizeInBytesIncludingMipmaps() - firstOffset;
+
+        unsigned char* data = new unsigned char[size];
+        std::memcpy(data, image.getMipmapData(firstLevel), size);
+
+        osg::Image::MipmapDataType offsets;
+        for (unsigned int level=firstLevel+1; level<numLevels; ++level)
+            offsets.push_back(image.getMipmapOffset(level) - firstOffset);
+
+        osg::ref_ptr<osg::Image> result (new osg::Image);
+        result->setFileName(image.getFileName());
+        result->setImage(std::max(1, image.s() >> firstLevel), std::max(1, image.t() >> firstLevel), 1, image.getInternalTextureFormat(),
+                         image.getPixelFormat(), image.getDataType(), data, osg::Image::USE_NEW_DELETE, image.getPacking());
+        result->setMipmapLevels(offsets);
+        result->setOrigin(image.getOrigin());
+        return result;
+    }
+
+}
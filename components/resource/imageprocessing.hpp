@@ -0,0 +1,47 @@
+#ifndef OPENMW_COMPONENTS_RESOURCE_IMAGEPROCESSING_H
+#define OPENMW_COMPONENTS_RESOURCE_IMAGEPROCESSING_H
+
+#include <osg/ref_ptr>
+#include <osg/Image>
+
+namespace Resource
+{
+
+    /// How the contents of an image are used, which decides how they can be processed.
+    enum ImageUsage
+    {
+        /// Colours in sRGB space, with the alpha as coverage, e.g. diffuse maps.
+        Usage_Color,
+        /// Values that are not colours, e.g. normal, height or specular maps. Are neither converted nor compressed.
+        Usage_Data
+    };
+
+    /// Note how \a image is used, so that processing it later, e.g. for texture streaming, treats it the same way.
+    void setImageUsage(osg::Image& image, ImageUsage usage);
+
+    /// @return Usage_Color unless set otherwise with setImageUsage().
+    ImageUsage getImageUsage(const osg::Image& image);
+
+    /// Check if generateMipmaps() can handle \a image: a 2D image of 8 bit channels that has no mipmaps yet.
+    bool canGenerateMipmaps(const osg::Image& image);
+
+    /// Generate the mipmaps of \a image on the CPU.
+    /// @par Colours are averaged in linear space and weighted by their alpha, so that unlike with the driver's mipmap
+    /// generation, textures do not get darker when minified and transparent pixels do not bleed into the visible ones.
+    /// Data is averaged as it is, like the driver does.
+    /// @return A copy of \a image with the mipmaps added.
+    osg::ref_ptr<osg::Image> generateMipmaps(const osg::Image& image, ImageUsage usage = Usage_Color);
+
+    /// Check if compressImage() can handle \a image: a 2D RGB(A) image of 8 bit channels, with a size divisible by 4.
+    bool canCompress(const osg::Image& image);
+
+    /// Compress \a image and its mipmaps, if any, to DXT1, or to DXT5 if it is not fully opaque.
+    osg::ref_ptr<osg::Image> compressImage(const osg::Image& image);
+
+    /// Copy the mipmaps of \a image from \a firstLevel on into a new image, with that level as its base.
+    /// @return NULL if \a image has no such level.
+    osg::ref_ptr<osg::Image> getMipmapLevels(const osg::Image& image, unsigned int firstLevel);
+
+}
+
+#endif
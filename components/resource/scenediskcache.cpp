@@ -0,0 +1,336 @@
+#include "scenediskcache.hpp"
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include <boost/crc.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include <osg/Node>
+#include <osg/Image>
+#include <osg/Drawable>
+#include <osg/StateSet>
+#include <osg/Texture>
+#include <osg/UserDataContainer>
+
+#include <osgDB/ObjectWrapper>
+#include <osgDB/InputStream>
+#include <osgDB/OutputStream>
+#include <osgDB/Registry>
+
+#include <components/nifosg/userdata.hpp>
+
+#include "imageprocessing.hpp"
+
+namespace
+{
+
+    osg::Object* createNodeUserData() { return new NifOsg::NodeUserData; }
+
+    bool checkNodeUserData(const NifOsg::NodeUserData&) { return true; }
+
+    bool readNodeUserData(osgDB::InputStream& is, NifOsg::NodeUserData& data)
+    {
+        is >> data.mIndex >> data.mScale;
+        for (int i=0; i<3; ++i)
+            for (int j=0; j<3; ++j)
+                is >> data.mRotationScale.mValues[i][j];
+        return true;
+    }
+
+    bool writeNodeUserData(osgDB::OutputStream& os, const NifOsg::NodeUserData& data)
+    {
+        os << data.mIndex << data.mScale;
+        for (int i=0; i<3; ++i)
+            for (int j=0; j<3; ++j)
+                os << data.mRotationScale.mValues[i][j];
+        os << std::endl;
+        return true;
+    }
+
+    /// Needed by keyframe controllers that may be attached to the scene later on.
+    class NodeUserDataSerializer : public osgDB::ObjectWrapper
+    {
+    public:
+        NodeUserDataSerializer()
+            : osgDB::ObjectWrapper(createNodeUserData, "NifOsg::NodeUserData", "osg::Object NifOsg::NodeUserData")
+        {
+            addSerializer(new osgDB::UserSerializer<NifOsg::NodeUserData>("Data", checkNodeUserData, readNodeUserData, writeNodeUserData));
+        }
+    };
+
+    /// SceneUtil::registerSerializers() replaces some wrappers with dummies for debug output, the cache can't be used after that.
+    bool hasRequiredSerializers()
+    {
+        osgDB::ObjectWrapperManager* mgr = osgDB::Registry::instance()->getObjectWrapperManager();
+        osgDB::ObjectWrapper* geometry = mgr->findWrapper("osg::Geometry");
+        osgDB::ObjectWrapper* userData = mgr->findWrapper("NifOsg::NodeUserData");
+        return geometry && geometry->getSerializer("VertexArray") && userData && userData->getSerializer("Data");
+    }
+
+    bool isStandardObject(const osg::Object& object)
+    {
+        return std::string(object.libraryName()) == "osg";
+    }
+
+    class CanStoreVisitor : public osg::NodeVisitor
+    {
+    public:
+        CanStoreVisitor()
+            : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN)
+            , mResult(true)
+        {
+        }
+
+        virtual void apply(osg::Node& node)
+        {
+            if (!mResult)
+                return;
+
+            if (!canStore(node))
+            {
+                mResult = false;
+                return;
+            }
+
+            traverse(node);
+        }
+
+        bool canStore(const osg::Node& node) const
+        {
+            const std::string className = node.className();
+            if (!isStandardObject(node) || (className != "Group" && className != "MatrixTransform" && className != "Geometry"))
+                return false;
+
+            if (node.getUpdateCallback() || node.getCullCallback() || node.getEventCallback() || node.getComputeBoundingSphereCallback())
+                return false;
+
+            if (const osg::Drawable* drawable = node.asDrawable())
+            {
+                if (drawable->getDrawCallback() || drawable->getComputeBoundingBoxCallback())
+                    return false;
+            }
+
+            if (const osg::UserDataContainer* udc = node.getUserDataContainer())
+            {
+                if (udc->getNumUserObjects() || udc->getNumDescriptions())
+                    return false;
+                const osg::Object* userData = udc->getUserData();
+                if (userData && !dynamic_cast<const NifOsg::NodeUserData*>(userData))
+                    return false;
+            }
+
+            return !node.getStateSet() || canStore(*node.getStateSet());
+        }
+
+        bool canStore(const osg::StateSet& stateset) const
+        {
+            if (stateset.getUpdateCallback() || stateset.getEventCallback())
+                return false;
+
+            const osg::StateSet::AttributeList& attributes = stateset.getAttributeList();
+            for (osg::StateSet::AttributeList::const_iterator it = attributes.begin(); it != attributes.end(); ++it)
+            {
+                // shaders are not stored as they are managed by the ShaderManager
+                if (it->first.first == osg::StateAttribute::PROGRAM || !canStore(*it->second.first))
+                    return false;
+            }
+
+            const osg::StateSet::TextureAttributeList& textureAttributes = stateset.getTextureAttributeList();
+            for (unsigned int unit=0; unit<textureAttributes.size(); ++unit)
+            {
+                for (osg::StateSet::AttributeList::const_iterator it = textureAttributes[unit].begin(); it != textureAttributes[unit].end(); ++it)
+                {
+                    if (!canStore(*it->second.first))
+                        return false;
+                }
+            }
+
+            const osg::StateSet::UniformList& uniforms = stateset.getUniformList();
+            for (osg::StateSet::UniformList::const_iterator it = uniforms.begin(); it != uniforms.end(); ++it)
+            {
+                if (it->second.first->getUpdateCallback() || it->second.first->getEventCallback())
+                    return false;
+            }
+            return true;
+        }
+
+        bool canStore(const osg::StateAttribute& attribute) const
+        {
+            if (!isStandardObject(attribute) || attribute.getUpdateCallback() || attribute.getEventCallback())
+                return false;
+
+            // images are referenced by file name, so they have to have one, and are read back as colour images
+            if (const osg::Texture* texture = attribute.asTexture())
+            {
+                for (unsigned int i=0; i<texture->getNumImages(); ++i)
+                {
+                    const osg::Image* image = texture->getImage(i);
+                    if (!image || image->getFileName().empty() || getImageUsage(*image) != Usage_Color)
+                        return false;
+                }
+            }
+            return true;
+        }
+
+        bool getResult() const
+        {
+            return mResult;
+        }
+
+    private:
+        bool mResult;
+    };
+
+}
+
+namespace Resource
+{
+
+SceneDiskCache::SceneDiskCache(const std::string &path)
+    : mPath(path)
+    , mReaderWriter(osgDB::Registry::instance()->getReaderWriterForExtension("osgb"))
+    , mTempFileCounter(0)
+{
+    if (!mReaderWriter)
+    {
+        std::cerr << "Can not use the disk cache at " << mPath << ": no readerwriter for 'osgb' found" << std::endl;
+        return;
+    }
+
+    try
+    {
+        boost::filesystem::create_directories(mPath);
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Can not use the disk cache at " << mPath << ": " << e.what() << std::endl;
+        mReaderWriter = NULL;
+        return;
+    }
+
+    osgDB::ObjectWrapperManager* mgr = osgDB::Registry::instance()->getObjectWrapperManager();
+    if (osgDB::ObjectWrapper* wrapper = mgr->findWrapper("NifOsg::NodeUserData"))
+        mgr->removeWrapper(wrapper);
+    mgr->addWrapper(new NodeUserDataSerializer);
+}
+
+bool SceneDiskCache::isValid() const
+{
+    return mReaderWriter != NULL;
+}
+
+osg::ref_ptr<osg::Node> SceneDiskCache::read(const std::string &key, const osgDB::Options* options) const
+{
+    if (!mReaderWriter || !hasRequiredSerializers())
+        return NULL;
+
+    std::string fileName = getFileName(key);
+    boost::filesystem::ifstream stream (fileName, std::ios::binary);
+    if (!stream.is_open())
+        return NULL;
+
+    osgDB::ReaderWriter::ReadResult result = mReaderWriter->readNode(stream, options);
+    if (!result.success())
+    {
+        std::cerr << "Failed to read '" << fileName << "' from the disk cache: " << result.message() << std::endl;
+        return NULL;
+    }
+    return result.getNode();
+}
+
+void SceneDiskCache::write(const std::string &key, const osg::Node &node)
+{
+    if (!mReaderWriter || !hasRequiredSerializers())
+        return;
+
+    osg::ref_ptr<osgDB::Options> options (new osgDB::Options("WriteImageHint=UseExternal"));
+    options->setPluginStringData("fileType", "Binary");
+    writeObject(key, node, options);
+}
+
+osg::ref_ptr<osg::Image> SceneDiskCache::readImage(const std::string &key) const
+{
+    if (!mReaderWriter)
+        return NULL;
+
+    std::string fileName = getFileName(key);
+    boost::filesystem::ifstream stream (fileName, std::ios::binary);
+    if (!stream.is_open())
+        return NULL;
+
+    osgDB::ReaderWriter::ReadResult result = mReaderWriter->readImage(stream);
+    if (!result.success())
+    {
+        std::cerr << "Failed to read '" << fileName << "' from the disk cache: " << result.message() << std::endl;
+        return NULL;
+    }
+    return result.getImage();
+}
+
+void SceneDiskCache::writeImage(const std::string &key, const osg::Image &image)
+{
+    if (!mReaderWriter)
+        return;
+
+    osg::ref_ptr<osgDB::Options> options (new osgDB::Options("WriteImageHint=IncludeData"));
+    options->setPluginStringData("fileType", "Binary");
+    writeObject(key, image, options);
+}
+
+void SceneDiskCache::writeObject(const std::string &key, const osg::Object &object, const osgDB::Options *options)
+{
+    // write to a temporary file first, so that other threads never read a partially written file
+    std::string fileName = getFileName(key);
+    std::ostringstream tempFileName;
+    tempFileName << fileName << "." << ++mTempFileCounter << ".tmp";
+
+    try
+    {
+        {
+            boost::filesystem::ofstream stream (tempFileName.str(), std::ios::binary);
+            if (!stream.is_open())
+                throw std::runtime_error("can not open " + tempFileName.str());
+
+            osgDB::ReaderWriter::WriteResult result;
+            if (const osg::Image* image = dynamic_cast<const osg::Image*>(&object))
+                result = mReaderWriter->writeImage(*image, stream, options);
+            else
+                result = mReaderWriter->writeNode(static_cast<const osg::Node&>(object), stream, options);
+            if (!result.success())
+                throw std::runtime_error(result.message());
+        }
+
+        boost::filesystem::rename(tempFileName.str(), fileName);
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Failed to write '" << fileName << "' to the disk cache: " << e.what() << std::endl;
+        boost::system::error_code ec;
+        boost::filesystem::remove(tempFileName.str(), ec);
+    }
+}
+
+bool SceneDiskCache::canStore(const osg::Node &node)
+{
+    CanStoreVisitor visitor;
+    const_cast<osg::Node&>(node).accept(visitor);
+    return visitor.getResult();
+}
+
+std::string SceneDiskCache::getFileName(const std::string &key) const
+{
+    // two different checksums make collisions unlikely enough even for large numbers of files
+    boost::crc_32_type crc;
+    crc.process_bytes(key.data(), key.size());
+    boost::crc_optimal<32, 0x1EDC6F41, 0xFFFFFFFF, 0xFFFFFFFF, true, true> crc32c;
+    crc32c.process_bytes(key.data(), key.size());
+
+    std::ostringstream stream;
+    stream << std::hex << std::setfill('0') << std::setw(8) << crc.checksum() << std::setw(8) << crc32c.checksum() << ".osgb";
+    return (boost::filesystem::path(mPath) / stream.str()).string();
+}
+
+}
@@ -0,0 +1,72 @@
+#ifndef OPENMW_COMPONENTS_RESOURCE_SCENEDISKCACHE_H
+#define OPENMW_COMPONENTS_RESOURCE_SCENEDISKCACHE_H
+
+#include <string>
+
+#include <osg/ref_ptr>
+
+#include <OpenThreads/Atomic>
+
+namespace osg
+{
+    class Node;
+    class Image;
+    class Object;
+}
+
+namespace osgDB
+{
+    class Options;
+    class ReaderWriter;
+}
+
+namespace Resource
+{
+
+    /// @brief Stores processed scene templates in a directory using the OSG binary format, so that they can be loaded again
+    /// without parsing and optimizing the original file.
+    /// @par Only scenes made up of plain OSG nodes, drawables and state attributes are stored, see canStore(). Images are
+    /// stored as references to their file name. Processed images can be stored on their own, see writeImage().
+    /// @note Thread safe.
+    class SceneDiskCache
+    {
+    public:
+        /// @param path The directory to store files in, created if it does not exist.
+        SceneDiskCache(const std::string& path);
+
+        /// @return False if the OSG binary format is not available or the directory could not be created, in which case
+        /// nothing will be read or written.
+        bool isValid() const;
+
+        /// @param key Identifies the processed scene, must include everything the result depends on.
+        /// @param options Passed to the reader, needs to be able to read the referenced images.
+        /// @return NULL if there is no such entry or it could not be read.
+        osg::ref_ptr<osg::Node> read(const std::string& key, const osgDB::Options* options) const;
+
+        /// @note Errors are logged, not thrown.
+        void write(const std::string& key, const osg::Node& node);
+
+        /// Check if the subgraph below \a node can be stored without losing information, i.e. contains no callbacks,
+        /// shaders or classes other than the standard OSG ones.
+        static bool canStore(const osg::Node& node);
+
+        /// @return NULL if there is no such entry or it could not be read.
+        osg::ref_ptr<osg::Image> readImage(const std::string& key) const;
+
+        /// Store an image along with its data and mipmaps.
+        /// @note Errors are logged, not thrown.
+        void writeImage(const std::string& key, const osg::Image& image);
+
+    private:
+        std::string getFileName(const std::string& key) const;
+
+        void writeObject(const std::string& key, const osg::Object& object, const osgDB::Options* options);
+
+        std::string mPath;
+        osgDB::ReaderWriter* mReaderWriter;
+        OpenThreads::Atomic mTempFileCounter;
+    };
+
+}
+
+#endif
@@ -2,6 +2,9 @@
 
 #include <iostream>
 #include <cstdlib>
+#include <sstream>
+
+#include <boost/crc.hpp>
 
 #include <osg/Node>
 #include <osg/UserDataContainer>
@@ -32,6 +35,8 @@
 #include "niffilemanager.hpp"
 #include "objectcache.hpp"
 #include "multiobjectcache.hpp"
+#include "scenediskcache.hpp"
+#include "texturestreamer.hpp"
 
 namespace
 {
@@ -105,6 +110,25 @@ namespace
     private:
         unsigned int mMask;
     };
+
+    /// Give every node a StateSet of its own. The ShaderVisitor sets up a StateSet for the node it is attached to,
+    /// so it must not see StateSets that are shared with other nodes, e.g. by the optimizing or the unprepared templates.
+    class UnshareStateSetsVisitor : public osg::NodeVisitor
+    {
+    public:
+        UnshareStateSetsVisitor()
+            : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN)
+        {
+        }
+
+        virtual void apply(osg::Node& node)
+        {
+            osg::StateSet* stateset = node.getStateSet();
+            if (stateset && stateset->referenceCount() > 1)
+                node.setStateSet(new osg::StateSet(*stateset, osg::CopyOp::SHALLOW_COPY));
+            traverse(node);
+        }
+    };
 }
 
 namespace Resource
@@ -222,6 +246,7 @@ namespace Resource
         , mAutoUseSpecularMaps(false)
         , mInstanceCache(new MultiObjectCache)
         , mSharedStateManager(new SharedStateManager)
+        , mUnpreparedSharedStateManager(new SharedStateManager)
         , mImageManager(imageManager)
         , mNifFileManager(nifFileManager)
         , mMinFilter(osg::Texture::LINEAR_MIPMAP_LINEAR)
@@ -475,6 +500,26 @@ namespace Resource
         return options;
     }
 
+    /// Identifies the processed template of a file, covering the file's contents and the settings affecting the loading and optimizing.
+    /// @note Reads the whole file, and rewinds it afterwards.
+    std::string getDiskCacheKey(const std::string& normalizedFilename, std::istream& file)
+    {
+        boost::crc_32_type crc;
+        char buffer[4096];
+        while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0)
+            crc.process_bytes(buffer, file.gcount());
+        file.clear();
+        file.seekg(0);
+
+        // increment when the loader or optimizer changes in a way that affects the result
+        const int version = 2;
+
+        std::ostringstream stream;
+        stream << version << " " << normalizedFilename << " " << crc.checksum() << " " << canOptimize(normalizedFilename)
+               << " " << getOptimizationOptions() << " " << NifOsg::Loader::getShowMarkers();
+        return stream.str();
+    }
+
     osg::ref_ptr<const osg::Node> SceneManager::getTemplate(const std::string &name)
     {
         std::string normalized = name;
@@ -485,65 +530,111 @@ namespace Resource
             return osg::ref_ptr<const osg::Node>(static_cast<osg::Node*>(obj.get()));
         else
         {
-            osg::ref_ptr<osg::Node> loaded;
-            try
-            {
-                Files::IStreamPtr file = mVFS->get(normalized);
+            osg::ref_ptr<osg::Node> loaded = loadUnprepared(name, normalized);
 
-                loaded = load(file, normalized, mImageManager, mNifFileManager);
-            }
-            catch (std::exception& e)
-            {
-                static const char * const sMeshTypes[] = { "nif", "osg", "osgt", "osgb", "osgx", "osg2" };
+            prepareScene(*loaded);
 
-                for (unsigned int i=0; i<sizeof(sMeshTypes)/sizeof(sMeshTypes[0]); ++i)
-                {
-                    normalized = "meshes/marker_error." + std::string(sMeshTypes[i]);
-                    if (mVFS->exists(normalized))
-                    {
-                        std::cerr << "Failed to load '" << name << "': " << e.what() << ", using marker_error." << sMeshTypes[i] << " instead" << std::endl;
-                        Files::IStreamPtr file = mVFS->get(normalized);
-                        loaded = load(file, normalized, mImageManager, mNifFileManager);
-                        break;
-                    }
-                }
+            if (mIncrementalCompileOperation)
+                mIncrementalCompileOperation->add(loaded);
 
-                if (!loaded)
-                    throw;
-            }
+            mCache->addEntryToObjectCache(normalized, loaded);
+            return loaded;
+        }
+    }
+
+    osg::ref_ptr<const osg::Node> SceneManager::getUnpreparedTemplate(const std::string &name)
+    {
+        std::string normalized = name;
+        mVFS->normalizeFilename(normalized);
 
-            // set filtering settings
-            SetFilterSettingsVisitor setFilterSettingsVisitor(mMinFilter, mMagFilter, mMaxAnisotropy);
-            loaded->accept(setFilterSettingsVisitor);
-            SetFilterSettingsControllerVisitor setFilterSettingsControllerVisitor(mMinFilter, mMagFilter, mMaxAnisotropy);
-            loaded->accept(setFilterSettingsControllerVisitor);
+        // not a valid file name, so it can't collide with the prepared templates
+        const std::string key = "unprepared:" + normalized;
 
-            osg::ref_ptr<Shader::ShaderVisitor> shaderVisitor (createShaderVisitor());
-            loaded->accept(*shaderVisitor);
+        osg::ref_ptr<osg::Object> obj = mCache->getRefFromObjectCache(key);
+        if (obj)
+            return osg::ref_ptr<const osg::Node>(static_cast<osg::Node*>(obj.get()));
+        else
+        {
+            osg::ref_ptr<osg::Node> loaded = loadUnprepared(name, normalized);
 
-            // share state
-            // do this before optimizing so the optimizer will be able to combine nodes more aggressively
-            // note, because StateSets will be shared at this point, StateSets can not be modified inside the optimizer
+            // share the state with the other unprepared templates, so that scenes built from several of them can be merged
             mSharedStateMutex.lock();
-            mSharedStateManager->share(loaded.get());
+            mUnpreparedSharedStateManager->share(loaded);
             mSharedStateMutex.unlock();
 
-            if (canOptimize(normalized))
+            mCache->addEntryToObjectCache(key, loaded);
+            return loaded;
+        }
+    }
+
+    osg::ref_ptr<osg::Node> SceneManager::loadUnprepared(const std::string &name, const std::string &normalizedName)
+    {
+        std::string normalized = normalizedName;
+        osg::ref_ptr<osg::Node> loaded;
+        std::string diskCacheKey;
+        bool fromDiskCache = false;
+        try
+        {
+            Files::IStreamPtr file = mVFS->get(normalized);
+
+            if (mDiskCache)
             {
-                SceneUtil::Optimizer optimizer;
-                optimizer.setIsOperationPermissibleForObjectCallback(new CanOptimizeCallback);
+                diskCacheKey = getDiskCacheKey(normalized, *file);
+
+                osg::ref_ptr<osgDB::Options> options (new osgDB::Options);
+                options->setReadFileCallback(new ImageReadCallback(mImageManager));
+                loaded = mDiskCache->read(diskCacheKey, options);
+                fromDiskCache = loaded.valid();
+            }
+
+            if (!loaded)
+                loaded = load(file, normalized, mImageManager, mNifFileManager);
+        }
+        catch (std::exception& e)
+        {
+            diskCacheKey.clear();
 
-                static const unsigned int options = getOptimizationOptions();
+            static const char * const sMeshTypes[] = { "nif", "osg", "osgt", "osgb", "osgx", "osg2" };
 
-                optimizer.optimize(loaded, options);
+            for (unsigned int i=0; i<sizeof(sMeshTypes)/sizeof(sMeshTypes[0]); ++i)
+            {
+                normalized = "meshes/marker_error." + std::string(sMeshTypes[i]);
+                if (mVFS->exists(normalized))
+                {
+                    std::cerr << "Failed to load '" << name << "': " << e.what() << ", using marker_error." << sMeshTypes[i] << " instead" << std::endl;
+                    Files::IStreamPtr file = mVFS->get(normalized);
+                    loaded = load(file, normalized, mImageManager, mNifFileManager);
+                    break;
+                }
             }
 
-            if (mIncrementalCompileOperation)
-                mIncrementalCompileOperation->add(loaded);
+            if (!loaded)
+                throw;
+        }
 
-            mCache->addEntryToObjectCache(normalized, loaded);
+        // the stored template is already optimized
+        if (fromDiskCache)
             return loaded;
+
+        // share the state within the scene so the optimizer will be able to combine nodes more aggressively
+        // note, because StateSets will be shared at this point, StateSets can not be modified inside the optimizer
+        osg::ref_ptr<osgDB::SharedStateManager> sharedStateManager (new osgDB::SharedStateManager);
+        sharedStateManager->share(loaded);
+
+        if (canOptimize(normalized))
+        {
+            SceneUtil::Optimizer optimizer;
+            optimizer.setIsOperationPermissibleForObjectCallback(new CanOptimizeCallback);
+
+            static const unsigned int options = getOptimizationOptions();
+
+            optimizer.optimize(loaded, options);
         }
+
+        if (!diskCacheKey.empty())
+            writeCachedScene(diskCacheKey, *loaded);
+
+        return loaded;
     }
 
     osg::ref_ptr<osg::Node> SceneManager::cacheInstance(const std::string &name)
@@ -629,6 +720,64 @@ namespace Resource
         mSharedStateManager->releaseGLObjects(state);
     }
 
+    void SceneManager::setDiskCachePath(const std::string &path)
+    {
+        mDiskCache.reset(new SceneDiskCache(path));
+        if (!mDiskCache->isValid())
+            mDiskCache.reset();
+    }
+
+    osg::ref_ptr<osg::Node> SceneManager::readCachedScene(const std::string &key)
+    {
+        if (!mDiskCache)
+            return NULL;
+
+        osg::ref_ptr<osgDB::Options> options (new osgDB::Options);
+        options->setReadFileCallback(new ImageReadCallback(mImageManager));
+        osg::ref_ptr<osg::Node> loaded = mDiskCache->read(key, options);
+        if (loaded)
+            prepareScene(*loaded);
+        return loaded;
+    }
+
+    void SceneManager::writeCachedScene(const std::string &key, const osg::Node &node)
+    {
+        if (!mDiskCache)
+            return;
+
+        if (SceneDiskCache::canStore(node))
+        {
+            mDiskCache->write(key, node);
+            ++mNumDiskCacheStored;
+        }
+        else
+            ++mNumDiskCacheRejected;
+    }
+
+    void SceneManager::prepareScene(osg::Node &node)
+    {
+        UnshareStateSetsVisitor unshareStateSetsVisitor;
+        node.accept(unshareStateSetsVisitor);
+
+        // set filtering settings
+        SetFilterSettingsVisitor setFilterSettingsVisitor(mMinFilter, mMagFilter, mMaxAnisotropy);
+        node.accept(setFilterSettingsVisitor);
+        SetFilterSettingsControllerVisitor setFilterSettingsControllerVisitor(mMinFilter, mMagFilter, mMaxAnisotropy);
+        node.accept(setFilterSettingsControllerVisitor);
+
+        osg::ref_ptr<Shader::ShaderVisitor> shaderVisitor (createShaderVisitor());
+        node.accept(*shaderVisitor);
+
+        // replaces textures, so has to happen while the state is not shared with other scenes yet
+        if (TextureStreamer* textureStreamer = mImageManager->getTextureStreamer())
+            textureStreamer->setupStreaming(node);
+
+        // share state
+        mSharedStateMutex.lock();
+        mSharedStateManager->share(&node);
+        mSharedStateMutex.unlock();
+    }
+
     void SceneManager::setIncrementalCompileOperation(osgUtil::IncrementalCompileOperation *ico)
     {
         mIncrementalCompileOperation = ico;
@@ -713,6 +862,7 @@ namespace Resource
 
         mSharedStateMutex.lock();
         mSharedStateManager->prune();
+        mUnpreparedSharedStateManager->prune();
         mSharedStateMutex.unlock();
     }
 
@@ -722,6 +872,7 @@ namespace Resource
 
         OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mSharedStateMutex);
         mSharedStateManager->clearCache();
+        mUnpreparedSharedStateManager->clearCache();
         mInstanceCache->clear();
     }
 
@@ -740,6 +891,12 @@ namespace Resource
 
         stats->setAttribute(frameNumber, "Node", mCache->getCacheSize());
         stats->setAttribute(frameNumber, "Node Instance", mInstanceCache->getCacheSize());
+
+        if (mDiskCache)
+        {
+            stats->setAttribute(frameNumber, "Disk Cache Stored", static_cast<unsigned int>(mNumDiskCacheStored));
+            stats->setAttribute(frameNumber, "Disk Cache Rejected", static_cast<unsigned int>(mNumDiskCacheRejected));
+        }
     }
 
     Shader::ShaderVisitor *SceneManager::createShaderVisitor()
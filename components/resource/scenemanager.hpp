@@ -9,6 +9,8 @@
 #include <osg/Node>
 #include <osg/Texture>
 
+#include <OpenThreads/Atomic>
+
 #include "resourcemanager.hpp"
 
 namespace Resource
@@ -38,6 +40,7 @@ namespace Resource
 {
 
     class MultiObjectCache;
+    class SceneDiskCache;
 
     /// @brief Handles loading and caching of scenes, e.g. .nif files or .osg files
     /// @note Some methods of the scene manager can be used from any thread, see the methods documentation for more details.
@@ -88,6 +91,12 @@ namespace Resource
         /// @note Thread safe.
         osg::ref_ptr<const osg::Node> getTemplate(const std::string& name);
 
+        /// Get a read-only template as it is stored in the disk cache, i.e. optimized, but without the filter settings, shaders
+        /// and texture streaming. Scenes built from such templates can be stored with writeCachedScene(), and have to be set up
+        /// with prepareScene() before they are displayed.
+        /// @note Thread safe.
+        osg::ref_ptr<const osg::Node> getUnpreparedTemplate(const std::string& name);
+
         /// Create an instance of the given scene template and cache it for later use, so that future calls to getInstance() can simply
         /// return this cached object instead of creating a new one.
         /// @note The returned ref_ptr may be kept around by the caller to ensure that the object stays in cache for as long as needed.
@@ -119,6 +128,27 @@ namespace Resource
         /// in cases where multiple contexts are used over the lifetime of the application.
         void releaseGLObjects(osg::State* state) override;
 
+        /// Store processed templates in the given directory, and load them from there rather than from the original files.
+        /// @note Not thread safe, call before loading anything.
+        void setDiskCachePath(const std::string& path);
+
+        /// Read a scene that was built from templates and stored with writeCachedScene(), and set it up like a loaded template.
+        /// @return NULL if the disk cache is not used or has no such entry.
+        /// @note Thread safe.
+        osg::ref_ptr<osg::Node> readCachedScene(const std::string& key);
+
+        /// Store a scene that was built from templates, if the disk cache is used and the scene can be stored.
+        /// @note The scene must not be set up with prepareScene() yet. Scenes that can't be stored are counted in the
+        /// "Disk Cache Rejected" stat.
+        /// @param key Identifies the scene, must include everything it depends on and must not be a file name.
+        /// @note Thread safe.
+        void writeCachedScene(const std::string& key, const osg::Node& node);
+
+        /// Apply the filter settings, shaders and texture streaming to a scene that was just loaded, read from the disk cache
+        /// or built from unprepared templates, and share its state with other scenes.
+        /// @note Thread safe, as long as the scene is not part of the main scene graph yet.
+        void prepareScene(osg::Node& node);
+
         /// Set up an IncrementalCompileOperation for background compiling of loaded scenes.
         void setIncrementalCompileOperation(osgUtil::IncrementalCompileOperation* ico);
 
@@ -152,6 +182,9 @@ namespace Resource
 
         Shader::ShaderVisitor* createShaderVisitor();
 
+        /// Load a template, or read it from the disk cache, and optimize and store it if it was loaded.
+        osg::ref_ptr<osg::Node> loadUnprepared(const std::string& name, const std::string& normalizedName);
+
         std::unique_ptr<Shader::ShaderManager> mShaderManager;
         bool mForceShaders;
         bool mClampLighting;
@@ -164,7 +197,12 @@ namespace Resource
 
         osg::ref_ptr<MultiObjectCache> mInstanceCache;
 
+        std::unique_ptr<SceneDiskCache> mDiskCache;
+        OpenThreads::Atomic mNumDiskCacheStored;
+        OpenThreads::Atomic mNumDiskCacheRejected;
+
         osg::ref_ptr<Resource::SharedStateManager> mSharedStateManager;
+        osg::ref_ptr<Resource::SharedStateManager> mUnpreparedSharedStateManager;
         mutable OpenThreads::Mutex mSharedStateMutex;
 
         Resource::ImageManager* mImageManager;
@@ -259,7 +259,7 @@ void StatsHandler::setUpScene(osgViewer::ViewerBase *viewer)
         _resourceStatsChildNum = _switch->getNumChildren();
         _switch->addChild(group, false);
 
-        const char* statNames[] = {"Compiling", "WorkQueue", "WorkThread", "", "Texture", "StateSet", "Node", "Node Instance", "Shape", "Shape Instance", "Image", "Nif", "Keyframe", "", "Terrain Chunk", "Terrain Texture", "Land", "Composite", "", "UnrefQueue"};
+        const char* statNames[] = {"Compiling", "WorkQueue", "WorkThread", "WorkQueue Wait ms", "WorkQueue Max ms", "WorkQueue Cancel", "Jobs", "Job ms", "Job Steals", "Job Wait ms", "", "Texture", "StateSet", "Node", "Node Instance", "Disk Cache Stored", "Disk Cache Rejected", "Shape", "Shape Instance", "Image", "Streamed Image", "Streaming MB", "Nif", "Keyframe", "", "Terrain Chunk", "Terrain Texture", "Land", "Composite", "Distant Objects", "", "UnrefQueue"};
 
         int numLines = sizeof(statNames) / sizeof(statNames[0]);
 
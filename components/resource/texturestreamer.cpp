@@ -0,0 +1,539 @@
+#include "texturestreamer.hpp"
+
+#include <algorithm>
+#include <set>
+
+#include <osg/Stats>
+
+#include <osgUtil/CullVisitor>
+
+#include <components/sceneutil/workqueue.hpp>
+
+#include "imagemanager.hpp"
+#include "imageprocessing.hpp"
+
+namespace
+{
+
+    /// Texels a texture is needed with per pixel of the projected size of the drawable using it. Covers textures that are
+    /// repeated or only partly used across the drawable.
+    const float sTexelsPerPixel = 2.f;
+
+    /// Number of frames a request is held for, so that mipmaps aren't dropped and loaded again while looking around.
+    const unsigned int sHoldFrames = 120;
+
+    /// Maximum number of images loaded at the same time.
+    const unsigned int sMaxLoading = 4;
+
+    /// Has a drawable request the size its StreamedImages are needed at, based on the drawable's size on screen.
+    class TextureStreamingCullCallback : public osg::Drawable::CullCallback
+    {
+    public:
+        TextureStreamingCullCallback()
+        {
+        }
+
+        TextureStreamingCullCallback(const std::vector<osg::ref_ptr<Resource::StreamedImage> >& images)
+            : mImages(images)
+        {
+        }
+
+        TextureStreamingCullCallback(const TextureStreamingCullCallback& copy, const osg::CopyOp& copyop)
+            : osg::Drawable::CullCallback(copy, copyop)
+            , mImages(copy.mImages)
+        {
+        }
+
+        META_Object(Resource, TextureStreamingCullCallback)
+
+        virtual bool cull(osg::NodeVisitor* nv, osg::Drawable* drawable, osg::State*) const
+        {
+            osgUtil::CullVisitor* cv = static_cast<osgUtil::CullVisitor*>(nv);
+
+            // the culling itself is left to the cull visitor, this only avoids requests for drawables that are not visible
+            const osg::BoundingBox& box = drawable->getBoundingBox();
+            if (!box.valid() || cv->isCulled(box))
+                return false;
+
+            float size = cv->clampedPixelSize(drawable->getBound()) * 2.f * sTexelsPerPixel;
+            for (std::vector<osg::ref_ptr<Resource::StreamedImage> >::const_iterator it = mImages.begin(); it != mImages.end(); ++it)
+                (*it)->request(size);
+            return false;
+        }
+
+    private:
+        std::vector<osg::ref_ptr<Resource::StreamedImage> > mImages;
+    };
+
+}
+
+namespace Resource
+{
+
+    /// @brief Loads the larger mipmaps of a StreamedImage.
+    class StreamingLoader : public SceneUtil::WorkItem
+    {
+    public:
+        StreamingLoader(ImageManager* imageManager, const std::string& fileName, ImageUsage usage, int width, int height,
+                        unsigned int numLevels, unsigned int level, size_t estimatedSize)
+            : mImageManager(imageManager)
+            , mFileName(fileName)
+            , mUsage(usage)
+            , mWidth(width)
+            , mHeight(height)
+            , mNumLevels(numLevels)
+            , mLevel(level)
+            , mEstimatedSize(estimatedSize)
+        {
+            setPool(SceneUtil::WorkQueue::Pool_IO);
+        }
+
+        virtual void doWork()
+        {
+            osg::ref_ptr<osg::Image> image = mImageManager->readImage(mFileName, mUsage);
+            if (!image->isMipmap() && canGenerateMipmaps(*image))
+                image = generateMipmaps(*image, mUsage);
+
+            // the file may have failed to load this time
+            if (image->s() != mWidth || image->t() != mHeight || image->getNumMipmapLevels() != mNumLevels)
+                return;
+
+            mResult = getMipmapLevels(*image, mLevel);
+        }
+
+        /// @return NULL if the mipmaps could not be loaded.
+        osg::Image* getResult() const
+        {
+            return mResult;
+        }
+
+        unsigned int getLevel() const
+        {
+            return mLevel;
+        }
+
+        size_t getEstimatedSize() const
+        {
+            return mEstimatedSize;
+        }
+
+    private:
+        ImageManager* mImageManager;
+        std::string mFileName;
+        ImageUsage mUsage;
+        int mWidth;
+        int mHeight;
+        unsigned int mNumLevels;
+        unsigned int mLevel;
+        size_t mEstimatedSize;
+
+        osg::ref_ptr<osg::Image> mResult;
+    };
+
+    /// @brief Collects the drawables of a scene along with the StateSets applying to them, to set up their textures for streaming.
+    class TextureStreamingVisitor : public osg::NodeVisitor
+    {
+    public:
+        TextureStreamingVisitor(TextureStreamer& streamer)
+            : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN)
+            , mStreamer(streamer)
+        {
+        }
+
+        virtual void apply(osg::Node& node)
+        {
+            osg::StateSet* stateset = node.getStateSet();
+            if (stateset)
+                mStateSets.push_back(stateset);
+
+            if (osg::Drawable* drawable = node.asDrawable())
+            {
+                DrawableStates states;
+                states.mDrawable = drawable;
+                states.mStateSets = mStateSets;
+                mDrawables.push_back(states);
+            }
+
+            traverse(node);
+
+            if (stateset)
+                mStateSets.pop_back();
+        }
+
+        void setupStreaming()
+        {
+            // a drawable with a cull callback of its own can't request the size its textures are needed at, so those are left alone
+            std::set<const osg::StateAttribute*> excluded;
+            for (std::vector<DrawableStates>::const_iterator it = mDrawables.begin(); it != mDrawables.end(); ++it)
+            {
+                if (!it->mDrawable->getCullCallback())
+                    continue;
+                for (std::vector<osg::StateSet*>::const_iterator stateset = it->mStateSets.begin(); stateset != it->mStateSets.end(); ++stateset)
+                {
+                    for (unsigned int unit=0; unit<(*stateset)->getTextureAttributeList().size(); ++unit)
+                        excluded.insert((*stateset)->getTextureAttribute(unit, osg::StateAttribute::TEXTURE));
+                }
+            }
+
+            for (std::vector<DrawableStates>::const_iterator it = mDrawables.begin(); it != mDrawables.end(); ++it)
+            {
+                if (it->mDrawable->getCullCallback())
+                    continue;
+
+                std::vector<osg::ref_ptr<StreamedImage> > images;
+                for (std::vector<osg::StateSet*>::const_iterator stateset = it->mStateSets.begin(); stateset != it->mStateSets.end(); ++stateset)
+                {
+                    for (unsigned int unit=0; unit<(*stateset)->getTextureAttributeList().size(); ++unit)
+                    {
+                        StreamingTexture* texture = getStreamingTexture(**stateset, unit, excluded);
+                        if (texture && std::find(images.begin(), images.end(), texture->getStreamedImage()) == images.end())
+                            images.push_back(texture->getStreamedImage());
+                    }
+                }
+
+                if (!images.empty())
+                    it->mDrawable->setCullCallback(new TextureStreamingCullCallback(images));
+            }
+        }
+
+    private:
+        /// Get the texture of a unit of \a stateset, replacing it with a StreamingTexture if not done already.
+        /// @return NULL if the texture can't be streamed.
+        StreamingTexture* getStreamingTexture(osg::StateSet& stateset, unsigned int unit, const std::set<const osg::StateAttribute*>& excluded)
+        {
+            osg::StateAttribute* attribute = stateset.getTextureAttribute(unit, osg::StateAttribute::TEXTURE);
+            if (!attribute)
+                return NULL;
+
+            if (StreamingTexture* texture = dynamic_cast<StreamingTexture*>(attribute))
+                return texture;
+
+            if (excluded.count(attribute) || std::string(attribute->libraryName()) != "osg" || std::string(attribute->className()) != "Texture2D")
+                return NULL;
+
+            // the same texture may be used by several StateSets
+            osg::ref_ptr<StreamingTexture> texture;
+            ConvertedMap::const_iterator found = mConverted.find(attribute);
+            if (found != mConverted.end())
+                texture = found->second;
+            else
+            {
+                const osg::Texture2D& source = static_cast<const osg::Texture2D&>(*attribute);
+                osg::ref_ptr<StreamedImage> image;
+                if (source.getImage())
+                    image = mStreamer.getStreamedImage(*source.getImage());
+                if (image)
+                    texture = new StreamingTexture(source, image);
+                mConverted[attribute] = texture;
+            }
+
+            if (texture)
+                stateset.setTextureAttribute(unit, texture, stateset.getTextureAttributePair(unit, osg::StateAttribute::TEXTURE)->second);
+            return texture;
+        }
+
+        TextureStreamer& mStreamer;
+
+        struct DrawableStates
+        {
+            osg::Drawable* mDrawable;
+            std::vector<osg::StateSet*> mStateSets;
+        };
+        std::vector<DrawableStates> mDrawables;
+        std::vector<osg::StateSet*> mStateSets;
+
+        // holds on to the replaced textures, so that their addresses are not reused while the visitor runs
+        typedef std::map<osg::ref_ptr<osg::StateAttribute>, osg::ref_ptr<StreamingTexture> > ConvertedMap;
+        ConvertedMap mConverted;
+    };
+
+    StreamedImage::StreamedImage(const std::string& fileName, ImageUsage usage, int width, int height, unsigned int numLevels, unsigned int tailLevel, osg::Image* tail)
+        : mFileName(fileName)
+        , mUsage(usage)
+        , mWidth(width)
+        , mHeight(height)
+        , mNumLevels(numLevels)
+        , mTailLevel(tailLevel)
+        , mResidentLevel(tailLevel)
+        , mResidentSize(tail->getTotalSizeInBytesIncludingMipmaps())
+        , mRequestedSize(0.f)
+        , mHeldSize(0.f)
+        , mHeldFrame(0)
+        , mFailed(false)
+        , mImage(tail)
+        , mGeneration(0)
+    {
+    }
+
+    StreamedImage::~StreamedImage()
+    {
+    }
+
+    osg::ref_ptr<osg::Image> StreamedImage::getImage(unsigned int &generation) const
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+        generation = mGeneration;
+        return mImage;
+    }
+
+    unsigned int StreamedImage::getGeneration() const
+    {
+        return mGeneration;
+    }
+
+    void StreamedImage::setImage(osg::Image *image, unsigned int level)
+    {
+        mResidentLevel = level;
+        mResidentSize = image->getTotalSizeInBytesIncludingMipmaps();
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+        mImage = image;
+        ++mGeneration;
+    }
+
+    StreamingTexture::StreamingTexture()
+        : mGeneration(0)
+    {
+    }
+
+    StreamingTexture::StreamingTexture(const osg::Texture2D &texture, StreamedImage *image)
+        : osg::Texture2D(texture, osg::CopyOp::SHALLOW_COPY)
+        , mStreamedImage(image)
+        , mGeneration(0)
+    {
+        setImage(image->getImage(mGeneration));
+    }
+
+    StreamingTexture::StreamingTexture(const StreamingTexture &copy, const osg::CopyOp &copyop)
+        : osg::Texture2D(copy, copyop)
+        , mStreamedImage(copy.mStreamedImage)
+        , mGeneration(copy.mGeneration)
+    {
+    }
+
+    int StreamingTexture::compare(const osg::StateAttribute &sa) const
+    {
+        COMPARE_StateAttribute_Types(StreamingTexture, sa)
+
+        COMPARE_StateAttribute_Parameter(mStreamedImage)
+
+        return compareTexture(rhs);
+    }
+
+    void StreamingTexture::apply(osg::State &state) const
+    {
+        if (mStreamedImage && mStreamedImage->getGeneration() != mGeneration)
+        {
+            StreamingTexture* self = const_cast<StreamingTexture*>(this);
+            self->setImage(mStreamedImage->getImage(mGeneration));
+            self->dirtyTextureObject();
+        }
+
+        osg::Texture2D::apply(state);
+    }
+
+    StreamedImage* StreamingTexture::getStreamedImage() const
+    {
+        return mStreamedImage;
+    }
+
+    TextureStreamer::TextureStreamer(ImageManager* imageManager, unsigned int minSize, size_t budget)
+        : mImageManager(imageManager)
+        , mMinSize(std::max(1u, minSize))
+        , mBudget(budget)
+        , mResidentSize(0)
+        , mLoadingSize(0)
+        , mNumLoading(0)
+    {
+    }
+
+    TextureStreamer::~TextureStreamer()
+    {
+    }
+
+    void TextureStreamer::setupStreaming(osg::Node &node)
+    {
+        TextureStreamingVisitor visitor(*this);
+        node.accept(visitor);
+        visitor.setupStreaming();
+    }
+
+    osg::ref_ptr<StreamedImage> TextureStreamer::getStreamedImage(const osg::Image &image)
+    {
+        const std::string& fileName = image.getFileName();
+        if (fileName.empty() || image.r() != 1)
+            return NULL;
+
+        const ImageUsage usage = getImageUsage(image);
+        const std::pair<std::string, ImageUsage> key (fileName, usage);
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+            ImageMap::const_iterator found = mImages.find(key);
+            if (found != mImages.end())
+            {
+                if (found->second->mWidth != image.s() || found->second->mHeight != image.t())
+                    return NULL;
+                return found->second;
+            }
+        }
+
+        osg::ref_ptr<const osg::Image> source = &image;
+        if (!image.isMipmap())
+        {
+            if (!canGenerateMipmaps(image))
+                return NULL;
+            source = generateMipmaps(image, usage);
+        }
+
+        const unsigned int numLevels = source->getNumMipmapLevels();
+        unsigned int tailLevel = 0;
+        while (tailLevel+1 < numLevels && static_cast<unsigned int>(std::max(source->s(), source->t()) >> tailLevel) > mMinSize)
+            ++tailLevel;
+        // small enough already
+        if (tailLevel == 0)
+            return NULL;
+
+        osg::ref_ptr<osg::Image> tail = getMipmapLevels(*source, tailLevel);
+        if (!tail)
+            return NULL;
+
+        osg::ref_ptr<StreamedImage> streamed (new StreamedImage(fileName, usage, image.s(), image.t(), numLevels, tailLevel, tail));
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+        std::pair<ImageMap::iterator, bool> inserted = mImages.insert(std::make_pair(key, streamed));
+        if (inserted.second)
+            mResidentSize += streamed->mResidentSize;
+        return inserted.first->second;
+    }
+
+    unsigned int TextureStreamer::getWantedLevel(const StreamedImage &image) const
+    {
+        unsigned int level = 0;
+        float size = static_cast<float>(std::max(image.mWidth, image.mHeight));
+        while (level < image.mTailLevel && size / 2.f >= image.mHeldSize)
+        {
+            size /= 2.f;
+            ++level;
+        }
+        return level;
+    }
+
+    void TextureStreamer::dropLevels(StreamedImage &image, unsigned int level)
+    {
+        unsigned int generation;
+        osg::ref_ptr<osg::Image> resident = image.getImage(generation);
+        osg::ref_ptr<osg::Image> dropped = getMipmapLevels(*resident, level - image.mResidentLevel);
+        if (!dropped)
+            return;
+
+        mResidentSize += dropped->getTotalSizeInBytesIncludingMipmaps();
+        mResidentSize -= image.mResidentSize;
+        image.setImage(dropped, level);
+    }
+
+    void TextureStreamer::update(unsigned int frameNumber)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+
+        // images that need larger mipmaps, with their held request
+        std::vector<std::pair<float, StreamedImage*> > needed;
+
+        for (ImageMap::iterator it = mImages.begin(); it != mImages.end(); )
+        {
+            StreamedImage& image = *it->second;
+
+            if (image.mLoader && image.mLoader->isDone())
+            {
+                if (osg::Image* result = image.mLoader->getResult())
+                {
+                    mResidentSize += result->getTotalSizeInBytesIncludingMipmaps();
+                    mResidentSize -= image.mResidentSize;
+                    image.setImage(result, image.mLoader->getLevel());
+                }
+                else
+                    image.mFailed = true;
+
+                mLoadingSize -= image.mLoader->getEstimatedSize();
+                --mNumLoading;
+                image.mLoader = NULL;
+            }
+
+            // no longer used by any texture
+            if (it->second->referenceCount() == 1 && !image.mLoader)
+            {
+                mResidentSize -= image.mResidentSize;
+                mImages.erase(it++);
+                continue;
+            }
+
+            float requested = image.mRequestedSize;
+            image.mRequestedSize = 0.f;
+            if (requested >= image.mHeldSize || frameNumber - image.mHeldFrame > sHoldFrames)
+            {
+                image.mHeldSize = requested;
+                image.mHeldFrame = frameNumber;
+            }
+
+            if (!image.mLoader)
+            {
+                unsigned int wanted = getWantedLevel(image);
+                if (wanted > image.mResidentLevel)
+                    dropLevels(image, wanted);
+                else if (wanted < image.mResidentLevel && !image.mFailed)
+                    needed.push_back(std::make_pair(image.mHeldSize, &image));
+            }
+
+            ++it;
+        }
+
+        // over budget, drop a level of the images needed smallest
+        if (mResidentSize > mBudget)
+        {
+            std::vector<std::pair<float, StreamedImage*> > resident;
+            for (ImageMap::iterator it = mImages.begin(); it != mImages.end(); ++it)
+            {
+                if (!it->second->mLoader && it->second->mResidentLevel < it->second->mTailLevel)
+                    resident.push_back(std::make_pair(it->second->mHeldSize, it->second.get()));
+            }
+            std::sort(resident.begin(), resident.end());
+            for (std::vector<std::pair<float, StreamedImage*> >::iterator it = resident.begin(); it != resident.end() && mResidentSize > mBudget; ++it)
+                dropLevels(*it->second, it->second->mResidentLevel + 1);
+        }
+
+        // load the images needed largest first, as long as they fit
+        std::sort(needed.begin(), needed.end());
+        SceneUtil::WorkQueue* workQueue = mImageManager->getWorkQueue();
+        for (std::vector<std::pair<float, StreamedImage*> >::reverse_iterator it = needed.rbegin(); it != needed.rend() && mNumLoading < sMaxLoading; ++it)
+        {
+            StreamedImage& image = *it->second;
+            unsigned int level = getWantedLevel(image);
+            if (level >= image.mResidentLevel)
+                continue;
+
+            // each level is about four times the size of the next one
+            size_t estimatedSize = image.mResidentSize << (2 * (image.mResidentLevel - level));
+            if (mResidentSize + mLoadingSize + estimatedSize - image.mResidentSize > mBudget)
+                continue;
+
+            image.mLoader = new StreamingLoader(mImageManager, image.mFileName, image.mUsage, image.mWidth, image.mHeight, image.mNumLevels, level, estimatedSize);
+            mLoadingSize += estimatedSize;
+            ++mNumLoading;
+
+            if (workQueue)
+                workQueue->addWorkItem(image.mLoader);
+            else
+            {
+                image.mLoader->doWork();
+                image.mLoader->signalDone();
+            }
+        }
+    }
+
+    void TextureStreamer::reportStats(unsigned int frameNumber, osg::Stats *stats) const
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+        stats->setAttribute(frameNumber, "Streamed Image", mImages.size());
+        stats->setAttribute(frameNumber, "Streaming MB", mResidentSize / (1024.0 * 1024.0));
+    }
+
+}
@@ -0,0 +1,161 @@
+#ifndef OPENMW_COMPONENTS_RESOURCE_TEXTURESTREAMER_H
+#define OPENMW_COMPONENTS_RESOURCE_TEXTURESTREAMER_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <OpenThreads/Atomic>
+#include <OpenThreads/Mutex>
+
+#include <osg/ref_ptr>
+#include <osg/Image>
+#include <osg/Texture2D>
+
+#include "imageprocessing.hpp"
+
+namespace osg
+{
+    class Node;
+    class Stats;
+}
+
+namespace Resource
+{
+
+    class ImageManager;
+    class StreamingLoader;
+
+    /// @brief An image of which only the mipmaps needed at the moment are loaded, shared by all StreamingTextures of the same file.
+    class StreamedImage : public osg::Referenced
+    {
+    public:
+        StreamedImage(const std::string& fileName, ImageUsage usage, int width, int height, unsigned int numLevels, unsigned int tailLevel, osg::Image* tail);
+
+        /// Note that the image is needed with at least \a size texels across.
+        /// @note Call during the cull traversal. Requests of the same frame are merged without locking, as the cull traversals
+        /// of all cameras are done by the same thread.
+        void request(float size)
+        {
+            if (size > mRequestedSize)
+                mRequestedSize = size;
+        }
+
+        /// Get the resident mipmaps, and the generation they belong to. The generation changes whenever the mipmaps do.
+        /// @note Thread safe.
+        osg::ref_ptr<osg::Image> getImage(unsigned int& generation) const;
+
+        unsigned int getGeneration() const;
+
+    protected:
+        virtual ~StreamedImage();
+
+    private:
+        friend class TextureStreamer;
+
+        void setImage(osg::Image* image, unsigned int level);
+
+        const std::string mFileName;
+        const ImageUsage mUsage;
+        const int mWidth;
+        const int mHeight;
+        const unsigned int mNumLevels;
+        /// The first of the mipmaps that are always resident.
+        const unsigned int mTailLevel;
+
+        /// The base level of the resident image.
+        unsigned int mResidentLevel;
+        size_t mResidentSize;
+
+        float mRequestedSize;
+        float mHeldSize;
+        unsigned int mHeldFrame;
+
+        osg::ref_ptr<StreamingLoader> mLoader;
+        bool mFailed;
+
+        mutable OpenThreads::Mutex mMutex;
+        osg::ref_ptr<osg::Image> mImage;
+        OpenThreads::Atomic mGeneration;
+    };
+
+    /// @brief A texture drawing whichever mipmaps of a StreamedImage are resident.
+    class StreamingTexture : public osg::Texture2D
+    {
+    public:
+        StreamingTexture();
+
+        /// Take the settings of \a texture, drawing \a image instead of its image.
+        StreamingTexture(const osg::Texture2D& texture, StreamedImage* image);
+
+        StreamingTexture(const StreamingTexture& copy, const osg::CopyOp& copyop = osg::CopyOp::SHALLOW_COPY);
+
+        META_StateAttribute(Resource, StreamingTexture, TEXTURE)
+
+        /// Compares the StreamedImage rather than its resident mipmaps, which change over time.
+        virtual int compare(const osg::StateAttribute& sa) const;
+
+        /// Switches to the latest resident mipmaps before applying the texture. As this happens in the draw thread,
+        /// the image is never changed while being uploaded.
+        virtual void apply(osg::State& state) const;
+
+        StreamedImage* getStreamedImage() const;
+
+    private:
+        osg::ref_ptr<StreamedImage> mStreamedImage;
+        mutable unsigned int mGeneration;
+    };
+
+    /// @brief Keeps only the mipmaps of textures resident that are needed for the size objects are seen at.
+    /// @par Textures start out with their smallest mipmaps. During the cull traversal, drawables note the size their textures
+    /// are needed at, based on their size on screen. Once per frame, larger mipmaps are loaded in the background for the
+    /// textures that are needed largest, and the mipmaps that are no longer needed are dropped, within a memory budget.
+    class TextureStreamer
+    {
+    public:
+        /// @param minSize Size of the mipmaps that are always resident.
+        /// @param budget Memory in bytes the resident mipmaps should stay within.
+        TextureStreamer(ImageManager* imageManager, unsigned int minSize, size_t budget);
+        ~TextureStreamer();
+
+        /// Replace the textures below \a node with StreamingTextures, and have the drawables using them request the size
+        /// they are needed at. Textures that can't be streamed, e.g. as they have no mipmaps, are left alone.
+        /// @note Call before the state of \a node is shared with other scenes. Thread safe.
+        void setupStreaming(osg::Node& node);
+
+        /// Load and drop mipmaps based on the requests made since the last update.
+        /// @note Call once per frame, from the thread doing the cull traversals, while they are not running.
+        void update(unsigned int frameNumber);
+
+        void reportStats(unsigned int frameNumber, osg::Stats* stats) const;
+
+    private:
+        friend class TextureStreamingVisitor;
+
+        /// Get the StreamedImage of a texture's image.
+        /// @return NULL if the image can't be streamed.
+        osg::ref_ptr<StreamedImage> getStreamedImage(const osg::Image& image);
+
+        /// The mipmap level to be resident for the held requests of \a image.
+        unsigned int getWantedLevel(const StreamedImage& image) const;
+
+        /// Replace the mipmaps of \a image by smaller ones that are already resident.
+        void dropLevels(StreamedImage& image, unsigned int level);
+
+        ImageManager* mImageManager;
+        unsigned int mMinSize;
+        size_t mBudget;
+
+        typedef std::map<std::pair<std::string, ImageUsage>, osg::ref_ptr<StreamedImage> > ImageMap;
+        ImageMap mImages;
+        size_t mResidentSize;
+        mutable OpenThreads::Mutex mMutex;
+
+        /// Estimated size of the mipmaps being loaded.
+        size_t mLoadingSize;
+        unsigned int mNumLoading;
+    };
+
+}
+
+#endif
@@ -0,0 +1,245 @@
+#include "instancedgeometry.hpp"
+
+#include <osg/GLExtensions>
+#include <osg/Polytope>
+
+#include <osgUtil/CullVisitor>
+
+#include "util.hpp"
+
+namespace SceneUtil
+{
+
+namespace
+{
+    /// Rows of the per-instance transform, at locations that are not used by anything else.
+    const unsigned int sMatrixAttribLocation = 5;
+    const char* sMatrixAttribNames[3] = { "instanceMatrix0", "instanceMatrix1", "instanceMatrix2" };
+}
+
+InstancedGeometry::InstancedGeometry()
+{
+    setSupportsDisplayList(false);
+}
+
+InstancedGeometry::InstancedGeometry(const InstancedGeometry &copy, const osg::CopyOp &copyop)
+    : osg::Drawable(copy, copyop)
+    , mGeometry(copy.mGeometry)
+{
+    setSupportsDisplayList(false);
+    if (!mGeometry)
+        return;
+    initInstancedGeometry();
+    for (std::vector<Instance>::const_iterator it = copy.mInstances.begin(); it != copy.mInstances.end(); ++it)
+        addInstance(it->mMatrix);
+}
+
+InstancedGeometry::InstancedGeometry(osg::ref_ptr<const osg::Geometry> geometry)
+    : mGeometry(geometry)
+{
+    setSupportsDisplayList(false);
+    initInstancedGeometry();
+}
+
+void InstancedGeometry::initInstancedGeometry()
+{
+    for (unsigned int i=0; i<3; ++i)
+        mMatrixRows[i] = new osg::Vec4Array;
+
+    for (unsigned int frame=0; frame<2; ++frame)
+    {
+        FrameInstances& instances = mFrameInstances[frame];
+        instances.mFrameNumber = ~0u;
+
+        instances.mGeometry = new osg::Geometry(*mGeometry, osg::CopyOp::SHALLOW_COPY);
+        instances.mGeometry->setSupportsDisplayList(false);
+        instances.mGeometry->setUseVertexBufferObjects(true);
+
+        // the primitive sets are shared with the original geometry, so use copies to set the number of instances on
+        osg::Geometry::PrimitiveSetList primitives = instances.mGeometry->getPrimitiveSetList();
+        instances.mGeometry->removePrimitiveSet(0, primitives.size());
+        for (osg::Geometry::PrimitiveSetList::const_iterator it = primitives.begin(); it != primitives.end(); ++it)
+            instances.mGeometry->addPrimitiveSet(osg::clone(it->get(), osg::CopyOp::DEEP_COPY_ALL));
+
+        for (unsigned int i=0; i<3; ++i)
+        {
+            instances.mMatrixRows[i] = new osg::Vec4Array;
+            instances.mGeometry->setVertexAttribArray(sMatrixAttribLocation+i, instances.mMatrixRows[i], osg::Array::BIND_PER_VERTEX);
+        }
+    }
+}
+
+void InstancedGeometry::addInstance(const osg::Matrixf &matrix)
+{
+    const osg::BoundingBox& box = mGeometry->getBoundingBox();
+
+    Instance instance;
+    instance.mMatrix = matrix;
+    instance.mBound = osg::BoundingSphere(box.center(), box.radius());
+    transformBoundingSphere(matrix, instance.mBound);
+    instance.mVisibleFrame = ~0u;
+    mInstances.push_back(instance);
+
+    // osg matrices transform row vectors, so each output component is the dot product with a column
+    for (unsigned int i=0; i<3; ++i)
+        mMatrixRows[i]->push_back(osg::Vec4f(matrix(0,i), matrix(1,i), matrix(2,i), matrix(3,i)));
+
+    dirtyBound();
+}
+
+unsigned int InstancedGeometry::getNumInstances() const
+{
+    return mInstances.size();
+}
+
+osg::Program::AttribBindingList InstancedGeometry::getAttribBindings()
+{
+    osg::Program::AttribBindingList bindings;
+    for (unsigned int i=0; i<3; ++i)
+        bindings[sMatrixAttribNames[i]] = sMatrixAttribLocation+i;
+    return bindings;
+}
+
+osg::BoundingBox InstancedGeometry::computeBoundingBox() const
+{
+    osg::BoundingBox box;
+    for (std::vector<Instance>::const_iterator it = mInstances.begin(); it != mInstances.end(); ++it)
+        box.expandBy(it->mBound);
+    return box;
+}
+
+void InstancedGeometry::accept(osg::NodeVisitor &nv)
+{
+    if (!nv.validNodeMask(*this))
+        return;
+
+    nv.pushOntoNodePath(this);
+
+    if (nv.getVisitorType() == osg::NodeVisitor::CULL_VISITOR)
+        cull(&nv);
+    else
+        nv.apply(*this);
+
+    nv.popFromNodePath();
+}
+
+void InstancedGeometry::cull(osg::NodeVisitor *nv)
+{
+    if (!mGeometry)
+        return;
+
+    osgUtil::CullVisitor* cv = static_cast<osgUtil::CullVisitor*>(nv);
+    if (cv->isCulled(*this))
+        return;
+
+    const unsigned int frameNumber = nv->getTraversalNumber();
+    FrameInstances& instances = mFrameInstances[frameNumber%2];
+
+    // the first camera to cull the drawable in this frame starts over, the others add the instances they see
+    if (instances.mFrameNumber != frameNumber)
+    {
+        instances.mFrameNumber = frameNumber;
+        for (unsigned int i=0; i<3; ++i)
+            instances.mMatrixRows[i]->clear();
+    }
+
+    // the cull visitor's frustum is in the space of this drawable, so the instance bounds can be used as they are
+    bool added = false;
+    for (unsigned int i=0; i<mInstances.size(); ++i)
+    {
+        Instance& instance = mInstances[i];
+        if (instance.mVisibleFrame == frameNumber || cv->isCulled(instance.mBound))
+            continue;
+
+        instance.mVisibleFrame = frameNumber;
+        for (unsigned int j=0; j<3; ++j)
+            instances.mMatrixRows[j]->push_back((*mMatrixRows[j])[i]);
+        added = true;
+    }
+
+    if (added)
+    {
+        for (unsigned int i=0; i<3; ++i)
+            instances.mMatrixRows[i]->dirty();
+        for (unsigned int i=0; i<instances.mGeometry->getNumPrimitiveSets(); ++i)
+            instances.mGeometry->getPrimitiveSet(i)->setNumInstances(instances.mMatrixRows[0]->size());
+    }
+
+    // nothing to draw for this camera, and a primitive set with 0 instances would be drawn once without instancing
+    if (instances.mMatrixRows[0]->empty())
+        return;
+
+    nv->apply(*this);
+}
+
+void InstancedGeometry::drawImplementation(osg::RenderInfo &renderInfo) const
+{
+    if (!mGeometry)
+        return;
+
+    osg::State& state = *renderInfo.getState();
+    const osg::GLExtensions* ext = state.get<osg::GLExtensions>();
+
+    if (ext->glVertexAttribDivisor && ext->glDrawElementsInstanced && ext->glDrawArraysInstanced)
+    {
+        const FrameInstances& instances = mFrameInstances[state.getFrameStamp()->getFrameNumber()%2];
+        if (instances.mFrameNumber != state.getFrameStamp()->getFrameNumber() || instances.mMatrixRows[0]->empty())
+            return;
+
+        for (unsigned int i=0; i<3; ++i)
+            ext->glVertexAttribDivisor(sMatrixAttribLocation+i, 1);
+
+        instances.mGeometry->drawImplementation(renderInfo);
+
+        for (unsigned int i=0; i<3; ++i)
+            ext->glVertexAttribDivisor(sMatrixAttribLocation+i, 0);
+        return;
+    }
+
+    // Without instanced arrays, draw the instances one by one. The original geometry has no attribute arrays at the
+    // matrix locations, so the shader reads the constant values set here.
+    // Cull them like the cull traversal does for nodes, but in the space of this drawable, so the instance bounds can be used as they are.
+    osg::Polytope frustum;
+    frustum.setToUnitFrustum();
+    frustum.transformProvidingInverse(state.getModelViewMatrix() * state.getProjectionMatrix());
+
+    for (unsigned int i=0; i<mInstances.size(); ++i)
+    {
+        if (!frustum.contains(mInstances[i].mBound))
+            continue;
+
+        for (unsigned int j=0; j<3; ++j)
+            ext->glVertexAttrib4fv(sMatrixAttribLocation+j, (*mMatrixRows[j])[i].ptr());
+        mGeometry->drawImplementation(renderInfo);
+    }
+}
+
+void InstancedGeometry::compileGLObjects(osg::RenderInfo &renderInfo) const
+{
+    if (!mGeometry)
+        return;
+    for (unsigned int i=0; i<2; ++i)
+        mFrameInstances[i].mGeometry->compileGLObjects(renderInfo);
+}
+
+void InstancedGeometry::resizeGLObjectBuffers(unsigned int maxSize)
+{
+    osg::Drawable::resizeGLObjectBuffers(maxSize);
+    if (!mGeometry)
+        return;
+    const_cast<osg::Geometry*>(mGeometry.get())->resizeGLObjectBuffers(maxSize);
+    for (unsigned int i=0; i<2; ++i)
+        mFrameInstances[i].mGeometry->resizeGLObjectBuffers(maxSize);
+}
+
+void InstancedGeometry::releaseGLObjects(osg::State *state) const
+{
+    osg::Drawable::releaseGLObjects(state);
+    if (!mGeometry)
+        return;
+    mGeometry->releaseGLObjects(state);
+    for (unsigned int i=0; i<2; ++i)
+        mFrameInstances[i].mGeometry->releaseGLObjects(state);
+}
+
+}
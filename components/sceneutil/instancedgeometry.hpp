@@ -0,0 +1,87 @@
+#ifndef OPENMW_COMPONENTS_SCENEUTIL_INSTANCEDGEOMETRY_H
+#define OPENMW_COMPONENTS_SCENEUTIL_INSTANCEDGEOMETRY_H
+
+#include <vector>
+
+#include <osg/Geometry>
+#include <osg/Matrixf>
+#include <osg/Program>
+
+namespace SceneUtil
+{
+
+    /// @brief Draws a shared Geometry at a list of transforms with a single instanced draw call.
+    /// @par The transforms are passed as per-instance vertex attributes (see getAttribBindings()), so the StateSet of this
+    /// drawable must use a shader program that applies them, e.g. the objects shader with \@instancing enabled.
+    /// Compared to merging copies of the geometry, this saves memory, and compared to a drawable per instance,
+    /// it saves the cost of traversing, sorting and drawing them one by one.
+    /// @par The instances are still culled one by one in the cull traversal, and only the visible ones are drawn. Their
+    /// transforms are gathered in an array per frame, so that the draw traversal of the previous frame can still use its own.
+    /// If the drawable is culled by several cameras in a frame, the instances visible to any of them are drawn.
+    /// @note If the driver does not support instanced arrays, the instances are drawn one by one with their transform
+    /// set as a constant attribute instead, and culled against the view frustum separately.
+    /// @note The instances must not be changed once the drawable is in use.
+    class InstancedGeometry : public osg::Drawable
+    {
+    public:
+        InstancedGeometry();
+        InstancedGeometry(const InstancedGeometry& copy, const osg::CopyOp& copyop);
+
+        META_Object(SceneUtil, InstancedGeometry)
+
+        /// @param geometry The geometry to draw. Its StateSet is ignored, use the StateSet of this drawable instead.
+        /// @note The geometry will not be modified.
+        InstancedGeometry(osg::ref_ptr<const osg::Geometry> geometry);
+
+        void addInstance(const osg::Matrixf& matrix);
+
+        unsigned int getNumInstances() const;
+
+        /// The vertex attributes holding the rows of the per-instance transform, to be bound in the shader program.
+        static osg::Program::AttribBindingList getAttribBindings();
+
+        virtual void accept(osg::NodeVisitor& nv);
+
+        virtual osg::BoundingBox computeBoundingBox() const;
+
+        virtual void drawImplementation(osg::RenderInfo& renderInfo) const;
+
+        virtual void compileGLObjects(osg::RenderInfo& renderInfo) const;
+
+        virtual void resizeGLObjectBuffers(unsigned int maxSize);
+
+        virtual void releaseGLObjects(osg::State* state=0) const;
+
+    private:
+        osg::ref_ptr<const osg::Geometry> mGeometry;
+
+        /// The rows of the transforms of all instances.
+        osg::ref_ptr<osg::Vec4Array> mMatrixRows[3];
+
+        struct Instance
+        {
+            osg::Matrixf mMatrix;
+            osg::BoundingSphere mBound;
+            /// The last frame the instance was found to be visible in.
+            unsigned int mVisibleFrame;
+        };
+        std::vector<Instance> mInstances;
+
+        /// The instances visible in a frame.
+        struct FrameInstances
+        {
+            /// Shares the arrays of mGeometry, with the per-instance attributes added and its primitive sets drawn for every instance.
+            osg::ref_ptr<osg::Geometry> mGeometry;
+            osg::ref_ptr<osg::Vec4Array> mMatrixRows[3];
+            unsigned int mFrameNumber;
+        };
+        FrameInstances mFrameInstances[2];
+
+        void initInstancedGeometry();
+
+        void cull(osg::NodeVisitor* nv);
+    };
+
+}
+
+#endif
@@ -0,0 +1,410 @@
+#include "jobsystem.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <osg/Stats>
+
+namespace SceneUtil
+{
+
+Job::Job()
+    : mGroup(NULL)
+{
+}
+
+JobGroup::JobGroup()
+{
+}
+
+bool JobGroup::isDone() const
+{
+    return (mPending == 0);
+}
+
+/// A range of a parallel loop, which is split in half as long as it is larger than the grain size.
+class RangeJob : public Job
+{
+public:
+    RangeJob(JobSystem& jobSystem, JobGroup& group, const std::function<void(unsigned int, unsigned int)>& func,
+             unsigned int begin, unsigned int end, unsigned int grainSize)
+        : mJobSystem(jobSystem)
+        , mJobGroup(group)
+        , mFunc(func)
+        , mBegin(begin)
+        , mEnd(end)
+        , mGrainSize(grainSize)
+    {
+    }
+
+    virtual void run()
+    {
+        // keep the first half, so that the thread works through the loop in order while others steal the large ranges
+        while (mEnd - mBegin > mGrainSize)
+        {
+            unsigned int middle = mBegin + (mEnd - mBegin) / 2;
+            mJobSystem.submit(new RangeJob(mJobSystem, mJobGroup, mFunc, middle, mEnd, mGrainSize), mJobGroup);
+            mEnd = middle;
+        }
+        mFunc(mBegin, mEnd);
+    }
+
+private:
+    JobSystem& mJobSystem;
+    JobGroup& mJobGroup;
+    const std::function<void(unsigned int, unsigned int)>& mFunc;
+    unsigned int mBegin;
+    unsigned int mEnd;
+    unsigned int mGrainSize;
+};
+
+JobSystem::Queue::Queue()
+    : mNumRun(0)
+    , mNumStolen(0)
+    , mBusyTicks(0)
+{
+}
+
+JobSystem::JobSystem(unsigned int numThreads)
+    : mIsReleased(false)
+    , mWaitTime(0.0)
+{
+    // the first queue is shared by the threads that are not part of the system
+    for (unsigned int i=0; i<numThreads+1; ++i)
+        mQueues.push_back(new Queue);
+
+    for (unsigned int i=0; i<numThreads; ++i)
+    {
+        JobThread* thread = new JobThread(this, i+1);
+        mThreads.push_back(thread);
+        thread->startThread();
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+        mIsReleased = true;
+        mCondition.broadcast();
+    }
+
+    for (unsigned int i=0; i<mThreads.size(); ++i)
+    {
+        mThreads[i]->join();
+        delete mThreads[i];
+    }
+
+    for (unsigned int i=0; i<mQueues.size(); ++i)
+        delete mQueues[i];
+}
+
+unsigned int JobSystem::getNumThreads() const
+{
+    return mThreads.size() + 1;
+}
+
+unsigned int JobSystem::getQueueIndex() const
+{
+    JobThread* thread = dynamic_cast<JobThread*>(OpenThreads::Thread::CurrentThread());
+    if (thread && thread->getJobSystem() == this)
+        return thread->getIndex();
+    return 0;
+}
+
+void JobSystem::submit(Job *job, JobGroup &group)
+{
+    job->mGroup = &group;
+    ++group.mPending;
+
+    Queue& queue = *mQueues[getQueueIndex()];
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(queue.mMutex);
+        queue.mJobs.push_back(job);
+        ++mNumQueued;
+    }
+
+    if (mNumSleeping > 0)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+        mCondition.broadcast();
+    }
+}
+
+osg::ref_ptr<Job> JobSystem::findJob(unsigned int index, bool& stolen)
+{
+    osg::ref_ptr<Job> job;
+    stolen = false;
+
+    {
+        Queue& queue = *mQueues[index];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(queue.mMutex);
+        if (!queue.mJobs.empty())
+        {
+            job = queue.mJobs.back();
+            queue.mJobs.pop_back();
+            --mNumQueued;
+            return job;
+        }
+    }
+
+    if (mNumQueued == 0)
+        return job;
+
+    // start with a different victim every time, so that thieves don't all fight over the same queue
+    unsigned int numQueues = mQueues.size();
+    unsigned int start = (++mNextVictim) % numQueues;
+    for (unsigned int i=0; i<numQueues; ++i)
+    {
+        unsigned int victim = (start + i) % numQueues;
+        if (victim == index)
+            continue;
+
+        Queue& queue = *mQueues[victim];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(queue.mMutex);
+        if (!queue.mJobs.empty())
+        {
+            job = queue.mJobs.front();
+            queue.mJobs.pop_front();
+            --mNumQueued;
+            stolen = true;
+            return job;
+        }
+    }
+    return job;
+}
+
+void JobSystem::runJob(Job *job, unsigned int index, bool stolen)
+{
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+    try
+    {
+        job->run();
+    }
+    catch (...)
+    {
+        JobGroup& group = *job->mGroup;
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(group.mErrorMutex);
+        if (!group.mError)
+            group.mError = std::current_exception();
+    }
+    osg::Timer_t endTick = osg::Timer::instance()->tick();
+
+    {
+        Queue& queue = *mQueues[index];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(queue.mMutex);
+        ++queue.mNumRun;
+        if (stolen)
+            ++queue.mNumStolen;
+        queue.mBusyTicks += endTick - startTick;
+    }
+
+    // the group may be destroyed as soon as its last job is done
+    if ((--job->mGroup->mPending) == 0 && mNumSleeping > 0)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+        mCondition.broadcast();
+    }
+}
+
+bool JobSystem::sleep(const JobGroup *group)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+    ++mNumSleeping;
+    while (!mIsReleased && mNumQueued == 0 && !(group && group->isDone()))
+        mCondition.wait(&mMutex);
+    --mNumSleeping;
+    return !mIsReleased;
+}
+
+void JobSystem::wait(JobGroup &group)
+{
+    unsigned int index = getQueueIndex();
+    while (!group.isDone())
+    {
+        bool stolen;
+        osg::ref_ptr<Job> job = findJob(index, stolen);
+        if (job)
+        {
+            runJob(job, index, stolen);
+            continue;
+        }
+
+        // the remaining jobs of the group are running on other threads
+        osg::Timer_t startTick = osg::Timer::instance()->tick();
+        sleep(&group);
+        double waitTime = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mStatsMutex);
+        mWaitTime += waitTime;
+    }
+
+    // all jobs are done, so nothing else touches the group anymore
+    if (group.mError)
+    {
+        std::exception_ptr error = group.mError;
+        group.mError = std::exception_ptr();
+        std::rethrow_exception(error);
+    }
+}
+
+void JobSystem::runThread(unsigned int index)
+{
+    while (true)
+    {
+        bool stolen;
+        osg::ref_ptr<Job> job = findJob(index, stolen);
+        if (job)
+            runJob(job, index, stolen);
+        else if (!sleep(NULL))
+            return;
+    }
+}
+
+void JobSystem::parallelFor(unsigned int count, const std::function<void (unsigned int, unsigned int)> &func, unsigned int grainSize)
+{
+    grainSize = std::max(1u, grainSize);
+    if (count <= grainSize || mThreads.empty())
+    {
+        if (count > 0)
+            func(0, count);
+        return;
+    }
+
+    JobGroup group;
+    submit(new RangeJob(*this, group, func, 0, count, grainSize), group);
+    wait(group);
+}
+
+void JobSystem::reportStats(unsigned int frameNumber, osg::Stats *stats) const
+{
+    unsigned int numRun = 0;
+    unsigned int numStolen = 0;
+    osg::Timer_t busyTicks = 0;
+    for (unsigned int i=0; i<mQueues.size(); ++i)
+    {
+        Queue& queue = *mQueues[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(queue.mMutex);
+        numRun += queue.mNumRun;
+        numStolen += queue.mNumStolen;
+        busyTicks += queue.mBusyTicks;
+        queue.mNumRun = 0;
+        queue.mNumStolen = 0;
+        queue.mBusyTicks = 0;
+    }
+
+    stats->setAttribute(frameNumber, "Jobs", numRun);
+    stats->setAttribute(frameNumber, "Job Steals", numStolen);
+    stats->setAttribute(frameNumber, "Job ms", osg::Timer::instance()->delta_m(0, busyTicks));
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mStatsMutex);
+    stats->setAttribute(frameNumber, "Job Wait ms", mWaitTime * 1000.0);
+    mWaitTime = 0.0;
+}
+
+/// Runs a task of a JobGraph, then starts the tasks that were only waiting for it.
+class GraphJob : public Job
+{
+public:
+    GraphJob(JobSystem& jobSystem, JobGroup& group, JobGraph& graph, unsigned int node)
+        : mJobSystem(jobSystem)
+        , mJobGroup(group)
+        , mGraph(graph)
+        , mNode(node)
+    {
+    }
+
+    virtual void run()
+    {
+        // if the task throws, the tasks depending on it are never started
+        JobGraph::Node& node = *mGraph.mNodes[mNode];
+        node.mTask();
+
+        for (std::vector<unsigned int>::const_iterator it = node.mDependents.begin(); it != node.mDependents.end(); ++it)
+        {
+            if ((--mGraph.mNodes[*it]->mRemaining) == 0)
+                mJobSystem.submit(new GraphJob(mJobSystem, mJobGroup, mGraph, *it), mJobGroup);
+        }
+    }
+
+private:
+    JobSystem& mJobSystem;
+    JobGroup& mJobGroup;
+    JobGraph& mGraph;
+    unsigned int mNode;
+};
+
+unsigned int JobGraph::addTask(const Task &task)
+{
+    osg::ref_ptr<Node> node (new Node);
+    node->mTask = task;
+    node->mNumDependencies = 0;
+    mNodes.push_back(node);
+    return mNodes.size()-1;
+}
+
+void JobGraph::addDependency(unsigned int task, unsigned int dependency)
+{
+    mNodes[dependency]->mDependents.push_back(task);
+    ++mNodes[task]->mNumDependencies;
+}
+
+void JobGraph::run(JobSystem &jobSystem)
+{
+    // check that every task can be reached from the tasks without dependencies, as a cycle would never finish
+    std::vector<unsigned int> remaining;
+    std::vector<unsigned int> ready;
+    for (unsigned int i=0; i<mNodes.size(); ++i)
+    {
+        remaining.push_back(mNodes[i]->mNumDependencies);
+        if (remaining.back() == 0)
+            ready.push_back(i);
+    }
+    std::vector<unsigned int> roots = ready;
+    unsigned int numReachable = 0;
+    while (!ready.empty())
+    {
+        unsigned int index = ready.back();
+        ready.pop_back();
+        ++numReachable;
+        const std::vector<unsigned int>& dependents = mNodes[index]->mDependents;
+        for (std::vector<unsigned int>::const_iterator it = dependents.begin(); it != dependents.end(); ++it)
+        {
+            if (--remaining[*it] == 0)
+                ready.push_back(*it);
+        }
+    }
+    if (numReachable != mNodes.size())
+        throw std::runtime_error("Job graph has cyclic dependencies");
+
+    for (unsigned int i=0; i<mNodes.size(); ++i)
+        mNodes[i]->mRemaining.exchange(mNodes[i]->mNumDependencies);
+
+    JobGroup group;
+    for (std::vector<unsigned int>::const_iterator it = roots.begin(); it != roots.end(); ++it)
+        jobSystem.submit(new GraphJob(jobSystem, group, *this, *it), group);
+    jobSystem.wait(group);
+}
+
+JobThread::JobThread(JobSystem *jobSystem, unsigned int index)
+    : mJobSystem(jobSystem)
+    , mIndex(index)
+{
+}
+
+void JobThread::run()
+{
+    mJobSystem->runThread(mIndex);
+}
+
+JobSystem* JobThread::getJobSystem() const
+{
+    return mJobSystem;
+}
+
+unsigned int JobThread::getIndex() const
+{
+    return mIndex;
+}
+
+}
@@ -0,0 +1,187 @@
+#ifndef OPENMW_COMPONENTS_SCENEUTIL_JOBSYSTEM_H
+#define OPENMW_COMPONENTS_SCENEUTIL_JOBSYSTEM_H
+
+#include <OpenThreads/Atomic>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/Condition>
+#include <OpenThreads/Thread>
+
+#include <osg/Referenced>
+#include <osg/ref_ptr>
+#include <osg/Timer>
+
+#include <deque>
+#include <exception>
+#include <functional>
+#include <vector>
+
+namespace osg
+{
+    class Stats;
+}
+
+namespace SceneUtil
+{
+
+    class JobGroup;
+
+    /// @brief A small piece of work run by a JobSystem, e.g. a part of a parallel loop.
+    /// @par Unlike a WorkItem, a job is meant to be waited for within the same frame, by a thread that helps running jobs meanwhile.
+    class Job : public osg::Referenced
+    {
+    public:
+        Job();
+
+        virtual void run() = 0;
+
+    private:
+        friend class JobSystem;
+        JobGroup* mGroup;
+    };
+
+    /// @brief Jobs that are waited for together, see JobSystem::wait().
+    class JobGroup
+    {
+    public:
+        JobGroup();
+
+        bool isDone() const;
+
+    private:
+        friend class JobSystem;
+        OpenThreads::Atomic mPending;
+
+        /// The first exception thrown by a job of the group, rethrown by JobSystem::wait().
+        std::exception_ptr mError;
+        OpenThreads::Mutex mErrorMutex;
+    };
+
+    class JobThread;
+
+    /// @brief Runs short jobs on a fixed set of threads, so that the work of a frame can be spread over several cores.
+    /// @par Each thread keeps the jobs it creates in a queue of its own and runs the newest first, which keeps nested work on
+    /// the same core. Threads that run out of work steal the oldest jobs of other threads, which are usually the largest.
+    /// Threads that are not part of the system, such as the main thread, share a queue, and help running jobs while they wait.
+    /// @note Jobs must not wait for anything other than jobs, as the threads waiting for them run other jobs in the meantime.
+    class JobSystem : public osg::Referenced
+    {
+    public:
+        /// @param numThreads Threads to create in addition to the threads waiting for jobs. With none, jobs run on the waiting threads.
+        JobSystem(unsigned int numThreads);
+        ~JobSystem();
+
+        /// Get the number of threads that can run jobs at the same time, including the thread waiting for them.
+        unsigned int getNumThreads() const;
+
+        /// Add \a job to the queue of the calling thread, as part of \a group.
+        /// @note Thread safe.
+        void submit(Job* job, JobGroup& group);
+
+        /// Run jobs until the jobs of \a group are done, including the jobs they submitted to the same group.
+        /// @note Thread safe. If a job of the group threw an exception, the first one is rethrown once all jobs are done.
+        void wait(JobGroup& group);
+
+        /// Call \a func with the ranges [begin, end) that [0, count) is split into, in parallel, and wait for them to finish.
+        /// @param grainSize The number of elements below which a range isn't split any further.
+        /// @note If \a func throws, the other ranges still run, and the first exception is rethrown afterwards.
+        void parallelFor(unsigned int count, const std::function<void(unsigned int begin, unsigned int end)>& func, unsigned int grainSize=1);
+
+        /// Report the jobs run since the last report, how long they took in total, and how long threads waited for them.
+        void reportStats(unsigned int frameNumber, osg::Stats* stats) const;
+
+        /// Internally used by JobThread.
+        void runThread(unsigned int index);
+
+    private:
+        /// The jobs of one thread, or of all threads that are not part of the system.
+        struct Queue
+        {
+            Queue();
+
+            OpenThreads::Mutex mMutex;
+            std::deque<osg::ref_ptr<Job> > mJobs;
+
+            unsigned int mNumRun;
+            unsigned int mNumStolen;
+            osg::Timer_t mBusyTicks;
+        };
+
+        /// Get the queue of the calling thread.
+        unsigned int getQueueIndex() const;
+
+        /// Take the newest job of queue \a index, or else steal the oldest job of another queue.
+        /// @return NULL if all queues are empty.
+        osg::ref_ptr<Job> findJob(unsigned int index, bool& stolen);
+
+        void runJob(Job* job, unsigned int index, bool stolen);
+
+        /// Block until there are jobs to take, or \a group is done.
+        /// @return false if the system is being destroyed.
+        bool sleep(const JobGroup* group);
+
+        std::vector<Queue*> mQueues;
+        std::vector<JobThread*> mThreads;
+
+        /// The number of jobs in all queues.
+        OpenThreads::Atomic mNumQueued;
+        OpenThreads::Atomic mNumSleeping;
+        OpenThreads::Atomic mNextVictim;
+
+        OpenThreads::Mutex mMutex;
+        OpenThreads::Condition mCondition;
+        bool mIsReleased;
+
+        mutable OpenThreads::Mutex mStatsMutex;
+        mutable double mWaitTime;
+    };
+
+    /// @brief Tasks with dependencies between them, run in parallel as far as the dependencies allow.
+    class JobGraph
+    {
+    public:
+        typedef std::function<void()> Task;
+
+        /// @return The index of the task, to refer to it in addDependency().
+        unsigned int addTask(const Task& task);
+
+        /// Have \a task start only after \a dependency is done.
+        void addDependency(unsigned int task, unsigned int dependency);
+
+        /// Run the tasks and wait for them to finish. The graph can be run again afterwards.
+        /// @note Throws std::runtime_error if the dependencies form a cycle. If a task throws, the tasks depending on it
+        /// are skipped, and the first exception is rethrown once the other tasks are done.
+        void run(JobSystem& jobSystem);
+
+    private:
+        struct Node : public osg::Referenced
+        {
+            Task mTask;
+            std::vector<unsigned int> mDependents;
+            unsigned int mNumDependencies;
+            OpenThreads::Atomic mRemaining;
+        };
+
+        friend class GraphJob;
+
+        std::vector<osg::ref_ptr<Node> > mNodes;
+    };
+
+    /// Internally used by JobSystem.
+    class JobThread : public OpenThreads::Thread
+    {
+    public:
+        JobThread(JobSystem* jobSystem, unsigned int index);
+
+        virtual void run();
+
+        JobSystem* getJobSystem() const;
+        unsigned int getIndex() const;
+
+    private:
+        JobSystem* mJobSystem;
+        unsigned int mIndex;
+    };
+
+}
+
+#endif
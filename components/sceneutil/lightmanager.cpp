@@ -1,5 +1,8 @@
 #include "lightmanager.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 #include <osgUtil/CullVisitor>
 
 #include <components/sceneutil/util.hpp>
@@ -189,6 +192,7 @@ namespace SceneUtil
     {
         mLights.clear();
         mLightsInViewSpace.clear();
+        mLightGrids.clear();
 
         // do an occasional cleanup for orphaned lights
         for (int i=0; i<2; ++i)
@@ -288,6 +292,140 @@ namespace SceneUtil
         return it->second;
     }
 
+    void LightManager::getLightsIntersecting(osg::Camera* camera, const osg::RefMatrix* viewMatrix, const osg::BoundingSphere& viewBound, LightList& lightList)
+    {
+        const LightSourceViewBoundCollection& lights = getLightsInViewSpace(camera, viewMatrix);
+
+        lightList.clear();
+
+        // not worth building a grid for
+        static const unsigned int minGridLights = 8;
+        if (lights.size() <= minGridLights)
+        {
+            for (unsigned int i=0; i<lights.size(); ++i)
+            {
+                if (lights[i].mViewBound.intersects(viewBound))
+                    lightList.push_back(&lights[i]);
+            }
+            return;
+        }
+
+        osg::observer_ptr<osg::Camera> camPtr (camera);
+        std::map<osg::observer_ptr<osg::Camera>, LightGrid>::iterator it = mLightGrids.find(camPtr);
+        if (it == mLightGrids.end())
+        {
+            it = mLightGrids.insert(std::make_pair(camPtr, LightGrid())).first;
+            it->second.build(lights);
+        }
+        LightGrid& grid = it->second;
+
+        int first[3], last[3];
+        if (!grid.getCellRange(viewBound, first, last))
+            return;
+
+        ++grid.mQuery;
+        for (int z=first[2]; z<=last[2]; ++z)
+            for (int y=first[1]; y<=last[1]; ++y)
+                for (int x=first[0]; x<=last[0]; ++x)
+                {
+                    int cell = (z * grid.mSize[1] + y) * grid.mSize[0] + x;
+                    for (unsigned int i=grid.mCellStart[cell]; i<grid.mCellStart[cell+1]; ++i)
+                    {
+                        unsigned int index = grid.mIndices[i];
+                        if (grid.mVisited[index] == grid.mQuery)
+                            continue;
+                        grid.mVisited[index] = grid.mQuery;
+
+                        if (lights[index].mViewBound.intersects(viewBound))
+                            lightList.push_back(&lights[index]);
+                    }
+                }
+
+        // restore the order of the light collection, the StateSet cache depends on it
+        std::sort(lightList.begin(), lightList.end());
+    }
+
+    void LightManager::LightGrid::build(const LightSourceViewBoundCollection& lights)
+    {
+        mQuery = 0;
+        mVisited.assign(lights.size(), 0);
+
+        osg::BoundingBox box;
+        float radiusSum = 0.f;
+        for (LightSourceViewBoundCollection::const_iterator it = lights.begin(); it != lights.end(); ++it)
+        {
+            box.expandBy(it->mViewBound);
+            radiusSum += it->mViewBound.radius();
+        }
+
+        // cells about the size of a light, but limit the memory used for far spread out lights
+        static const int maxCells = 4096;
+        float cellSize = std::max(2.f * radiusSum / lights.size(), 1.f);
+        int numCells = 0;
+        while (true)
+        {
+            numCells = 1;
+            for (int i=0; i<3; ++i)
+            {
+                mSize[i] = std::max(1, static_cast<int>(std::ceil((box._max[i] - box._min[i]) / cellSize)));
+                numCells *= mSize[i];
+            }
+            if (numCells <= maxCells)
+                break;
+            cellSize *= 2.f;
+        }
+        mOrigin = box._min;
+        mInvCellSize = 1.f / cellSize;
+
+        // count the lights per cell, then fill in the light indices
+        mCellStart.assign(numCells + 1, 0);
+        int first[3], last[3];
+        for (unsigned int pass=0; pass<2; ++pass)
+        {
+            std::vector<unsigned int> cursor;
+            if (pass == 1)
+            {
+                for (int i=0; i<numCells; ++i)
+                    mCellStart[i+1] += mCellStart[i];
+                mIndices.resize(mCellStart[numCells]);
+                cursor.assign(mCellStart.begin(), mCellStart.end() - 1);
+            }
+
+            for (unsigned int index=0; index<lights.size(); ++index)
+            {
+                if (!getCellRange(lights[index].mViewBound, first, last))
+                    continue;
+                for (int z=first[2]; z<=last[2]; ++z)
+                    for (int y=first[1]; y<=last[1]; ++y)
+                        for (int x=first[0]; x<=last[0]; ++x)
+                        {
+                            int cell = (z * mSize[1] + y) * mSize[0] + x;
+                            if (pass == 0)
+                                ++mCellStart[cell+1];
+                            else
+                                mIndices[cursor[cell]++] = index;
+                        }
+            }
+        }
+    }
+
+    bool LightManager::LightGrid::getCellRange(const osg::BoundingSphere& bound, int* first, int* last) const
+    {
+        if (!bound.valid())
+            return false;
+
+        for (int i=0; i<3; ++i)
+        {
+            first[i] = static_cast<int>(std::floor((bound.center()[i] - bound.radius() - mOrigin[i]) * mInvCellSize));
+            last[i] = static_cast<int>(std::floor((bound.center()[i] + bound.radius() - mOrigin[i]) * mInvCellSize));
+            if (last[i] < 0 || first[i] >= mSize[i])
+                return false;
+            first[i] = std::max(first[i], 0);
+            last[i] = std::min(last[i], mSize[i]-1);
+        }
+        return true;
+    }
+
     class DisableLight : public osg::StateAttribute
     {
     public:
@@ -404,8 +542,6 @@ namespace SceneUtil
 
         // Possible optimizations:
         // - cull list of lights by the camera frustum
-        // - organize lights in a quad tree
-
 
         // update light list if necessary
         // makes sure we don't update it more than once per frame when rendering with multiple cameras
@@ -415,7 +551,6 @@ namespace SceneUtil
 
             // Don't use Camera::getViewMatrix, that one might be relative to another camera!
             const osg::RefMatrix* viewMatrix = cv->getCurrentRenderStage()->getInitialViewMatrix();
-            const std::vector<LightManager::LightSourceViewBound>& lights = mLightManager->getLightsInViewSpace(cv->getCurrentCamera(), viewMatrix);
 
             // get the node bounds in view space
             // NB do not node->getBound() * modelView, that would apply the node's transformation twice
@@ -431,16 +566,17 @@ namespace SceneUtil
             osg::Matrixf mat = *cv->getModelViewMatrix();
             transformBoundingSphere(mat, nodeBound);
 
-            mLightList.clear();
-            for (unsigned int i=0; i<lights.size(); ++i)
-            {
-                const LightManager::LightSourceViewBound& l = lights[i];
-
-                if (mIgnoredLightSources.count(l.mLightSource))
-                    continue;
+            mLightManager->getLightsIntersecting(cv->getCurrentCamera(), viewMatrix, nodeBound, mLightList);
 
-                if (l.mViewBound.intersects(nodeBound))
-                    mLightList.push_back(&l);
+            if (!mIgnoredLightSources.empty())
+            {
+                for (LightManager::LightList::iterator it = mLightList.begin(); it != mLightList.end(); )
+                {
+                    if (mIgnoredLightSources.count((*it)->mLightSource))
+                        it = mLightList.erase(it);
+                    else
+                        ++it;
+                }
             }
         }
         if (!mLightList.empty())
@@ -476,10 +612,10 @@ namespace SceneUtil
                     while (lightList.size() > maxLights)
                         lightList.pop_back();
                 }
-                stateset = mLightManager->getLightListStateSet(lightList, cv->getTraversalNumber());
+                stateset = getLightListStateSet(lightList, cv->getTraversalNumber());
             }
             else
-                stateset = mLightManager->getLightListStateSet(mLightList, cv->getTraversalNumber());
+                stateset = getLightListStateSet(mLightList, cv->getTraversalNumber());
 
 
             cv->pushStateSet(stateset);
@@ -488,4 +624,19 @@ namespace SceneUtil
         return false;
     }
 
+    osg::StateSet* LightListCallback::getLightListStateSet(const LightManager::LightList& lightList, unsigned int frameNum)
+    {
+        mLightIds.clear();
+        for (unsigned int i=0; i<lightList.size(); ++i)
+            mLightIds.push_back(lightList[i]->mLightSource->getId());
+
+        unsigned int index = frameNum%2;
+        if (!mLastStateSet[index] || mLightIds != mLastLightIds[index])
+        {
+            mLastStateSet[index] = mLightManager->getLightListStateSet(lightList, frameNum);
+            mLastLightIds[index] = mLightIds;
+        }
+        return mLastStateSet[index];
+    }
+
 }
@@ -127,6 +127,11 @@ namespace SceneUtil
 
         typedef std::vector<const LightSourceViewBound*> LightList;
 
+        /// Collect the lights of getLightsInViewSpace() whose bounds intersect the given view space bound, in the same order.
+        /// @note Uses a grid of light clusters that is built once per camera and frame, so only the lights near
+        /// \a viewBound need to be tested.
+        void getLightsIntersecting(osg::Camera* camera, const osg::RefMatrix* viewMatrix, const osg::BoundingSphere& viewBound, LightList& lightList);
+
         osg::ref_ptr<osg::StateSet> getLightListStateSet(const LightList& lightList, unsigned int frameNum);
 
     private:
@@ -136,6 +141,29 @@ namespace SceneUtil
         typedef std::vector<LightSourceViewBound> LightSourceViewBoundCollection;
         std::map<osg::observer_ptr<osg::Camera>, LightSourceViewBoundCollection> mLightsInViewSpace;
 
+        /// Uniform grid in view space, each cell referring to the lights overlapping it.
+        struct LightGrid
+        {
+            osg::Vec3f mOrigin;
+            float mInvCellSize;
+            int mSize[3];
+
+            /// Light indices of cell i are mIndices[mCellStart[i]] to mIndices[mCellStart[i+1]].
+            std::vector<unsigned int> mCellStart;
+            std::vector<unsigned int> mIndices;
+
+            /// Per light, the query that last visited it. Avoids adding lights spanning several cells more than once.
+            std::vector<unsigned int> mVisited;
+            unsigned int mQuery;
+
+            void build(const LightSourceViewBoundCollection& lights);
+
+            /// Get the range of cells overlapped by \a bound, clamped to the grid.
+            /// @return false if \a bound does not overlap the grid at all.
+            bool getCellRange(const osg::BoundingSphere& bound, int* first, int* last) const;
+        };
+        std::map<osg::observer_ptr<osg::Camera>, LightGrid> mLightGrids;
+
         // < Light list hash , StateSet >
         typedef std::map<size_t, osg::ref_ptr<osg::StateSet> > LightStateSetMap;
         LightStateSetMap mStateSetCache[2];
@@ -177,10 +205,18 @@ namespace SceneUtil
         std::set<SceneUtil::LightSource*>& getIgnoredLightSources() { return mIgnoredLightSources; }
 
     private:
+        osg::StateSet* getLightListStateSet(const LightManager::LightList& lightList, unsigned int frameNum);
+
         LightManager* mLightManager;
         unsigned int mLastFrameNumber;
         LightManager::LightList mLightList;
         std::set<SceneUtil::LightSource*> mIgnoredLightSources;
+
+        // The StateSet pushed in the last frame of each parity and the lights it was made for.
+        // Lets us skip the StateSet cache lookup while the light list of a node does not change.
+        osg::ref_ptr<osg::StateSet> mLastStateSet[2];
+        std::vector<int> mLastLightIds[2];
+        std::vector<int> mLightIds;
     };
 
 }
@@ -5,8 +5,39 @@
 namespace SceneUtil
 {
 
+class MorphGeometry::MorphWorkItem : public WorkItem
+{
+public:
+    MorphWorkItem(MorphGeometry* morphGeometry, osg::Geometry* geom)
+        : mMorphGeometry(morphGeometry)
+        , mGeometry(geom)
+    {
+    }
+
+    virtual void doWork()
+    {
+        mMorphGeometry->morph(*mGeometry);
+
+        // release our reference to avoid a cycle with MorphGeometry::mMorphItem
+        mMorphGeometry = NULL;
+        mGeometry = NULL;
+    }
+
+private:
+    osg::ref_ptr<MorphGeometry> mMorphGeometry;
+    osg::ref_ptr<osg::Geometry> mGeometry;
+};
+
+osg::ref_ptr<WorkQueue> MorphGeometry::sWorkQueue;
+
+void MorphGeometry::setWorkQueue(osg::ref_ptr<WorkQueue> workQueue)
+{
+    sWorkQueue = workQueue;
+}
+
 MorphGeometry::MorphGeometry()
-    : mLastFrameNumber(0)
+    : mMorphFrame(0)
+    , mLastFrameNumber(0)
     , mDirty(true)
     , mMorphedBoundingBox(false)
 {
@@ -16,6 +47,7 @@ MorphGeometry::MorphGeometry()
 MorphGeometry::MorphGeometry(const MorphGeometry &copy, const osg::CopyOp &copyop)
     : osg::Drawable(copy, copyop)
     , mMorphTargets(copy.mMorphTargets)
+    , mMorphFrame(0)
     , mLastFrameNumber(0)
     , mDirty(true)
     , mMorphedBoundingBox(false)
@@ -79,6 +111,8 @@ void MorphGeometry::accept(osg::NodeVisitor &nv)
 
     if (nv.getVisitorType() == osg::NodeVisitor::CULL_VISITOR)
         cull(&nv);
+    else if (nv.getVisitorType() == osg::NodeVisitor::UPDATE_VISITOR)
+        update(&nv);
     else
         nv.apply(*this);
 
@@ -143,21 +177,34 @@ osg::BoundingBox MorphGeometry::computeBoundingBox() const
     }
 }
 
-void MorphGeometry::cull(osg::NodeVisitor *nv)
+void MorphGeometry::update(osg::NodeVisitor *nv)
 {
-    if (mLastFrameNumber == nv->getTraversalNumber() || !mDirty)
+    // morphing from the previous frame may still be reading the morph targets
+    waitForMorphing();
+
+    nv->apply(*this);
+
+    // Start morphing right away if we were drawn in the previous frame, as we will most likely be drawn in this frame too.
+    // The morph target weights have been updated by our update callback.
+    if (sWorkQueue && mDirty && mLastFrameNumber != 0 && mLastFrameNumber+1 >= nv->getTraversalNumber())
     {
-        osg::Geometry& geom = *getGeometry(mLastFrameNumber);
-        nv->pushOntoNodePath(&geom);
-        nv->apply(geom);
-        nv->popFromNodePath();
-        return;
+        mMorphFrame = nv->getTraversalNumber();
+        mMorphItem = new MorphWorkItem(this, getGeometry(mMorphFrame));
+        sWorkQueue->addWorkItem(mMorphItem);
     }
+}
 
-    mDirty = false;
-    mLastFrameNumber = nv->getTraversalNumber();
-    osg::Geometry& geom = *getGeometry(mLastFrameNumber);
+void MorphGeometry::waitForMorphing()
+{
+    if (mMorphItem)
+    {
+        mMorphItem->waitTillDone();
+        mMorphItem = NULL;
+    }
+}
 
+void MorphGeometry::morph(osg::Geometry& geom)
+{
     const osg::Vec3Array* positionSrc = static_cast<osg::Vec3Array*>(mSourceGeometry->getVertexArray());
     osg::Vec3Array* positionDst = static_cast<osg::Vec3Array*>(geom.getVertexArray());
     assert(positionSrc->size() == positionDst->size());
@@ -173,8 +220,32 @@ void MorphGeometry::cull(osg::NodeVisitor *nv)
         for (unsigned int vertex=0; vertex<positionSrc->size(); ++vertex)
             (*positionDst)[vertex] += (*offsets)[vertex] * weight;
     }
+}
+
+void MorphGeometry::cull(osg::NodeVisitor *nv)
+{
+    // if morphing for this frame was started in the update traversal, we only have to wait for it
+    bool morphed = mMorphItem && mMorphFrame == nv->getTraversalNumber();
+
+    if (!morphed && (mLastFrameNumber == nv->getTraversalNumber() || !mDirty))
+    {
+        osg::Geometry& geom = *getGeometry(mLastFrameNumber);
+        nv->pushOntoNodePath(&geom);
+        nv->apply(geom);
+        nv->popFromNodePath();
+        return;
+    }
+
+    waitForMorphing();
+
+    mDirty = false;
+    mLastFrameNumber = nv->getTraversalNumber();
+    osg::Geometry& geom = *getGeometry(mLastFrameNumber);
+
+    if (!morphed)
+        morph(geom);
 
-    positionDst->dirty();
+    geom.getVertexArray()->dirty();
 
     nv->pushOntoNodePath(&geom);
     nv->apply(geom);
@@ -3,6 +3,8 @@
 
 #include <osg/Geometry>
 
+#include "workqueue.hpp"
+
 namespace SceneUtil
 {
 
@@ -65,8 +67,27 @@ namespace SceneUtil
 
         virtual osg::BoundingBox computeBoundingBox() const;
 
+        /// Set a work queue to perform morphing on. If set, the morphing of a MorphGeometry that was visible in the previous frame
+        /// is started as soon as its update traversal is done, and the cull traversal only waits for the result.
+        /// @par Pass NULL to morph on the cull thread (default).
+        static void setWorkQueue(osg::ref_ptr<WorkQueue> workQueue);
+
     private:
         void cull(osg::NodeVisitor* nv);
+        void update(osg::NodeVisitor* nv);
+
+        /// Apply the morph targets to the vertices of the given geometry buffer.
+        void morph(osg::Geometry& geom);
+
+        class MorphWorkItem;
+
+        static osg::ref_ptr<WorkQueue> sWorkQueue;
+
+        /// Morphing started during the update traversal, to be picked up by the cull traversal of mMorphFrame.
+        osg::ref_ptr<WorkItem> mMorphItem;
+        unsigned int mMorphFrame;
+
+        void waitForMorphing();
 
         MorphTargetList mMorphTargets;
 
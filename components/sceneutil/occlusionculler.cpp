@@ -0,0 +1,409 @@
+#include "occlusionculler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <osg/Camera>
+#include <osg/Geometry>
+#include <osg/LOD>
+#include <osg/Polytope>
+#include <osg/Sequence>
+#include <osg/Switch>
+#include <osg/TriangleIndexFunctor>
+
+#include <osgUtil/CullVisitor>
+
+#include "lightmanager.hpp"
+
+namespace SceneUtil
+{
+
+namespace
+{
+
+    bool isTransparent(const osg::StateSet& stateset)
+    {
+        return (stateset.getMode(GL_BLEND) & osg::StateAttribute::ON) || (stateset.getMode(GL_ALPHA_TEST) & osg::StateAttribute::ON);
+    }
+
+    bool isStatic(const osg::Node& node)
+    {
+        if (node.getUpdateCallback() || (node.getStateSet() && node.getStateSet()->getUpdateCallback()))
+            return false;
+
+        // billboards and the like are implemented as cull callbacks
+        for (const osg::Callback* callback = node.getCullCallback(); callback; callback = callback->getNestedCallback())
+        {
+            if (!dynamic_cast<const LightListCallback*>(callback))
+                return false;
+        }
+        return true;
+    }
+
+    struct CollectTriangles
+    {
+        CollectTriangles()
+            : mIndices(NULL)
+            , mOffset(0)
+        {
+        }
+
+        void operator()(unsigned int i1, unsigned int i2, unsigned int i3)
+        {
+            mIndices->push_back(mOffset + i1);
+            mIndices->push_back(mOffset + i2);
+            mIndices->push_back(mOffset + i3);
+        }
+
+        std::vector<unsigned int>* mIndices;
+        unsigned int mOffset;
+    };
+
+    void collectTriangles(const osg::Node& node, const osg::Matrixf& matrix, unsigned int cullMask, OccluderMesh& mesh)
+    {
+        if (!(node.getNodeMask() & cullMask) || !isStatic(node))
+            return;
+
+        if (node.getStateSet() && isTransparent(*node.getStateSet()))
+            return;
+
+        if (node.className() == std::string("Geometry"))
+        {
+            const osg::Geometry* geom = node.asGeometry();
+            const osg::Vec3Array* vertices = dynamic_cast<const osg::Vec3Array*>(geom->getVertexArray());
+            if (!vertices)
+                return;
+
+            osg::TriangleIndexFunctor<CollectTriangles> functor;
+            functor.mIndices = &mesh.mIndices;
+            functor.mOffset = mesh.mVertices.size();
+            geom->accept(functor);
+
+            for (osg::Vec3Array::const_iterator it = vertices->begin(); it != vertices->end(); ++it)
+                mesh.mVertices.push_back(*it * matrix);
+        }
+        else if (const osg::Group* group = node.asGroup())
+        {
+            // only some of the children are shown at a time
+            if (group->asSwitch() || dynamic_cast<const osg::LOD*>(group) || dynamic_cast<const osg::Sequence*>(group))
+                return;
+
+            for (unsigned int i=0; i<group->getNumChildren(); ++i)
+            {
+                const osg::Node& child = *group->getChild(i);
+                osg::Matrixf childMatrix = matrix;
+                if (const osg::Transform* transform = child.asTransform())
+                {
+                    if (transform->getReferenceFrame() != osg::Transform::RELATIVE_RF)
+                        continue;
+                    osg::Matrix local;
+                    transform->computeLocalToWorldMatrix(local, NULL);
+                    childMatrix = osg::Matrixf(local) * matrix;
+                }
+                collectTriangles(child, childMatrix, cullMask, mesh);
+            }
+        }
+    }
+
+    osg::BoundingSphere transformBound(const osg::BoundingSphere& bound, const osg::Matrix& matrix)
+    {
+        osg::Vec3d scale = matrix.getScale();
+        return osg::BoundingSphere(bound.center() * matrix, bound.radius() * std::max(scale.x(), std::max(scale.y(), scale.z())));
+    }
+
+    struct Edge
+    {
+        /// Set up the edge from \a a to \a b, positive for pixels that are entirely on its left.
+        Edge(const osg::Vec3f& a, const osg::Vec3f& b)
+        {
+            mA = a.y() - b.y();
+            mB = b.x() - a.x();
+            mC = -(mA * a.x() + mB * a.y()) - 0.5f * (std::abs(mA) + std::abs(mB));
+        }
+
+        float evaluate(float x, float y) const
+        {
+            return mA * x + mB * y + mC;
+        }
+
+        float mA;
+        float mB;
+        float mC;
+    };
+
+    struct Candidate
+    {
+        const Occluder* mOccluder;
+        osg::Matrix mMatrix;
+        float mScreenSize;
+
+        bool operator<(const Candidate& other) const
+        {
+            return mScreenSize > other.mScreenSize;
+        }
+    };
+
+}
+
+void OccluderMesh::computeBound()
+{
+    mBound.init();
+    osg::BoundingBox box;
+    for (std::vector<osg::Vec3f>::const_iterator it = mVertices.begin(); it != mVertices.end(); ++it)
+        box.expandBy(*it);
+    mBound.expandBy(box);
+}
+
+osg::ref_ptr<OccluderMesh> createOccluderMesh(const osg::Node& node, unsigned int cullMask, unsigned int maxTriangles)
+{
+    osg::ref_ptr<OccluderMesh> mesh = new OccluderMesh;
+
+    if (const osg::Group* group = node.asGroup())
+    {
+        if (!(node.getNodeMask() & cullMask) || !isStatic(node) || (node.getStateSet() && isTransparent(*node.getStateSet())))
+            return NULL;
+
+        for (unsigned int i=0; i<group->getNumChildren(); ++i)
+            collectTriangles(*group->getChild(i), osg::Matrixf(), cullMask, *mesh);
+    }
+    else
+        collectTriangles(node, osg::Matrixf(), cullMask, *mesh);
+
+    if (mesh->mIndices.empty() || mesh->mIndices.size() / 3 > maxTriangles)
+        return NULL;
+
+    mesh->computeBound();
+    return mesh;
+}
+
+Occluder::Occluder(const OccluderMesh *mesh, const osg::Transform *transform)
+    : mMesh(mesh)
+    , mTransform(transform)
+{
+}
+
+OcclusionCuller::OcclusionCuller(int width, int height)
+    : mWidth(width)
+    , mHeight(height)
+    , mDepth(width*height, std::numeric_limits<float>::max())
+    , mCamera(NULL)
+    , mMaxOccluders(32)
+    , mFrameNumber(0)
+    , mPrepared(false)
+{
+}
+
+void OcclusionCuller::setCamera(const osg::Camera *camera)
+{
+    mCamera = camera;
+    mPrepared = false;
+}
+
+void OcclusionCuller::setMaxOccluders(unsigned int maxOccluders)
+{
+    mMaxOccluders = maxOccluders;
+}
+
+void OcclusionCuller::addOccluder(Occluder *occluder)
+{
+    mOccluders.insert(occluder);
+}
+
+void OcclusionCuller::removeOccluder(Occluder *occluder)
+{
+    mOccluders.erase(occluder);
+}
+
+bool OcclusionCuller::prepare(osgUtil::CullVisitor *cv)
+{
+    if (!mCamera || cv->getCurrentCamera() != mCamera || !cv->getFrameStamp())
+        return false;
+
+    unsigned int frameNumber = cv->getFrameStamp()->getFrameNumber();
+    if (mPrepared && frameNumber == mFrameNumber)
+        return true;
+
+    mPrepared = true;
+    mFrameNumber = frameNumber;
+    mProjection = *cv->getProjectionMatrix();
+    std::fill(mDepth.begin(), mDepth.end(), std::numeric_limits<float>::max());
+
+    const osg::Matrix viewProjection = mCamera->getViewMatrix() * mProjection;
+    const osg::Vec3f eye = mCamera->getInverseViewMatrix().getTrans();
+
+    osg::Polytope frustum;
+    frustum.setToUnitFrustum();
+    frustum.transformProvidingInverse(viewProjection);
+
+    std::vector<Candidate> candidates;
+    candidates.reserve(mOccluders.size());
+    for (std::set<osg::ref_ptr<Occluder> >::const_iterator it = mOccluders.begin(); it != mOccluders.end(); ++it)
+    {
+        const Occluder& occluder = **it;
+        if (occluder.mTransform && !occluder.mTransform->getNodeMask())
+            continue;
+
+        Candidate candidate;
+        candidate.mOccluder = &occluder;
+        if (occluder.mTransform)
+            occluder.mTransform->computeLocalToWorldMatrix(candidate.mMatrix, NULL);
+
+        osg::BoundingSphere bound = transformBound(occluder.mMesh->mBound, candidate.mMatrix);
+        if (!frustum.contains(bound))
+            continue;
+
+        float distance = (bound.center() - eye).length();
+        candidate.mScreenSize = distance > bound.radius() ? bound.radius() / distance : std::numeric_limits<float>::max();
+        candidates.push_back(candidate);
+    }
+
+    unsigned int numDrawn = std::min(static_cast<unsigned int>(candidates.size()), mMaxOccluders);
+    std::partial_sort(candidates.begin(), candidates.begin() + numDrawn, candidates.end());
+
+    for (unsigned int i=0; i<numDrawn; ++i)
+        drawOccluder(*candidates[i].mOccluder, candidates[i].mMatrix * viewProjection);
+
+    return true;
+}
+
+void OcclusionCuller::drawOccluder(const Occluder &occluder, const osg::Matrix &modelViewProjection)
+{
+    const OccluderMesh& mesh = *occluder.mMesh;
+
+    mScreenVertices.resize(mesh.mVertices.size());
+    mVertexVisible.resize(mesh.mVertices.size());
+    for (unsigned int i=0; i<mesh.mVertices.size(); ++i)
+    {
+        osg::Vec4d clip = osg::Vec4d(mesh.mVertices[i], 1.0) * modelViewProjection;
+        mVertexVisible[i] = clip.w() > 0.0 && clip.z() > -clip.w();
+        if (!mVertexVisible[i])
+            continue;
+        mScreenVertices[i] = osg::Vec3f((clip.x() / clip.w() * 0.5 + 0.5) * mWidth, (clip.y() / clip.w() * 0.5 + 0.5) * mHeight, clip.z() / clip.w());
+    }
+
+    for (unsigned int i=0; i+2<mesh.mIndices.size(); i+=3)
+    {
+        unsigned int i0 = mesh.mIndices[i], i1 = mesh.mIndices[i+1], i2 = mesh.mIndices[i+2];
+        // triangles crossing the near plane would need clipping, simply leave them out
+        if (!mVertexVisible[i0] || !mVertexVisible[i1] || !mVertexVisible[i2])
+            continue;
+        drawTriangle(mScreenVertices[i0], mScreenVertices[i1], mScreenVertices[i2]);
+    }
+}
+
+void OcclusionCuller::drawTriangle(const osg::Vec3f &v0, const osg::Vec3f &v1, const osg::Vec3f &v2)
+{
+    float area = (v1.x() - v0.x()) * (v2.y() - v0.y()) - (v2.x() - v0.x()) * (v1.y() - v0.y());
+    // back facing, these are not drawn by the renderer either
+    if (area <= 0.f)
+        return;
+
+    int minX = std::max(0, static_cast<int>(std::floor(std::min(v0.x(), std::min(v1.x(), v2.x())))));
+    int maxX = std::min(mWidth-1, static_cast<int>(std::floor(std::max(v0.x(), std::max(v1.x(), v2.x())))));
+    int minY = std::max(0, static_cast<int>(std::floor(std::min(v0.y(), std::min(v1.y(), v2.y())))));
+    int maxY = std::min(mHeight-1, static_cast<int>(std::floor(std::max(v0.y(), std::max(v1.y(), v2.y())))));
+    if (minX > maxX || minY > maxY)
+        return;
+
+    // use the farthest depth of the triangle within each pixel
+    float dzdx = ((v1.z() - v0.z()) * (v2.y() - v0.y()) - (v2.z() - v0.z()) * (v1.y() - v0.y())) / area;
+    float dzdy = ((v1.x() - v0.x()) * (v2.z() - v0.z()) - (v2.x() - v0.x()) * (v1.z() - v0.z())) / area;
+    float depthOffset = 0.5f * (std::abs(dzdx) + std::abs(dzdy));
+    float maxZ = std::max(v0.z(), std::max(v1.z(), v2.z()));
+
+    // only pixels that are covered entirely are drawn
+    Edge e0 (v0, v1);
+    Edge e1 (v1, v2);
+    Edge e2 (v2, v0);
+
+    for (int y = minY; y <= maxY; ++y)
+    {
+        float py = y + 0.5f;
+        float* row = &mDepth[y * mWidth];
+        for (int x = minX; x <= maxX; ++x)
+        {
+            float px = x + 0.5f;
+            if (e0.evaluate(px, py) <= 0.f || e1.evaluate(px, py) <= 0.f || e2.evaluate(px, py) <= 0.f)
+                continue;
+
+            float z = std::min(maxZ, v0.z() + dzdx * (px - v0.x()) + dzdy * (py - v0.y()) + depthOffset);
+            row[x] = std::min(row[x], z);
+        }
+    }
+}
+
+bool OcclusionCuller::isOccluded(const osg::BoundingSphere &bound, const osg::Matrix &modelView) const
+{
+    if (!bound.valid())
+        return false;
+
+    const osg::Matrix modelViewProjection = modelView * mProjection;
+
+    float minX = std::numeric_limits<float>::max(), minY = minX, minZ = minX;
+    float maxX = -minX, maxY = -minX;
+    for (int i=0; i<8; ++i)
+    {
+        osg::Vec3d corner = osg::Vec3d(bound.center()) + osg::Vec3d((i&1) ? bound.radius() : -bound.radius(),
+                                                        (i&2) ? bound.radius() : -bound.radius(),
+                                                        (i&4) ? bound.radius() : -bound.radius());
+        osg::Vec4d clip = osg::Vec4d(corner, 1.0) * modelViewProjection;
+        // in front of the near plane, or the viewer is inside of it
+        if (clip.w() <= 0.0 || clip.z() <= -clip.w())
+            return false;
+
+        float x = (clip.x() / clip.w() * 0.5 + 0.5) * mWidth;
+        float y = (clip.y() / clip.w() * 0.5 + 0.5) * mHeight;
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        minZ = std::min(minZ, static_cast<float>(clip.z() / clip.w()));
+    }
+
+    int x0 = std::max(0, static_cast<int>(std::floor(minX)));
+    int x1 = std::min(mWidth-1, static_cast<int>(std::floor(maxX)));
+    int y0 = std::max(0, static_cast<int>(std::floor(minY)));
+    int y1 = std::min(mHeight-1, static_cast<int>(std::floor(maxY)));
+    // off screen, that is up to the frustum culling
+    if (x0 > x1 || y0 > y1)
+        return false;
+
+    for (int y = y0; y <= y1; ++y)
+    {
+        const float* row = &mDepth[y * mWidth];
+        for (int x = x0; x <= x1; ++x)
+        {
+            if (row[x] >= minZ)
+                return false;
+        }
+    }
+    return true;
+}
+
+OcclusionCullCallback::OcclusionCullCallback(OcclusionCuller *culler)
+    : mCuller(culler)
+{
+}
+
+void OcclusionCullCallback::operator()(osg::Node *node, osg::NodeVisitor *nv)
+{
+    osgUtil::CullVisitor* cv = static_cast<osgUtil::CullVisitor*>(nv);
+    osg::Group* group = node->asGroup();
+    if (!group || !mCuller->prepare(cv))
+    {
+        traverse(node, nv);
+        return;
+    }
+
+    const osg::Matrix& modelView = *cv->getModelViewMatrix();
+    for (unsigned int i=0; i<group->getNumChildren(); ++i)
+    {
+        osg::Node* child = group->getChild(i);
+        if (!cv->validNodeMask(*child) || mCuller->isOccluded(child->getBound(), modelView))
+            continue;
+        child->accept(*nv);
+    }
+}
+
+}
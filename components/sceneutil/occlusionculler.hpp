@@ -0,0 +1,117 @@
+#ifndef OPENMW_COMPONENTS_SCENEUTIL_OCCLUSIONCULLER_H
+#define OPENMW_COMPONENTS_SCENEUTIL_OCCLUSIONCULLER_H
+
+#include <set>
+#include <vector>
+
+#include <osg/NodeCallback>
+#include <osg/Matrix>
+#include <osg/Transform>
+
+namespace osg
+{
+    class Camera;
+}
+
+namespace osgUtil
+{
+    class CullVisitor;
+}
+
+namespace SceneUtil
+{
+
+    /// @brief Triangles of an object that hide whatever is behind them, in the object's local coordinate frame.
+    class OccluderMesh : public osg::Referenced
+    {
+    public:
+        std::vector<osg::Vec3f> mVertices;
+        std::vector<unsigned int> mIndices;
+
+        /// Recompute mBound after the vertices were changed.
+        void computeBound();
+
+        osg::BoundingSphere mBound;
+    };
+
+    /// Collect the opaque triangles below \a node into an OccluderMesh. The transform of \a node itself, if any, is not applied.
+    /// @par Geometry that is blended, alpha tested, animated or hidden by \a cullMask is left out.
+    /// @return NULL if there are no triangles, or more than \a maxTriangles.
+    osg::ref_ptr<OccluderMesh> createOccluderMesh(const osg::Node& node, unsigned int cullMask, unsigned int maxTriangles);
+
+    /// @brief An OccluderMesh placed in the world.
+    class Occluder : public osg::Referenced
+    {
+    public:
+        /// @param transform The transform placing the mesh. NULL if the mesh is in world space already.
+        Occluder(const OccluderMesh* mesh, const osg::Transform* transform);
+
+        osg::ref_ptr<const OccluderMesh> mMesh;
+        osg::ref_ptr<const osg::Transform> mTransform;
+    };
+
+    /// @brief Hides objects behind large occluders, such as buildings, walls and terrain, on the CPU.
+    /// @par At the start of a camera's cull traversal, the occluders closest to the viewer are drawn into a small depth buffer.
+    /// Objects are then hidden if their bounding box is behind the depth buffer wherever it would be drawn. Occluders are only
+    /// drawn where they cover a whole pixel, so nothing is hidden that could be seen through gaps in the depth buffer.
+    /// @note Only handles a single camera. Not thread safe, use from the thread doing its cull traversal.
+    class OcclusionCuller : public osg::Referenced
+    {
+    public:
+        /// @param width Width of the depth buffer.
+        /// @param height Height of the depth buffer.
+        OcclusionCuller(int width, int height);
+
+        /// Set the camera whose cull traversal is sped up. Other cameras are not affected.
+        void setCamera(const osg::Camera* camera);
+
+        /// Set the number of occluders drawn per frame. Those that are largest on screen are drawn first.
+        void setMaxOccluders(unsigned int maxOccluders);
+
+        void addOccluder(Occluder* occluder);
+        void removeOccluder(Occluder* occluder);
+
+        /// Draw the occluders for the traversal of \a cv, if not done already in this frame.
+        /// @return Can objects be tested in this traversal?
+        bool prepare(osgUtil::CullVisitor* cv);
+
+        /// Is \a bound, given in the coordinate frame of \a modelView, hidden behind the occluders?
+        bool isOccluded(const osg::BoundingSphere& bound, const osg::Matrix& modelView) const;
+
+    private:
+        void drawOccluder(const Occluder& occluder, const osg::Matrix& viewProjection);
+        void drawTriangle(const osg::Vec3f& v0, const osg::Vec3f& v1, const osg::Vec3f& v2);
+
+        int mWidth;
+        int mHeight;
+        std::vector<float> mDepth;
+
+        const osg::Camera* mCamera;
+        unsigned int mMaxOccluders;
+        unsigned int mFrameNumber;
+        bool mPrepared;
+
+        osg::Matrix mProjection;
+
+        std::set<osg::ref_ptr<Occluder> > mOccluders;
+
+        /// Screen space vertices of the occluder being drawn. Kept around to avoid allocations.
+        std::vector<osg::Vec3f> mScreenVertices;
+        std::vector<bool> mVertexVisible;
+    };
+
+    /// @brief Cull callback for a Group, skipping the children hidden behind an OcclusionCuller's occluders.
+    class OcclusionCullCallback : public osg::NodeCallback
+    {
+    public:
+        OcclusionCullCallback(OcclusionCuller* culler);
+
+        virtual void operator()(osg::Node* node, osg::NodeVisitor* nv);
+
+    private:
+        osg::ref_ptr<OcclusionCuller> mCuller;
+    };
+
+}
+
+#endif
@@ -4,28 +4,85 @@
 #include <iostream>
 #include <cstdlib>
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define SCENEUTIL_SKINNING_SSE
+#endif
+
 #include "skeleton.hpp"
 #include "util.hpp"
 
 namespace SceneUtil
 {
 
+class RigGeometry::SkinningWorkItem : public WorkItem
+{
+public:
+    SkinningWorkItem(RigGeometry* rig, osg::Geometry* geom)
+        : mRig(rig)
+        , mGeometry(geom)
+    {
+    }
+
+    virtual void doWork()
+    {
+        mRig->skin(*mGeometry);
+
+        // release our reference to avoid a cycle with RigGeometry::mSkinningItem
+        mRig = NULL;
+        mGeometry = NULL;
+    }
+
+private:
+    osg::ref_ptr<RigGeometry> mRig;
+    osg::ref_ptr<osg::Geometry> mGeometry;
+};
+
+osg::ref_ptr<WorkQueue> RigGeometry::sWorkQueue;
+osg::ref_ptr<SkinningCache> RigGeometry::sSkinningCache;
+
+void RigGeometry::setWorkQueue(osg::ref_ptr<WorkQueue> workQueue)
+{
+    sWorkQueue = workQueue;
+}
+
+void RigGeometry::setSkinningCache(osg::ref_ptr<SkinningCache> cache)
+{
+    sSkinningCache = cache;
+}
+
 RigGeometry::RigGeometry()
-    : mSkeleton(NULL)
+    : mPreparedFrame(0)
+    , mPreparedChanged(false)
+    , mSkeleton(NULL)
     , mLastFrameNumber(0)
     , mBoundsFirstFrame(true)
 {
+    for (unsigned int i=0; i<2; ++i)
+    {
+        mBufferFrame[i] = 0;
+        mBufferKeyValid[i] = false;
+    }
+
     setUpdateCallback(new osg::Callback); // dummy to make sure getNumChildrenRequiringUpdateTraversal() is correct
                                           // update done in accept(NodeVisitor&)
 }
 
 RigGeometry::RigGeometry(const RigGeometry &copy, const osg::CopyOp &copyop)
     : Drawable(copy, copyop)
+    , mPreparedFrame(0)
+    , mPreparedChanged(false)
     , mSkeleton(NULL)
     , mInfluenceMap(copy.mInfluenceMap)
     , mLastFrameNumber(0)
     , mBoundsFirstFrame(true)
 {
+    for (unsigned int i=0; i<2; ++i)
+    {
+        mBufferFrame[i] = 0;
+        mBufferKeyValid[i] = false;
+    }
+
     setSourceGeometry(copy.mSourceGeometry);
 }
 
@@ -106,8 +163,13 @@ bool RigGeometry::initFromParentSkeleton(osg::NodeVisitor* nv)
         return false;
     }
 
-    typedef std::map<unsigned short, std::vector<BoneWeight> > Vertex2BoneMap;
+    // <bone binding index, weight>
+    typedef std::vector<std::pair<unsigned int, float> > BoneWeights;
+
+    typedef std::map<unsigned short, BoneWeights> Vertex2BoneMap;
     Vertex2BoneMap vertex2BoneMap;
+    mBoneBindings.clear();
+    mBoneSphereMap.clear();
     for (std::map<std::string, BoneInfluence>::const_iterator it = mInfluenceMap->mMap.begin(); it != mInfluenceMap->mMap.end(); ++it)
     {
         Bone* bone = mSkeleton->getBone(it->first);
@@ -121,117 +183,360 @@ bool RigGeometry::initFromParentSkeleton(osg::NodeVisitor* nv)
 
         const BoneInfluence& bi = it->second;
 
+        BoneBinding binding;
+        binding.mBone = bone;
+        binding.mInvBindMatrix = bi.mInvBindMatrix;
+        unsigned int bindingIndex = mBoneBindings.size();
+        mBoneBindings.push_back(binding);
+
         const std::map<unsigned short, float>& weights = it->second.mWeights;
         for (std::map<unsigned short, float>::const_iterator weightIt = weights.begin(); weightIt != weights.end(); ++weightIt)
-        {
-            std::vector<BoneWeight>& vec = vertex2BoneMap[weightIt->first];
+            vertex2BoneMap[weightIt->first].push_back(std::make_pair(bindingIndex, weightIt->second));
+    }
 
-            BoneWeight b = std::make_pair(std::make_pair(bone, bi.mInvBindMatrix), weightIt->second);
+    typedef std::map<BoneWeights, std::vector<unsigned short> > Bone2VertexMap;
+    Bone2VertexMap bone2VertexMap;
+    for (Vertex2BoneMap::iterator it = vertex2BoneMap.begin(); it != vertex2BoneMap.end(); ++it)
+    {
+        bone2VertexMap[it->second].push_back(it->first);
+    }
 
-            vec.push_back(b);
+    // flatten the groups into contiguous arrays
+    mInfluenceGroups.clear();
+    mWeightBones.clear();
+    mWeights.clear();
+    mVertices.clear();
+    for (Bone2VertexMap::const_iterator it = bone2VertexMap.begin(); it != bone2VertexMap.end(); ++it)
+    {
+        InfluenceGroup group;
+        group.mFirstWeight = mWeights.size();
+        group.mNumWeights = it->first.size();
+        group.mFirstVertex = mVertices.size();
+        group.mNumVertices = it->second.size();
+        mInfluenceGroups.push_back(group);
+
+        for (BoneWeights::const_iterator weightIt = it->first.begin(); weightIt != it->first.end(); ++weightIt)
+        {
+            mWeightBones.push_back(weightIt->first);
+            mWeights.push_back(weightIt->second);
         }
+
+        mVertices.insert(mVertices.end(), it->second.begin(), it->second.end());
     }
 
-    for (Vertex2BoneMap::iterator it = vertex2BoneMap.begin(); it != vertex2BoneMap.end(); ++it)
+    mSkinMatrices.resize(mBoneBindings.size());
+
+    // gather the source vertex data in group order
+    const osg::Vec3Array* positions = static_cast<const osg::Vec3Array*>(mSourceGeometry->getVertexArray());
+    const osg::Vec3Array* normals = static_cast<const osg::Vec3Array*>(mSourceGeometry->getNormalArray());
+    const osg::Vec4Array* tangents = mSourceTangents;
+
+    SourceArrays* arrays[3] = { &mSourcePositions, &mSourceNormals, &mSourceTangentVectors };
+    for (unsigned int i=0; i<3; ++i)
     {
-        mBone2VertexMap[it->second].push_back(it->first);
+        arrays[i]->mX.clear();
+        arrays[i]->mY.clear();
+        arrays[i]->mZ.clear();
+    }
+
+    for (std::vector<unsigned short>::const_iterator it = mVertices.begin(); it != mVertices.end(); ++it)
+    {
+        const osg::Vec3f& position = (*positions)[*it];
+        mSourcePositions.mX.push_back(position.x());
+        mSourcePositions.mY.push_back(position.y());
+        mSourcePositions.mZ.push_back(position.z());
+
+        if (normals)
+        {
+            const osg::Vec3f& normal = (*normals)[*it];
+            mSourceNormals.mX.push_back(normal.x());
+            mSourceNormals.mY.push_back(normal.y());
+            mSourceNormals.mZ.push_back(normal.z());
+        }
+
+        if (tangents)
+        {
+            const osg::Vec4f& tangent = (*tangents)[*it];
+            mSourceTangentVectors.mX.push_back(tangent.x());
+            mSourceTangentVectors.mY.push_back(tangent.y());
+            mSourceTangentVectors.mZ.push_back(tangent.z());
+        }
     }
 
     return true;
 }
 
-void accumulateMatrix(const osg::Matrixf& invBindMatrix, const osg::Matrixf& matrix, float weight, osg::Matrixf& result)
+namespace
 {
-    osg::Matrixf m = invBindMatrix * matrix;
-    float* ptr = m.ptr();
-    float* ptrresult = result.ptr();
-    ptrresult[0] += ptr[0] * weight;
-    ptrresult[1] += ptr[1] * weight;
-    ptrresult[2] += ptr[2] * weight;
-
-    ptrresult[4] += ptr[4] * weight;
-    ptrresult[5] += ptr[5] * weight;
-    ptrresult[6] += ptr[6] * weight;
-
-    ptrresult[8] += ptr[8] * weight;
-    ptrresult[9] += ptr[9] * weight;
-    ptrresult[10] += ptr[10] * weight;
-
-    ptrresult[12] += ptr[12] * weight;
-    ptrresult[13] += ptr[13] * weight;
-    ptrresult[14] += ptr[14] * weight;
-}
+    /// Add \a weight * \a matrix to \a result. The last column is not used by the skinning kernel.
+    inline void accumulateMatrix(const osg::Matrixf& matrix, float weight, float* result)
+    {
+        const float* ptr = matrix.ptr();
+#ifdef SCENEUTIL_SKINNING_SSE
+        __m128 w = _mm_set1_ps(weight);
+        for (unsigned int row=0; row<16; row+=4)
+            _mm_storeu_ps(result+row, _mm_add_ps(_mm_loadu_ps(result+row), _mm_mul_ps(_mm_loadu_ps(ptr+row), w)));
+#else
+        for (unsigned int i=0; i<16; ++i)
+            result[i] += ptr[i] * weight;
+#endif
+    }
 
-void RigGeometry::cull(osg::NodeVisitor* nv)
-{
-    if (!mSkeleton)
+    template <class Vec>
+    inline void storeVertex(Vec& vec, float x, float y, float z)
     {
-        std::cerr << "Error: RigGeometry rendering with no skeleton, should have been initialized by UpdateVisitor" << std::endl;
-        // try to recover anyway, though rendering is likely to be incorrect.
-        if (!initFromParentSkeleton(nv))
-            return;
+        vec.x() = x;
+        vec.y() = y;
+        vec.z() = z;
     }
 
-    if ((!mSkeleton->getActive() && mLastFrameNumber != 0) || mLastFrameNumber == nv->getTraversalNumber())
+    /// Transform \a count vertices given as structure of arrays by the affine matrix \a m and scatter them to \a dst.
+    /// @param translate Apply the translation part of the matrix (positions), or only the 3x3 part (directions).
+    template <class Vec>
+    void transformVertices(const float* m, bool translate, const float* x, const float* y, const float* z,
+                           const unsigned short* vertices, unsigned int count, Vec* dst)
     {
-        osg::Geometry& geom = *getGeometry(mLastFrameNumber);
-        nv->pushOntoNodePath(&geom);
-        nv->apply(geom);
-        nv->popFromNodePath();
-        return;
+        float tx = translate ? m[12] : 0.f;
+        float ty = translate ? m[13] : 0.f;
+        float tz = translate ? m[14] : 0.f;
+
+        unsigned int i = 0;
+#ifdef SCENEUTIL_SKINNING_SSE
+        const __m128 m0 = _mm_set1_ps(m[0]);
+        const __m128 m1 = _mm_set1_ps(m[1]);
+        const __m128 m2 = _mm_set1_ps(m[2]);
+        const __m128 m4 = _mm_set1_ps(m[4]);
+        const __m128 m5 = _mm_set1_ps(m[5]);
+        const __m128 m6 = _mm_set1_ps(m[6]);
+        const __m128 m8 = _mm_set1_ps(m[8]);
+        const __m128 m9 = _mm_set1_ps(m[9]);
+        const __m128 m10 = _mm_set1_ps(m[10]);
+        const __m128 t0 = _mm_set1_ps(tx);
+        const __m128 t1 = _mm_set1_ps(ty);
+        const __m128 t2 = _mm_set1_ps(tz);
+
+        float rx[4], ry[4], rz[4];
+        for (; i+4 <= count; i+=4)
+        {
+            __m128 vx = _mm_loadu_ps(x+i);
+            __m128 vy = _mm_loadu_ps(y+i);
+            __m128 vz = _mm_loadu_ps(z+i);
+
+            _mm_storeu_ps(rx, _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, m0), _mm_mul_ps(vy, m4)), _mm_add_ps(_mm_mul_ps(vz, m8), t0)));
+            _mm_storeu_ps(ry, _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, m1), _mm_mul_ps(vy, m5)), _mm_add_ps(_mm_mul_ps(vz, m9), t1)));
+            _mm_storeu_ps(rz, _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, m2), _mm_mul_ps(vy, m6)), _mm_add_ps(_mm_mul_ps(vz, m10), t2)));
+
+            for (unsigned int j=0; j<4; ++j)
+                storeVertex(dst[vertices[i+j]], rx[j], ry[j], rz[j]);
+        }
+#endif
+        for (; i<count; ++i)
+            storeVertex(dst[vertices[i]],
+                        x[i]*m[0] + y[i]*m[4] + z[i]*m[8] + tx,
+                        x[i]*m[1] + y[i]*m[5] + z[i]*m[9] + ty,
+                        x[i]*m[2] + y[i]*m[6] + z[i]*m[10] + tz);
     }
-    mLastFrameNumber = nv->getTraversalNumber();
-    osg::Geometry& geom = *getGeometry(mLastFrameNumber);
+}
 
-    mSkeleton->updateBoneMatrices(nv->getTraversalNumber());
+void RigGeometry::prepareSkinning()
+{
+    // Combine bone and inverse bind matrices once per bone. The geometry to skeleton transform is linear,
+    // so its 3x3 part can be applied here as well, leaving only its translation to be added per group.
+    osg::Matrixf geomToSkelLinear;
+    mSkinTranslation = osg::Vec3f();
+    if (mGeomToSkelMatrix)
+    {
+        geomToSkelLinear = osg::Matrixf(*mGeomToSkelMatrix);
+        mSkinTranslation = geomToSkelLinear.getTrans();
+        geomToSkelLinear.setTrans(0, 0, 0);
+    }
 
-    // skinning
-    const osg::Vec3Array* positionSrc = static_cast<osg::Vec3Array*>(mSourceGeometry->getVertexArray());
-    const osg::Vec3Array* normalSrc = static_cast<osg::Vec3Array*>(mSourceGeometry->getNormalArray());
-    const osg::Vec4Array* tangentSrc = mSourceTangents;
+    for (unsigned int i=0; i<mBoneBindings.size(); ++i)
+    {
+        const BoneBinding& binding = mBoneBindings[i];
+        mSkinMatrices[i] = binding.mInvBindMatrix * binding.mBone->mMatrixInSkeletonSpace;
+        if (mGeomToSkelMatrix)
+            mSkinMatrices[i] *= geomToSkelLinear;
+    }
+}
 
+void RigGeometry::skin(osg::Geometry& geom)
+{
     osg::Vec3Array* positionDst = static_cast<osg::Vec3Array*>(geom.getVertexArray());
     osg::Vec3Array* normalDst = static_cast<osg::Vec3Array*>(geom.getNormalArray());
     osg::Vec4Array* tangentDst = static_cast<osg::Vec4Array*>(geom.getTexCoordArray(7));
 
-    for (Bone2VertexMap::const_iterator it = mBone2VertexMap.begin(); it != mBone2VertexMap.end(); ++it)
+    if (mVertices.empty())
+        return;
+
+    for (std::vector<InfluenceGroup>::const_iterator it = mInfluenceGroups.begin(); it != mInfluenceGroups.end(); ++it)
+    {
+        float resultMat[16] = { 0 };
+
+        for (unsigned int i = it->mFirstWeight; i < it->mFirstWeight + it->mNumWeights; ++i)
+            accumulateMatrix(mSkinMatrices[mWeightBones[i]], mWeights[i], resultMat);
+
+        resultMat[12] += mSkinTranslation.x();
+        resultMat[13] += mSkinTranslation.y();
+        resultMat[14] += mSkinTranslation.z();
+
+        const unsigned short* vertices = &mVertices[it->mFirstVertex];
+        unsigned int first = it->mFirstVertex;
+        unsigned int count = it->mNumVertices;
+
+        transformVertices(resultMat, true, &mSourcePositions.mX[first], &mSourcePositions.mY[first], &mSourcePositions.mZ[first],
+                          vertices, count, &positionDst->front());
+        if (normalDst)
+            transformVertices(resultMat, false, &mSourceNormals.mX[first], &mSourceNormals.mY[first], &mSourceNormals.mZ[first],
+                              vertices, count, &normalDst->front());
+        if (tangentDst)
+            transformVertices(resultMat, false, &mSourceTangentVectors.mX[first], &mSourceTangentVectors.mY[first],
+                              &mSourceTangentVectors.mZ[first], vertices, count, &tangentDst->front());
+    }
+}
+
+void RigGeometry::waitForSkinning()
+{
+    if (mSkinningItem)
+    {
+        mSkinningItem->waitTillDone();
+        mSkinningItem = NULL;
+    }
+}
+
+void RigGeometry::prepareFrame(unsigned int frame, bool background)
+{
+    prepareSkinning();
+
+    mPreparedFrame = frame;
+    mPreparedItem = NULL;
+
+    if (sSkinningCache)
     {
-        osg::Matrixf resultMat  (0, 0, 0, 0,
-                                0, 0, 0, 0,
-                                0, 0, 0, 0,
-                                0, 0, 0, 1);
+        sSkinningCache->makeKey(mSkinMatrices, mSkinTranslation, mKey);
 
-        for (std::vector<BoneWeight>::const_iterator weightIt = it->first.begin(); weightIt != it->first.end(); ++weightIt)
+        // still in the same pose as one of our buffers, e.g. a paused animation
+        for (unsigned int i=0; i<2; ++i)
         {
-            Bone* bone = weightIt->first.first;
-            const osg::Matrix& invBindMatrix = weightIt->first.second;
-            float weight = weightIt->second;
-            const osg::Matrixf& boneMatrix = bone->mMatrixInSkeletonSpace;
-            accumulateMatrix(invBindMatrix, boneMatrix, weight, resultMat);
+            if (mBufferKeyValid[i] && mBufferKey[i] == mKey)
+            {
+                mBufferFrame[i] = frame;
+                mPreparedGeometry = mGeometry[i];
+                mPreparedChanged = false;
+
+                SkinningCache::Entry entry;
+                entry.mGeometry = mPreparedGeometry;
+                sSkinningCache->insert(mSourceGeometry.get(), mKey, frame, entry);
+                return;
+            }
         }
-        if (mGeomToSkelMatrix)
-            resultMat *= (*mGeomToSkelMatrix);
 
-        for (std::vector<unsigned short>::const_iterator vertexIt = it->second.begin(); vertexIt != it->second.end(); ++vertexIt)
+        // Another instance of this mesh was already skinned into this pose during this frame.
+        // Entries only live for the frame they were created in, so the owner will not write to that buffer before our draw is done.
+        if (const SkinningCache::Entry* entry = sSkinningCache->find(mSourceGeometry.get(), mKey, frame))
         {
-            unsigned short vertex = *vertexIt;
-            (*positionDst)[vertex] = resultMat.preMult((*positionSrc)[vertex]);
-            if (normalDst)
-                (*normalDst)[vertex] = osg::Matrix::transform3x3((*normalSrc)[vertex], resultMat);
-            if (tangentDst)
+            mPreparedGeometry = entry->mGeometry;
+            mPreparedItem = entry->mItem;
+            mPreparedChanged = false;
+            return;
+        }
+    }
+
+    unsigned int index = mBufferFrame[0] <= mBufferFrame[1] ? 0 : 1;
+    mBufferFrame[index] = frame;
+    mBufferKeyValid[index] = sSkinningCache != NULL;
+    if (sSkinningCache)
+        mBufferKey[index] = mKey;
+
+    mPreparedGeometry = mGeometry[index];
+    mPreparedChanged = true;
+
+    if (background)
+    {
+        mSkinningItem = new SkinningWorkItem(this, mPreparedGeometry);
+        mPreparedItem = mSkinningItem;
+        sWorkQueue->addWorkItem(mSkinningItem);
+    }
+    else
+        skin(*mPreparedGeometry);
+
+    if (sSkinningCache)
+    {
+        SkinningCache::Entry entry;
+        entry.mGeometry = mPreparedGeometry;
+        entry.mItem = mPreparedItem;
+        sSkinningCache->insert(mSourceGeometry.get(), mKey, frame, entry);
+    }
+}
+
+void RigGeometry::cull(osg::NodeVisitor* nv)
+{
+    if (!mSkeleton)
+    {
+        std::cerr << "Error: RigGeometry rendering with no skeleton, should have been initialized by UpdateVisitor" << std::endl;
+        // try to recover anyway, though rendering is likely to be incorrect.
+        if (!initFromParentSkeleton(nv))
+            return;
+    }
+
+    unsigned int traversalNumber = nv->getTraversalNumber();
+
+    if (mDrawnGeometry && (mLastFrameNumber == traversalNumber || !mSkeleton->getActive()))
+    {
+        // a buffer of another RigGeometry can only be kept for the frame it was shared in
+        for (unsigned int i=0; i<2 && mLastFrameNumber != traversalNumber; ++i)
+        {
+            if (mDrawnGeometry == mGeometry[i])
             {
-                osg::Vec4f srcTangent = (*tangentSrc)[vertex];
-                osg::Vec3f transformedTangent = osg::Matrix::transform3x3(osg::Vec3f(srcTangent.x(), srcTangent.y(), srcTangent.z()), resultMat);
-                (*tangentDst)[vertex] = osg::Vec4f(transformedTangent, srcTangent.w());
+                mBufferFrame[i] = traversalNumber;
+                mLastFrameNumber = traversalNumber;
             }
         }
+
+        if (mLastFrameNumber == traversalNumber)
+        {
+            osg::Geometry& geom = *mDrawnGeometry;
+            nv->pushOntoNodePath(&geom);
+            nv->apply(geom);
+            nv->popFromNodePath();
+            return;
+        }
     }
 
-    positionDst->dirty();
-    if (normalDst)
-        normalDst->dirty();
-    if (tangentDst)
-        tangentDst->dirty();
+    // if skinning for this frame was prepared in the update traversal, we only have to wait for it
+    if (mPreparedFrame != traversalNumber || !mPreparedGeometry)
+    {
+        waitForSkinning();
+        mSkeleton->updateBoneMatrices(traversalNumber);
+        prepareFrame(traversalNumber, false);
+    }
+
+    if (mPreparedItem)
+    {
+        mPreparedItem->waitTillDone();
+        mPreparedItem = NULL;
+    }
+    if (mSkinningItem && mSkinningItem->isDone())
+        mSkinningItem = NULL;
+
+    mLastFrameNumber = traversalNumber;
+    mDrawnGeometry = mPreparedGeometry;
+    osg::Geometry& geom = *mDrawnGeometry;
+
+    if (mPreparedChanged)
+    {
+        osg::Vec3Array* positionDst = static_cast<osg::Vec3Array*>(geom.getVertexArray());
+        osg::Vec3Array* normalDst = static_cast<osg::Vec3Array*>(geom.getNormalArray());
+        osg::Vec4Array* tangentDst = static_cast<osg::Vec4Array*>(geom.getTexCoordArray(7));
+
+        positionDst->dirty();
+        if (normalDst)
+            normalDst->dirty();
+        if (tangentDst)
+            tangentDst->dirty();
+
+        mPreparedChanged = false;
+    }
 
     nv->pushOntoNodePath(&geom);
     nv->apply(geom);
@@ -240,6 +545,9 @@ void RigGeometry::cull(osg::NodeVisitor* nv)
 
 void RigGeometry::updateBounds(osg::NodeVisitor *nv)
 {
+    // skinning from the previous frame may still be using our matrices
+    waitForSkinning();
+
     if (!mSkeleton)
     {
         if (!initFromParentSkeleton(nv))
@@ -274,6 +582,11 @@ void RigGeometry::updateBounds(osg::NodeVisitor *nv)
         for (unsigned int i=0; i<getNumParents(); ++i)
             getParent(i)->dirtyBound();
     }
+
+    // Start skinning right away if we were drawn in the previous frame, as we will most likely be drawn in this frame too.
+    // The bone matrices will not change until the cull traversal.
+    if (sWorkQueue && mLastFrameNumber != 0 && mLastFrameNumber+1 >= nv->getTraversalNumber() && !mVertices.empty())
+        prepareFrame(nv->getTraversalNumber(), true);
 }
 
 void RigGeometry::updateGeomToSkelMatrix(const osg::NodePath& nodePath)
@@ -326,12 +639,10 @@ void RigGeometry::accept(osg::NodeVisitor &nv)
 
 void RigGeometry::accept(osg::PrimitiveFunctor& func) const
 {
-    getGeometry(mLastFrameNumber)->accept(func);
-}
-
-osg::Geometry* RigGeometry::getGeometry(unsigned int frame) const
-{
-    return mGeometry[frame%2].get();
+    if (mDrawnGeometry)
+        mDrawnGeometry->accept(func);
+    else
+        mGeometry[0]->accept(func);
 }
 
 
@@ -4,6 +4,9 @@
 #include <osg/Geometry>
 #include <osg/Matrixf>
 
+#include "workqueue.hpp"
+#include "skinningcache.hpp"
+
 namespace SceneUtil
 {
 
@@ -47,6 +50,15 @@ namespace SceneUtil
 
         osg::ref_ptr<osg::Geometry> getSourceGeometry();
 
+        /// Set a work queue to perform skinning on. If set, the skinning of a RigGeometry that was visible in the previous frame
+        /// is started as soon as its update traversal is done, and the cull traversal only waits for the result.
+        /// @par Pass NULL to skin on the cull thread (default).
+        static void setWorkQueue(osg::ref_ptr<WorkQueue> workQueue);
+
+        /// Set a cache to share skinning results between RigGeometries of the same mesh that are in the same pose in the same frame.
+        /// @par Pass NULL to disable sharing (default).
+        static void setSkinningCache(osg::ref_ptr<SkinningCache> cache);
+
         virtual void accept(osg::NodeVisitor &nv);
         virtual bool supports(const osg::PrimitiveFunctor&) const { return true; }
         virtual void accept(osg::PrimitiveFunctor&) const;
@@ -55,8 +67,40 @@ namespace SceneUtil
         void cull(osg::NodeVisitor* nv);
         void updateBounds(osg::NodeVisitor* nv);
 
+        class SkinningWorkItem;
+
+        static osg::ref_ptr<WorkQueue> sWorkQueue;
+        static osg::ref_ptr<SkinningCache> sSkinningCache;
+
+        /// Our own skinning job, which uses mSkinMatrices and writes to one of mGeometry.
+        osg::ref_ptr<WorkItem> mSkinningItem;
+
+        void waitForSkinning();
+
+        /// The geometry to be drawn in mPreparedFrame. May be a buffer of another RigGeometry sharing our pose.
+        osg::ref_ptr<osg::Geometry> mPreparedGeometry;
+        /// Must be waited for before mPreparedGeometry may be used, may belong to another RigGeometry.
+        osg::ref_ptr<WorkItem> mPreparedItem;
+        unsigned int mPreparedFrame;
+        /// Whether mPreparedGeometry was written to, so its arrays need to be dirtied.
+        bool mPreparedChanged;
+
+        /// The geometry drawn in mLastFrameNumber.
+        osg::ref_ptr<osg::Geometry> mDrawnGeometry;
+
         osg::ref_ptr<osg::Geometry> mGeometry[2];
-        osg::Geometry* getGeometry(unsigned int frame) const;
+        /// The last frame each buffer was prepared for. The buffer used least recently is the one written to next,
+        /// as the other one may still be in use by the draw traversal of the previous frame.
+        unsigned int mBufferFrame[2];
+        /// The pose each buffer holds, only used with a SkinningCache.
+        SkinningCache::Key mBufferKey[2];
+        bool mBufferKeyValid[2];
+
+        SkinningCache::Key mKey;
+
+        /// Find or produce the skinned geometry for \a frame using the current bone matrices.
+        /// @param background Skin on sWorkQueue rather than right away.
+        void prepareFrame(unsigned int frame, bool background);
 
         osg::ref_ptr<osg::Geometry> mSourceGeometry;
         osg::ref_ptr<const osg::Vec4Array> mSourceTangents;
@@ -66,15 +110,45 @@ namespace SceneUtil
 
         osg::ref_ptr<InfluenceMap> mInfluenceMap;
 
-        typedef std::pair<Bone*, osg::Matrixf> BoneBindMatrixPair;
+        // Influence data flattened into contiguous arrays by initFromParentSkeleton(), consumed by the skinning kernel.
 
-        typedef std::pair<BoneBindMatrixPair, float> BoneWeight;
+        struct BoneBinding
+        {
+            Bone* mBone;
+            osg::Matrixf mInvBindMatrix;
+        };
 
-        typedef std::vector<unsigned short> VertexList;
+        std::vector<BoneBinding> mBoneBindings;
 
-        typedef std::map<std::vector<BoneWeight>, VertexList> Bone2VertexMap;
+        /// Vertices that are affected by the same set of bones with the same weights.
+        struct InfluenceGroup
+        {
+            unsigned int mFirstWeight; ///< into mWeightBones/mWeights
+            unsigned int mNumWeights;
+            unsigned int mFirstVertex; ///< into mVertices and the source arrays
+            unsigned int mNumVertices;
+        };
 
-        Bone2VertexMap mBone2VertexMap;
+        std::vector<InfluenceGroup> mInfluenceGroups;
+        std::vector<unsigned int> mWeightBones; ///< index into mBoneBindings
+        std::vector<float> mWeights;
+        std::vector<unsigned short> mVertices; ///< destination vertex index, in group order
+
+        /// Source vertex data in group order, stored as structure of arrays.
+        struct SourceArrays
+        {
+            std::vector<float> mX;
+            std::vector<float> mY;
+            std::vector<float> mZ;
+        };
+
+        SourceArrays mSourcePositions;
+        SourceArrays mSourceNormals;
+        SourceArrays mSourceTangentVectors;
+
+        /// Per frame scratch buffer, bone matrices premultiplied with the inverse bind matrices.
+        std::vector<osg::Matrixf> mSkinMatrices;
+        osg::Vec3f mSkinTranslation;
 
         typedef std::map<Bone*, osg::BoundingSpheref> BoneSphereMap;
 
@@ -85,6 +159,12 @@ namespace SceneUtil
 
         bool initFromParentSkeleton(osg::NodeVisitor* nv);
 
+        /// Compute mSkinMatrices from the current bone matrices.
+        void prepareSkinning();
+
+        /// Skin into the given geometry buffer using the matrices computed by prepareSkinning().
+        void skin(osg::Geometry& geom);
+
         void updateGeomToSkelMatrix(const osg::NodePath& nodePath);
     };
 
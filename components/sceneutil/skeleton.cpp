@@ -6,6 +6,7 @@
 #include <components/misc/stringops.hpp>
 
 #include <iostream>
+#include <algorithm>
 
 namespace SceneUtil
 {
@@ -39,6 +40,11 @@ Skeleton::Skeleton()
     , mActive(Active)
     , mLastFrameNumber(0)
     , mLastCullFrameNumber(0)
+    , mUpdateInterval(1)
+    , mUpdatePhase(static_cast<unsigned int>(reinterpret_cast<size_t>(this) / sizeof(Skeleton)))
+    , mPoseFrame(0)
+    , mPoseSpan(0)
+    , mPoseHeld(false)
 {
 
 }
@@ -50,6 +56,11 @@ Skeleton::Skeleton(const Skeleton &copy, const osg::CopyOp &copyop)
     , mActive(copy.mActive)
     , mLastFrameNumber(0)
     , mLastCullFrameNumber(0)
+    , mUpdateInterval(copy.mUpdateInterval)
+    , mUpdatePhase(static_cast<unsigned int>(reinterpret_cast<size_t>(this) / sizeof(Skeleton)))
+    , mPoseFrame(0)
+    , mPoseSpan(0)
+    , mPoseHeld(false)
 {
 
 }
@@ -135,9 +146,20 @@ bool Skeleton::getActive() const
     return mActive != Inactive;
 }
 
+void Skeleton::setUpdateInterval(unsigned int interval)
+{
+    mUpdateInterval = std::max(1u, interval);
+}
+
+unsigned int Skeleton::getUpdateInterval() const
+{
+    return mUpdateInterval;
+}
+
 void Skeleton::markDirty()
 {
     mLastFrameNumber = 0;
+    mPoseFrame = 0;
     mBoneCache.clear();
     mBoneCacheInit = false;
 }
@@ -150,6 +172,16 @@ void Skeleton::traverse(osg::NodeVisitor& nv)
             return;
         if (mActive == SemiActive && mLastFrameNumber != 0 && mLastCullFrameNumber+3 <= nv.getTraversalNumber())
             return;
+
+        // the bones are only known once the RigGeometries found them
+        if (mUpdateInterval > 1 && mRootBone.get())
+        {
+            updateThrottled(nv);
+            return;
+        }
+
+        // start over when the interval is used again
+        mPoseFrame = 0;
     }
     else if (nv.getVisitorType() == osg::NodeVisitor::CULL_VISITOR)
         mLastCullFrameNumber = nv.getTraversalNumber();
@@ -157,6 +189,91 @@ void Skeleton::traverse(osg::NodeVisitor& nv)
     osg::Group::traverse(nv);
 }
 
+void Skeleton::updateThrottled(osg::NodeVisitor &nv)
+{
+    const unsigned int frameNumber = nv.getTraversalNumber();
+
+    // the bones of a skeleton that is not seen are held until it is seen again
+    bool visible = mLastCullFrameNumber+3 > frameNumber;
+    if (mPoseFrame == 0 || (visible && (frameNumber + mUpdatePhase) % mUpdateInterval == 0))
+    {
+        if (!mBoneUpdateVisitor)
+            mBoneUpdateVisitor = new osg::NodeVisitor(osg::NodeVisitor::UPDATE_VISITOR, osg::NodeVisitor::TRAVERSE_NONE);
+        mBoneUpdateVisitor->setTraversalNumber(frameNumber);
+        mBoneUpdateVisitor->setFrameStamp(const_cast<osg::FrameStamp*>(nv.getFrameStamp()));
+        updateBoneCallbacks(*mRootBone, *mBoneUpdateVisitor);
+
+        // don't interpolate from a pose that is out of date, e.g. from before the skeleton was last seen
+        bool restart = mPoseFrame == 0 || frameNumber - mPoseFrame > 2 * mUpdateInterval;
+        mPoseSpan = restart ? 0 : frameNumber - mPoseFrame;
+        mPoseFrame = frameNumber;
+        mPoseHeld = false;
+        for (unsigned int i=0; i<mRootBone->mChildren.size(); ++i)
+            mRootBone->mChildren[i]->recordPose(restart);
+    }
+
+    // Show the previous pose when a new one was recorded, and move towards the new one until the next is recorded.
+    // Unlike continuing the motion, this does not overshoot, at the cost of lagging behind by one interval.
+    if (!mPoseHeld)
+    {
+        float factor = 1.f;
+        if (mPoseSpan > 0)
+            factor = std::min(1.f, static_cast<float>(frameNumber - mPoseFrame) / mPoseSpan);
+        for (unsigned int i=0; i<mRootBone->mChildren.size(); ++i)
+            mRootBone->mChildren[i]->interpolatePose(factor);
+        mPoseHeld = factor >= 1.f;
+    }
+
+    traverseBones(*mRootBone, *this, nv);
+}
+
+void Skeleton::updateBoneCallbacks(Bone &bone, osg::NodeVisitor &nv)
+{
+    for (unsigned int i=0; i<bone.mChildren.size(); ++i)
+    {
+        Bone* child = bone.mChildren[i];
+        if (!child->mNode)
+            continue;
+
+        if (osg::Callback* callback = child->mNode->getUpdateCallback())
+            callback->run(child->mNode, &nv);
+
+        updateBoneCallbacks(*child, nv);
+    }
+}
+
+void Skeleton::traverseBones(Bone &bone, osg::Group &node, osg::NodeVisitor &nv)
+{
+    for (unsigned int i=0; i<node.getNumChildren(); ++i)
+    {
+        osg::Node* child = node.getChild(i);
+
+        Bone* childBone = NULL;
+        for (unsigned int j=0; j<bone.mChildren.size(); ++j)
+        {
+            if (bone.mChildren[j]->mNode == child)
+            {
+                childBone = bone.mChildren[j];
+                break;
+            }
+        }
+
+        // anything that is not a bone is updated as usual, e.g. attached objects, particles and RigGeometries
+        if (!childBone)
+        {
+            child->accept(nv);
+            continue;
+        }
+
+        if (!nv.validNodeMask(*child))
+            continue;
+
+        nv.pushOntoNodePath(child);
+        traverseBones(*childBone, *childBone->mNode, nv);
+        nv.popFromNodePath();
+    }
+}
+
 void Skeleton::childInserted(unsigned int)
 {
     markDirty();
@@ -169,6 +286,7 @@ void Skeleton::childRemoved(unsigned int, unsigned int)
 
 Bone::Bone()
     : mNode(NULL)
+    , mHasPoses(false)
 {
 }
 
@@ -197,4 +315,40 @@ void Bone::update(const osg::Matrixf* parentMatrixInSkeletonSpace)
     }
 }
 
+void Bone::recordPose(bool restart)
+{
+    if (mNode)
+    {
+        Pose pose;
+        osg::Quat scaleOrientation;
+        mNode->getMatrix().decompose(pose.mTranslation, pose.mRotation, pose.mScale, scaleOrientation);
+
+        mPoses[0] = (restart || !mHasPoses) ? pose : mPoses[1];
+        mPoses[1] = pose;
+        mHasPoses = true;
+    }
+
+    for (unsigned int i=0; i<mChildren.size(); ++i)
+        mChildren[i]->recordPose(restart);
+}
+
+void Bone::interpolatePose(float factor)
+{
+    if (mNode && mHasPoses)
+    {
+        const Pose& from = mPoses[0];
+        const Pose& to = mPoses[1];
+
+        osg::Quat rotation;
+        rotation.slerp(factor, from.mRotation, to.mRotation);
+        osg::Vec3f scale = from.mScale + (to.mScale - from.mScale) * factor;
+        osg::Vec3f translation = from.mTranslation + (to.mTranslation - from.mTranslation) * factor;
+
+        mNode->setMatrix(osg::Matrix::scale(scale) * osg::Matrix::rotate(rotation) * osg::Matrix::translate(translation));
+    }
+
+    for (unsigned int i=0; i<mChildren.size(); ++i)
+        mChildren[i]->interpolatePose(factor);
+}
+
 }
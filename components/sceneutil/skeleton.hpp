@@ -2,6 +2,8 @@
 #define OPENMW_COMPONENTS_NIFOSG_SKELETON_H
 
 #include <osg/Group>
+#include <osg/Quat>
+#include <osg/Vec3f>
 
 #include <memory>
 
@@ -25,6 +27,26 @@ namespace SceneUtil
         /// Update the skeleton-space matrix of this bone and all its children.
         void update(const osg::Matrixf* parentMatrixInSkeletonSpace);
 
+        /// A local matrix of mNode, decomposed for interpolating.
+        struct Pose
+        {
+            osg::Vec3f mTranslation;
+            osg::Quat mRotation;
+            osg::Vec3f mScale;
+        };
+
+        /// The last two poses recorded while the skeleton's update interval is used, the latest one second.
+        Pose mPoses[2];
+        bool mHasPoses;
+
+        /// Record the current local matrix of this bone and all its children as their latest pose.
+        /// @param restart Make it the previous pose as well, so that nothing is interpolated from older poses.
+        void recordPose(bool restart);
+
+        /// Set the local matrix of this bone and all its children between their last two poses.
+        /// @param factor 0 for the previous pose, 1 for the latest pose.
+        void interpolatePose(float factor);
+
     private:
         Bone(const Bone&);
         void operator=(const Bone&);
@@ -60,6 +82,17 @@ namespace SceneUtil
 
         bool getActive() const;
 
+        /// Only run the update callbacks of the bones every \a interval frames, for distant skeletons whose animation does not
+        /// need to be exact. In the frames in between, the bones are interpolated between the last two updates, so the animation
+        /// lags behind by one interval. Bones of a skeleton that was not drawn in the last frames are not updated at all.
+        /// Other controllers and objects attached to the bones are still updated every frame. Skeletons are assigned different
+        /// phases to spread the work over the frames.
+        /// @par Use 1 to update every frame (default).
+        /// @note Only the bones used by a RigGeometry are throttled.
+        void setUpdateInterval(unsigned int interval);
+
+        unsigned int getUpdateInterval() const;
+
         void traverse(osg::NodeVisitor& nv);
 
         void markDirty();
@@ -68,6 +101,15 @@ namespace SceneUtil
         virtual void childRemoved(unsigned int, unsigned int);
 
     private:
+        /// Update traversal while the update interval is used.
+        void updateThrottled(osg::NodeVisitor& nv);
+
+        /// Run the update callbacks of the children of \a bone and their children, using a visitor that does not traverse.
+        void updateBoneCallbacks(Bone& bone, osg::NodeVisitor& nv);
+
+        /// Traverse the children of \a node, which belongs to \a bone, leaving out the update callbacks of bones.
+        void traverseBones(Bone& bone, osg::Group& node, osg::NodeVisitor& nv);
+
         // The root bone is not a "real" bone, it has no corresponding node in the scene graph.
         // As far as the scene graph goes we support multiple root bones.
         std::unique_ptr<Bone> mRootBone;
@@ -82,6 +124,18 @@ namespace SceneUtil
 
         unsigned int mLastFrameNumber;
         unsigned int mLastCullFrameNumber;
+
+        unsigned int mUpdateInterval;
+        unsigned int mUpdatePhase;
+
+        /// Runs the bones' update callbacks on their own.
+        osg::ref_ptr<osg::NodeVisitor> mBoneUpdateVisitor;
+        /// The frame the latest pose of the bones was recorded in, 0 if none was recorded since the interval was last used.
+        unsigned int mPoseFrame;
+        /// The frames between the last two poses, 0 if there is only one.
+        unsigned int mPoseSpan;
+        /// Whether the bones are set to their latest pose already.
+        bool mPoseHeld;
     };
 
 }
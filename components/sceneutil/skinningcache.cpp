@@ -0,0 +1,82 @@
+#include "skinningcache.hpp"
+
+#include <cmath>
+#include <cstring>
+
+#include <osg/Geometry>
+
+#include "workqueue.hpp"
+
+namespace SceneUtil
+{
+
+SkinningCache::SkinningCache(float precision)
+    : mPrecision(precision)
+    , mFrame(0)
+{
+}
+
+void SkinningCache::makeKey(const std::vector<osg::Matrixf>& matrices, const osg::Vec3f& translation, Key& key) const
+{
+    key.clear();
+    key.reserve(matrices.size() * 12 + 3);
+
+    std::vector<float> values;
+    values.reserve(key.capacity());
+    for (std::vector<osg::Matrixf>::const_iterator it = matrices.begin(); it != matrices.end(); ++it)
+    {
+        // the last column is not used for skinning
+        const float* ptr = it->ptr();
+        for (unsigned int row=0; row<4; ++row)
+            values.insert(values.end(), ptr + row*4, ptr + row*4 + 3);
+    }
+    values.push_back(translation.x());
+    values.push_back(translation.y());
+    values.push_back(translation.z());
+
+    for (std::vector<float>::const_iterator it = values.begin(); it != values.end(); ++it)
+    {
+        int quantized;
+        if (mPrecision > 0)
+            quantized = static_cast<int>(std::floor(*it / mPrecision + 0.5f));
+        else
+        {
+            float value = *it + 0.f; // avoid distinguishing between -0 and 0
+            std::memcpy(&quantized, &value, sizeof(int));
+        }
+        key.push_back(quantized);
+    }
+}
+
+const SkinningCache::Entry* SkinningCache::find(const osg::Referenced* source, const Key& key, unsigned int frame)
+{
+    setFrame(frame);
+
+    EntryMap::const_iterator found = mEntries.find(std::make_pair(source, key));
+    if (found == mEntries.end())
+        return NULL;
+    return &found->second;
+}
+
+void SkinningCache::insert(const osg::Referenced* source, const Key& key, unsigned int frame, const Entry& entry)
+{
+    setFrame(frame);
+
+    mEntries[std::make_pair(source, key)] = entry;
+}
+
+unsigned int SkinningCache::getNumEntries() const
+{
+    return mEntries.size();
+}
+
+void SkinningCache::setFrame(unsigned int frame)
+{
+    if (frame != mFrame)
+    {
+        mEntries.clear();
+        mFrame = frame;
+    }
+}
+
+}
@@ -0,0 +1,64 @@
+#ifndef OPENMW_COMPONENTS_SCENEUTIL_SKINNINGCACHE_H
+#define OPENMW_COMPONENTS_SCENEUTIL_SKINNINGCACHE_H
+
+#include <map>
+#include <vector>
+
+#include <osg/ref_ptr>
+#include <osg/Referenced>
+#include <osg/Matrixf>
+
+namespace osg
+{
+    class Geometry;
+}
+
+namespace SceneUtil
+{
+    class WorkItem;
+
+    /// @brief Shares the results of skinning between RigGeometries that use the same source data and are in the same pose.
+    /// @par Results are only shared within the frame they were created in.
+    /// @note Not thread safe. To be used from the update and cull traversals only, which run on the same thread.
+    class SkinningCache : public osg::Referenced
+    {
+    public:
+        /// @param precision Skinning matrices are rounded to a multiple of this value before being compared. Use 0 to only share
+        /// results for exactly identical matrices.
+        SkinningCache(float precision);
+
+        /// Quantized skinning matrices describing a pose.
+        typedef std::vector<int> Key;
+
+        void makeKey(const std::vector<osg::Matrixf>& matrices, const osg::Vec3f& translation, Key& key) const;
+
+        struct Entry
+        {
+            osg::ref_ptr<osg::Geometry> mGeometry;
+
+            /// The work item producing mGeometry, if any. Must be waited for before the geometry may be used.
+            osg::ref_ptr<WorkItem> mItem;
+        };
+
+        /// @param source Identifies the source data (geometry and influences) that was skinned.
+        /// @return The entry created in \a frame for this source and pose, or NULL if there is none.
+        const Entry* find(const osg::Referenced* source, const Key& key, unsigned int frame);
+
+        void insert(const osg::Referenced* source, const Key& key, unsigned int frame, const Entry& entry);
+
+        unsigned int getNumEntries() const;
+
+    private:
+        /// Drop the entries of earlier frames.
+        void setFrame(unsigned int frame);
+
+        float mPrecision;
+        unsigned int mFrame;
+
+        typedef std::map<std::pair<const osg::Referenced*, Key>, Entry> EntryMap;
+        EntryMap mEntries;
+    };
+
+}
+
+#endif
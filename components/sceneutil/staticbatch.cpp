@@ -0,0 +1,367 @@
+#include "staticbatch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+#include <osg/Geometry>
+#include <osg/Program>
+#include <osg/Transform>
+
+#include <components/shader/shadermanager.hpp>
+
+#include "instancedgeometry.hpp"
+#include "lightmanager.hpp"
+#include "optimizer.hpp"
+
+namespace SceneUtil
+{
+
+namespace
+{
+
+    class CanBatchVisitor : public osg::NodeVisitor
+    {
+    public:
+        CanBatchVisitor(const osg::Node* root, unsigned int cullMask)
+            : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN)
+            , mRoot(root)
+            , mCullMask(cullMask)
+            , mResult(true)
+        {
+        }
+
+        virtual void apply(osg::Node& node)
+        {
+            if (!mResult || !(node.getNodeMask() & mCullMask))
+                return;
+
+            if (&node != mRoot && !canBatch(node))
+            {
+                mResult = false;
+                return;
+            }
+
+            traverse(node);
+        }
+
+        bool canBatch(const osg::Node& node) const
+        {
+            if (node.getNodeMask() != ~0u)
+                return false;
+
+            // controllers
+            if (node.getUpdateCallback() || (node.getStateSet() && node.getStateSet()->getUpdateCallback()))
+                return false;
+
+            // light lists are replaced by the batch's own, anything else (e.g. billboards) would stop working
+            for (const osg::Callback* callback = node.getCullCallback(); callback; callback = callback->getNestedCallback())
+            {
+                if (!dynamic_cast<const LightListCallback*>(callback))
+                    return false;
+            }
+
+            if (const osg::Transform* transform = node.asTransform())
+                return transform->getReferenceFrame() == osg::Transform::RELATIVE_RF
+                        && (node.className() == std::string("MatrixTransform") || node.className() == std::string("PositionAttitudeTransform"));
+
+            // no particle systems, rigs or other special drawables, and no switches, LOD nodes or light sources
+            const std::string className = node.className();
+            return className == "Geometry" || className == "Group";
+        }
+
+        bool getResult() const
+        {
+            return mResult;
+        }
+
+    private:
+        const osg::Node* mRoot;
+        unsigned int mCullMask;
+        bool mResult;
+    };
+
+    /// Combined StateSets, so that geometry below the same StateSets ends up with the same StateSet and can be merged.
+    typedef std::map<std::vector<const osg::StateSet*>, osg::ref_ptr<osg::StateSet> > StateSetCache;
+
+    osg::StateSet* getCombinedStateSet(const std::vector<const osg::StateSet*>& statesets, StateSetCache& cache)
+    {
+        if (statesets.empty())
+            return NULL;
+        if (statesets.size() == 1)
+            return const_cast<osg::StateSet*>(statesets.front());
+
+        osg::ref_ptr<osg::StateSet>& combined = cache[statesets];
+        if (!combined)
+        {
+            combined = new osg::StateSet(*statesets.front(), osg::CopyOp::SHALLOW_COPY);
+            for (unsigned int i=1; i<statesets.size(); ++i)
+                combined->merge(*statesets[i]);
+        }
+        return combined;
+    }
+
+    /// StateSets with the program replaced by its instancing variant, NULL for StateSets that can not be drawn instanced.
+    typedef std::map<osg::StateSet*, osg::ref_ptr<osg::StateSet> > InstancingStateSetCache;
+
+    osg::StateSet* getInstancingStateSet(osg::StateSet* stateset, Shader::ShaderManager* shaderManager, InstancingStateSetCache& cache)
+    {
+        InstancingStateSetCache::iterator found = cache.find(stateset);
+        if (found != cache.end())
+            return found->second;
+
+        osg::ref_ptr<osg::StateSet>& result = cache[stateset];
+        if (!stateset || !shaderManager)
+            return NULL;
+
+        // the fixed function pipeline has no means of reading a per-instance transform
+        const osg::StateSet::RefAttributePair* program = stateset->getAttributePair(osg::StateAttribute::PROGRAM);
+        if (!program)
+            return NULL;
+
+        osg::ref_ptr<osg::Program> variant = shaderManager->getProgramVariant(static_cast<const osg::Program*>(program->first.get()),
+                                                                              "instancing", "1", InstancedGeometry::getAttribBindings());
+        if (!variant)
+            return NULL;
+
+        result = new osg::StateSet(*stateset, osg::CopyOp::SHALLOW_COPY);
+        result->setAttribute(variant, program->second);
+        return result;
+    }
+
+    struct GeometryInstance
+    {
+        const osg::Geometry* mGeometry;
+        osg::Matrixf mMatrix;
+        osg::StateSet* mStateSet;
+    };
+
+    void addGeometry(const osg::Geometry& source, const osg::Matrixf& matrix, osg::StateSet* stateset, osg::Group& target)
+    {
+        if (!dynamic_cast<const osg::Vec3Array*>(source.getVertexArray()))
+            return;
+
+        // arrays and primitives are modified when merging, so they need to be copied as well
+        osg::ref_ptr<osg::Geometry> geom = new osg::Geometry(source, osg::CopyOp::DEEP_COPY_ARRAYS|osg::CopyOp::DEEP_COPY_PRIMITIVES);
+        geom->setStateSet(stateset);
+
+        osg::Vec3Array* vertices = static_cast<osg::Vec3Array*>(geom->getVertexArray());
+        for (osg::Vec3Array::iterator it = vertices->begin(); it != vertices->end(); ++it)
+            *it = *it * matrix;
+
+        osg::Matrixf inverse = osg::Matrixf::inverse(matrix);
+        if (osg::Vec3Array* normals = dynamic_cast<osg::Vec3Array*>(geom->getNormalArray()))
+        {
+            for (osg::Vec3Array::iterator it = normals->begin(); it != normals->end(); ++it)
+            {
+                *it = osg::Matrixf::transform3x3(inverse, *it);
+                it->normalize();
+            }
+        }
+
+        if (osg::Vec4Array* tangents = dynamic_cast<osg::Vec4Array*>(geom->getTexCoordArray(7)))
+        {
+            for (osg::Vec4Array::iterator it = tangents->begin(); it != tangents->end(); ++it)
+            {
+                osg::Vec3f tangent = osg::Matrixf::transform3x3(osg::Vec3f(it->x(), it->y(), it->z()), matrix);
+                tangent.normalize();
+                *it = osg::Vec4f(tangent, it->w());
+            }
+        }
+
+        vertices->dirty();
+        geom->dirtyBound();
+        target.addChild(geom);
+    }
+
+    void collectGeometry(const osg::Node& node, const osg::Matrixf& matrix, unsigned int cullMask, float minRadius,
+                         std::vector<const osg::StateSet*>& statesets, StateSetCache& stateSetCache, std::vector<GeometryInstance>& target)
+    {
+        if (!(node.getNodeMask() & cullMask))
+            return;
+
+        // the bounds of drawables are in their own space, unlike those of transforms
+        if (minRadius > 0.f && node.asGeometry())
+        {
+            osg::Vec3f scale = matrix.getScale();
+            if (node.asGeometry()->getBound().radius() * std::max(scale.x(), std::max(scale.y(), scale.z())) < minRadius)
+                return;
+        }
+
+        if (node.getStateSet())
+            statesets.push_back(node.getStateSet());
+
+        if (const osg::Geometry* geom = node.asGeometry())
+        {
+            GeometryInstance instance;
+            instance.mGeometry = geom;
+            instance.mMatrix = matrix;
+            instance.mStateSet = getCombinedStateSet(statesets, stateSetCache);
+            target.push_back(instance);
+        }
+        else if (const osg::Group* group = node.asGroup())
+        {
+            for (unsigned int i=0; i<group->getNumChildren(); ++i)
+            {
+                const osg::Node& child = *group->getChild(i);
+                osg::Matrixf childMatrix = matrix;
+                if (const osg::Transform* transform = child.asTransform())
+                {
+                    osg::Matrix local;
+                    transform->computeLocalToWorldMatrix(local, NULL);
+                    childMatrix = osg::Matrixf(local) * matrix;
+                }
+                collectGeometry(child, childMatrix, cullMask, minRadius, statesets, stateSetCache, target);
+            }
+        }
+
+        if (node.getStateSet())
+            statesets.pop_back();
+    }
+
+}
+
+StaticBatch::StaticBatch(float cellSize, unsigned int cullMask)
+    : mCellSize(cellSize)
+    , mCullMask(cullMask)
+    , mMinInstances(0)
+    , mShaderManager(NULL)
+    , mMinRadius(0.f)
+    , mAborted(0)
+{
+}
+
+void StaticBatch::addObject(osg::ref_ptr<const osg::Node> node, const osg::Matrixf &worldMatrix)
+{
+    Object object;
+    object.mNode = node;
+    object.mWorldMatrix = worldMatrix;
+    mObjects.push_back(object);
+}
+
+void StaticBatch::setMinInstances(unsigned int minInstances)
+{
+    mMinInstances = minInstances;
+}
+
+void StaticBatch::setShaderManager(Shader::ShaderManager *shaderManager)
+{
+    mShaderManager = shaderManager;
+}
+
+void StaticBatch::setMinRadius(float radius)
+{
+    mMinRadius = radius;
+}
+
+unsigned int StaticBatch::getNumObjects() const
+{
+    return mObjects.size();
+}
+
+bool StaticBatch::canBatch(const osg::Node *node, unsigned int cullMask)
+{
+    CanBatchVisitor visitor(node, cullMask);
+    const_cast<osg::Node*>(node)->accept(visitor);
+    return visitor.getResult();
+}
+
+void StaticBatch::doWork()
+{
+    osg::ref_ptr<osg::Group> result = new osg::Group;
+    result->setName("Static Batch");
+
+    struct Group
+    {
+        osg::ref_ptr<osg::Group> mNode;
+        std::vector<GeometryInstance> mGeometry;
+    };
+    typedef std::map<std::pair<int, int>, Group> GroupMap;
+    GroupMap groups;
+    StateSetCache stateSetCache;
+    InstancingStateSetCache instancingStateSetCache;
+    std::vector<const osg::StateSet*> statesets;
+
+    for (std::vector<Object>::const_iterator it = mObjects.begin(); it != mObjects.end(); ++it)
+    {
+        if (mAborted)
+            return;
+
+        const osg::Vec3f pos = it->mWorldMatrix.getTrans();
+        std::pair<int, int> key (static_cast<int>(std::floor(pos.x() / mCellSize)), static_cast<int>(std::floor(pos.y() / mCellSize)));
+
+        Group& group = groups[key];
+        if (!group.mNode)
+        {
+            group.mNode = new osg::Group;
+            group.mNode->addCullCallback(new LightListCallback);
+            result->addChild(group.mNode);
+        }
+
+        collectGeometry(*it->mNode, it->mWorldMatrix, mCullMask, mMinRadius, statesets, stateSetCache, group.mGeometry);
+    }
+
+    for (GroupMap::iterator it = groups.begin(); it != groups.end(); ++it)
+    {
+        if (mAborted)
+            return;
+
+        osg::Group& node = *it->second.mNode;
+        const std::vector<GeometryInstance>& geometry = it->second.mGeometry;
+
+        // geometry of the same mesh is shared by all of its instances, so it can be identified by its address
+        typedef std::map<std::pair<const osg::Geometry*, osg::StateSet*>, osg::ref_ptr<InstancedGeometry> > InstanceMap;
+        InstanceMap instances;
+        if (mMinInstances > 0)
+        {
+            std::map<std::pair<const osg::Geometry*, osg::StateSet*>, unsigned int> counts;
+            for (std::vector<GeometryInstance>::const_iterator geom = geometry.begin(); geom != geometry.end(); ++geom)
+                ++counts[std::make_pair(geom->mGeometry, geom->mStateSet)];
+
+            for (std::map<std::pair<const osg::Geometry*, osg::StateSet*>, unsigned int>::const_iterator count = counts.begin(); count != counts.end(); ++count)
+            {
+                if (count->second < mMinInstances)
+                    continue;
+                osg::StateSet* stateset = getInstancingStateSet(count->first.second, mShaderManager, instancingStateSetCache);
+                if (!stateset)
+                    continue;
+                osg::ref_ptr<InstancedGeometry> drawable = new InstancedGeometry(count->first.first);
+                drawable->setStateSet(stateset);
+                instances[count->first] = drawable;
+            }
+        }
+
+        for (std::vector<GeometryInstance>::const_iterator geom = geometry.begin(); geom != geometry.end(); ++geom)
+        {
+            InstanceMap::iterator found = instances.find(std::make_pair(geom->mGeometry, geom->mStateSet));
+            if (found != instances.end())
+                found->second->addInstance(geom->mMatrix);
+            else
+                addGeometry(*geom->mGeometry, geom->mMatrix, geom->mStateSet, node);
+        }
+
+        Optimizer optimizer;
+        optimizer.optimize(&node, Optimizer::MERGE_GEOMETRY);
+
+        for (InstanceMap::iterator instance = instances.begin(); instance != instances.end(); ++instance)
+            node.addChild(instance->second);
+    }
+
+    // compute the bounds here rather than in the cull traversal
+    result->getBound();
+
+    mObjects.clear();
+    mResult = result;
+}
+
+void StaticBatch::abort()
+{
+    mAborted = 1;
+}
+
+osg::ref_ptr<osg::Group> StaticBatch::getResult() const
+{
+    return mResult;
+}
+
+}
@@ -0,0 +1,84 @@
+#ifndef OPENMW_COMPONENTS_SCENEUTIL_STATICBATCH_H
+#define OPENMW_COMPONENTS_SCENEUTIL_STATICBATCH_H
+
+#include <vector>
+
+#include <osg/ref_ptr>
+#include <osg/Matrixf>
+#include <osg/Group>
+
+#include "workqueue.hpp"
+
+namespace Shader
+{
+    class ShaderManager;
+}
+
+namespace SceneUtil
+{
+
+    /// @brief Merges the geometry of many static objects into few drawables, reducing the number of nodes and draw calls
+    /// the cull and draw traversals have to deal with.
+    /// @par Objects are grouped by their position on a grid, each group receiving its own light list. Within a group,
+    /// geometry sharing the same StateSet is merged, while meshes that are repeated often and use shaders can be drawn
+    /// with hardware instancing instead.
+    /// @note The work item only reads from the objects' subgraphs, but these must not be changed until it is done.
+    class StaticBatch : public WorkItem
+    {
+    public:
+        /// @param cellSize Size of the grid cells objects are grouped in.
+        /// @param cullMask Nodes whose node mask does not match are hidden and left out.
+        StaticBatch(float cellSize, unsigned int cullMask);
+
+        /// Add an object to be merged. Must be called before the work item is queued.
+        /// @param node The object's subgraph. The transform of \a node itself, if any, is replaced by \a worldMatrix.
+        void addObject(osg::ref_ptr<const osg::Node> node, const osg::Matrixf& worldMatrix);
+
+        /// Draw a mesh with an InstancedGeometry rather than merging copies of it, if it appears at least \a minInstances
+        /// times in the same group. 0 (the default) always merges.
+        /// @note Requires a shader manager, as only meshes drawn with its shaders can be instanced. Others are merged.
+        void setMinInstances(unsigned int minInstances);
+
+        /// Set the shader manager to get the instancing variants of shader programs from.
+        void setShaderManager(Shader::ShaderManager* shaderManager);
+
+        /// Leave out the parts of objects that are smaller than \a radius once transformed, e.g. the small details of large
+        /// buildings seen from far away. 0 (the default) keeps everything.
+        void setMinRadius(float radius);
+
+        unsigned int getNumObjects() const;
+
+        /// Check if the subgraph below \a node can be merged, i.e. does not contain anything that is animated or updated,
+        /// such as controllers, particle systems, lights, switches or skinned geometry.
+        /// @note Call this before adding \a node, from the thread that owns it.
+        static bool canBatch(const osg::Node* node, unsigned int cullMask);
+
+        virtual void doWork();
+
+        virtual void abort();
+
+        /// The merged geometry, only valid once the work item is done. NULL if aborted.
+        osg::ref_ptr<osg::Group> getResult() const;
+
+    private:
+        float mCellSize;
+        unsigned int mCullMask;
+        unsigned int mMinInstances;
+        Shader::ShaderManager* mShaderManager;
+        float mMinRadius;
+
+        struct Object
+        {
+            osg::ref_ptr<const osg::Node> mNode;
+            osg::Matrixf mWorldMatrix;
+        };
+        std::vector<Object> mObjects;
+
+        osg::ref_ptr<osg::Group> mResult;
+
+        OpenThreads::Atomic mAborted;
+    };
+
+}
+
+#endif
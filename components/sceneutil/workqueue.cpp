@@ -1,7 +1,10 @@
 #include "workqueue.hpp"
 
+#include <algorithm>
 #include <iostream>
 
+#include <osg/Stats>
+
 namespace SceneUtil
 {
 
@@ -27,6 +30,9 @@ void WorkItem::signalDone()
 }
 
 WorkItem::WorkItem()
+    : mPriority(0)
+    , mPool(WorkQueue::Pool_CPU)
+    , mQueuedTime(0)
 {
 }
 
@@ -39,14 +45,50 @@ bool WorkItem::isDone() const
     return (mDone > 0);
 }
 
-WorkQueue::WorkQueue(int workerThreads)
+bool WorkItem::isCancelled() const
+{
+    return (mCancelled > 0);
+}
+
+void WorkItem::setPriority(int priority)
+{
+    mPriority = priority;
+}
+
+int WorkItem::getPriority() const
+{
+    return mPriority;
+}
+
+void WorkItem::setPool(int pool)
+{
+    mPool = pool;
+}
+
+int WorkItem::getPool() const
+{
+    return mPool;
+}
+
+WorkQueue::WorkQueue(int workerThreads, int ioThreads)
     : mIsReleased(false)
+    , mNumItems(0)
+    , mNumStarted(0)
+    , mTotalWait(0.0)
+    , mMaxWait(0.0)
+    , mNumCancelled(0)
 {
-    for (int i=0; i<workerThreads; ++i)
+    mNumPoolThreads[Pool_CPU] = std::max(0, workerThreads);
+    mNumPoolThreads[Pool_IO] = std::max(0, ioThreads);
+
+    for (int pool=0; pool<NumPools; ++pool)
     {
-        WorkThread* thread = new WorkThread(this);
-        mThreads.push_back(thread);
-        thread->startThread();
+        for (unsigned int i=0; i<mNumPoolThreads[pool]; ++i)
+        {
+            WorkThread* thread = new WorkThread(this, pool);
+            mThreads.push_back(thread);
+            thread->startThread();
+        }
     }
 }
 
@@ -54,8 +96,9 @@ WorkQueue::~WorkQueue()
 {
     {
         OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
-        while (!mQueue.empty())
-            mQueue.pop_back();
+        for (int pool=0; pool<NumPools; ++pool)
+            mQueues[pool].clear();
+        mNumItems = 0;
         mIsReleased = true;
         mCondition.broadcast();
     }
@@ -67,6 +110,13 @@ WorkQueue::~WorkQueue()
     }
 }
 
+int WorkQueue::getRunningPool(int pool) const
+{
+    if (pool < 0 || pool >= NumPools || !mNumPoolThreads[pool])
+        return Pool_CPU;
+    return pool;
+}
+
 void WorkQueue::addWorkItem(osg::ref_ptr<WorkItem> item, bool front)
 {
     if (item->isDone())
@@ -75,25 +125,94 @@ void WorkQueue::addWorkItem(osg::ref_ptr<WorkItem> item, bool front)
         return;
     }
 
+    item->mQueuedTime = osg::Timer::instance()->tick();
+
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+    std::deque<osg::ref_ptr<WorkItem> >& queue = mQueues[getRunningPool(item->getPool())][item->getPriority()];
     if (front)
-        mQueue.push_front(item);
+        queue.push_front(item);
     else
-        mQueue.push_back(item);
-    mCondition.signal();
+        queue.push_back(item);
+    ++mNumItems;
+    // threads of different pools wait on the same condition
+    mCondition.broadcast();
+}
+
+bool WorkQueue::remove(WorkItem *item)
+{
+    ItemQueue& queues = mQueues[getRunningPool(item->getPool())];
+    ItemQueue::iterator found = queues.find(item->getPriority());
+    if (found == queues.end())
+        return false;
+
+    std::deque<osg::ref_ptr<WorkItem> >& queue = found->second;
+    for (std::deque<osg::ref_ptr<WorkItem> >::iterator it = queue.begin(); it != queue.end(); ++it)
+    {
+        if (*it == item)
+        {
+            queue.erase(it);
+            if (queue.empty())
+                queues.erase(found);
+            --mNumItems;
+            return true;
+        }
+    }
+    return false;
 }
 
-osg::ref_ptr<WorkItem> WorkQueue::removeWorkItem()
+bool WorkQueue::setPriority(WorkItem *item, int priority, bool front)
 {
+    osg::ref_ptr<WorkItem> ref (item);
+
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
-    while (mQueue.empty() && !mIsReleased)
+    if (!remove(item))
+        return false;
+
+    item->mPriority = priority;
+    std::deque<osg::ref_ptr<WorkItem> >& queue = mQueues[getRunningPool(item->getPool())][priority];
+    if (front)
+        queue.push_front(ref);
+    else
+        queue.push_back(ref);
+    ++mNumItems;
+    return true;
+}
+
+bool WorkQueue::cancel(WorkItem *item)
+{
+    osg::ref_ptr<WorkItem> ref (item);
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+        if (!remove(item))
+            return false;
+        ++mNumCancelled;
+    }
+
+    item->mCancelled.exchange(1);
+    item->signalDone();
+    return true;
+}
+
+osg::ref_ptr<WorkItem> WorkQueue::removeWorkItem(int pool)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+    while (mQueues[pool].empty() && !mIsReleased)
     {
         mCondition.wait(&mMutex);
     }
-    if (!mQueue.empty())
+    if (!mQueues[pool].empty())
     {
-        osg::ref_ptr<WorkItem> item = mQueue.front();
-        mQueue.pop_front();
+        ItemQueue::iterator highest = mQueues[pool].begin();
+        osg::ref_ptr<WorkItem> item = highest->second.front();
+        highest->second.pop_front();
+        if (highest->second.empty())
+            mQueues[pool].erase(highest);
+        --mNumItems;
+
+        double wait = osg::Timer::instance()->delta_s(item->mQueuedTime, osg::Timer::instance()->tick());
+        ++mNumStarted;
+        mTotalWait += wait;
+        mMaxWait = std::max(mMaxWait, wait);
         return item;
     }
     else
@@ -103,7 +222,12 @@ osg::ref_ptr<WorkItem> WorkQueue::removeWorkItem()
 unsigned int WorkQueue::getNumItems() const
 {
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
-    return mQueue.size();
+    return mNumItems;
+}
+
+unsigned int WorkQueue::getNumThreads() const
+{
+    return mNumPoolThreads[Pool_CPU];
 }
 
 unsigned int WorkQueue::getNumActiveThreads() const
@@ -117,8 +241,28 @@ unsigned int WorkQueue::getNumActiveThreads() const
     return count;
 }
 
-WorkThread::WorkThread(WorkQueue *workQueue)
+void WorkQueue::reportStats(unsigned int frameNumber, osg::Stats *stats) const
+{
+    stats->setAttribute(frameNumber, "WorkQueue", getNumItems());
+    stats->setAttribute(frameNumber, "WorkThread", getNumActiveThreads());
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+    if (mNumStarted)
+    {
+        stats->setAttribute(frameNumber, "WorkQueue Wait ms", mTotalWait / mNumStarted * 1000.0);
+        stats->setAttribute(frameNumber, "WorkQueue Max ms", mMaxWait * 1000.0);
+    }
+    stats->setAttribute(frameNumber, "WorkQueue Cancel", mNumCancelled);
+
+    mNumStarted = 0;
+    mTotalWait = 0.0;
+    mMaxWait = 0.0;
+    mNumCancelled = 0;
+}
+
+WorkThread::WorkThread(WorkQueue *workQueue, int pool)
     : mWorkQueue(workQueue)
+    , mPool(pool)
     , mActive(false)
 {
 }
@@ -127,7 +271,7 @@ void WorkThread::run()
 {
     while (true)
     {
-        osg::ref_ptr<WorkItem> item = mWorkQueue->removeWorkItem();
+        osg::ref_ptr<WorkItem> item = mWorkQueue->removeWorkItem(mPool);
         if (!item)
             return;
         mActive = true;
@@ -8,8 +8,17 @@
 
 #include <osg/Referenced>
 #include <osg/ref_ptr>
+#include <osg/Timer>
 
-#include <queue>
+#include <deque>
+#include <functional>
+#include <map>
+#include <vector>
+
+namespace osg
+{
+    class Stats;
+}
 
 namespace SceneUtil
 {
@@ -34,52 +43,118 @@ namespace SceneUtil
         /// Set abort flag in order to return from doWork() as soon as possible. May not be respected by all WorkItems.
         virtual void abort() {}
 
+        /// Check if the item was cancelled by WorkQueue::cancel() before it was started, i.e. it is done without doWork() having run.
+        bool isCancelled() const;
+
+        /// Items of a higher priority are started first. The default is 0, negative values are meant for speculative work.
+        /// @note Use WorkQueue::setPriority() once the item was added to a queue.
+        void setPriority(int priority);
+        int getPriority() const;
+
+        /// Set the pool of threads of a WorkQueue to run the item, see WorkQueue::Pool.
+        /// @note Call before adding the item to a queue.
+        void setPool(int pool);
+        int getPool() const;
+
     protected:
         OpenThreads::Atomic mDone;
         OpenThreads::Mutex mMutex;
         OpenThreads::Condition mCondition;
+
+    private:
+        friend class WorkQueue;
+
+        OpenThreads::Atomic mCancelled;
+        int mPriority;
+        int mPool;
+        osg::Timer_t mQueuedTime;
     };
 
     class WorkThread;
 
     /// @brief A work queue that users can push work items onto, to be completed by one or more background threads.
-    /// @note Work items will be processed in the order that they were given in, however
+    /// @note Work items of the same priority will be processed in the order that they were given in, however
     /// if multiple work threads are involved then it is possible for a later item to complete before earlier items.
     class WorkQueue : public osg::Referenced
     {
     public:
-        WorkQueue(int numWorkerThreads=1);
+        /// Kinds of work that can be given threads of their own, so that one kind can't hold up the other.
+        enum Pool
+        {
+            /// Work bound by computation, the default.
+            Pool_CPU,
+            /// Work that mostly waits for files to be read or written.
+            Pool_IO,
+
+            NumPools
+        };
+
+        /// @param numIOThreads Threads for the IO pool. Without any, its items are run by the threads of the CPU pool.
+        WorkQueue(int numWorkerThreads=1, int numIOThreads=0);
         ~WorkQueue();
 
-        /// Add a new work item to the back of the queue.
+        /// Add a new work item to the back of the queue, behind the items of the same or a higher priority.
         /// @par The work item's waitTillDone() method may be used by the caller to wait until the work is complete.
-        /// @param front If true, add item to the front of the queue. If false (default), add to the back.
+        /// @param front If true, add item in front of the items of the same priority. If false (default), add behind them.
         void addWorkItem(osg::ref_ptr<WorkItem> item, bool front=false);
 
-        /// Get the next work item from the front of the queue. If the queue is empty, waits until a new item is added.
+        /// Change the priority of a work item that is still waiting in the queue, e.g. because its result is needed sooner than expected.
+        /// @param front If true, move the item in front of the items of its new priority.
+        /// @return false if the item is not in the queue, i.e. it has already been started or was never added.
+        bool setPriority(WorkItem* item, int priority, bool front=false);
+
+        /// Remove a work item that is still waiting in the queue, e.g. because its result is no longer needed.
+        /// The item is marked as done and cancelled, so waiting for it won't block.
+        /// @return false if the item is not in the queue, i.e. it has already been started or was never added.
+        bool cancel(WorkItem* item);
+
+        /// Get the next work item of a pool. If there is none, waits until a new item is added.
         /// If the workqueue is in the process of being destroyed, may return NULL.
         /// @par Used internally by the WorkThread.
-        osg::ref_ptr<WorkItem> removeWorkItem();
+        osg::ref_ptr<WorkItem> removeWorkItem(int pool);
 
         unsigned int getNumItems() const;
 
         unsigned int getNumActiveThreads() const;
 
+        /// Get the number of threads in the CPU pool, which is where helpers for splitting up work should be added.
+        unsigned int getNumThreads() const;
+
+        /// Report the number of waiting items and active threads, and how long the items started since the last report had
+        /// been waiting in the queue.
+        void reportStats(unsigned int frameNumber, osg::Stats* stats) const;
+
     private:
+        /// The pool that runs items of \a pool.
+        int getRunningPool(int pool) const;
+
+        /// @note Call with the mutex locked.
+        bool remove(WorkItem* item);
+
         bool mIsReleased;
-        std::deque<osg::ref_ptr<WorkItem> > mQueue;
+
+        /// The waiting items of each pool, by descending priority.
+        typedef std::map<int, std::deque<osg::ref_ptr<WorkItem> >, std::greater<int> > ItemQueue;
+        ItemQueue mQueues[NumPools];
+        unsigned int mNumItems;
 
         mutable OpenThreads::Mutex mMutex;
         OpenThreads::Condition mCondition;
 
         std::vector<WorkThread*> mThreads;
+        unsigned int mNumPoolThreads[NumPools];
+
+        mutable unsigned int mNumStarted;
+        mutable double mTotalWait;
+        mutable double mMaxWait;
+        mutable unsigned int mNumCancelled;
     };
 
     /// Internally used by WorkQueue.
     class WorkThread : public OpenThreads::Thread
     {
     public:
-        WorkThread(WorkQueue* workQueue);
+        WorkThread(WorkQueue* workQueue, int pool);
 
         virtual void run();
 
@@ -87,6 +162,7 @@ namespace SceneUtil
 
     private:
         WorkQueue* mWorkQueue;
+        int mPool;
         volatile bool mActive;
     };
 
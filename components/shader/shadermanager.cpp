@@ -162,6 +162,54 @@ namespace Shader
         return found->second;
     }
 
+    osg::ref_ptr<osg::Program> ShaderManager::getProgramVariant(const osg::Program *program, const std::string &define, const std::string &value,
+                                                                const osg::Program::AttribBindingList &bindings)
+    {
+        MapKey vertexKey;
+        osg::ref_ptr<osg::Shader> fragmentShader;
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+            ProgramMap::const_iterator found = mPrograms.begin();
+            for (; found != mPrograms.end(); ++found)
+            {
+                if (found->second == program)
+                    break;
+            }
+            if (found == mPrograms.end())
+                return NULL;
+
+            ShaderMap::const_iterator shader = mShaders.begin();
+            for (; shader != mShaders.end(); ++shader)
+            {
+                if (shader->second == found->first.first)
+                    break;
+            }
+            if (shader == mShaders.end())
+                return NULL;
+
+            vertexKey = shader->first;
+            fragmentShader = found->first.second;
+        }
+
+        vertexKey.second[define] = value;
+        osg::ref_ptr<osg::Shader> vertexShader = getShader(vertexKey.first, vertexKey.second, osg::Shader::VERTEX);
+        if (!vertexShader)
+            return NULL;
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+        ProgramMap::iterator found = mPrograms.find(std::make_pair(vertexShader, fragmentShader));
+        if (found == mPrograms.end())
+        {
+            osg::ref_ptr<osg::Program> variant (new osg::Program);
+            variant->addShader(vertexShader);
+            variant->addShader(fragmentShader);
+            for (osg::Program::AttribBindingList::const_iterator it = bindings.begin(); it != bindings.end(); ++it)
+                variant->addBindAttribLocation(it->first, it->second);
+            found = mPrograms.insert(std::make_pair(std::make_pair(vertexShader, fragmentShader), variant)).first;
+        }
+        return found->second;
+    }
+
     void ShaderManager::releaseGLObjects(osg::State *state)
     {
         OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
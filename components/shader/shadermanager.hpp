@@ -7,6 +7,7 @@
 #include <osg/ref_ptr>
 
 #include <osg/Shader>
+#include <osg/Program>
 
 #include <OpenThreads/Mutex>
 
@@ -32,6 +33,13 @@ namespace Shader
 
         osg::ref_ptr<osg::Program> getProgram(osg::ref_ptr<osg::Shader> vertexShader, osg::ref_ptr<osg::Shader> fragmentShader);
 
+        /// Get a program like \a program, but with \a define set to \a value in its vertex shader.
+        /// @param bindings Attribute locations to bind, only applied when the program is first created.
+        /// @note Returns NULL if \a program was not created by this manager, or the variant fails to build.
+        /// @note Thread safe.
+        osg::ref_ptr<osg::Program> getProgramVariant(const osg::Program* program, const std::string& define, const std::string& value,
+                                                     const osg::Program::AttribBindingList& bindings);
+
         void releaseGLObjects(osg::State* state);
 
     private:
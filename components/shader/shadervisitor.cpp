@@ -162,7 +162,7 @@ namespace Shader
                 boost::replace_last(normalHeightMap, ".", mNormalHeightMapPattern + ".");
                 if (mImageManager.getVFS()->exists(normalHeightMap))
                 {
-                    image = mImageManager.getImage(normalHeightMap);
+                    image = mImageManager.getImage(normalHeightMap, Resource::Usage_Data);
                     normalHeight = true;
                 }
                 else
@@ -170,7 +170,7 @@ namespace Shader
                     boost::replace_last(normalMapFileName, ".", mNormalMapPattern + ".");
                     if (mImageManager.getVFS()->exists(normalMapFileName))
                     {
-                        image = mImageManager.getImage(normalMapFileName);
+                        image = mImageManager.getImage(normalMapFileName, Resource::Usage_Data);
                     }
                 }
 
@@ -200,7 +200,7 @@ namespace Shader
                 boost::replace_last(specularMapFileName, ".", mSpecularMapPattern + ".");
                 if (mImageManager.getVFS()->exists(specularMapFileName))
                 {
-                    osg::ref_ptr<osg::Texture2D> specularMapTex (new osg::Texture2D(mImageManager.getImage(specularMapFileName)));
+                    osg::ref_ptr<osg::Texture2D> specularMapTex (new osg::Texture2D(mImageManager.getImage(specularMapFileName, Resource::Usage_Data)));
                     specularMapTex->setWrap(osg::Texture::WRAP_S, diffuseMap->getWrap(osg::Texture::WRAP_S));
                     specularMapTex->setWrap(osg::Texture::WRAP_T, diffuseMap->getWrap(osg::Texture::WRAP_T));
                     specularMapTex->setFilter(osg::Texture::MIN_FILTER, diffuseMap->getFilter(osg::Texture::MIN_FILTER));
@@ -295,6 +295,9 @@ namespace Shader
 
         defineMap["parallax"] = reqs.mNormalHeight ? "1" : "0";
 
+        // only enabled in the variants used by SceneUtil::InstancedGeometry
+        defineMap["instancing"] = "0";
+
         osg::ref_ptr<osg::Shader> vertexShader (mShaderManager.getShader(mDefaultVsTemplate, defineMap, osg::Shader::VERTEX));
         osg::ref_ptr<osg::Shader> fragmentShader (mShaderManager.getShader(mDefaultFsTemplate, defineMap, osg::Shader::FRAGMENT));
 
@@ -8,6 +8,8 @@
 
 #include <components/resource/objectcache.hpp>
 #include <components/resource/scenemanager.hpp>
+#include <components/resource/scenediskcache.hpp>
+#include <components/resource/imagemanager.hpp>
 
 #include <components/sceneutil/positionattitudetransform.hpp>
 #include <components/sceneutil/lightmanager.hpp>
@@ -73,6 +75,39 @@ void ChunkManager::setCullingActive(bool active)
     mCullingActive = active;
 }
 
+void ChunkManager::setDiskCache(std::shared_ptr<Resource::SceneDiskCache> diskCache)
+{
+    mDiskCache = diskCache;
+}
+
+std::string ChunkManager::getCompositeMapDiskCacheKey(float chunkSize, const osg::Vec2f &chunkCenter)
+{
+    unsigned int checksum;
+    if (!mDiskCache || !mStorage->getBlendmapChecksum(chunkSize, chunkCenter, checksum))
+        return std::string();
+
+    // composite maps are stored compressed where possible
+    std::ostringstream stream;
+    stream << "terrain composite map " << chunkSize << " " << chunkCenter.x() << " " << chunkCenter.y() << " " << mCompositeMapSize
+           << " " << checksum << " " << Resource::isS3TCSupported();
+    return stream.str();
+}
+
+osg::ref_ptr<osg::Texture2D> ChunkManager::readCompositeMap(const std::string &diskCacheKey)
+{
+    osg::ref_ptr<osg::Image> image = mDiskCache->readImage(diskCacheKey);
+    if (!image)
+        return NULL;
+
+    osg::ref_ptr<osg::Texture2D> texture (new osg::Texture2D(image));
+    texture->setFilter(osg::Texture::MIN_FILTER, osg::Texture::LINEAR);
+    texture->setFilter(osg::Texture::MAG_FILTER, osg::Texture::LINEAR);
+    texture->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+    texture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+    texture->setResizeNonPowerOfTwoHint(false);
+    return texture;
+}
+
 osg::ref_ptr<osg::Texture2D> ChunkManager::createCompositeMapRTT()
 {
     osg::ref_ptr<osg::Texture2D> texture = new osg::Texture2D;
@@ -139,7 +174,7 @@ std::vector<osg::ref_ptr<osg::StateSet> > ChunkManager::createPasses(float chunk
             textureLayer.mDiffuseMap = mTextureManager->getTexture(it->mDiffuseMap);
 
             if (!forCompositeMap && !it->mNormalMap.empty())
-                textureLayer.mNormalMap = mTextureManager->getTexture(it->mNormalMap);
+                textureLayer.mNormalMap = mTextureManager->getTexture(it->mNormalMap, Resource::Usage_Data);
 
             if (it->requiresShaders())
                 useShaders = true;
@@ -207,17 +242,27 @@ osg::ref_ptr<osg::Node> ChunkManager::createChunk(float chunkSize, const osg::Ve
 
     if (useCompositeMap)
     {
-        osg::ref_ptr<CompositeMap> compositeMap = new CompositeMap;
-        compositeMap->mTexture = createCompositeMapRTT();
+        TextureLayer layer;
 
-        createCompositeMapGeometry(chunkSize, chunkCenter, osg::Vec4f(0,0,1,1), *compositeMap);
+        std::string diskCacheKey = getCompositeMapDiskCacheKey(chunkSize, chunkCenter);
+        if (!diskCacheKey.empty())
+            layer.mDiffuseMap = readCompositeMap(diskCacheKey);
 
-        mCompositeMapRenderer->addCompositeMap(compositeMap.get(), false);
+        if (!layer.mDiffuseMap)
+        {
+            osg::ref_ptr<CompositeMap> compositeMap = new CompositeMap;
+            compositeMap->mTexture = createCompositeMapRTT();
+            compositeMap->mDiskCacheKey = diskCacheKey;
 
-        transform->getOrCreateUserDataContainer()->setUserData(compositeMap);
+            createCompositeMapGeometry(chunkSize, chunkCenter, osg::Vec4f(0,0,1,1), *compositeMap);
+
+            mCompositeMapRenderer->addCompositeMap(compositeMap.get(), false);
+
+            transform->getOrCreateUserDataContainer()->setUserData(compositeMap);
+
+            layer.mDiffuseMap = compositeMap->mTexture;
+        }
 
-        TextureLayer layer;
-        layer.mDiffuseMap = compositeMap->mTexture;
         layer.mParallax = false;
         layer.mSpecular = false;
         geometry->setPasses(::Terrain::createPasses(mSceneManager->getForceShaders() || !mSceneManager->getClampLighting(), mSceneManager->getForcePerPixelLighting(),
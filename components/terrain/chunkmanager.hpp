@@ -1,6 +1,8 @@
 #ifndef OPENMW_COMPONENTS_TERRAIN_CHUNKMANAGER_H
 #define OPENMW_COMPONENTS_TERRAIN_CHUNKMANAGER_H
 
+#include <memory>
+
 #include <components/resource/resourcemanager.hpp>
 
 #include "buffercache.hpp"
@@ -14,6 +16,7 @@ namespace osg
 namespace Resource
 {
     class SceneManager;
+    class SceneDiskCache;
 }
 
 namespace Terrain
@@ -40,11 +43,21 @@ namespace Terrain
 
         void setCullingActive(bool active);
 
+        /// Use composite maps stored in \a diskCache by earlier sessions, rather than rendering them again. Composite maps
+        /// that aren't found are marked to be stored by the CompositeMapRenderer.
+        void setDiskCache(std::shared_ptr<Resource::SceneDiskCache> diskCache);
+
     private:
         osg::ref_ptr<osg::Node> createChunk(float size, const osg::Vec2f& center, int lod, unsigned int lodFlags);
 
         osg::ref_ptr<osg::Texture2D> createCompositeMapRTT();
 
+        /// @return An empty string if composite maps of this chunk can't be stored.
+        std::string getCompositeMapDiskCacheKey(float chunkSize, const osg::Vec2f& chunkCenter);
+
+        /// @return NULL if the composite map is not in the disk cache.
+        osg::ref_ptr<osg::Texture2D> readCompositeMap(const std::string& diskCacheKey);
+
         void createCompositeMapGeometry(float chunkSize, const osg::Vec2f& chunkCenter, const osg::Vec4f& texCoords, CompositeMap& map);
 
         std::vector<osg::ref_ptr<osg::StateSet> > createPasses(float chunkSize, const osg::Vec2f& chunkCenter, bool forCompositeMap);
@@ -58,6 +71,8 @@ namespace Terrain
         unsigned int mCompositeMapSize;
 
         bool mCullingActive;
+
+        std::shared_ptr<Resource::SceneDiskCache> mDiskCache;
     };
 
 }
@@ -8,6 +8,42 @@
 
 #include <algorithm>
 
+#include <components/resource/scenediskcache.hpp>
+#include <components/resource/imageprocessing.hpp>
+#include <components/resource/imagemanager.hpp>
+#include <components/sceneutil/workqueue.hpp>
+
+namespace
+{
+
+    /// Compresses a composite map that was read back, if possible, and writes it to the disk cache.
+    class CompositeMapWriter : public SceneUtil::WorkItem
+    {
+    public:
+        CompositeMapWriter(std::shared_ptr<Resource::SceneDiskCache> diskCache, const std::string& key, osg::Image* image)
+            : mDiskCache(diskCache)
+            , mKey(key)
+            , mImage(image)
+        {
+            setPool(SceneUtil::WorkQueue::Pool_IO);
+        }
+
+        virtual void doWork()
+        {
+            osg::ref_ptr<osg::Image> image = mImage;
+            if (Resource::canCompress(*image) && Resource::isS3TCSupported())
+                image = Resource::compressImage(*image);
+            mDiskCache->writeImage(mKey, *image);
+        }
+
+    private:
+        std::shared_ptr<Resource::SceneDiskCache> mDiskCache;
+        std::string mKey;
+        osg::ref_ptr<osg::Image> mImage;
+    };
+
+}
+
 namespace Terrain
 {
 
@@ -88,7 +124,8 @@ void CompositeMapRenderer::compile(CompositeMap &compositeMap, osg::RenderInfo &
 
     osg::FrameBufferAttachment attach (compositeMap.mTexture);
     mFBO->setAttachment(osg::Camera::COLOR_BUFFER, attach);
-    mFBO->apply(state, osg::FrameBufferObject::DRAW_FRAMEBUFFER);
+    // bound for reading as well, for storing the finished composite map
+    mFBO->apply(state, osg::FrameBufferObject::READ_DRAW_FRAMEBUFFER);
 
     GLenum status = ext->glCheckFramebufferStatus(GL_FRAMEBUFFER_EXT);
 
@@ -134,10 +171,28 @@ void CompositeMapRenderer::compile(CompositeMap &compositeMap, osg::RenderInfo &
 
     state.haveAppliedAttribute(osg::StateAttribute::VIEWPORT);
 
+    if (compositeMap.mCompiled >= compositeMap.mDrawables.size() && !compositeMap.mDiskCacheKey.empty() && mDiskCache)
+        store(compositeMap);
+
     GLuint fboId = state.getGraphicsContext() ? state.getGraphicsContext()->getDefaultFboId() : 0;
     ext->glBindFramebuffer(GL_FRAMEBUFFER_EXT, fboId);
 }
 
+void CompositeMapRenderer::store(const CompositeMap &compositeMap) const
+{
+    osg::ref_ptr<osg::Image> image (new osg::Image);
+    image->readPixels(0, 0, compositeMap.mTexture->getTextureWidth(), compositeMap.mTexture->getTextureHeight(), GL_RGB, GL_UNSIGNED_BYTE);
+    image->setInternalTextureFormat(GL_RGB);
+
+    mWorkQueue->addWorkItem(new CompositeMapWriter(mDiskCache, compositeMap.mDiskCacheKey, image));
+}
+
+void CompositeMapRenderer::setDiskCache(std::shared_ptr<Resource::SceneDiskCache> diskCache, SceneUtil::WorkQueue *workQueue)
+{
+    mDiskCache = diskCache;
+    mWorkQueue = workQueue;
+}
+
 void CompositeMapRenderer::setMinimumTimeAvailableForCompile(double time)
 {
     mMinimumTimeAvailable = time;
@@ -5,7 +5,9 @@
 
 #include <OpenThreads/Mutex>
 
+#include <memory>
 #include <set>
+#include <string>
 
 namespace osg
 {
@@ -14,6 +16,16 @@ namespace osg
     class Texture2D;
 }
 
+namespace Resource
+{
+    class SceneDiskCache;
+}
+
+namespace SceneUtil
+{
+    class WorkQueue;
+}
+
 namespace Terrain
 {
 
@@ -25,6 +37,9 @@ namespace Terrain
         std::vector<osg::ref_ptr<osg::Drawable> > mDrawables;
         osg::ref_ptr<osg::Texture2D> mTexture;
         unsigned int mCompiled;
+
+        /// The key to store the rendered texture under in the disk cache, empty if it shouldn't be stored.
+        std::string mDiskCacheKey;
     };
 
     /**
@@ -53,7 +68,14 @@ namespace Terrain
 
         unsigned int getCompileSetSize() const;
 
+        /// Store composite maps that have a disk cache key in \a diskCache once they are rendered.
+        /// @param workQueue Used to compress and write the composite maps in the background.
+        void setDiskCache(std::shared_ptr<Resource::SceneDiskCache> diskCache, SceneUtil::WorkQueue* workQueue);
+
     private:
+        /// Read back the composite map rendered to the currently bound frame buffer, and store it in the disk cache.
+        void store(const CompositeMap& compositeMap) const;
+
         float mTargetFrameRate;
         double mMinimumTimeAvailable;
         mutable osg::Timer mTimer;
@@ -68,6 +90,9 @@ namespace Terrain
         mutable OpenThreads::Mutex mMutex;
 
         osg::ref_ptr<osg::FrameBufferObject> mFBO;
+
+        std::shared_ptr<Resource::SceneDiskCache> mDiskCache;
+        osg::ref_ptr<SceneUtil::WorkQueue> mWorkQueue;
     };
 
 }
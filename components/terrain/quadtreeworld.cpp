@@ -2,7 +2,14 @@
 
 #include <osgUtil/CullVisitor>
 
+#include <OpenThreads/Atomic>
+#include <OpenThreads/Condition>
+#include <OpenThreads/ScopedLock>
+
 #include <sstream>
+#include <algorithm>
+
+#include <components/sceneutil/workqueue.hpp>
 
 #include "quadtreenode.hpp"
 #include "storage.hpp"
@@ -236,6 +243,11 @@ QuadTreeWorld::~QuadTreeWorld()
     mViewDataMap->clear();
 }
 
+void QuadTreeWorld::setWorkQueue(SceneUtil::WorkQueue *workQueue)
+{
+    mWorkQueue = workQueue;
+}
+
 
 void traverse(QuadTreeNode* node, ViewData* vd, osg::NodeVisitor* nv, LodCallback* lodCallback, const osg::Vec3f& eyePoint, bool visible)
 {
@@ -306,7 +318,9 @@ unsigned int getLodFlags(QuadTreeNode* node, int ourLod, ViewData* vd)
     return lodFlags;
 }
 
-void loadRenderingNode(ViewData::Entry& entry, ViewData* vd, ChunkManager* chunkManager)
+/// @param loadProviders Also load the chunks of the providers, which are only needed for rendering.
+void loadRenderingNode(ViewData::Entry& entry, ViewData* vd, ChunkManager* chunkManager, const std::vector<QuadTreeWorld::ChunkProvider*>& chunkProviders,
+                       bool async, bool loadProviders)
 {
     if (vd->hasChanged())
     {
@@ -325,8 +339,97 @@ void loadRenderingNode(ViewData::Entry& entry, ViewData* vd, ChunkManager* chunk
         int ourLod = Log2(int(entry.mNode->getSize()));
         entry.mRenderingNode = chunkManager->getChunk(entry.mNode->getSize(), entry.mNode->getCenter(), ourLod, entry.mLodFlags);
     }
+
+    if (loadProviders && !entry.mProviderNodesLoaded)
+    {
+        for (std::vector<QuadTreeWorld::ChunkProvider*>::const_iterator it = chunkProviders.begin(); it != chunkProviders.end(); ++it)
+        {
+            osg::ref_ptr<osg::Node> node = (*it)->getChunk(entry.mNode->getSize(), entry.mNode->getCenter(), async);
+            if (node)
+                entry.mProviderNodes.push_back(node);
+        }
+        entry.mProviderNodesLoaded = true;
+    }
 }
 
+/// Minimum number of chunks to load for them to be spread over the work queue.
+const unsigned int sMinParallelPreloadJobs = 8;
+
+/// @brief Loads the chunks of a view, on the preloading thread and on any work queue threads that join in.
+/// @par Chunks are claimed one at a time, so the preloading thread only ever waits for chunks that are already being loaded.
+/// Work items that start late find nothing left to do and don't touch the view.
+class PreloadJobRunner : public osg::Referenced
+{
+public:
+    PreloadJobRunner(ViewData* vd, ChunkManager* chunkManager, const std::vector<QuadTreeWorld::ChunkProvider*>& chunkProviders)
+        : mViewData(vd)
+        , mChunkManager(chunkManager)
+        , mChunkProviders(chunkProviders)
+        , mNumJobs(vd->getNumEntries())
+        , mNext(0)
+        , mFinished(0)
+    {
+    }
+
+    unsigned int getNumJobs() const
+    {
+        return mNumJobs;
+    }
+
+    void run()
+    {
+        while (true)
+        {
+            unsigned int index = (++mNext) - 1;
+            if (index >= mNumJobs)
+                return;
+
+            loadRenderingNode(mViewData->getEntry(index), mViewData, mChunkManager, mChunkProviders, false, true);
+
+            if ((++mFinished) == mNumJobs)
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+                mCondition.broadcast();
+            }
+        }
+    }
+
+    void waitTillDone()
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+        while (mFinished < mNumJobs)
+            mCondition.wait(&mMutex);
+    }
+
+private:
+    ViewData* mViewData;
+    ChunkManager* mChunkManager;
+    std::vector<QuadTreeWorld::ChunkProvider*> mChunkProviders;
+    unsigned int mNumJobs;
+
+    OpenThreads::Atomic mNext;
+    OpenThreads::Atomic mFinished;
+    OpenThreads::Mutex mMutex;
+    OpenThreads::Condition mCondition;
+};
+
+class PreloadJobWorkItem : public SceneUtil::WorkItem
+{
+public:
+    PreloadJobWorkItem(PreloadJobRunner* runner)
+        : mRunner(runner)
+    {
+    }
+
+    virtual void doWork()
+    {
+        mRunner->run();
+    }
+
+private:
+    osg::ref_ptr<PreloadJobRunner> mRunner;
+};
+
 void QuadTreeWorld::accept(osg::NodeVisitor &nv)
 {
     if (nv.getVisitorType() != osg::NodeVisitor::CULL_VISITOR && nv.getVisitorType() != osg::NodeVisitor::INTERSECTION_VISITOR)
@@ -357,7 +460,9 @@ void QuadTreeWorld::accept(osg::NodeVisitor &nv)
     {
         ViewData::Entry& entry = vd->getEntry(i);
 
-        loadRenderingNode(entry, vd, mChunkManager.get());
+        // intersections and culled entries don't need the provided nodes, which are expensive to create
+        bool loadProviders = entry.mVisible && nv.getVisitorType() == osg::NodeVisitor::CULL_VISITOR;
+        loadRenderingNode(entry, vd, mChunkManager.get(), mChunkProviders, true, loadProviders);
 
         if (entry.mVisible)
         {
@@ -369,6 +474,10 @@ void QuadTreeWorld::accept(osg::NodeVisitor &nv)
             }
             entry.mRenderingNode->accept(nv);
         }
+
+        // the provided nodes may stick out of the terrain's bounds, let them cull themselves
+        for (std::vector<osg::ref_ptr<osg::Node> >::const_iterator it = entry.mProviderNodes.begin(); it != entry.mProviderNodes.end(); ++it)
+            (*it)->accept(nv);
     }
 
     vd->reset(nv.getTraversalNumber());
@@ -414,7 +523,7 @@ void QuadTreeWorld::cacheCell(View *view, int x, int y)
     for (unsigned int i=0; i<vd->getNumEntries(); ++i)
     {
         ViewData::Entry& entry = vd->getEntry(i);
-        loadRenderingNode(entry, vd, mChunkManager.get());
+        loadRenderingNode(entry, vd, mChunkManager.get(), mChunkProviders, false, true);
     }
 }
 
@@ -430,11 +539,18 @@ void QuadTreeWorld::preload(View *view, const osg::Vec3f &eyePoint)
     ViewData* vd = static_cast<ViewData*>(view);
     traverse(mRootNode.get(), vd, NULL, mRootNode->getLodCallback(), eyePoint, false);
 
-    for (unsigned int i=0; i<vd->getNumEntries(); ++i)
+    osg::ref_ptr<PreloadJobRunner> runner (new PreloadJobRunner(vd, mChunkManager.get(), mChunkProviders));
+
+    // the calling thread is usually a thread of the same queue, so it's not counted
+    if (mWorkQueue && mWorkQueue->getNumThreads() > 1 && runner->getNumJobs() >= sMinParallelPreloadJobs)
     {
-        ViewData::Entry& entry = vd->getEntry(i);
-        loadRenderingNode(entry, vd, mChunkManager.get());
+        unsigned int numHelpers = std::min(runner->getNumJobs() / sMinParallelPreloadJobs, mWorkQueue->getNumThreads()-1);
+        for (unsigned int i=0; i<numHelpers; ++i)
+            mWorkQueue->addWorkItem(new PreloadJobWorkItem(runner), true);
     }
+
+    runner->run();
+    runner->waitTillDone();
 }
 
 void QuadTreeWorld::reportStats(unsigned int frameNumber, osg::Stats *stats)
@@ -447,5 +563,10 @@ void QuadTreeWorld::setDefaultViewer(osg::Object *obj)
     mViewDataMap->setDefaultViewer(obj);
 }
 
+void QuadTreeWorld::addChunkProvider(QuadTreeWorld::ChunkProvider *provider)
+{
+    mChunkProviders.push_back(provider);
+}
+
 
 }
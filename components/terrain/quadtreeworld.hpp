@@ -3,11 +3,21 @@
 
 #include "world.hpp"
 
+#include <vector>
+
 #include <OpenThreads/Mutex>
 
+#include <osg/Vec2f>
+
 namespace osg
 {
     class NodeVisitor;
+    class Node;
+}
+
+namespace SceneUtil
+{
+    class WorkQueue;
 }
 
 namespace Terrain
@@ -29,12 +39,34 @@ namespace Terrain
         void cacheCell(View *view, int x, int y);
 
         View* createView();
+
+        /// @note The chunks of the view are loaded in parallel if a work queue is set.
         void preload(View* view, const osg::Vec3f& eyePoint);
 
+        /// Set a work queue to help loading the chunks of a view in preload(). It may be the queue preload() itself is called from.
+        void setWorkQueue(SceneUtil::WorkQueue* workQueue);
+
         void reportStats(unsigned int frameNumber, osg::Stats* stats);
 
         virtual void setDefaultViewer(osg::Object* obj);
 
+        /// @brief Supplies additional nodes to be drawn along with the terrain chunks, e.g. distant objects.
+        class ChunkProvider
+        {
+        public:
+            virtual ~ChunkProvider() {}
+
+            /// @param size Size of the chunk in cell units.
+            /// @param center Center of the chunk in cell units.
+            /// @param async Allow the node to be filled in the background, rather than waiting for it to be ready.
+            /// @return The node to draw with the chunk, or NULL if there is nothing to draw. The node is expected to do its own culling.
+            /// @note Thread safe.
+            virtual osg::ref_ptr<osg::Node> getChunk(float size, const osg::Vec2f& center, bool async) = 0;
+        };
+
+        /// @note Ownership is not taken. Add any providers before the terrain is first drawn or preloaded.
+        void addChunkProvider(ChunkProvider* provider);
+
     private:
         void ensureQuadTreeBuilt();
 
@@ -44,6 +76,10 @@ namespace Terrain
 
         OpenThreads::Mutex mQuadTreeMutex;
         bool mQuadTreeBuilt;
+
+        std::vector<ChunkProvider*> mChunkProviders;
+
+        osg::ref_ptr<SceneUtil::WorkQueue> mWorkQueue;
     };
 
 }
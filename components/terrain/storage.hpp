@@ -70,6 +70,14 @@ namespace Terrain
                            ImageVector& blendmaps,
                            std::vector<LayerInfo>& layerList) = 0;
 
+        /// Get a checksum of everything getBlendmaps() depends on for a terrain region, i.e. the land textures of the region
+        /// and the layers they map to, including the contents of the layer textures, to tell if results stored for the region
+        /// in an earlier session are still valid.
+        /// @note May be called from background threads.
+        /// @param checksum The checksum will be stored here.
+        /// @return false if no checksum is available, in which case results for the region should not be stored.
+        virtual bool getBlendmapChecksum (float chunkSize, const osg::Vec2f& chunkCenter, unsigned int& checksum) { return false; }
+
         virtual float getHeightAt (const osg::Vec3f& worldPos) = 0;
 
         virtual LayerInfo getDefaultLayer() = 0;
@@ -37,19 +37,20 @@ void TextureManager::updateTextureFiltering()
     mCache->call(f);
 }
 
-osg::ref_ptr<osg::Texture2D> TextureManager::getTexture(const std::string &name)
+osg::ref_ptr<osg::Texture2D> TextureManager::getTexture(const std::string &name, Resource::ImageUsage usage)
 {
     // don't bother with case folding, since there is only one way of referring to terrain textures we can assume the case is always the same
-    osg::ref_ptr<osg::Object> obj = mCache->getRefFromObjectCache(name);
+    const std::string key = (usage == Resource::Usage_Color) ? name : name + " data";
+    osg::ref_ptr<osg::Object> obj = mCache->getRefFromObjectCache(key);
     if (obj)
         return static_cast<osg::Texture2D*>(obj.get());
     else
     {
-        osg::ref_ptr<osg::Texture2D> texture (new osg::Texture2D(mSceneManager->getImageManager()->getImage(name)));
+        osg::ref_ptr<osg::Texture2D> texture (new osg::Texture2D(mSceneManager->getImageManager()->getImage(name, usage)));
         texture->setWrap(osg::Texture::WRAP_S, osg::Texture::REPEAT);
         texture->setWrap(osg::Texture::WRAP_T, osg::Texture::REPEAT);
         mSceneManager->applyFilterSettings(texture);
-        mCache->addEntryToObjectCache(name, texture.get());
+        mCache->addEntryToObjectCache(key, texture.get());
         return texture;
     }
 }
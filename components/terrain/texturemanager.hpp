@@ -4,6 +4,7 @@
 #include <string>
 
 #include <components/resource/resourcemanager.hpp>
+#include <components/resource/imageprocessing.hpp>
 
 namespace Resource
 {
@@ -25,7 +26,8 @@ namespace Terrain
 
         void updateTextureFiltering();
 
-        osg::ref_ptr<osg::Texture2D> getTexture(const std::string& name);
+        /// @param usage See ImageManager::getImage().
+        osg::ref_ptr<osg::Texture2D> getTexture(const std::string& name, Resource::ImageUsage usage = Resource::Usage_Color);
 
         virtual void reportStats(unsigned int frameNumber, osg::Stats* stats) const;
 
@@ -94,6 +94,7 @@ ViewData::Entry::Entry()
     : mNode(NULL)
     , mVisible(true)
     , mLodFlags(0)
+    , mProviderNodesLoaded(false)
 {
 
 }
@@ -108,6 +109,8 @@ bool ViewData::Entry::set(QuadTreeNode *node, bool visible)
         mNode = node;
         // clear cached data
         mRenderingNode = NULL;
+        mProviderNodes.clear();
+        mProviderNodesLoaded = false;
         return true;
     }
 }
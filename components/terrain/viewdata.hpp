@@ -38,6 +38,10 @@ namespace Terrain
 
             unsigned int mLodFlags;
             osg::ref_ptr<osg::Node> mRenderingNode;
+
+            /// Nodes supplied by the QuadTreeWorld's chunk providers.
+            std::vector<osg::ref_ptr<osg::Node> > mProviderNodes;
+            bool mProviderNodesLoaded;
         };
 
         unsigned int getNumEntries() const;
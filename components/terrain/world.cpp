@@ -5,6 +5,7 @@
 #include <osg/Camera>
 
 #include <components/resource/resourcesystem.hpp>
+#include <components/resource/scenediskcache.hpp>
 
 #include "storage.hpp"
 #include "texturemanager.hpp"
@@ -70,6 +71,16 @@ void World::setTargetFrameRate(float rate)
     mCompositeMapRenderer->setTargetFrameRate(rate);
 }
 
+void World::setDiskCachePath(const std::string &path, SceneUtil::WorkQueue *workQueue)
+{
+    std::shared_ptr<Resource::SceneDiskCache> diskCache (new Resource::SceneDiskCache(path));
+    if (!diskCache->isValid())
+        return;
+
+    mChunkManager->setDiskCache(diskCache);
+    mCompositeMapRenderer->setDiskCache(diskCache, workQueue);
+}
+
 float World::getHeightAt(const osg::Vec3f &worldPos)
 {
     return mStorage->getHeightAt(worldPos);
@@ -6,6 +6,7 @@
 #include <osg/Vec3f>
 
 #include <memory>
+#include <string>
 
 #include "defs.hpp"
 
@@ -22,6 +23,11 @@ namespace Resource
     class ResourceSystem;
 }
 
+namespace SceneUtil
+{
+    class WorkQueue;
+}
+
 namespace Terrain
 {
     class Storage;
@@ -60,6 +66,11 @@ namespace Terrain
         /// See CompositeMapRenderer::setTargetFrameRate
         void setTargetFrameRate(float rate);
 
+        /// Store the composite maps of distant terrain chunks in \a path, so that later sessions don't have to render them again.
+        /// @param workQueue Used to compress and write the composite maps in the background.
+        /// @note Call before any chunks are created.
+        void setDiskCachePath(const std::string& path, SceneUtil::WorkQueue* workQueue);
+
         /// Apply the scene manager's texture filtering settings to all cached textures.
         /// @note Thread safe.
         void updateTextureFiltering();
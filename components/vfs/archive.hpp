@@ -2,6 +2,7 @@
 #define OPENMW_COMPONENTS_RESOURCE_ARCHIVE_H
 
 #include <map>
+#include <string>
 
 #include <components/files/constrainedfilestream.hpp>
 
@@ -14,6 +15,10 @@ namespace VFS
         virtual ~File() {}
 
         virtual Files::IStreamPtr open() = 0;
+
+        /// Describe where the contents of the file come from, without reading them, e.g. its size and location.
+        /// Changes whenever the contents are likely to have changed, so it can be used in the keys of caches.
+        virtual std::string getStamp() const = 0;
     };
 
     class Archive
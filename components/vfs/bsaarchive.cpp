@@ -1,5 +1,7 @@
 #include "bsaarchive.hpp"
 
+#include <sstream>
+
 namespace VFS
 {
 
@@ -40,4 +42,11 @@ Files::IStreamPtr BsaArchiveFile::open()
     return mFile->getFile(mInfo);
 }
 
+std::string BsaArchiveFile::getStamp() const
+{
+    std::ostringstream stream;
+    stream << mFile->getFilename() << ":" << mInfo->offset << ":" << mInfo->fileSize;
+    return stream.str();
+}
+
 }
@@ -15,6 +15,8 @@ namespace VFS
 
         virtual Files::IStreamPtr open();
 
+        virtual std::string getStamp() const;
+
         const Bsa::BSAFile::FileStruct* mInfo;
         Bsa::BSAFile* mFile;
     };
@@ -1,6 +1,7 @@
 #include "filesystemarchive.hpp"
 
 #include <iostream>
+#include <sstream>
 
 #include <boost/filesystem.hpp>
 
@@ -65,4 +66,15 @@ namespace VFS
         return Files::openConstrainedFileStream(mPath.c_str());
     }
 
+    std::string FileSystemArchiveFile::getStamp() const
+    {
+        boost::system::error_code error;
+        boost::uintmax_t size = boost::filesystem::file_size(mPath, error);
+        std::time_t time = boost::filesystem::last_write_time(mPath, error);
+
+        std::ostringstream stream;
+        stream << mPath << ":" << size << ":" << time;
+        return stream.str();
+    }
+
 }
@@ -79,6 +79,17 @@ namespace VFS
         return found->second->open();
     }
 
+    std::string Manager::getStamp(const std::string &name) const
+    {
+        std::string normalized = name;
+        normalize_path(normalized, mStrict);
+
+        std::map<std::string, File*>::const_iterator found = mIndex.find(normalized);
+        if (found == mIndex.end())
+            return std::string();
+        return found->second->getStamp();
+    }
+
     bool Manager::exists(const std::string &name) const
     {
         std::string normalized = name;
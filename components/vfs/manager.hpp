@@ -58,6 +58,11 @@ namespace VFS
         /// @note May be called from any thread once the index has been built.
         Files::IStreamPtr getNormalized(const std::string& normalizedName) const;
 
+        /// Describe where the contents of a file come from without reading them, see File::getStamp().
+        /// @return An empty string if the file can not be found.
+        /// @note May be called from any thread once the index has been built.
+        std::string getStamp(const std::string& name) const;
+
     private:
         bool mStrict;
 
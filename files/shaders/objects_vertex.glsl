@@ -45,16 +45,32 @@ centroid varying vec4 passColor;
 varying vec3 passViewPos;
 varying vec3 passNormal;
 
+#if @instancing
+// the first three columns of the instance's transform, one vec4 per row of the matrix
+attribute vec4 instanceMatrix0;
+attribute vec4 instanceMatrix1;
+attribute vec4 instanceMatrix2;
+#endif
+
 #include "lighting.glsl"
 
 void main(void)
 {
-    gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;
+#if @instancing
+    vec4 vertex = vec4(dot(gl_Vertex, instanceMatrix0), dot(gl_Vertex, instanceMatrix1), dot(gl_Vertex, instanceMatrix2), gl_Vertex.w);
+    mat3 instanceRotation = mat3(instanceMatrix0.xyz, instanceMatrix1.xyz, instanceMatrix2.xyz);
+    vec3 normal = gl_Normal * instanceRotation;
+#else
+    vec4 vertex = gl_Vertex;
+    vec3 normal = gl_Normal;
+#endif
+
+    gl_Position = gl_ModelViewProjectionMatrix * vertex;
     depth = gl_Position.z;
 
-    vec4 viewPos = (gl_ModelViewMatrix * gl_Vertex);
+    vec4 viewPos = (gl_ModelViewMatrix * vertex);
     gl_ClipVertex = viewPos;
-    vec3 viewNormal = normalize((gl_NormalMatrix * gl_Normal).xyz);
+    vec3 viewNormal = normalize((gl_NormalMatrix * normal).xyz);
 
 #if @envMap
     vec3 viewVec = normalize(viewPos.xyz);
@@ -86,6 +102,9 @@ void main(void)
 #if @normalMap
     normalMapUV = (gl_TextureMatrix[@normalMapUV] * gl_MultiTexCoord@normalMapUV).xy;
     passTangent = gl_MultiTexCoord7.xyzw;
+#if @instancing
+    passTangent.xyz = passTangent.xyz * instanceRotation;
+#endif
 #endif
 
 #if @specularMap
@@ -98,5 +117,5 @@ void main(void)
     passColor = gl_Color;
 #endif
     passViewPos = viewPos.xyz;
-    passNormal = gl_Normal.xyz;
+    passNormal = normal.xyz;
 }